@@ -0,0 +1,121 @@
+#include "benchCorpus.hpp"
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <mutex>
+#include <random>
+#include <stdexcept>
+
+namespace {
+
+///< Bumped whenever the generated bytes change, so corpora on disk are regenerated.
+constexpr int kGeneratorVersion = 1;
+constexpr std::size_t kFilesPerDirectory = 100;
+
+const char* const kLevels[] = {"INFO", "INFO", "INFO", "DEBUG", "WARN", "ERROR"};
+const char* const kWords[] = {"request", "served", "in", "ms", "user", "session", "cache", "miss", "warning",
+                              "retry", "worker", "queue", "flush", "GET", "POST", "200", "404",
+                              "/api/v1/items", "timeout", "error"};
+
+/// Appends log-like lines until the text holds at least `size` bytes; counts the needles planted.
+void appendLines(std::string& text, std::size_t size, std::size_t needleEvery, std::mt19937& rng,
+                 std::size_t& needles) {
+    std::uniform_int_distribution<std::size_t> level(0, std::size(kLevels) - 1);
+    std::uniform_int_distribution<std::size_t> word(0, std::size(kWords) - 1);
+    std::uniform_int_distribution<int> wordCount(6, 14);
+    std::uniform_int_distribution<std::size_t> needleDraw(1, needleEvery > 0 ? needleEvery : 1);
+    for (std::size_t line = 0; text.size() < size; ++line) {
+        text += std::to_string(1700000000 + line);
+        text += ' ';
+        text += kLevels[level(rng)];
+        const int words = wordCount(rng);
+        const bool needle = needleEvery > 0 && needleDraw(rng) == 1;
+        const int needleAt = needle ? words / 2 : -1;
+        for (int w = 0; w < words; ++w) {
+            text += ' ';
+            text += w == needleAt ? kNeedle : kWords[word(rng)];
+        }
+        text += '\n';
+        needles += needle;
+    }
+}
+
+/// The stamp file of a corpus, next to its directory so it is not searched.
+std::filesystem::path stampPath(const std::filesystem::path& root) {
+    return root.parent_path() / (root.filename().string() + ".corpus");
+}
+
+std::filesystem::path filePath(const CorpusSpec& spec, const std::filesystem::path& root, std::size_t index) {
+    if (spec.files == 1)
+        return root / "huge.log";
+    const std::size_t outer = index / (kFilesPerDirectory * kFilesPerDirectory);
+    const std::size_t inner = index / kFilesPerDirectory % kFilesPerDirectory;
+    return root / ("d" + std::to_string(outer)) / ("d" + std::to_string(inner)) / ("f" + std::to_string(index) + ".log");
+}
+
+Corpus generate(const CorpusSpec& spec, const std::filesystem::path& root) {
+    std::filesystem::remove(stampPath(root));
+    std::filesystem::remove_all(root);
+    std::filesystem::create_directories(root);
+
+    Corpus corpus;
+    corpus.root = root;
+    std::mt19937 rng(spec.seed);
+    std::uniform_int_distribution<std::size_t> size(spec.fileSize / 2, spec.fileSize + spec.fileSize / 2);
+    std::string text;
+    for (std::size_t i = 0; i < spec.files; ++i) {
+        text.clear();
+        if (spec.binaryEvery > 0 && i % spec.binaryEvery == 0)
+            text.assign("\x7F" "ELF\2\1\1\0\0\0\0\0\0\0\0\0", 16);
+        appendLines(text, spec.files == 1 ? spec.fileSize : size(rng), spec.needleEvery, rng, corpus.needles);
+
+        const std::filesystem::path path = filePath(spec, root, i);
+        std::filesystem::create_directories(path.parent_path());
+        std::ofstream out(path, std::ios::binary);
+        out.write(text.data(), static_cast<std::streamsize>(text.size()));
+        if (!out)
+            throw std::runtime_error("could not write " + path.string());
+        ++corpus.files;
+        corpus.bytes += text.size();
+    }
+
+    // Written last: a corpus without a stamp is incomplete and generated again.
+    std::ofstream stamp(stampPath(root));
+    stamp << spec.describe() << '\n' << corpus.files << ' ' << corpus.bytes << ' ' << corpus.needles << '\n';
+    return corpus;
+}
+
+/// The corpus recorded by the stamp file of `root`, if it was generated from the same spec.
+bool reuse(const CorpusSpec& spec, const std::filesystem::path& root, Corpus& corpus) {
+    std::ifstream stamp(stampPath(root));
+    std::string description;
+    if (!std::getline(stamp, description) || description != spec.describe())
+        return false;
+    corpus.root = root;
+    return static_cast<bool>(stamp >> corpus.files >> corpus.bytes >> corpus.needles);
+}
+
+}  // namespace
+
+std::string CorpusSpec::describe() const {
+    return name + " files=" + std::to_string(files) + " fileSize=" + std::to_string(fileSize) +
+           " needleEvery=" + std::to_string(needleEvery) + " binaryEvery=" + std::to_string(binaryEvery) +
+           " seed=" + std::to_string(seed) + " version=" + std::to_string(kGeneratorVersion);
+}
+
+const Corpus& corpus(const CorpusSpec& spec) {
+    static std::mutex mutex;
+    static std::map<std::string, Corpus> corpora;
+    std::lock_guard<std::mutex> lock(mutex);
+    if (const auto found = corpora.find(spec.name); found != corpora.end())
+        return found->second;
+
+    const char* base = std::getenv("FILESEARCHER_BENCH_DIR");
+    const std::filesystem::path root =
+        (base ? std::filesystem::path(base) : std::filesystem::temp_directory_path() / "fileSearcherBench") / spec.name;
+    Corpus generated;
+    if (!reuse(spec, root, generated))
+        generated = generate(spec, root);
+    return corpora.emplace(spec.name, std::move(generated)).first->second;
+}
@@ -0,0 +1,51 @@
+#ifndef BENCHCORPUS_HPP
+#define BENCHCORPUS_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+
+/**
+ * @brief The shape of a synthetic corpus: how many files, how large, how often lines match.
+ */
+struct CorpusSpec {
+    std::string name;                   ///< Directory of the corpus; unique per spec.
+    std::size_t files = 1;
+    std::size_t fileSize = 0;           ///< Average bytes per file.
+    std::size_t needleEvery = 0;        ///< One line in this many contains kNeedle (0: none).
+    std::size_t binaryEvery = 0;        ///< One file in this many is binary: NUL bytes up front (0: none).
+    std::uint32_t seed = 1;
+
+    /// One line describing the spec; a corpus on disk is reused only if its description matches.
+    std::string describe() const;
+};
+
+/**
+ * @brief A generated corpus on disk.
+ */
+struct Corpus {
+    std::filesystem::path root;         ///< The directory to search.
+    std::size_t files = 0;
+    std::size_t bytes = 0;
+    std::size_t needles = 0;            ///< Lines containing kNeedle, in text and binary files.
+};
+
+///< The token planted in the matching lines of every corpus.
+inline constexpr const char* kNeedle = "TimeoutError";
+
+/**
+ * @brief The corpus of a spec, generated on first use.
+ *
+ * Generation is deterministic: the same spec always yields the same bytes, so runs on
+ * different commits search identical data. Lines are log-like, built from a small fixed
+ * vocabulary in which kNeedle only appears where it is planted. Trees put at most 100 files in
+ * a directory, two levels deep.
+ *
+ * Corpora live below $FILESEARCHER_BENCH_DIR, or `fileSearcherBench` in the temporary
+ * directory, and are kept: a later run reuses a corpus whose stamp file (`<name>.corpus`, next
+ * to it) records the same spec, so only the first run pays for writing it.
+ */
+const Corpus& corpus(const CorpusSpec& spec);
+
+#endif  // BENCHCORPUS_HPP
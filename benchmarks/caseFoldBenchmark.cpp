@@ -0,0 +1,72 @@
+#include <benchmark/benchmark.h>
+#include "caseFoldMatcher.hpp"
+#include <algorithm>
+#include <random>
+#include <sstream>
+#include <string>
+
+namespace {
+
+/// About 8 MiB of log-like lines; `needleEvery` controls how often a line contains the needle.
+std::string makeText(const std::string& needle, int needleEvery) {
+    static const char* const words[] = {"request", "served", "in", "ms", "user", "session",
+                                        "cache", "miss", "warning", "retry", "timeout", "ok"};
+    std::mt19937 rng(1234);
+    std::uniform_int_distribution<int> pick(0, 11);
+    std::string text;
+    for (int line = 0; text.size() < (8u << 20); ++line) {
+        for (int w = 0; w < 10; ++w) {
+            text += words[pick(rng)];
+            text += ' ';
+        }
+        if (line % needleEvery == 0) {
+            text += needle;
+        }
+        text += '\n';
+    }
+    return text;
+}
+
+/// The previous case-insensitive path: copy each line, lower it with ::tolower, then find.
+void BM_CaseInsensitive_LoweredCopy(benchmark::State& state, const std::string& query, const std::string& inText) {
+    const std::string text = makeText(inText, 1000);
+    std::string loweredQuery = query;
+    std::transform(loweredQuery.begin(), loweredQuery.end(), loweredQuery.begin(), ::tolower);
+
+    for (auto _ : state) {
+        std::istringstream input(text);
+        std::string line;
+        size_t matches = 0;
+        while (std::getline(input, line)) {
+            std::string loweredLine = line;
+            std::transform(loweredLine.begin(), loweredLine.end(), loweredLine.begin(), ::tolower);
+            matches += loweredLine.find(loweredQuery) != std::string::npos;
+        }
+        benchmark::DoNotOptimize(matches);
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) * static_cast<int64_t>(text.size()));
+}
+
+/// The folding matcher scanning the whole buffer in place.
+void BM_CaseInsensitive_FoldMatcher(benchmark::State& state, const std::string& query, const std::string& inText) {
+    const std::string text = makeText(inText, 1000);
+    const CaseFoldMatcher matcher(query);
+
+    for (auto _ : state) {
+        size_t matches = 0;
+        size_t pos = 0;
+        while (auto match = matcher.find(text, pos)) {
+            ++matches;
+            pos = match.position + std::max<size_t>(match.length, 1);
+        }
+        benchmark::DoNotOptimize(matches);
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) * static_cast<int64_t>(text.size()));
+}
+
+}  // namespace
+
+BENCHMARK_CAPTURE(BM_CaseInsensitive_LoweredCopy, ascii, std::string("Deadlock"), std::string("DEADLOCK"));
+BENCHMARK_CAPTURE(BM_CaseInsensitive_FoldMatcher, ascii, std::string("Deadlock"), std::string("DEADLOCK"));
+BENCHMARK_CAPTURE(BM_CaseInsensitive_LoweredCopy, utf8, std::string("Ошибка"), std::string("ОШИБКА"));
+BENCHMARK_CAPTURE(BM_CaseInsensitive_FoldMatcher, utf8, std::string("Ошибка"), std::string("ОШИБКА"));
@@ -0,0 +1,108 @@
+#include <benchmark/benchmark.h>
+#include "benchCorpus.hpp"
+#include "grepLikeUtility.hpp"
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+
+namespace {
+
+/// The corpora searched end to end, from many small files to one huge file.
+enum class Scenario { SmallFiles, HugeFileSparse, HugeFileDense, BinaryTree };
+
+/// The kinds of query, each taking a different matching path.
+enum class Engine { Literal, CaseInsensitive, Regex };
+
+const CorpusSpec& spec(Scenario scenario) {
+    static const CorpusSpec specs[] = {
+        {.name = "smallFiles", .files = 20000, .fileSize = 2 * 1024, .needleEvery = 500, .seed = 1},
+        {.name = "hugeFileSparse", .files = 1, .fileSize = 128 << 20, .needleEvery = 100000, .seed = 2},
+        {.name = "hugeFileDense", .files = 1, .fileSize = 128 << 20, .needleEvery = 4, .seed = 3},
+        {.name = "binaryTree", .files = 4000, .fileSize = 16 * 1024, .needleEvery = 500, .binaryEvery = 2, .seed = 4},
+    };
+    return specs[static_cast<int>(scenario)];
+}
+
+/// Counts the results instead of printing them, so the benchmark measures the search alone.
+class CountingSink : public ResultSink {
+public:
+    void consume(std::vector<SearchResult>& results, const std::string& /*threadIdStr*/) override {
+        count.fetch_add(results.size(), std::memory_order_relaxed);
+    }
+
+    std::atomic<size_t> count{0};
+};
+
+/// Records the corpus specs in the JSON output, so results of different runs can be matched up.
+const bool kContextAdded = [] {
+    for (const Scenario scenario :
+         {Scenario::SmallFiles, Scenario::HugeFileSparse, Scenario::HugeFileDense, Scenario::BinaryTree})
+        benchmark::AddCustomContext("corpus." + spec(scenario).name, spec(scenario).describe());
+    return true;
+}();
+
+/**
+ * @brief Searches a whole corpus through SearchManager with `state.range(0)` worker threads.
+ *
+ * Reports GB/s, files/s and the results per search, which checks that the corpus is intact.
+ * The corpus is in the page cache after the first iteration, so this is warm-cache throughput.
+ */
+void BM_Search(benchmark::State& state, Scenario scenario, Engine engine) {
+    const Corpus& data = corpus(spec(scenario));
+    std::string query = kNeedle;
+    if (engine == Engine::CaseInsensitive)
+        std::transform(query.begin(), query.end(), query.begin(), ::tolower);
+    else if (engine == Engine::Regex)
+        query = "Timeout[A-Z][a-z]+r";
+
+    auto sink = std::make_shared<CountingSink>();
+    SearchManager manager(std::make_unique<TextFileSearcher>(), query, engine != Engine::CaseInsensitive, false,
+                          engine == Engine::Regex);
+    manager.setNumThreads(static_cast<size_t>(state.range(0)));
+    manager.setResultSink(sink);
+
+    for (auto _ : state)
+        manager.searchInDirectory(data.root);
+
+    const auto iterations = static_cast<double>(state.iterations());
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) * static_cast<int64_t>(data.bytes));
+    state.counters["GB_per_second"] =
+        benchmark::Counter(static_cast<double>(data.bytes) / 1e9, benchmark::Counter::kIsIterationInvariantRate);
+    state.counters["files_per_second"] =
+        benchmark::Counter(static_cast<double>(data.files), benchmark::Counter::kIsIterationInvariantRate);
+    state.counters["results"] = static_cast<double>(sink->count.load()) / iterations;
+}
+
+/// 1, 2, 4, ... worker threads up to the hardware concurrency.
+void threadCounts(benchmark::internal::Benchmark* benchmark) {
+    const int hardware = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+    benchmark->ArgName("threads");
+    for (int threads = 1; threads < hardware; threads *= 2)
+        benchmark->Arg(threads);
+    benchmark->Arg(hardware);
+    benchmark->UseRealTime()->Unit(benchmark::kMillisecond);
+}
+
+}  // namespace
+
+BENCHMARK_CAPTURE(BM_Search, smallFiles_literal, Scenario::SmallFiles, Engine::Literal)->Apply(threadCounts);
+BENCHMARK_CAPTURE(BM_Search, smallFiles_caseInsensitive, Scenario::SmallFiles, Engine::CaseInsensitive)
+    ->Apply(threadCounts);
+BENCHMARK_CAPTURE(BM_Search, smallFiles_regex, Scenario::SmallFiles, Engine::Regex)->Apply(threadCounts);
+
+BENCHMARK_CAPTURE(BM_Search, hugeFileSparse_literal, Scenario::HugeFileSparse, Engine::Literal)->Apply(threadCounts);
+BENCHMARK_CAPTURE(BM_Search, hugeFileSparse_caseInsensitive, Scenario::HugeFileSparse, Engine::CaseInsensitive)
+    ->Apply(threadCounts);
+BENCHMARK_CAPTURE(BM_Search, hugeFileSparse_regex, Scenario::HugeFileSparse, Engine::Regex)->Apply(threadCounts);
+
+BENCHMARK_CAPTURE(BM_Search, hugeFileDense_literal, Scenario::HugeFileDense, Engine::Literal)->Apply(threadCounts);
+BENCHMARK_CAPTURE(BM_Search, hugeFileDense_caseInsensitive, Scenario::HugeFileDense, Engine::CaseInsensitive)
+    ->Apply(threadCounts);
+BENCHMARK_CAPTURE(BM_Search, hugeFileDense_regex, Scenario::HugeFileDense, Engine::Regex)->Apply(threadCounts);
+
+BENCHMARK_CAPTURE(BM_Search, binaryTree_literal, Scenario::BinaryTree, Engine::Literal)->Apply(threadCounts);
+BENCHMARK_CAPTURE(BM_Search, binaryTree_caseInsensitive, Scenario::BinaryTree, Engine::CaseInsensitive)
+    ->Apply(threadCounts);
+BENCHMARK_CAPTURE(BM_Search, binaryTree_regex, Scenario::BinaryTree, Engine::Regex)->Apply(threadCounts);
@@ -0,0 +1,33 @@
+# ---------------------------------------------------------------------------------------
+# Google Benchmark Setup via FetchContent
+#
+# Same layout as the GoogleTest setup in testing.cmake: sources and build tree live under
+# `external/` inside the build directory. Only pulled in when BUILD_BENCHMARKS is ON.
+#
+# The resulting target (`benchmark::benchmark`) can be linked with the benchmark suite.
+# ---------------------------------------------------------------------------------------
+include(FetchContent)
+
+set(EXTERNAL_LOCATION ${CMAKE_BINARY_DIR}/external)
+set(BENCHMARK_LOCATION ${EXTERNAL_LOCATION}/benchmark)
+set(BENCHMARK_ALL_BINARY_DIR ${BENCHMARK_LOCATION}/benchmark-build)
+
+# Reuse the GoogleTest fetched for the unit tests instead of letting benchmark fetch its own
+set(BENCHMARK_ENABLE_TESTING OFF CACHE BOOL "" FORCE)
+set(BENCHMARK_ENABLE_GTEST_TESTS OFF CACHE BOOL "" FORCE)
+set(BENCHMARK_ENABLE_INSTALL OFF CACHE BOOL "" FORCE)
+
+FetchContent_Declare(
+  benchmark
+  GIT_REPOSITORY https://github.com/google/benchmark.git
+  GIT_TAG        v1.8.3
+  SOURCE_DIR     ${BENCHMARK_LOCATION}/benchmark-src
+  BINARY_DIR     ${BENCHMARK_ALL_BINARY_DIR}
+  SUBBUILD_DIR   ${BENCHMARK_LOCATION}/benchmark-subbuild
+)
+
+FetchContent_GetProperties(benchmark)
+if(NOT benchmark_POPULATED)
+  FetchContent_Populate(benchmark)
+  add_subdirectory(${benchmark_SOURCE_DIR} ${BENCHMARK_ALL_BINARY_DIR} EXCLUDE_FROM_ALL)
+endif()
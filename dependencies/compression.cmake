@@ -0,0 +1,31 @@
+# ---------------------------------------------------------------------------------------
+# Compression Libraries (optional)
+#
+# CompressedFileSearcher decompresses gzip (zlib), xz (liblzma) and zstd (libzstd) files
+# with the system libraries. Every library that is found is linked into the target and
+# enabled with a public FILESEARCHER_HAVE_<NAME> definition, so the tests see it too; files
+# in a format whose library is missing are searched as they are (i.e. as binary files).
+# ---------------------------------------------------------------------------------------
+function(add_compression_support target)
+  find_package(ZLIB)
+  if(ZLIB_FOUND)
+    target_link_libraries(${target} PUBLIC ZLIB::ZLIB)
+    target_compile_definitions(${target} PUBLIC FILESEARCHER_HAVE_ZLIB)
+  endif()
+
+  find_package(LibLZMA)
+  if(LIBLZMA_FOUND)
+    target_link_libraries(${target} PUBLIC LibLZMA::LibLZMA)
+    target_compile_definitions(${target} PUBLIC FILESEARCHER_HAVE_LZMA)
+  endif()
+
+  find_path(ZSTD_INCLUDE_DIR zstd.h)
+  find_library(ZSTD_LIBRARY NAMES zstd)
+  if(ZSTD_INCLUDE_DIR AND ZSTD_LIBRARY)
+    target_include_directories(${target} PUBLIC ${ZSTD_INCLUDE_DIR})
+    target_link_libraries(${target} PUBLIC ${ZSTD_LIBRARY})
+    target_compile_definitions(${target} PUBLIC FILESEARCHER_HAVE_ZSTD)
+  endif()
+
+  message(STATUS "Compressed file search: gzip=${ZLIB_FOUND} xz=${LIBLZMA_FOUND} zstd=${ZSTD_LIBRARY}")
+endfunction()
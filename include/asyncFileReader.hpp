@@ -0,0 +1,138 @@
+#ifndef ASYNCFILEREADER_HPP
+#define ASYNCFILEREADER_HPP
+
+#include "bufferPool.hpp"
+#include "fileBuffer.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <vector>
+
+/**
+ * @brief How SearchManager reads the files it searches.
+ */
+enum class IoBackend {
+    Sync,       ///< Each worker opens and reads the file it searches.
+    Uring,      ///< Small files are read ahead by an AsyncFileReader; see SearchManager::setIoBackend().
+};
+
+/**
+ * @brief Reads many small files at once with io_uring, so the device queue never runs dry.
+ *
+ * Files are added by path and come back, read into a FileBuffer, in the order their reads
+ * complete. With io_uring, add() only prepares a statx submission. take() submits everything
+ * prepared in one system call and moves every file whose step completed on to the next:
+ * statx, then openat, then a read of the whole file, so files that are not read are never
+ * opened. Up to `depth` files are in flight or waiting to be taken at a time, so a tree of thousands of
+ * small files keeps that many requests queued on the device instead of one per searching thread.
+ *
+ * Only regular files smaller than `maxSize` are read; the others come back unread, for the
+ * caller to search the usual way (streamed, mapped or split). Errors are reported with the
+ * errno of the failed call.
+ *
+ * Without io_uring (not Linux, a kernel without the needed operations, or io_uring disabled
+ * by a sandbox), add() reads the file at once with stat, open and pread: the results are the
+ * same, only nothing overlaps.
+ *
+ * With a BufferPool, the blocks are taken from the pool and charged to it as they are
+ * reserved; whoever takes a file hands its buffer back with BufferPool::recycle().
+ *
+ * One thread drives the reader: it calls add(), take() and pending() from the same thread.
+ * The ring is driven by raw system calls, so no library is needed.
+ */
+class AsyncFileReader {
+public:
+    ///< Files in flight or waiting to be taken by default.
+    static constexpr std::size_t kDefaultDepth = 64;
+
+    /// A file that was added, read or not.
+    struct File {
+        std::filesystem::path path;
+        FileBuffer buffer;      ///< The contents, if `loaded`.
+        bool loaded = false;    ///< Whether the file was read: a regular file below the size limit.
+        int error = 0;          ///< errno of the open, stat or read that failed; 0 on success.
+        std::size_t charged = 0;    ///< Bytes charged to the BufferPool for `buffer`.
+    };
+
+    /**
+     * @brief Constructor; sets up the ring unless told not to.
+     *
+     * @param depth    Files in flight or waiting to be taken at most (at least 1).
+     * @param maxSize  Files at least this large come back unread.
+     * @param useUring Whether to use io_uring where it is available; false reads with pread.
+     * @param buffers  Pool to take the blocks from and charge them to; nullptr allocates them.
+     */
+    explicit AsyncFileReader(std::size_t depth = kDefaultDepth, std::size_t maxSize = FileBuffer::kMapThreshold,
+                             bool useUring = true, BufferPool* buffers = nullptr);
+
+    /**
+     * @brief Waits for the reads still in flight (their buffers are written by the kernel) and closes the ring.
+     *
+     * The buffers of files not taken go back to the pool.
+     */
+    ~AsyncFileReader();
+
+    AsyncFileReader(const AsyncFileReader&) = delete;
+    AsyncFileReader& operator=(const AsyncFileReader&) = delete;
+
+    /**
+     * @brief Whether this system can set up an io_uring with the operations the reader needs.
+     */
+    static bool uringAvailable();
+
+    /**
+     * @brief Whether this reader overlaps its reads with io_uring, or reads with pread.
+     */
+    bool usesUring() const { return ring_ != nullptr; }
+
+    /**
+     * @brief Starts reading a file. Must not be called while full().
+     */
+    void add(std::filesystem::path path);
+
+    /**
+     * @brief Takes a file whose read is done, in completion order.
+     *
+     * Submits what add() prepared first.
+     *
+     * @param file Receives the file.
+     * @param wait Whether to wait for a read to complete if none is done yet.
+     * @return false if no file was done (and, when waiting, none is pending).
+     */
+    bool take(File& file, bool wait);
+
+    /**
+     * @brief Files added and not taken yet.
+     */
+    std::size_t pending() const { return slots_.size() - free_.size(); }
+
+    bool full() const { return free_.empty(); }
+
+    std::size_t depth() const { return slots_.size(); }
+
+private:
+    struct Ring;
+    struct Slot;
+
+    char* reserve(Slot& slot, std::size_t capacity, std::size_t keep = 0);
+    void readNow(Slot& slot);
+    void submitOpen(std::size_t index);
+    void submitRead(std::size_t index);
+    void complete(std::uint64_t userData, int result);
+    void finish(std::size_t index);
+    bool enter(unsigned minComplete);
+    void reap();
+
+    std::size_t maxSize_;
+    BufferPool* buffers_;
+    std::vector<std::unique_ptr<Slot>> slots_;
+    std::vector<std::size_t> free_;
+    std::deque<std::size_t> done_;          ///< Slots whose file is done, in completion order.
+    std::unique_ptr<Ring> ring_;            ///< nullptr: reads with pread.
+    std::size_t inFlight_ = 0;              ///< Operations submitted or prepared, not completed yet.
+};
+
+#endif  // ASYNCFILEREADER_HPP
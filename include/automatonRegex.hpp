@@ -0,0 +1,109 @@
+#ifndef AUTOMATONREGEX_HPP
+#define AUTOMATONREGEX_HPP
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "matchSpan.hpp"
+
+/**
+ * @brief Thrown by AutomatonRegex for syntax errors and unsupported constructs.
+ */
+class RegexError : public std::runtime_error {
+public:
+    using std::runtime_error::runtime_error;
+};
+
+/**
+ * @brief Linear-time regex engine for line-oriented search.
+ *
+ * The pattern (an ECMAScript subset: literals, `.`, classes, `\d\w\s` and their negations,
+ * groups, alternation, greedy and lazy `* + ? {n,m}`, `^ $ \b \B`) is compiled to a Thompson
+ * NFA. Matching never backtracks, so its cost is bounded by (line length x program size)
+ * regardless of the pattern:
+ *
+ * - search() decides whether a line contains a match with a DFA that is built lazily from the
+ *   NFA, one state and one transition at a time, and cached per thread. If the cache grows too
+ *   large it is flushed and rebuilt on demand.
+ * - find() reports the exact leftmost-first span (ECMAScript semantics, honouring lazy
+ *   quantifiers) with a Pike VM simulation of the same NFA.
+ *
+ * Matching is byte-oriented like std::regex over char: `.` matches any byte except '\\n' and
+ * '\\r', and case-insensitive matching folds ASCII letters only. Backreferences and lookaround
+ * cannot be run in linear time and are rejected with a RegexError.
+ *
+ * requiredLiteral() is a string every match must contain; callers use it as a prefilter to
+ * skip regions of a buffer before running the automaton.
+ *
+ * Instances are immutable after construction and can be shared between threads.
+ */
+class AutomatonRegex {
+public:
+    /**
+     * @brief Parses and compiles the pattern.
+     *
+     * @param pattern       The regular expression.
+     * @param caseSensitive Whether matching should be case-sensitive.
+     * @throws RegexError on invalid or unsupported syntax.
+     */
+    AutomatonRegex(std::string_view pattern, bool caseSensitive);
+
+    /**
+     * @brief Whether the line (without its terminating newline) contains a match.
+     */
+    bool search(std::string_view line) const;
+
+    /**
+     * @brief Leftmost-first match starting at or after `from`.
+     *
+     * Bytes before `from` are still used as context for `\b` and `^`, like
+     * std::regex_constants::match_prev_avail.
+     */
+    MatchSpan find(std::string_view line, std::size_t from = 0) const;
+
+    /// A string every match contains (ASCII-case-insensitively if !caseSensitive); may be empty.
+    const std::string& requiredLiteral() const { return requiredLiteral_; }
+
+    bool caseSensitive() const { return caseSensitive_; }
+
+    /// Number of NFA instructions.
+    std::size_t programSize() const { return program_.size(); }
+
+    /// Upper bound on NFA instructions; larger patterns (e.g. huge counted repeats) are rejected.
+    static constexpr std::size_t kMaxProgramSize = 100000;
+
+    /// DFA states kept per thread before the cache is flushed.
+    static constexpr std::size_t kMaxDfaStates = 4096;
+
+    enum class AssertKind : std::uint8_t { LineStart, LineEnd, WordBoundary, NotWordBoundary };
+
+    enum class Op : std::uint8_t { ByteSet, Split, Jump, Assert, Match };
+
+    struct Instruction {
+        Op op;
+        AssertKind assertKind = AssertKind::LineStart;
+        std::uint32_t x = 0;   ///< ByteSet: set index; Split/Jump: first target.
+        std::uint32_t y = 0;   ///< Split: second (lower priority) target.
+    };
+
+    using ByteSet = std::array<std::uint64_t, 4>;
+
+private:
+    friend class AutomatonDfa;
+
+    std::vector<Instruction> program_;
+    std::vector<ByteSet> sets_;
+    std::array<std::uint8_t, 256> byteClass_{};  ///< Bytes no ByteSet distinguishes share a class.
+    std::size_t classCount_ = 1;
+    bool caseSensitive_;
+    bool startNeedsLineStart_ = false;           ///< Every match must begin with `^`.
+    std::string requiredLiteral_;
+    std::uint64_t id_;                           ///< Distinguishes instances in per-thread caches.
+};
+
+#endif  // AUTOMATONREGEX_HPP
@@ -0,0 +1,105 @@
+#ifndef BOUNDEDQUEUE_HPP
+#define BOUNDEDQUEUE_HPP
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <utility>
+
+/**
+ * @brief Blocking multi-producer, multi-consumer FIFO with a fixed capacity.
+ *
+ * Producers block while the queue is full, which bounds memory when they run ahead of the
+ * consumers; consumers block while it is empty. close() wakes everyone: pushes then fail and
+ * pops drain what is left before failing.
+ *
+ * @tparam T The element type.
+ */
+template <typename T>
+class BoundedQueue {
+public:
+    /**
+     * @brief Constructor.
+     *
+     * @param capacity Maximum number of queued elements (at least 1).
+     */
+    explicit BoundedQueue(std::size_t capacity) : capacity_(std::max<std::size_t>(capacity, 1)) {}
+
+    /**
+     * @brief Appends an element, waiting for room if the queue is full.
+     *
+     * @return false if the queue was closed (the element is dropped).
+     */
+    bool push(T value) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        notFull_.wait(lock, [this] { return closed_ || items_.size() < capacity_; });
+        if (closed_)
+            return false;
+        items_.push_back(std::move(value));
+        lock.unlock();
+        notEmpty_.notify_one();
+        return true;
+    }
+
+    /**
+     * @brief Removes the oldest element, waiting for one if the queue is empty.
+     *
+     * @return false once the queue is closed and empty.
+     */
+    bool pop(T& value) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        notEmpty_.wait(lock, [this] { return closed_ || !items_.empty(); });
+        if (items_.empty())
+            return false;
+        value = std::move(items_.front());
+        items_.pop_front();
+        lock.unlock();
+        notFull_.notify_one();
+        return true;
+    }
+
+    /// Outcome of tryPop().
+    enum class PopResult { Popped, Empty, Closed };
+
+    /**
+     * @brief Removes the oldest element if there is one, without waiting.
+     *
+     * @return Popped, Empty while the queue is open but empty, or Closed once it is closed and empty.
+     */
+    PopResult tryPop(T& value) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        if (items_.empty())
+            return closed_ ? PopResult::Closed : PopResult::Empty;
+        value = std::move(items_.front());
+        items_.pop_front();
+        lock.unlock();
+        notFull_.notify_one();
+        return PopResult::Popped;
+    }
+
+    /**
+     * @brief Rejects further pushes and wakes all waiting producers and consumers.
+     */
+    void close() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            closed_ = true;
+        }
+        notFull_.notify_all();
+        notEmpty_.notify_all();
+    }
+
+    std::size_t capacity() const { return capacity_; }
+
+private:
+    std::size_t capacity_;
+    std::deque<T> items_;
+    bool closed_ = false;
+    std::mutex mutex_;
+    std::condition_variable notFull_;
+    std::condition_variable notEmpty_;
+};
+
+#endif  // BOUNDEDQUEUE_HPP
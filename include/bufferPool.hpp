@@ -0,0 +1,113 @@
+#ifndef BUFFERPOOL_HPP
+#define BUFFERPOOL_HPP
+
+#include "fileBuffer.hpp"
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <vector>
+
+/**
+ * @brief Recycles the blocks of FileBuffers and keeps the memory of the files in flight within a budget.
+ *
+ * Buffers handed back with recycle() keep their block (up to kMaxPooledCapacity) and are
+ * handed out again by acquire(), so reading thousands of small files does not allocate and
+ * free a block per file. At most `maxIdle` blocks are kept.
+ *
+ * Independently, holders charge the memory of the buffers they fill with account() and
+ * release it when they are done with them. waitForRoom() blocks while the charged bytes are
+ * at or above the limit, so the stage that starts reading more files (and through its
+ * bounded queues, the directory walk) waits until the files in flight are searched. Only
+ * that stage waits; charging never blocks, so a file larger than the limit is still read.
+ * Idle blocks are not charged: they are bounded by `maxIdle`.
+ *
+ * All members are thread safe.
+ */
+class BufferPool {
+public:
+    ///< Largest block kept for reuse: the block of a file just below FileBuffer::kMapThreshold.
+    static constexpr std::size_t kMaxPooledCapacity = FileBuffer::kMapThreshold + FileBuffer::kBlockSize;
+    ///< Idle blocks kept by default.
+    static constexpr std::size_t kDefaultMaxIdle = 64;
+
+    /**
+     * @brief Constructor.
+     *
+     * @param memoryLimit Charged bytes at which waitForRoom() blocks (0: no limit).
+     * @param maxIdle     Idle blocks kept at most.
+     */
+    explicit BufferPool(std::size_t memoryLimit = 0, std::size_t maxIdle = kDefaultMaxIdle)
+        : limit_(memoryLimit), maxIdle_(maxIdle) {}
+
+    BufferPool(const BufferPool&) = delete;
+    BufferPool& operator=(const BufferPool&) = delete;
+
+    /**
+     * @brief An empty buffer, with the block of a recycled one if there is one.
+     */
+    FileBuffer acquire();
+
+    /**
+     * @brief Takes a buffer back for reuse and releases the bytes charged for it.
+     *
+     * @param buffer  The buffer; its contents are discarded, its block is kept if it is not too large.
+     * @param charged What account() charged for the buffer.
+     */
+    void recycle(FileBuffer buffer, std::size_t charged = 0);
+
+    /**
+     * @brief Charges (or releases) the difference between the buffer's memory and what was charged for it.
+     *
+     * Mapped buffers count with their size, as their pages are resident while they are
+     * searched; read buffers with the capacity of their block.
+     *
+     * @param buffer  The buffer, after it was filled.
+     * @param charged What was charged for the buffer so far; updated.
+     */
+    void account(const FileBuffer& buffer, std::size_t& charged);
+
+    /**
+     * @brief Charges memory held outside of a FileBuffer.
+     */
+    void charge(std::size_t bytes);
+
+    /**
+     * @brief Releases charged memory.
+     */
+    void release(std::size_t bytes);
+
+    /**
+     * @brief Blocks while the charged bytes are at or above the limit.
+     */
+    void waitForRoom();
+
+    /**
+     * @brief Whether waitForRoom() would return at once.
+     */
+    bool hasRoom() const;
+
+    std::size_t limit() const { return limit_; }
+
+    /// Bytes charged now.
+    std::size_t inUse() const;
+
+    /// The most bytes charged at once.
+    std::size_t peak() const;
+
+    /// Blocks kept for reuse.
+    std::size_t idle() const;
+
+private:
+    void releaseLocked(std::size_t bytes);
+
+    const std::size_t limit_;
+    const std::size_t maxIdle_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable hasRoom_;
+    std::vector<FileBuffer> idle_;
+    std::size_t inUse_ = 0;
+    std::size_t peak_ = 0;
+};
+
+#endif  // BUFFERPOOL_HPP
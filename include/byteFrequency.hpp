@@ -0,0 +1,46 @@
+#ifndef BYTEFREQUENCY_HPP
+#define BYTEFREQUENCY_HPP
+
+#include <array>
+#include <cstdint>
+
+namespace detail {
+
+/**
+ * @brief Approximate byte frequency ranks for text and source files (higher = more common).
+ *
+ * Only the relative order matters: matchers use it to pick the needle bytes least likely to
+ * produce false candidates.
+ */
+constexpr std::array<std::uint8_t, 256> makeByteRanks() {
+    std::array<std::uint8_t, 256> ranks{};
+    for (int c = 0; c < 256; ++c) {
+        ranks[c] = c < 0x20 ? 10 : (c < 0x80 ? 60 : 30);
+    }
+    constexpr const char* lower = "etaoinsrhldcumfpgwybvkxjqz";
+    for (int i = 0; lower[i] != '\0'; ++i) {
+        ranks[static_cast<unsigned char>(lower[i])] = static_cast<std::uint8_t>(250 - i * 4);
+        ranks[static_cast<unsigned char>(lower[i] - 'a' + 'A')] = static_cast<std::uint8_t>(140 - i * 3);
+    }
+    for (int c = '0'; c <= '9'; ++c) {
+        ranks[c] = 120;
+    }
+    ranks[static_cast<unsigned char>(' ')] = 255;
+    ranks[static_cast<unsigned char>('\n')] = 170;
+    ranks[static_cast<unsigned char>('\t')] = 110;
+    for (char c : {'.', ',', '_', '-', '(', ')', ';', '"', '/', '=', ':', '\''}) {
+        ranks[static_cast<unsigned char>(c)] = 130;
+    }
+    return ranks;
+}
+
+inline constexpr std::array<std::uint8_t, 256> kByteRanks = makeByteRanks();
+
+}  // namespace detail
+
+/// Frequency rank of a byte in typical text; lower means rarer.
+constexpr std::uint8_t byteRank(unsigned char byte) {
+    return detail::kByteRanks[byte];
+}
+
+#endif  // BYTEFREQUENCY_HPP
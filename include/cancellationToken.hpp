@@ -0,0 +1,56 @@
+#ifndef CANCELLATIONTOKEN_HPP
+#define CANCELLATIONTOKEN_HPP
+
+#include <atomic>
+#include <chrono>
+
+/**
+ * @brief Shared flag telling the tasks of one search to stop, set explicitly or by a deadline.
+ *
+ * Tasks poll cancelled() between units of work (a file, a range of a large file); it is cheap
+ * enough to call per file. The deadline must be set before the token is shared.
+ */
+class CancellationToken {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    /**
+     * @brief Cancels the search; every later cancelled() returns true.
+     */
+    void cancel() { cancelled_.store(true, std::memory_order_relaxed); }
+
+    /**
+     * @brief Cancels the search automatically once the time point has passed.
+     */
+    void setDeadline(Clock::time_point deadline) {
+        deadline_ = deadline;
+        hasDeadline_ = true;
+    }
+
+    /**
+     * @brief Whether the search was cancelled or its deadline has passed.
+     */
+    bool cancelled() const {
+        if (cancelled_.load(std::memory_order_relaxed))
+            return true;
+        if (hasDeadline_ && Clock::now() >= deadline_) {
+            expired_.store(true, std::memory_order_relaxed);
+            cancelled_.store(true, std::memory_order_relaxed);
+            return true;
+        }
+        return false;
+    }
+
+    /**
+     * @brief Whether the cancellation was caused by the deadline.
+     */
+    bool deadlineExpired() const { return expired_.load(std::memory_order_relaxed); }
+
+private:
+    mutable std::atomic<bool> cancelled_{false};
+    mutable std::atomic<bool> expired_{false};
+    bool hasDeadline_ = false;
+    Clock::time_point deadline_{};
+};
+
+#endif  // CANCELLATIONTOKEN_HPP
@@ -0,0 +1,106 @@
+#ifndef CASEFOLDMATCHER_HPP
+#define CASEFOLDMATCHER_HPP
+
+#include "literalMatcher.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * @brief Case-insensitive fixed-string search over UTF-8 buffers, without copying them.
+ *
+ * The needle is case-folded once at construction; the haystack is compared in place.
+ *
+ * - ASCII fast path: if the folded needle is pure ASCII and contains no 'k' or 's' (the only
+ *   ASCII letters that non-ASCII characters fold to: KELVIN SIGN and LONG S), candidates are
+ *   found with a vectorised scan for the two rarest needle bytes in either case and verified
+ *   with an ASCII case-insensitive compare.
+ * - UTF-8 path: otherwise candidates are the positions of any lead byte that can start a
+ *   character folding to the needle's first character, and each candidate is verified by
+ *   decoding and folding the haystack code point by code point. A match may therefore have a
+ *   different byte length than the needle (e.g. "K" vs "k").
+ * - ASCII needles containing 'k' or 's' are searched window by window: windows without the
+ *   lead bytes of KELVIN SIGN or LONG S take the ASCII path, the others the UTF-8 path.
+ *
+ * Folding uses Unicode simple case folding (one code point to one code point). Invalid UTF-8
+ * bytes only match themselves. Like LiteralMatcher, an instance is immutable after
+ * construction and can be shared between threads.
+ */
+class CaseFoldMatcher {
+public:
+    using Kernel = LiteralMatcher::Kernel;
+
+    /// A match location in the haystack; position is npos when there is none.
+    struct Match {
+        std::size_t position = std::string_view::npos;
+        std::size_t length = 0;
+
+        explicit operator bool() const { return position != std::string_view::npos; }
+    };
+
+    /**
+     * @brief Builds a matcher for the given needle using the best kernel for this CPU.
+     *
+     * @param needle The UTF-8 string to search for, in any case.
+     */
+    explicit CaseFoldMatcher(std::string needle);
+
+    /**
+     * @brief Builds a matcher with an explicit kernel (downgraded to what the CPU supports).
+     */
+    CaseFoldMatcher(std::string needle, Kernel kernel);
+
+    /**
+     * @brief Finds the first case-insensitive occurrence at or after the given offset.
+     *
+     * @param haystack The UTF-8 buffer to search.
+     * @param from     Offset to start searching at; should be a character boundary.
+     * @return The match position and its length in haystack bytes.
+     */
+    Match find(std::string_view haystack, std::size_t from = 0) const;
+
+    /// The needle as given to the constructor.
+    const std::string& needle() const { return needle_; }
+
+    /// Whether the ASCII fast path is used for this needle.
+    bool asciiFastPath() const { return ascii_; }
+
+    Kernel kernel() const { return kernel_; }
+
+    /**
+     * @brief Unicode simple case folding of one code point.
+     *
+     * Covers Latin, Greek, Cyrillic, Armenian, Georgian, Cherokee, Glagolitic, Coptic,
+     * Deseret, Osage and the letter-like, Roman numeral, circled and full-width forms.
+     * Code points without a folding are returned unchanged.
+     */
+    static std::uint32_t foldCodePoint(std::uint32_t codePoint);
+
+private:
+    Match findAscii(std::string_view haystack, std::size_t from) const;
+    Match findUtf8(std::string_view haystack, std::size_t from, std::size_t limit) const;
+    std::size_t matchUtf8At(std::string_view haystack, std::size_t position) const;
+    std::size_t findAnyByte(std::string_view haystack, std::size_t from,
+                            const unsigned char* values, std::size_t count) const;
+
+    ///< Window size for choosing between the ASCII and UTF-8 paths for 'k'/'s' needles.
+    static constexpr std::size_t kWindowSize = 64 * 1024;
+
+    std::string needle_;
+    Kernel kernel_;
+    bool ascii_ = false;                   ///< ASCII fast path applies everywhere.
+    bool asciiNeedle_ = false;             ///< Folded needle is pure ASCII.
+
+    // ASCII fast path (also filled for ASCII needles containing 'k' or 's')
+    std::string foldedAscii_;              ///< Needle lower-cased byte for byte.
+    std::size_t rareOffset1_ = 0;
+    std::size_t rareOffset2_ = 0;
+
+    // UTF-8 path
+    std::vector<std::uint32_t> foldedCodePoints_;
+    std::vector<unsigned char> leadBytes_; ///< Bytes that can start the first needle character.
+};
+
+#endif  // CASEFOLDMATCHER_HPP
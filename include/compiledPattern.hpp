@@ -0,0 +1,185 @@
+#ifndef COMPILEDPATTERN_HPP
+#define COMPILEDPATTERN_HPP
+
+#include <cstddef>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <regex>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <vector>
+
+#include "matchSpan.hpp"
+
+class LiteralMatcher;
+class CaseFoldMatcher;
+class AutomatonRegex;
+class MultiLiteralMatcher;
+
+/**
+ * @brief Backend used for regex queries.
+ */
+enum class RegexEngine {
+    Automaton,  ///< AutomatonRegex: linear time, with a literal prefilter (default).
+    Std         ///< std::regex (ECMAScript, backtracking); supports backreferences and lookaround.
+};
+
+/**
+ * @brief A query compiled once into the engine that will run it.
+ *
+ * Literal queries get a LiteralMatcher (case-sensitive) or CaseFoldMatcher (case-insensitive).
+ * A list of literal patterns gets a MultiLiteralMatcher that finds all of them in one pass,
+ * and reports which one matched in MatchSpan::pattern.
+ * Regex queries get an AutomatonRegex, or a std::regex compiled with the ECMAScript grammar
+ * when RegexEngine::Std is selected. For automaton regexes, the literal every match must
+ * contain is compiled into a literal matcher as well, so that findCandidate() can skip the
+ * parts of a buffer that cannot match. The object is immutable after construction, so one
+ * instance can be shared read-only by every worker thread of a search instead of each file
+ * (or each highlighted line) recompiling the query.
+ *
+ * An invalid regex does not throw: valid() is false, error() describes the problem and the
+ * pattern never matches.
+ */
+class CompiledPattern {
+public:
+    /**
+     * @brief Compiles the query.
+     *
+     * @param query          The query string or regex pattern.
+     * @param caseSensitive  Whether matching should be case-sensitive.
+     * @param useRegex       Whether to interpret the query as a regex.
+     * @param engine         Backend for regex queries.
+     */
+    explicit CompiledPattern(std::string query, bool caseSensitive = true, bool useRegex = false,
+                             RegexEngine engine = RegexEngine::Automaton);
+
+    /**
+     * @brief Compiles a list of literal patterns, any of which may match.
+     *
+     * Empty patterns are dropped; patterns() holds the remaining ones, which the pattern
+     * indices of the matches refer to. A list of one pattern is compiled like a single query.
+     * Case-insensitive lists of several patterns fold ASCII letters only.
+     *
+     * @param patterns       The literal strings to search for.
+     * @param caseSensitive  Whether matching should be case-sensitive.
+     */
+    explicit CompiledPattern(std::vector<std::string> patterns, bool caseSensitive = true);
+
+    ~CompiledPattern();
+
+    CompiledPattern(const CompiledPattern&) = delete;
+    CompiledPattern& operator=(const CompiledPattern&) = delete;
+
+    /**
+     * @brief Finds the next match at or after `from`.
+     *
+     * Literal patterns search `text` as a whole buffer. Regex patterns are line-oriented, so
+     * `text` must be a single line (without its terminating newline).
+     *
+     * @param text The buffer (literal) or line (regex) to search.
+     * @param from Offset to start searching at.
+     * @return The match position and length in `text`.
+     */
+    MatchSpan find(std::string_view text, std::size_t from = 0) const;
+
+    /**
+     * @brief Whether the line (without its terminating newline) contains a match.
+     */
+    bool matchesLine(std::string_view line) const;
+
+    /**
+     * @brief Offset of the next place in a buffer where a match may be.
+     *
+     * No line that ends before the line containing the returned offset matches. Literal
+     * patterns return the next match; automaton regexes the next occurrence of their required
+     * literal. Without a prefilter every line is a candidate and `from` is returned.
+     *
+     * @param text The whole buffer.
+     * @param from Offset to start at (the start of a line).
+     * @return The candidate offset, or npos if nothing after `from` can match.
+     */
+    std::size_t findCandidate(std::string_view text, std::size_t from = 0) const;
+
+    const std::string& query() const { return query_; }
+    bool caseSensitive() const { return caseSensitive_; }
+    bool isRegex() const { return useRegex_; }
+    RegexEngine regexEngine() const { return engine_; }
+
+    /**
+     * @brief A string every match contains (the automaton regex's required literal); empty if unknown.
+     *
+     * For literal queries and pattern lists, use query() and patterns() instead.
+     */
+    std::string_view requiredLiteral() const;
+
+    /// Whether the pattern was compiled from a pattern list.
+    bool isPatternList() const { return patternList_; }
+    /// The patterns of a pattern list, indexed by MatchSpan::pattern.
+    const std::vector<std::string>& patterns() const { return patterns_; }
+
+    /// False if the regex failed to compile; such a pattern never matches.
+    bool valid() const { return valid_; }
+    const std::string& error() const { return error_; }
+
+private:
+    std::string query_;
+    bool caseSensitive_;
+    bool useRegex_;
+    RegexEngine engine_;
+    bool valid_ = true;
+    std::string error_;
+    bool patternList_ = false;
+    std::vector<std::string> patterns_;
+
+    std::unique_ptr<const LiteralMatcher> literal_;
+    std::unique_ptr<const CaseFoldMatcher> folded_;
+    std::unique_ptr<const AutomatonRegex> automaton_;
+    std::unique_ptr<const MultiLiteralMatcher> multi_;
+    std::unique_ptr<const LiteralMatcher> prefilter_;        ///< Required literal of automaton_.
+    std::unique_ptr<const CaseFoldMatcher> foldedPrefilter_;
+    std::regex regex_;
+};
+
+/**
+ * @brief Thread-safe LRU cache of compiled patterns.
+ *
+ * Serves library callers that issue the same queries repeatedly: a hit returns the shared,
+ * already compiled pattern; a miss compiles it and evicts the least recently used entry once
+ * the capacity is reached. Evicted patterns stay alive while a search still holds them.
+ */
+class PatternCache {
+public:
+    /**
+     * @brief Constructor.
+     *
+     * @param capacity Maximum number of patterns kept (at least 1).
+     */
+    explicit PatternCache(std::size_t capacity = 64);
+
+    /**
+     * @brief Returns the compiled pattern for the query and options, compiling it on a miss.
+     */
+    std::shared_ptr<const CompiledPattern> get(const std::string& query, bool caseSensitive, bool useRegex,
+                                               RegexEngine engine = RegexEngine::Automaton);
+
+    std::size_t size() const;
+    std::size_t capacity() const { return capacity_; }
+    void clear();
+
+    /// Process-wide cache used by SearchManager and highlightMatches.
+    static PatternCache& global();
+
+private:
+    using Key = std::tuple<std::string, bool, bool, RegexEngine>;
+    using Entry = std::pair<Key, std::shared_ptr<const CompiledPattern>>;
+
+    std::size_t capacity_;
+    std::list<Entry> entries_;                                 ///< Most recently used first.
+    std::map<Key, std::list<Entry>::iterator> index_;
+    mutable std::mutex mutex_;
+};
+
+#endif  // COMPILEDPATTERN_HPP
@@ -0,0 +1,95 @@
+#ifndef COMPRESSEDFILESEARCHER_HPP
+#define COMPRESSEDFILESEARCHER_HPP
+
+#include <cstddef>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "grepLikeUtility.hpp"
+#include "textEncoding.hpp"
+
+/**
+ * @brief FileSearcher that searches inside gzip, xz and zstd compressed files.
+ *
+ * The format is recognized by its magic bytes, not by the file name. A compressed file is
+ * decompressed on a separate thread, chunk by chunk, into a BoundedQueue of kQueueDepth
+ * chunks of kChunkSize bytes, while the calling thread searches the complete lines of every
+ * chunk it takes from the queue; memory stays bounded by the queue and the longest line, and
+ * decompression overlaps matching. Line numbers and byte offsets refer to the decompressed
+ * contents. Concatenated gzip members, xz streams and zstd frames are read one after another.
+ *
+ * The decompressed contents are handled like a file's by TextFileSearcher: the BinaryPolicy
+ * applies to binary contents (e.g. a compressed tarball), UTF-16 contents are transcoded, and
+ * the ReportMode, max count and context lines apply; once a file is done, decompression stops.
+ * Everything that is not compressed in a supported format is searched by a TextFileSearcher,
+ * so this searcher can be used for whole trees.
+ *
+ * Each format needs its library at build time (zlib, liblzma, libzstd; see
+ * dependencies/compression.cmake); files in a format built without support are searched as
+ * they are, i.e. as binary files.
+ */
+class CompressedFileSearcher : public FileSearcher {
+public:
+    /// Compression formats recognized by their magic bytes.
+    enum class Compression { None, Gzip, Xz, Zstd };
+
+    ///< Decompressed bytes per chunk handed from the decompressing to the searching thread.
+    static constexpr size_t kChunkSize = 1024 * 1024;
+    ///< Decompressed chunks queued before the decompressing thread waits for the search.
+    static constexpr size_t kQueueDepth = 4;
+
+    explicit CompressedFileSearcher(BinaryPolicy binaryPolicy = BinaryPolicy::Report) : text_(binaryPolicy) {}
+
+    using FileSearcher::search;
+
+    void search(const std::filesystem::path& filePath, const CompiledPattern& pattern,
+                ResultSink& sink, const std::string& threadIdStr = "") override;
+
+    bool supportsRanges() const override { return text_.supportsRanges(); }
+
+    ReportMode reportMode() const override { return text_.reportMode(); }
+    void setReportMode(ReportMode reportMode) { text_.setReportMode(reportMode); }
+
+    /**
+     * @brief Stops reading a file after this many matched lines (0: no limit).
+     */
+    void setMaxCount(size_t maxCount) { text_.setMaxCount(maxCount); }
+
+    /**
+     * @brief Also delivers up to `before` lines before and `after` lines after every matched line.
+     */
+    void setContext(size_t before, size_t after) { text_.setContext(before, after); }
+
+    bool requiresWholeFile(std::string_view head) const override;
+
+    void searchRange(const std::filesystem::path& filePath, std::string_view range,
+                     size_t firstLineNumber, size_t byteOffset, const CompiledPattern& pattern,
+                     std::vector<SearchResult>& results) override;
+
+    /**
+     * @brief Searches the contents of a file that are already in memory, decompressing them if needed.
+     */
+    void searchContents(const std::filesystem::path& filePath, std::string_view contents,
+                        const CompiledPattern& pattern, ResultSink& sink,
+                        const std::string& threadIdStr = "") override;
+
+    /**
+     * @brief The compression format announced by the first bytes of a file.
+     */
+    static Compression detectCompression(std::string_view head);
+
+    /**
+     * @brief Whether this build can decompress the format.
+     */
+    static bool isSupported(Compression compression);
+
+private:
+    void searchCompressed(const std::string& path, std::string_view input, Compression compression,
+                          const CompiledPattern& pattern, ResultSink& sink, const std::string& threadIdStr);
+
+    TextFileSearcher text_;
+};
+
+#endif  // COMPRESSEDFILESEARCHER_HPP
@@ -0,0 +1,108 @@
+#ifndef DIRECTORYWALKER_HPP
+#define DIRECTORYWALKER_HPP
+
+#include <condition_variable>
+#include <cstddef>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <system_error>
+#include <vector>
+
+#include "cancellationToken.hpp"
+#include "pathFilter.hpp"
+
+/**
+ * @brief Multi-threaded recursive directory traversal that reports files as it finds them.
+ *
+ * Directories are read concurrently by a set of walker threads sharing a stack of pending
+ * directories, and every regular file (or symlink to one) is passed to the file callback as
+ * soon as its directory has been read, so searching can start long before the traversal ends.
+ *
+ * On Linux, directories are read with getdents64 and subdirectories opened with openat
+ * relative to their parent's descriptor, so no path is resolved from the root again; entry
+ * types come from the directory listing, falling back to fstatat only when the file system
+ * does not report them. Elsewhere std::filesystem is used.
+ *
+ * Errors (permission denied, entries vanishing mid-walk, ...) are passed to the error
+ * callback and the walk continues with the remaining directories. Symlinks to directories are
+ * not followed unless requested; when they are, directories already visited (same device and
+ * inode) are skipped, which breaks symlink loops.
+ *
+ * With a PathFilter, every directory's ignore files are read as it is entered, and entries
+ * are tested against the filter as they are listed: a rejected subdirectory is never opened,
+ * so pruning shrinks the walk itself, not just its output.
+ */
+class DirectoryWalker {
+public:
+    using FileCallback = std::function<void(std::filesystem::path)>;
+    using ErrorCallback = std::function<void(const std::filesystem::path&, std::error_code)>;
+
+    ///< Subdirectory descriptors kept open while queued; beyond this, paths are queued instead.
+    static constexpr std::size_t kMaxOpenDirectories = 256;
+
+    /**
+     * @brief Constructor.
+     *
+     * @param numThreads     Number of walker threads (at least 1).
+     * @param followSymlinks Whether to descend into symlinks to directories.
+     */
+    explicit DirectoryWalker(std::size_t numThreads, bool followSymlinks = false);
+
+    /**
+     * @brief Restricts subsequent walks to the files and directories the filter accepts (nullptr: all).
+     */
+    void setFilter(std::shared_ptr<const PathFilter> filter);
+
+    /**
+     * @brief Makes walks stop early once the token is cancelled (nullptr: never).
+     *
+     * Directories not read yet are then dropped; walk() returns once the directories being
+     * read have been listed. The token must outlive the walks.
+     */
+    void setCancellationToken(const CancellationToken* token) { cancellation_ = token; }
+
+    /**
+     * @brief Walks the tree below root, blocking until every directory has been read.
+     *
+     * Callbacks are invoked concurrently from the walker threads. A file callback that blocks
+     * (e.g. on a full queue) throttles the walk.
+     *
+     * @param root    The directory to walk.
+     * @param onFile  Called with the path (root / relative path) of every regular file.
+     * @param onError Called for every directory or entry that could not be read.
+     */
+    void walk(const std::filesystem::path& root, const FileCallback& onFile, const ErrorCallback& onError);
+
+private:
+    /// A directory waiting to be read: an open descriptor when one could be kept, else -1.
+    struct PendingDirectory {
+        std::filesystem::path path;
+        int fd = -1;
+        std::string relative;                         ///< Path below the root with a trailing '/', if filtering.
+        std::shared_ptr<const IgnoreRules> rules;     ///< Ignore rules in effect in the parent, if filtering.
+    };
+
+    void runWorker(const FileCallback& onFile, const ErrorCallback& onError);
+    void readDirectory(PendingDirectory directory, const FileCallback& onFile, const ErrorCallback& onError);
+    void pushDirectory(PendingDirectory directory);
+    static void dropDirectory(PendingDirectory& directory);
+    bool firstVisit(const std::string& identity);
+
+    std::size_t numThreads_;
+    bool followSymlinks_;
+    std::shared_ptr<const PathFilter> filter_;    ///< nullptr unless the filter is active.
+    const CancellationToken* cancellation_ = nullptr;
+
+    std::mutex mutex_;
+    std::condition_variable workAvailable_;
+    std::vector<PendingDirectory> pending_;
+    std::size_t active_ = 0;        ///< Directories being read right now.
+    std::size_t openCount_ = 0;     ///< Descriptors held by pending_.
+    std::set<std::string> visited_;  ///< Identities of entered directories, when following symlinks.
+};
+
+#endif  // DIRECTORYWALKER_HPP
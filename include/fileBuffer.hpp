@@ -0,0 +1,99 @@
+#ifndef FILEBUFFER_HPP
+#define FILEBUFFER_HPP
+
+#include <cstddef>
+#include <filesystem>
+#include <string_view>
+
+/**
+ * @brief Read-only, contiguous view of a whole file's contents.
+ *
+ * Large regular files are memory-mapped so the search runs directly over the page cache
+ * without copying. Small files (and regular files whose size is not known up front, such as
+ * those under /proc) are read with large page-aligned block reads into a single buffer.
+ *
+ * Non-regular files (pipes, character devices, ...) are not handled here; callers fall back
+ * to streaming them line by line.
+ *
+ * The buffer is move-only; the mapping or allocation is released on destruction. A buffer
+ * that is opened again keeps its block, so reading many files through one buffer (or through
+ * a BufferPool) allocates only when a file does not fit.
+ */
+class FileBuffer {
+public:
+    /// How the contents of the buffer were obtained.
+    enum class Source { None, Mapped, Read };
+
+    ///< Regular files at least this large are memory-mapped instead of read.
+    static constexpr std::size_t kMapThreshold = 256 * 1024;
+    ///< Block size (and alignment) used for buffered reads.
+    static constexpr std::size_t kBlockSize = 64 * 1024;
+
+    FileBuffer() = default;
+    ~FileBuffer();
+
+    FileBuffer(FileBuffer&& other) noexcept;
+    FileBuffer& operator=(FileBuffer&& other) noexcept;
+    FileBuffer(const FileBuffer&) = delete;
+    FileBuffer& operator=(const FileBuffer&) = delete;
+
+    /**
+     * @brief Loads the file at the given path, replacing any previous contents.
+     *
+     * The block of an earlier read is reused if the file fits into it.
+     *
+     * @param filePath The regular file to map or read.
+     * @return true on success, false if the file could not be opened, mapped or read.
+     */
+    bool open(const std::filesystem::path& filePath);
+
+    /**
+     * @brief Releases the mapping or buffer.
+     */
+    void close();
+
+    /**
+     * @brief Releases the contents but keeps the block of the read path, for the next open() or reserve().
+     */
+    void clear();
+
+    /**
+     * @brief Makes room to read a file into: an aligned block of at least `capacity` bytes.
+     *
+     * For readers that fill the buffer themselves (e.g. with asynchronous reads). The first
+     * `keep` bytes of an earlier reserve() are kept; anything else the buffer held is released.
+     *
+     * @return The start of the block, valid until the next reserve(), close() or destruction.
+     */
+    char* reserve(std::size_t capacity, std::size_t keep = 0);
+
+    /**
+     * @brief Makes the first `size` bytes of the reserved block the contents.
+     */
+    void commitRead(std::size_t size);
+
+    /// Bytes of the block reserved with reserve() or used by the read path.
+    std::size_t capacity() const { return capacity_; }
+
+    /// The whole file contents. Valid until the buffer is closed, reopened or destroyed.
+    std::string_view view() const { return {data_, size_}; }
+
+    std::size_t size() const { return size_; }
+
+    Source source() const { return source_; }
+
+private:
+    bool readBlocks(int fd, std::size_t sizeHint);
+    void allocate(std::size_t capacity);
+    void releaseStorage();
+
+    const char* data_ = nullptr;
+    std::size_t size_ = 0;
+    Source source_ = Source::None;
+    void* mapping_ = nullptr;          ///< Start of the mapping when source_ == Mapped.
+    std::size_t mappingSize_ = 0;
+    char* storage_ = nullptr;          ///< Aligned heap block when source_ == Read.
+    std::size_t capacity_ = 0;
+};
+
+#endif  // FILEBUFFER_HPP
@@ -0,0 +1,130 @@
+#ifndef GLOBMATCHER_HPP
+#define GLOBMATCHER_HPP
+
+#include <bitset>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * @brief A compiled shell glob with gitignore semantics, matched against '/'-separated paths.
+ *
+ * `*` matches any run of characters except '/', `?` one character except '/', and `[...]`
+ * one character of a class (`[a-z]`, negated with `[!...]` or `[^...]`). `**` spans
+ * directories when it is a whole path component: `**` + `/` at the start or after a '/'
+ * matches zero or more leading directories (`**` + `/foo` matches `foo` and `a/b/foo`), and a
+ * trailing `/` + `**` matches everything below; elsewhere it is a plain `*`. A backslash
+ * escapes the next character.
+ *
+ * The common shapes are recognized at compile time and matched without the automaton: plain
+ * names (`node_modules`), extensions (`*.o`) and prefixes (`build*`). Anything else runs a
+ * bit-parallel simulation of the glob's NFA, linear in the length of the path whatever the
+ * glob. A GlobMatcher is immutable and can be shared by any number of threads.
+ */
+class GlobMatcher {
+public:
+    explicit GlobMatcher(std::string_view glob);
+
+    /**
+     * @brief Whether the whole path matches the glob.
+     */
+    bool matches(std::string_view path) const;
+
+    const std::string& glob() const { return glob_; }
+
+    /// The name the glob stands for if it has no wildcards, else empty.
+    const std::string& literal() const { return kind_ == Kind::Literal ? text_ : kEmpty; }
+
+    /// The extension (e.g. ".o") if the glob is `*` followed by an extension, else empty.
+    const std::string& extension() const { return kind_ == Kind::Suffix && isExtension(text_) ? text_ : kEmpty; }
+
+    /// Whether the glob contains a '/' (and so only matches a path, not a bare name).
+    bool containsSlash() const { return containsSlash_; }
+
+    /// Whether `suffix` is an extension: a '.' followed by no other '.' or '/'.
+    static bool isExtension(std::string_view suffix);
+
+private:
+    enum class Kind { Literal, Suffix, Prefix, Name, General };
+
+    /// An NFA state; the state after the last one accepts.
+    struct State {
+        enum Type : std::uint8_t { Char, Any, Class, Star, DoubleStar, DirsStart, DirsInside };
+        Type type;
+        unsigned char c = 0;                ///< Char: the character.
+        std::uint16_t classIndex = 0;       ///< Class: index into classes_.
+    };
+
+    bool matchesAutomaton(std::string_view path) const;
+
+    static const std::string kEmpty;
+
+    std::string glob_;
+    Kind kind_ = Kind::General;
+    std::string text_;                      ///< Literal, Suffix, Prefix: the literal part.
+    bool containsSlash_ = false;
+    std::vector<State> states_;
+    std::vector<std::bitset<256>> classes_;
+};
+
+/**
+ * @brief An ordered list of globs that finds the last one matching a path.
+ *
+ * Globs without a '/' are matched against the last component of the path (its name), others
+ * against the whole path. Name globs without wildcards and `*.<extension>` globs are looked
+ * up in hash tables, so a set of many such globs (a typical .gitignore) costs a couple of
+ * lookups per path; only the remaining globs are tried one by one, latest first, and only
+ * those added after the best hash match.
+ */
+class GlobSet {
+public:
+    static constexpr std::size_t npos = static_cast<std::size_t>(-1);
+
+    /**
+     * @brief Adds a glob.
+     *
+     * @param glob          The glob (see GlobMatcher).
+     * @param directoryOnly Whether the glob only matches directories.
+     * @return The index of the glob, counting from 0 in the order of addition.
+     */
+    std::size_t add(std::string_view glob, bool directoryOnly = false);
+
+    /**
+     * @brief Adds a glob that is always matched against the whole path, even without a '/'.
+     */
+    std::size_t addAnchored(std::string_view glob, bool directoryOnly = false);
+
+    /**
+     * @brief The index of the last added glob that matches the path, or npos.
+     *
+     * @param path        A '/'-separated relative path, without a trailing '/'.
+     * @param isDirectory Whether the path is a directory (directory-only globs need one).
+     */
+    std::size_t lastMatch(std::string_view path, bool isDirectory) const;
+
+    bool matches(std::string_view path, bool isDirectory) const { return lastMatch(path, isDirectory) != npos; }
+
+    std::size_t size() const { return entries_.size(); }
+    bool empty() const { return entries_.empty(); }
+
+private:
+    struct Entry {
+        GlobMatcher glob;
+        bool directoryOnly;
+        bool wholePath;
+    };
+
+    std::size_t add(std::string_view glob, bool directoryOnly, bool anchored);
+    std::size_t lastHashed(const std::unordered_map<std::string, std::vector<std::size_t>>& table,
+                           std::string_view key, bool isDirectory) const;
+
+    std::vector<Entry> entries_;
+    std::unordered_map<std::string, std::vector<std::size_t>> names_;        ///< Name -> globs, ascending.
+    std::unordered_map<std::string, std::vector<std::size_t>> extensions_;   ///< ".ext" -> globs, ascending.
+    std::vector<std::size_t> others_;                                        ///< Globs tried one by one, ascending.
+};
+
+#endif  // GLOBMATCHER_HPP
@@ -2,12 +2,26 @@
 #define GREPLIKEUTILITY_HPP
 
 #include <string>
+#include <string_view>
+#include <istream>
+#include <ostream>
 #include <filesystem>
 #include <memory>
 #include <vector>
 #include <thread>
 #include <mutex>
 #include <map>
+#include "asyncFileReader.hpp"
+#include "bufferPool.hpp"
+#include "cancellationToken.hpp"
+#include "compiledPattern.hpp"
+#include "outputWriter.hpp"
+#include "pathFilter.hpp"
+#include "searchResult.hpp"
+#include "searchStats.hpp"
+#include "textEncoding.hpp"
+#include "trigramIndex.hpp"
+#include "workStealingPool.hpp"
 
 /**
  * @brief Abstract interface for performing query search.
@@ -23,19 +37,90 @@
 class FileSearcher {
 public:
     /**
-     * @brief Searches a specified file for the query.
+     * @brief Searches a specified file for the pattern.
      *
-     * Reads the file line by line, searches for matches according to the provided options,
-     * and prints matched lines to the console (highlighted if requested).
+     * Searches the file for matches of the compiled pattern and delivers the matched lines,
+     * with their match spans, to the sink. The pattern is shared read-only between threads.
      *
      * @param filePath       The path to the file to search.
-     * @param query          The query string or regex pattern.
-     * @param caseSensitive  Whether the search should be case-sensitive.
+     * @param pattern        The compiled query (literal or regex, with its case sensitivity).
+     * @param sink           Receives the results, in batches in line order.
+     * @param threadIdStr    Identifier of the calling worker, passed on to the sink.
+     */
+    virtual void search(const std::filesystem::path& filePath, const CompiledPattern& pattern,
+                        ResultSink& sink, const std::string& threadIdStr = "") = 0;
+
+    /**
+     * @brief Searches a specified file for the pattern and prints the matched lines.
+     *
+     * Shorthand for search() with a ConsoleFormatter writing to std::cout.
+     *
+     * @param filePath       The path to the file to search.
+     * @param pattern        The compiled query (literal or regex, with its case sensitivity).
      * @param highlight      Whether to highlight matches in the output.
-     * @param useRegex       Whether to interpret the query as a regex.
+     * @param threadIdStr    Identifier of the calling worker, printed with each match.
+     */
+    void search(const std::filesystem::path& filePath, const CompiledPattern& pattern,
+                bool highlight, const std::string& threadIdStr = "");
+
+    /**
+     * @brief Whether searchRange() is implemented, so large files can be split into ranges.
+     */
+    virtual bool supportsRanges() const { return false; }
+
+    /**
+     * @brief What search() reports for every file, so the results can be presented accordingly.
+     */
+    virtual ReportMode reportMode() const { return ReportMode::Lines; }
+
+    /**
+     * @brief Whether a file starting with these bytes must be searched whole by search().
+     *
+     * Such files are never split into ranges. By default, those are the files that are not
+     * plain text (binary or UTF-16, see detectEncoding()).
+     *
+     * @param head The first bytes of the file (at least kEncodingSniffSize, if it has them).
+     */
+    virtual bool requiresWholeFile(std::string_view head) const {
+        return detectEncoding(head) != TextEncoding::Text;
+    }
+
+    /**
+     * @brief Searches one newline-aligned byte range of a file that is already in memory.
+     *
+     * Lets SearchManager spread a single large file over several workers. Only called when
+     * supportsRanges() is true. Results are appended to `results` rather than delivered, so
+     * the caller can pass the ranges of a file to its sink in file order.
+     *
+     * @param filePath        The path of the file the range belongs to.
+     * @param range           The bytes of the range; starts at a line start, ends after a newline
+     *                        or at the end of the file.
+     * @param firstLineNumber Line number of the first line of the range.
+     * @param byteOffset      Offset of the range in the file.
+     * @param pattern         The compiled query.
+     * @param results         Receives the matched lines.
      */
-    virtual void search(const std::filesystem::path& filePath, const std::string& query,
-                        bool caseSensitive, bool highlight, bool useRegex, const std::string& threadIdStr = "") = 0;
+    virtual void searchRange(const std::filesystem::path& /*filePath*/, std::string_view /*range*/,
+                             size_t /*firstLineNumber*/, size_t /*byteOffset*/,
+                             const CompiledPattern& /*pattern*/, std::vector<SearchResult>& /*results*/) {}
+
+    /**
+     * @brief Searches a file whose contents were already read, as search() would.
+     *
+     * Lets SearchManager read files into buffers it recycles, and ahead of the workers. By
+     * default the file is searched by its path, reading it again, so searchers that search
+     * regular files should override it.
+     *
+     * @param filePath    The path reported in the results.
+     * @param contents    The whole file.
+     * @param pattern     The compiled query.
+     * @param sink        Receives the results.
+     * @param threadIdStr Identifier of the calling worker, passed on to the sink.
+     */
+    virtual void searchContents(const std::filesystem::path& filePath, std::string_view /*contents*/,
+                                const CompiledPattern& pattern, ResultSink& sink, const std::string& threadIdStr = "") {
+        search(filePath, pattern, sink, threadIdStr);
+    }
 
     virtual ~FileSearcher() = default;
 };
@@ -45,23 +130,246 @@ public:
  *
  * Searches through plain text files, supporting literal and regex patterns,
  * with optional case sensitivity, and highlighting of matches.
+ *
+ * Regular files are loaded into a FileBuffer (memory-mapped or block-read) and searched as
+ * one buffer: line boundaries and line numbers are only computed around a hit. Other files
+ * (pipes, devices) are streamed line by line.
+ *
+ * The first block of a regular file is checked for NUL bytes (see detectEncoding()); binary
+ * files are skipped, reported once as matching, or searched as text, depending on the
+ * BinaryPolicy. Files starting with a UTF-16 byte order mark are transcoded to UTF-8 chunk by
+ * chunk as they are searched; their byte offsets are offsets in the transcoded text.
+ *
+ * The match spans of a matched line are collected while matching it (the first one is the
+ * hit itself for literal queries) and delivered with the result, so highlighting does not
+ * search the line again. Results are collected per search and handed to the sink in batches
+ * of kResultBatchSize (or when the file is done), so delivery never costs a lock per line.
+ *
+ * The ReportMode and the max count decide when a file is done: with FilesWithMatches at its
+ * first matched line, with a max count of N after N matched lines; the rest of the file is
+ * not read. Outside of ReportMode::Lines, matched lines are only counted, never copied into
+ * results, and one summary result per file with a match is delivered instead; a binary file
+ * is then counted like text, as there are no lines to garble the output.
+ *
+ * Context lines (see setContext()) are delivered as results marked `context`, with the line
+ * number and byte offset of the line; the windows of nearby matches merge, and the first line
+ * after lines that were left out is marked `gapBefore`. They cost nothing until a line
+ * matches: the lines before it are found by scanning back from it in the buffer, as far as
+ * the last line delivered, and the lines after it are taken one by one until the window
+ * closes (a matched line inside the window extends it). Sources read a chunk at a time keep
+ * the last lines of a chunk in front of the next one; streams keep the last lines in a ring
+ * of line buffers that lines are read into, so no line is copied before it is delivered.
+ * After the max count is reached, the lines after the last match are still delivered, as
+ * context.
+ *
+ * Files are split into ranges only in ReportMode::Lines without a max count or context,
+ * as the ranges of a file are searched independently.
  */
 class TextFileSearcher : public FileSearcher {
 public:
-void search(const std::filesystem::path& filePath, const std::string& query,
-    bool caseSensitive, bool highlight, bool useRegex,
-    const std::string& threadIdStr) override;
+    using FileSearcher::search;
+
+    explicit TextFileSearcher(BinaryPolicy binaryPolicy = BinaryPolicy::Report) : binaryPolicy_(binaryPolicy) {}
+
+    void search(const std::filesystem::path& filePath, const CompiledPattern& pattern,
+                ResultSink& sink, const std::string& threadIdStr = "") override;
+
+    bool supportsRanges() const override {
+        return reportMode_ == ReportMode::Lines && maxCount_ == 0 && !withContext_;
+    }
+
+    ///< Matched lines collected per search before they are handed to the sink.
+    static constexpr size_t kResultBatchSize = 1024;
+    ///< Bytes of a UTF-16 file transcoded at a time.
+    static constexpr size_t kTranscodeChunkSize = 1024 * 1024;
+
+    BinaryPolicy binaryPolicy() const { return binaryPolicy_; }
+    void setBinaryPolicy(BinaryPolicy binaryPolicy) { binaryPolicy_ = binaryPolicy; }
+
+    ReportMode reportMode() const override { return reportMode_; }
+    void setReportMode(ReportMode reportMode) { reportMode_ = reportMode; }
+
+    size_t maxCount() const { return maxCount_; }
+
+    /**
+     * @brief Stops reading a file after this many matched lines (0: no limit).
+     */
+    void setMaxCount(size_t maxCount) { maxCount_ = maxCount; }
+
+    size_t contextBefore() const { return contextBefore_; }
+    size_t contextAfter() const { return contextAfter_; }
+    bool withContext() const { return withContext_; }
+
+    /**
+     * @brief Also delivers up to `before` lines before and `after` lines after every matched line.
+     *
+     * Only applies in ReportMode::Lines. Even with no lines either side, matched lines that
+     * do not follow each other are then marked `gapBefore`, as with `grep -C 0`.
+     */
+    void setContext(size_t before, size_t after) {
+        contextBefore_ = before;
+        contextAfter_ = after;
+        withContext_ = true;
+    }
+
+    void searchRange(const std::filesystem::path& filePath, std::string_view range,
+                     size_t firstLineNumber, size_t byteOffset, const CompiledPattern& pattern,
+                     std::vector<SearchResult>& results) override;
+
+    /**
+     * @brief Searches the contents of a file that are already in memory, as search() would.
+     *
+     * @param filePath    The path reported in the results.
+     * @param contents    The whole file.
+     * @param pattern     The compiled query.
+     * @param sink        Receives the results.
+     * @param threadIdStr Identifier of the calling worker, passed on to the sink.
+     */
+    void searchContents(const std::filesystem::path& filePath, std::string_view contents,
+                        const CompiledPattern& pattern, ResultSink& sink,
+                        const std::string& threadIdStr = "") override;
 
 private:
+    /// Matched lines of the file being searched, how many make it done, and the open context window.
+    struct FileTally {
+        size_t matched = 0;
+        size_t limit = static_cast<size_t>(-1);
+        bool collect = true;            ///< Whether matched lines become results.
+        size_t after = 0;               ///< Context lines still to deliver after the last matched line.
+        size_t lastLine = 0;            ///< Number of the last line delivered (0: none yet).
+
+        bool limitReached() const { return matched >= limit; }
+        bool done() const { return limitReached() && after == 0; }
+    };
+
+    FileTally startFile() const;
+    void finishFile(const std::string& path, const FileTally& tally, std::vector<SearchResult>& results) const;
+
+    SearchResult& appendLine(const std::string& path, std::string_view line, size_t lineNumber, size_t byteOffset,
+                             bool context, FileTally& tally, std::vector<SearchResult>& results) const;
+    size_t historyStart(std::string_view lines) const;
+
+    void searchText(const std::string& path, std::string_view text, const CompiledPattern& pattern,
+                    FileTally& tally, std::vector<SearchResult>& results, ResultSink& sink,
+                    const std::string& threadIdStr);
+
+    void searchBuffer(const std::string& path, std::string_view text, size_t start, const CompiledPattern& pattern,
+                      size_t firstLineNumber, size_t byteOffset, FileTally& tally, std::vector<SearchResult>& results,
+                      ResultSink* sink, const std::string& threadIdStr);
+
+    void searchUtf16(const std::string& path, std::string_view text, bool bigEndian, const CompiledPattern& pattern,
+                     FileTally& tally, std::vector<SearchResult>& results, ResultSink& sink,
+                     const std::string& threadIdStr);
+
+    void searchStream(const std::string& path, std::istream& input, const CompiledPattern& pattern,
+                      FileTally& tally, std::vector<SearchResult>& results, ResultSink& sink,
+                      const std::string& threadIdStr);
+
+    BinaryPolicy binaryPolicy_;
+    ReportMode reportMode_ = ReportMode::Lines;
+    size_t maxCount_ = 0;
+    size_t contextBefore_ = 0;
+    size_t contextAfter_ = 0;
+    bool withContext_ = false;  ///< setContext() was called.
+
     ///< Mutex to synchronize multi-threaded console output.
     static std::mutex coutMutex;
     friend class SearchManager;
+    friend class ConsoleFormatter;
+    friend class SearchDaemon;
+    friend class CompressedFileSearcher;
+};
+
+/**
+ * @brief ResultSink that prints results as `path:line: [Thread id] line`, one per line.
+ *
+ * A batch is formatted into one string, highlighted from the delivered match spans if
+ * requested, and handed to the OutputWriter (or, without one, written to std::cout). For a
+ * pattern list, the patterns matched in a line are named before it: `[pattern: a, b] line`.
+ * Context lines are printed as `path-line- [Thread id] line`, and `--` separates them from
+ * the lines of the file before a gap, as grep does. Matching binary files are printed as
+ * `Binary file path matches`, file summaries as `path` (ReportMode::FilesWithMatches) or
+ * `path:count` (ReportMode::Count). Results delivered without a thread id (ordered output,
+ * which must not depend on scheduling) leave out the `[Thread id]` field: `path:line: line`.
+ */
+class ConsoleFormatter : public ResultSink {
+public:
+    /**
+     * @brief Constructor.
+     *
+     * @param highlight Whether to color the matches.
+     * @param writer    Destination of the output; nullptr writes to std::cout directly.
+     * @param patternNames The patterns of a pattern list, to name the matched ones; nullptr otherwise.
+     */
+    explicit ConsoleFormatter(bool highlight, OutputWriter* writer = nullptr,
+                              const std::vector<std::string>* patternNames = nullptr)
+        : highlight_(highlight), writer_(writer), patternNames_(patternNames) {}
+
+    void consume(std::vector<SearchResult>& results, const std::string& threadIdStr) override;
+
+    /**
+     * @brief How file summaries are printed: just the path, or the path and the count.
+     */
+    void setReportMode(ReportMode reportMode) { reportMode_ = reportMode; }
+
+private:
+    void appendPatternNames(const SearchResult& result, std::string& output) const;
+
+    bool highlight_;
+    OutputWriter* writer_;
+    const std::vector<std::string>* patternNames_;
+    ReportMode reportMode_ = ReportMode::Lines;
 };
 
 /**
  * @brief Manage file search operations across directories using threads.
  *
  * Coordinates multi-threaded file searching with optional regex and highlighting.
+ * The query is compiled once (through the global PatternCache) and shared read-only by all
+ * worker threads.
+ *
+ * Work is scheduled on a WorkStealingPool rather than dealt out up front: every file is a
+ * task, and files of at least two range sizes are split into newline-aligned byte ranges that
+ * are searched as separate tasks, so the load balances by bytes rather than by file count.
+ * The line numbers of the ranges come from a parallel newline-count pass, and the matches of
+ * a split file are delivered in file order.
+ *
+ * Results go to the ResultSink set with setResultSink() or setResultCallback(). Without one
+ * they are printed by a ConsoleFormatter through an OutputWriter: workers hand over whole
+ * buffers and one writer thread writes them in large batches. With ordered output the matches
+ * are written sorted by file path once the search is done (and without thread ids), so
+ * identical searches produce identical output.
+ *
+ * The directory tree is traversed by a DirectoryWalker in the background, which streams the
+ * files it finds through a bounded queue, so searching starts as soon as the first directory
+ * has been read and a slow traversal never piles up an unbounded file list.
+ *
+ * A PathFilter (ignore files, include/exclude globs, file types) prunes the walk itself:
+ * rejected directories are never opened.
+ *
+ * With a result limit, the search is cancelled once that many results have been delivered:
+ * the walk stops, queued files and ranges are skipped, and files being searched at that
+ * moment finish, but their results beyond the limit are dropped.
+ *
+ * With a TrigramIndex of the searched directory, files the index rules out are dropped as
+ * they are found, unless they changed since they were indexed; everything else is searched
+ * as usual, so the results are the same as without the index.
+ *
+ * With IoBackend::Uring, the files below the split size (and FileBuffer::kMapThreshold) are
+ * read ahead by an AsyncFileReader on the thread that feeds the pool, many at a time, and the
+ * workers search the buffers it hands over; other files are read by the workers as usual.
+ *
+ * With SearchStats set, every search collects per-thread counters and timers of its walk,
+ * I/O, matching and output, which cost nothing otherwise.
+ *
+ * Memory: every worker reads the files it searches whole into a block of its own arena,
+ * reused from file to file, and the AsyncFileReader takes its blocks from a BufferPool the
+ * workers hand them back to, so small files cost no allocation. The files in flight (read
+ * blocks, mapped files while they are searched) are charged to the pool; with a memory
+ * limit, the thread feeding the pool stops taking files from the walker, and the reader stops
+ * starting reads, while the charges are at the limit, and the walker stalls once its queue is
+ * full. The output queue gets a quarter of the limit (at most OutputWriter::kMaxQueuedBytes).
+ * Ordered output is held whole until the end and is not bounded by the limit.
  */
 class SearchManager {
 public:
@@ -73,32 +381,158 @@ public:
      * @param caseSensitive  Whether the search should be case-sensitive.
      * @param highlight      Whether to highlight the matches.
      * @param useRegex       Whether the query is a regex pattern.
+     * @param engine         Backend for regex queries.
      */
     SearchManager(std::unique_ptr<FileSearcher> searcher, const std::string& query,
-                  bool caseSensitive = true, bool highlight = false, bool useRegex = false);
+                  bool caseSensitive = true, bool highlight = false, bool useRegex = false,
+                  RegexEngine engine = RegexEngine::Automaton);
+
+    /**
+     * @brief Constructor from an already compiled pattern.
+     *
+     * @param searcher       A unique pointer to a FileSearcher implementation.
+     * @param pattern        The compiled query.
+     * @param highlight      Whether to highlight the matches.
+     */
+    SearchManager(std::unique_ptr<FileSearcher> searcher, std::shared_ptr<const CompiledPattern> pattern,
+                  bool highlight = false);
+
+    ///< Default size of the byte ranges large files are split into.
+    static constexpr size_t kDefaultRangeSize = 8 * 1024 * 1024;
+    ///< Discovered files buffered between the directory walker and the search workers.
+    static constexpr size_t kWalkQueueCapacity = 4096;
+    ///< File tasks queued on the pool per worker thread before the walker output is throttled.
+    static constexpr size_t kFilesInFlightPerThread = 4;
 
     /**
      * @brief Performs recursive search across all files in the directory.
      *
-     * Scans the directory recursively for regular files, then uses multiple threads to search
-     * through those files in parallel. Each thread receives an even slice of files.
+     * Walks the directory tree in parallel and searches the regular files as they are found,
+     * on a pool of worker threads that steal work from each other. Unreadable directories are
+     * reported and skipped. A per-worker utilization report is printed once the search is done.
+     *
+     * A regular file may be given instead of a directory; it is searched on its own, split
+     * over all workers if it is large.
      *
-     * @param dirPath The path to the root directory for searching.
+     * @param dirPath The path to the root directory (or the single file) to search.
      */
     void searchInDirectory(const std::filesystem::path& dirPath);
 
     size_t getNumThreads() const {return numThreads_; }
 
+    /**
+     * @brief Sets the number of worker threads; 0 selects std::thread::hardware_concurrency().
+     */
+    void setNumThreads(size_t numThreads);
+
+    size_t getRangeSize() const { return rangeSize_; }
+
+    /**
+     * @brief Sets the size of the byte ranges large files are split into (at least 1 byte).
+     */
+    void setRangeSize(size_t rangeSize);
+
+    /**
+     * @brief Whether to descend into symlinks to directories (loops are detected and skipped).
+     */
+    void setFollowSymlinks(bool followSymlinks) { followSymlinks_ = followSymlinks; }
+
+    /**
+     * @brief Restricts directory searches to the files the filter accepts (nullptr: every file).
+     *
+     * Directories the filter rejects are pruned from the walk. A single file given instead of
+     * a directory is always searched.
+     */
+    void setPathFilter(std::shared_ptr<const PathFilter> filter) { pathFilter_ = std::move(filter); }
+
+    /**
+     * @brief Whether to write the output sorted by file path, reproducibly, at the end of the search.
+     */
+    void setOrderedOutput(bool orderedOutput) { orderedOutput_ = orderedOutput; }
+
+    /**
+     * @brief Delivers the results of subsequent searches to the sink instead of printing them.
+     *
+     * Nothing is written to stdout then, not even the worker report; errors still go to
+     * stderr. nullptr restores printing.
+     */
+    void setResultSink(std::shared_ptr<ResultSink> sink) { resultSink_ = std::move(sink); }
+
+    /**
+     * @brief Delivers every result of subsequent searches to the callback (calls are serialized).
+     */
+    void setResultCallback(CallbackResultSink::Callback callback);
+
+    /**
+     * @brief Narrows directory searches with the index (nullptr: search every file).
+     *
+     * The index is only used when it was built for the searched directory.
+     */
+    void setIndex(std::shared_ptr<const TrigramIndex> index) { index_ = std::move(index); }
+
+    /**
+     * @brief Stops directory searches after the first `limit` results (0: no limit).
+     *
+     * Results are matched lines, or file summaries outside of ReportMode::Lines, counted in
+     * the order they are delivered; context lines do not count.
+     */
+    void setResultLimit(size_t limit) { resultLimit_ = limit; }
+
+    /**
+     * @brief Collects the counters and timers of subsequent searches into the stats (nullptr: none).
+     *
+     * Each search restarts the stats and stops them once its output is written, so they
+     * describe the last search.
+     */
+    void setStats(std::shared_ptr<SearchStats> stats) { stats_ = std::move(stats); }
+
+    /**
+     * @brief How directory searches read files; IoBackend::Uring falls back to Sync where io_uring is unavailable.
+     */
+    void setIoBackend(IoBackend backend) { ioBackend_ = backend; }
+
+    IoBackend ioBackend() const { return ioBackend_; }
+
+    /**
+     * @brief Bounds the memory of the files in flight and of the queued output (0: no limit).
+     *
+     * The limit is soft: files already being read or searched finish, and a single file
+     * larger than the limit is still searched, alone.
+     */
+    void setMemoryLimit(size_t bytes) { memoryLimit_ = bytes; }
+
+    size_t memoryLimit() const { return memoryLimit_; }
+
 private:
+    struct SplitFile;
+    struct WorkerArena;
+
+    void searchFile(WorkStealingPool& pool, const std::filesystem::path& filePath, size_t workerIndex);
+    void searchWholeFile(const std::filesystem::path& filePath, size_t workerIndex);
+    void searchReadFile(WorkStealingPool& pool, AsyncFileReader::File& file, size_t workerIndex);
+    void countRange(WorkStealingPool& pool, const std::shared_ptr<SplitFile>& split, size_t index);
+    void searchSplitRange(const std::shared_ptr<SplitFile>& split, size_t index, size_t workerIndex);
+    static void printUtilization(const WorkStealingPool& pool, std::ostream& out);
+    const std::string& threadLabel(size_t workerIndex) const;
+
     std::unique_ptr<FileSearcher> searcher_;
-    std::string query_;      
-    bool caseSensitive_;           
+    std::shared_ptr<const CompiledPattern> pattern_;
     bool highlight_;                       
-    bool useRegex_;                          
     size_t numThreads_ = std::thread::hardware_concurrency();
-    std::mutex threadIdMutex_;
-    std::map<std::thread::id, int> threadIdMap_;
-    std::atomic<int> nextThreadId_{1};
+    size_t rangeSize_ = kDefaultRangeSize;
+    bool followSymlinks_ = false;
+    std::shared_ptr<const PathFilter> pathFilter_;
+    bool orderedOutput_ = false;
+    std::shared_ptr<ResultSink> resultSink_;
+    std::shared_ptr<const TrigramIndex> index_;
+    size_t resultLimit_ = 0;
+    std::shared_ptr<SearchStats> stats_;
+    IoBackend ioBackend_ = IoBackend::Sync;
+    size_t memoryLimit_ = 0;
+    ResultSink* sink_ = nullptr;    ///< Sink of the running search.
+    BufferPool* buffers_ = nullptr;     ///< Buffer pool of the running search.
+    WorkerArena* arenas_ = nullptr;     ///< Arenas of the running search, one per worker.
+    CancellationToken* cancellation_ = nullptr;     ///< Token of the running search.
 };
 
 /**
@@ -117,4 +551,50 @@ private:
 std::string highlightMatches(const std::string& line, const std::string& query,
                              bool caseSensitive, bool useRegex);
 
+/**
+ * @brief Highlights matches of an already compiled pattern in a given line.
+ *
+ * @param line The line of text to search and highlight.
+ * @param pattern The compiled query.
+ * @return A new string with matching parts wrapped in color codes.
+ */
+std::string highlightMatches(std::string_view line, const CompiledPattern& pattern);
+
+/**
+ * @brief Highlights the given match spans in a line.
+ *
+ * @param line The line of text.
+ * @param spans Non-overlapping spans in the line, in order (as in SearchResult::spans).
+ * @return A new string with the spans wrapped in color codes.
+ */
+std::string highlightSpans(std::string_view line, const std::vector<MatchSpan>& spans);
+
+/**
+ * @brief Appends a line with the given match spans wrapped in color codes to output.
+ *
+ * @param line The line of text.
+ * @param spans Non-overlapping spans in the line, in order.
+ * @param output Receives the highlighted line.
+ */
+void appendHighlighted(std::string_view line, const std::vector<MatchSpan>& spans, std::string& output);
+
+/**
+ * @brief Whether any line of a buffer matches the pattern (stops at the first match).
+ *
+ * @param text The buffer, searched line by line like a file.
+ * @param pattern The compiled query.
+ */
+bool containsMatch(std::string_view text, const CompiledPattern& pattern);
+
+/**
+ * @brief Appends the non-empty matches of the pattern in a line, starting at `from`, to spans.
+ *
+ * @param line The line of text.
+ * @param pattern The compiled query.
+ * @param spans Receives the spans, relative to the start of the line.
+ * @param from Offset in the line to start at.
+ */
+void findMatchSpans(std::string_view line, const CompiledPattern& pattern, std::vector<MatchSpan>& spans,
+                    size_t from = 0);
+
 #endif  // GREPLIKEUTILITY_HPP
@@ -0,0 +1,71 @@
+#ifndef LITERALMATCHER_HPP
+#define LITERALMATCHER_HPP
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+/**
+ * @brief Reusable fixed-string search engine for whole buffers.
+ *
+ * The matcher is built once per query and is immutable afterwards, so a single instance can be
+ * shared by any number of threads.
+ *
+ * Search uses a rare-byte prefilter: the two statistically rarest bytes of the needle (and
+ * their offsets) are chosen at construction. The haystack is scanned a vector at a time for
+ * positions where both bytes occur at the right distance, and only those candidates are
+ * verified with a full comparison. The vector kernel (AVX2, SSE2 or scalar) is selected at
+ * runtime from what the CPU supports. Needles containing a genuinely rare byte (control,
+ * non-ASCII or uncommon upper-case bytes) skip the pair filter and use libc memchr on that
+ * byte, which is faster when candidates almost never occur.
+ */
+class LiteralMatcher {
+public:
+    /// Candidate-scanning kernel.
+    enum class Kernel { Scalar, Sse2, Avx2 };
+
+    /**
+     * @brief Builds a matcher for the given needle using the best kernel for this CPU.
+     *
+     * @param needle The literal string to search for.
+     */
+    explicit LiteralMatcher(std::string needle);
+
+    /**
+     * @brief Builds a matcher with an explicit kernel.
+     *
+     * A kernel the CPU does not support is downgraded to the best supported one.
+     *
+     * @param needle The literal string to search for.
+     * @param kernel The kernel to use.
+     */
+    LiteralMatcher(std::string needle, Kernel kernel);
+
+    /**
+     * @brief Finds the first occurrence of the needle at or after the given offset.
+     *
+     * @param haystack The buffer to search.
+     * @param from     Offset to start searching at.
+     * @return Offset of the match, or std::string_view::npos if there is none.
+     */
+    std::size_t find(std::string_view haystack, std::size_t from = 0) const;
+
+    const std::string& needle() const { return needle_; }
+
+    Kernel kernel() const { return kernel_; }
+
+    /// Best kernel supported by the CPU running the program.
+    static Kernel bestKernel();
+
+private:
+    std::size_t findScalar(std::string_view haystack, std::size_t from) const;
+    std::size_t findSse2(std::string_view haystack, std::size_t from) const;
+    std::size_t findAvx2(std::string_view haystack, std::size_t from) const;
+
+    std::string needle_;
+    Kernel kernel_;
+    std::size_t rareOffset1_ = 0;   ///< Offset of the rarest needle byte.
+    std::size_t rareOffset2_ = 0;   ///< Offset of the second rarest byte (at a different offset).
+};
+
+#endif  // LITERALMATCHER_HPP
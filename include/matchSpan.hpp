@@ -0,0 +1,18 @@
+#ifndef MATCHSPAN_HPP
+#define MATCHSPAN_HPP
+
+#include <cstddef>
+#include <string_view>
+
+/**
+ * @brief A match location; position is npos when there is no match.
+ */
+struct MatchSpan {
+    std::size_t position = std::string_view::npos;
+    std::size_t length = 0;
+    std::size_t pattern = 0;    ///< Index of the matched pattern, when searching for a pattern list.
+
+    explicit operator bool() const { return position != std::string_view::npos; }
+};
+
+#endif  // MATCHSPAN_HPP
@@ -0,0 +1,69 @@
+#ifndef MULTILITERALMATCHER_HPP
+#define MULTILITERALMATCHER_HPP
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "matchSpan.hpp"
+
+/**
+ * @brief Finds any of a set of fixed strings in a single pass over a buffer (Aho-Corasick).
+ *
+ * The patterns are compiled into a trie whose failure links are resolved up front, giving a
+ * dense DFA that consumes one byte per step whatever the number of patterns. To keep the
+ * transition table small, bytes are mapped to equivalence classes: all bytes that occur in no
+ * pattern share one class, so the table has (distinct pattern bytes + 1) columns per state.
+ *
+ * While the automaton is in its start state, it jumps straight to the next byte that can
+ * begin a pattern; when the patterns begin with at most kMaxVectorStartBytes distinct bytes
+ * (e.g. a watchlist of error codes), that jump is an SSE2 scan of 16 bytes at a time.
+ *
+ * Case-insensitive matching folds ASCII letters only. The matcher is immutable after
+ * construction and can be shared by any number of threads.
+ */
+class MultiLiteralMatcher {
+public:
+    ///< Most distinct start bytes for which the start state is skipped with a vector scan.
+    static constexpr std::size_t kMaxVectorStartBytes = 3;
+
+    /**
+     * @brief Compiles the patterns.
+     *
+     * Empty patterns are ignored; for duplicates, the first occurrence is reported.
+     *
+     * @param patterns      The strings to search for; their index identifies them in matches.
+     * @param caseSensitive Whether to match ASCII letters case-sensitively.
+     */
+    explicit MultiLiteralMatcher(const std::vector<std::string>& patterns, bool caseSensitive = true);
+
+    /**
+     * @brief Finds the leftmost match at or after `from`, the longest one if several start there.
+     *
+     * @param text The buffer to search.
+     * @param from Offset to start searching at.
+     * @return The match, with the index of the matched pattern in MatchSpan::pattern.
+     */
+    MatchSpan find(std::string_view text, std::size_t from = 0) const;
+
+    std::size_t stateCount() const { return matchLength_.size(); }
+    std::size_t classCount() const { return classCount_; }
+
+private:
+    std::size_t skipToStart(std::string_view text, std::size_t from) const;
+
+    std::array<std::uint16_t, 256> classes_{};         ///< Byte to equivalence class.
+    std::size_t classCount_ = 1;
+    std::vector<std::uint32_t> transitions_;           ///< [state * classCount_ + class].
+    std::vector<std::uint32_t> matchLength_;           ///< Longest pattern ending in a state; 0 if none.
+    std::vector<std::uint32_t> matchPattern_;          ///< Index of that pattern.
+    std::size_t maxLength_ = 0;
+
+    std::array<bool, 256> startByte_{};                ///< Bytes leaving the start state.
+    std::string vectorStartBytes_;                     ///< The start bytes, if few enough for the vector scan.
+};
+
+#endif  // MULTILITERALMATCHER_HPP
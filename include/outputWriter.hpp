@@ -0,0 +1,88 @@
+#ifndef OUTPUTWRITER_HPP
+#define OUTPUTWRITER_HPP
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdio>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief Collects formatted output from the search workers and writes it in large batches.
+ *
+ * Workers format their matched lines into their own buffers and hand over whole chunks (a
+ * file, or a large part of one) with write(), without contending on a lock per line.
+ *
+ * In the default streaming mode a dedicated writer thread takes every chunk queued since its
+ * last write, joins them and writes them with a single fwrite + fflush, so the number of
+ * write syscalls does not grow with the number of matches. Producers block once
+ * kMaxQueuedBytes (or the limit given to the constructor) are waiting, so a slow consumer of
+ * the output (e.g. a pager) throttles the search instead of letting the queue grow without
+ * bound.
+ *
+ * In ordered mode chunks are kept per file and written sorted by path when finish() is
+ * called, which makes the output reproducible regardless of which worker searched what.
+ * Chunks of the same file must be written in order, by one thread at a time.
+ */
+class OutputWriter {
+public:
+    ///< Queued bytes at which write() blocks in streaming mode, by default.
+    static constexpr std::size_t kMaxQueuedBytes = 64 * 1024 * 1024;
+    ///< Largest batch written at once in ordered mode.
+    static constexpr std::size_t kBatchSize = 1024 * 1024;
+
+    /**
+     * @brief Constructor.
+     *
+     * @param out           Destination stream.
+     * @param orderedByPath Whether to buffer everything and write it sorted by path on finish().
+     * @param maxQueuedBytes Queued bytes at which write() blocks in streaming mode.
+     */
+    explicit OutputWriter(std::FILE* out = stdout, bool orderedByPath = false,
+                          std::size_t maxQueuedBytes = kMaxQueuedBytes);
+
+    /**
+     * @brief Finishes (see finish()) if that was not done yet.
+     */
+    ~OutputWriter();
+
+    OutputWriter(const OutputWriter&) = delete;
+    OutputWriter& operator=(const OutputWriter&) = delete;
+
+    /**
+     * @brief Queues a chunk of formatted output belonging to a file.
+     *
+     * @param path  The file the output belongs to (the sort key in ordered mode).
+     * @param chunk Complete lines of output.
+     */
+    void write(const std::string& path, std::string chunk);
+
+    /**
+     * @brief Writes everything still queued (sorted by path in ordered mode) and stops the writer thread.
+     */
+    void finish();
+
+    bool orderedByPath() const { return orderedByPath_; }
+
+private:
+    void run();
+    void emit(const std::string& batch);
+
+    std::FILE* out_;
+    bool orderedByPath_;
+    std::size_t maxQueuedBytes_;
+
+    std::mutex mutex_;
+    std::condition_variable hasOutput_;
+    std::condition_variable hasRoom_;
+    std::vector<std::string> queue_;              ///< Streaming mode: chunks not yet written.
+    std::size_t queuedBytes_ = 0;
+    std::map<std::string, std::string> byPath_;   ///< Ordered mode: all output, keyed by path.
+    bool finished_ = false;
+    std::thread writer_;
+};
+
+#endif  // OUTPUTWRITER_HPP
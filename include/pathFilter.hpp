@@ -0,0 +1,148 @@
+#ifndef PATHFILTER_HPP
+#define PATHFILTER_HPP
+
+#include <array>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "globMatcher.hpp"
+
+/**
+ * @brief The rules of the ignore files of one directory, chained to those of its ancestors.
+ *
+ * Rules follow the .gitignore format: one glob per line, `#` comments, a leading `!` re-includes
+ * what an earlier rule ignored, a trailing `/` restricts a rule to directories, and a rule
+ * containing a '/' (other than a trailing one) is anchored to the directory of its file, while
+ * any other rule matches a name at any depth below it.
+ *
+ * Precedence is git's: within a directory the last matching rule wins, and the rules of a
+ * directory override those of its ancestors, whose rules only decide paths the deeper ones do
+ * not mention. Paths are never tested below an ignored directory (the walk prunes it), so, as
+ * in git, a file cannot be re-included once its directory is ignored.
+ */
+class IgnoreRules {
+public:
+    /**
+     * @brief Constructor.
+     *
+     * @param parent    The rules in effect in the parent directory, or nullptr.
+     * @param directory The directory of the ignore files, relative to the walk root, with a
+     *                  trailing '/' ("" for the root).
+     */
+    IgnoreRules(std::shared_ptr<const IgnoreRules> parent, std::string directory);
+
+    /**
+     * @brief Adds the rules of an ignore file; they take precedence over those added before.
+     */
+    void add(std::string_view contents);
+
+    bool empty() const { return globs_.empty(); }
+
+    /**
+     * @brief Whether a path below the directory is ignored by these rules or an ancestor's.
+     *
+     * @param path        The path relative to the walk root, without a trailing '/'.
+     * @param isDirectory Whether the path is a directory.
+     */
+    bool ignored(std::string_view path, bool isDirectory) const;
+
+private:
+    std::shared_ptr<const IgnoreRules> parent_;
+    std::string directory_;
+    GlobSet globs_;
+    std::vector<bool> negated_;         ///< Per glob: whether it is a `!` rule.
+};
+
+/**
+ * @brief Decides which files and directories a directory walk visits.
+ *
+ * Combines the ignore files found during the walk (.gitignore, and .ignore, whose rules take
+ * precedence over those of .gitignore in the same directory) with globs given by the user:
+ * excludes drop the files and directories they match, includes and file types keep only the
+ * files matching at least one of them. A directory that is ignored or excluded is pruned: the
+ * walk never opens it. With ignore files enabled, `.git` directories are always pruned.
+ *
+ * Globs without a '/' match the name of a file or directory, others the path relative to the
+ * walk root (see GlobMatcher). A PathFilter is immutable while a walk uses it and can be
+ * shared by the walker threads.
+ */
+class PathFilter {
+public:
+    ///< Ignore files read in every directory, lowest precedence first.
+    static constexpr std::array<const char*, 2> kIgnoreFileNames = {".gitignore", ".ignore"};
+
+    /// Reads the file of that name in the directory being entered; false if there is none.
+    using ReadFile = std::function<bool(const char* name, std::string& contents)>;
+
+    /**
+     * @brief Whether to honor ignore files (and prune `.git`); off by default.
+     */
+    void setUseIgnoreFiles(bool use) { useIgnoreFiles_ = use; }
+    bool usesIgnoreFiles() const { return useIgnoreFiles_; }
+
+    /**
+     * @brief Only search the files matching this glob (or another include).
+     */
+    void addInclude(std::string_view glob) { includes_.add(glob); }
+
+    /**
+     * @brief Skip the files and directories matching this glob.
+     */
+    void addExclude(std::string_view glob) { excludes_.add(glob); }
+
+    /**
+     * @brief Only search files of this type (or another added type), e.g. "cpp" or "py".
+     *
+     * @return false if the type is not known (see typeNames()).
+     */
+    bool addType(std::string_view name);
+
+    /**
+     * @brief The names of the known file types, with their globs (e.g. "py: *.py, *.pyi").
+     */
+    static std::vector<std::string> typeNames();
+
+    /**
+     * @brief Whether the filter drops anything at all; an inactive filter need not be consulted.
+     */
+    bool active() const;
+
+    /**
+     * @brief The rules in effect in a directory the walk is entering.
+     *
+     * @param parent    The rules in effect in its parent (nullptr at the walk root).
+     * @param directory The directory relative to the walk root, with a trailing '/' ("" for the root).
+     * @param readFile  Reads a file of the directory.
+     * @return parent itself unless the directory has ignore files.
+     */
+    std::shared_ptr<const IgnoreRules> enterDirectory(const std::shared_ptr<const IgnoreRules>& parent,
+                                                      const std::string& directory,
+                                                      const ReadFile& readFile) const;
+
+    /**
+     * @brief Whether the walk descends into a directory.
+     *
+     * @param rules The rules in effect in the directory containing it (may be nullptr).
+     * @param path  The directory relative to the walk root, without a trailing '/'.
+     */
+    bool acceptsDirectory(const IgnoreRules* rules, std::string_view path) const;
+
+    /**
+     * @brief Whether the walk reports a file.
+     *
+     * @param rules The rules in effect in the directory containing it (may be nullptr).
+     * @param path  The file relative to the walk root.
+     */
+    bool acceptsFile(const IgnoreRules* rules, std::string_view path) const;
+
+private:
+    bool useIgnoreFiles_ = false;
+    GlobSet includes_;
+    GlobSet excludes_;
+    GlobSet types_;
+};
+
+#endif  // PATHFILTER_HPP
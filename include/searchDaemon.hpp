@@ -0,0 +1,235 @@
+#ifndef SEARCHDAEMON_HPP
+#define SEARCHDAEMON_HPP
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <set>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "cancellationToken.hpp"
+#include "compiledPattern.hpp"
+#include "fileBuffer.hpp"
+#include "grepLikeUtility.hpp"
+#include "pathFilter.hpp"
+#include "searchResult.hpp"
+#include "textEncoding.hpp"
+#include "workStealingPool.hpp"
+
+/**
+ * @brief One request to a SearchDaemon, as sent over its socket.
+ *
+ * Requests and responses are lines of tab-separated fields; backslashes, tabs and newlines in
+ * a field are escaped as `\\`, `\t` and `\n`.
+ *
+ *     search <TAB> options <TAB> path <TAB> query       options: comma-separated, any of
+ *                                                       ignore-case, regex, engine=std,
+ *                                                       timeout-ms=<n>, binary=skip|text,
+ *                                                       decompress
+ *     rescan                                            re-walk the served directory
+ *     cancel                                            (while a search runs) stop it
+ *
+ * A search is answered with one line per matched line, then a status line:
+ *
+ *     match <TAB> path <TAB> line <TAB> byte offset <TAB> spans <TAB> text
+ *     binary <TAB> path                                 (a binary file matches)
+ *     done <TAB> matches | cancelled <TAB> deadline|client|shutdown | error <TAB> message
+ *
+ * where spans is a comma-separated list of `position:length`, and a search is cancelled by
+ * its deadline, by the client, or by the daemon shutting down. A rescan is answered with
+ * `done <TAB> files`.
+ */
+struct DaemonRequest {
+    enum class Kind { Search, Rescan };
+
+    Kind kind = Kind::Search;
+    std::string query;
+    bool caseSensitive = true;
+    bool useRegex = false;
+    RegexEngine engine = RegexEngine::Automaton;
+    std::filesystem::path path;                 ///< Directory or file to search; empty: the whole served tree.
+    std::chrono::milliseconds timeout{0};      ///< Deadline from the arrival of the request; 0: none.
+    BinaryPolicy binaryPolicy = BinaryPolicy::Report;
+    bool decompress = false;                   ///< Search inside compressed files (see CompressedFileSearcher).
+
+    /**
+     * @brief The request line, without its terminating newline.
+     */
+    std::string encode() const;
+
+    /**
+     * @brief Parses a request line (without its newline).
+     *
+     * @return The request, or std::nullopt with a description of the problem in error.
+     */
+    static std::optional<DaemonRequest> decode(std::string_view line, std::string& error);
+};
+
+/**
+ * @brief Resident search server answering queries over a Unix domain socket.
+ *
+ * Starting a search process for every query pays for process startup, a cold directory walk
+ * and page-cache misses on metadata. The daemon walks its directory once and keeps the sorted
+ * file list; it is walked again every rescan interval in the background, or on a rescan
+ * request. Queries are compiled through the global PatternCache, so repeated queries are not
+ * recompiled, and memory-mapped files (those of at least FileBuffer::kMapThreshold bytes) stay
+ * mapped in an LRU cache bounded by the mapping budget, revalidated against their size and
+ * modification time on every use.
+ *
+ * Every connection is served by its own thread, which handles its requests one at a time. The
+ * files of a search are searched on one WorkStealingPool shared by all connections, so
+ * concurrent queries share the workers instead of multiplying threads. Files larger than
+ * kRangeSize are searched range by range, so a search notices cancellation quickly even in a
+ * huge file. Each search has a CancellationToken, checked between files and ranges, which
+ * is cancelled by its deadline, by a `cancel` line from the client, or by the client
+ * disconnecting. Results are streamed back through an OutputWriter as they are found; a client
+ * that stops reading a cancelled search is disconnected rather than holding the workers.
+ *
+ * POSIX only; elsewhere listen() fails.
+ */
+class SearchDaemon {
+public:
+    ///< Default interval between background rescans of the served directory.
+    static constexpr std::chrono::seconds kDefaultRescanInterval{60};
+    ///< Default bound on the bytes of memory-mapped files kept open between queries.
+    static constexpr std::size_t kDefaultMappingBudget = std::size_t(1) << 30;
+    ///< Files are searched in ranges of this size, checking for cancellation in between.
+    static constexpr std::size_t kRangeSize = 8 * 1024 * 1024;
+    ///< Files searched per pool task.
+    static constexpr std::size_t kFilesPerTask = 16;
+    ///< How long a cancelled search waits for its client to read the pending results.
+    static constexpr std::chrono::milliseconds kDrainTimeout{1000};
+    ///< Longest request line accepted.
+    static constexpr std::size_t kMaxRequestLength = 1024 * 1024;
+
+    /**
+     * @brief Constructor.
+     *
+     * @param root           The directory to serve.
+     * @param numThreads     Number of search workers shared by all queries; 0 selects
+     *                       std::thread::hardware_concurrency().
+     * @param followSymlinks Whether to descend into symlinks to directories.
+     */
+    explicit SearchDaemon(std::filesystem::path root, std::size_t numThreads = 0, bool followSymlinks = false);
+
+    /**
+     * @brief Stops serving (see requestStop()) and removes the socket.
+     */
+    ~SearchDaemon();
+
+    SearchDaemon(const SearchDaemon&) = delete;
+    SearchDaemon& operator=(const SearchDaemon&) = delete;
+
+    /**
+     * @brief Walks the directory and binds the socket (readable by the current user only).
+     *
+     * A stale socket file left by a daemon that is gone is replaced; a socket another daemon
+     * still answers on is not.
+     *
+     * @return false if the directory cannot be read or the socket cannot be bound; error() says why.
+     */
+    bool listen(const std::filesystem::path& socketPath);
+
+    /**
+     * @brief Accepts and serves connections until requestStop() is called.
+     *
+     * On return, the running searches have been cancelled and every connection closed.
+     */
+    void run();
+
+    /**
+     * @brief Makes run() return. Async-signal-safe, so it may be called from a signal handler.
+     */
+    void requestStop();
+
+    /**
+     * @brief Walks the directory again and replaces the file list.
+     *
+     * @return The number of files found.
+     */
+    std::size_t rescan();
+
+    const std::string& error() const { return error_; }
+
+    /// Canonical path of the served directory.
+    const std::filesystem::path& root() const { return root_; }
+
+    std::size_t fileCount() const;
+
+    void setRescanInterval(std::chrono::seconds interval) { rescanInterval_ = interval; }
+    void setMappingBudget(std::size_t bytes) { mappingBudget_ = bytes; }
+
+    /**
+     * @brief Restricts the served files to those the filter accepts; call before listen().
+     */
+    void setPathFilter(std::shared_ptr<const PathFilter> filter) { filter_ = std::move(filter); }
+
+    /**
+     * @brief Sends a request to the daemon listening on a socket (the client side).
+     *
+     * The results of a search are delivered to the sink as they arrive, in batches of
+     * consecutive lines of one file, without a thread id: the daemon does not report which
+     * of its workers found them, so ConsoleFormatter prints them as `path:line: line`.
+     *
+     * @return The number from the final `done` line (matches, or files for a rescan), or
+     *         std::nullopt if the search failed or was cancelled; error says why.
+     */
+    static std::optional<std::size_t> query(const std::filesystem::path& socketPath, const DaemonRequest& request,
+                                            ResultSink& sink, std::string& error);
+
+private:
+    struct Connection;
+    struct CachedFile {
+        std::string path;
+        std::shared_ptr<const FileBuffer> buffer;
+        std::int64_t size = 0;
+        std::int64_t modificationTime = 0;
+    };
+
+    void serveConnection(const std::shared_ptr<Connection>& connection);
+    void runSearch(Connection& connection, const DaemonRequest& request);
+    void searchFile(const std::string& path, const CompiledPattern& pattern, const DaemonRequest& request,
+                    const CancellationToken& token, ResultSink& sink);
+    std::shared_ptr<const FileBuffer> mapFile(const std::string& path);
+    std::shared_ptr<const std::vector<std::string>> files() const;
+    void runRescans();
+
+    std::filesystem::path root_;
+    std::size_t numThreads_;
+    bool followSymlinks_;
+    std::chrono::seconds rescanInterval_ = kDefaultRescanInterval;
+    std::size_t mappingBudget_ = kDefaultMappingBudget;
+    std::shared_ptr<const PathFilter> filter_;
+    std::string error_;
+    TextFileSearcher searcher_;
+    std::unique_ptr<WorkStealingPool> pool_;
+
+    mutable std::mutex filesMutex_;
+    std::shared_ptr<const std::vector<std::string>> files_;   ///< Sorted paths of the regular files.
+
+    std::mutex cacheMutex_;
+    std::list<CachedFile> cache_;                                      ///< Most recently used first.
+    std::unordered_map<std::string, std::list<CachedFile>::iterator> cacheIndex_;
+    std::size_t cachedBytes_ = 0;
+
+    std::filesystem::path socketPath_;
+    int listenFd_ = -1;
+    int stopPipe_[2] = {-1, -1};
+    std::atomic<bool> stopping_{false};
+
+    std::mutex connectionsMutex_;                  ///< Guards connections_, also used to wake the rescanner.
+    std::condition_variable connectionsChanged_;
+    std::set<std::shared_ptr<Connection>> connections_;
+};
+
+#endif  // SEARCHDAEMON_HPP
@@ -0,0 +1,80 @@
+#ifndef SEARCHRESULT_HPP
+#define SEARCHRESULT_HPP
+
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "matchSpan.hpp"
+
+/**
+ * @brief What a search reports for every file.
+ */
+enum class ReportMode {
+    Lines,              ///< Every matched line.
+    FilesWithMatches,   ///< The path of every file with a match; a file is done at its first match.
+    Count,              ///< The number of matched lines of every file with a match.
+};
+
+/**
+ * @brief One matched line, a context line, a binary file that matches, or the summary of a file.
+ */
+struct SearchResult {
+    std::string path;               ///< The file, as it was found (root / relative path).
+    std::size_t lineNumber = 0;     ///< 1-based line number.
+    std::size_t byteOffset = 0;     ///< Offset of the first byte of the line in the file.
+    std::string line;               ///< The line, without its terminating newline.
+    std::vector<MatchSpan> spans;   ///< Non-empty matches in the line, relative to its start, in order.
+    bool binary = false;            ///< A binary file with a match (BinaryPolicy::Report); only path is set.
+    std::size_t matchCount = 0;     ///< A file summary (ReportMode other than Lines) if non-zero: the
+                                    ///< matched lines counted; only path is set.
+    bool context = false;           ///< A line around a matched line (context lines), not a match; no spans.
+    bool gapBefore = false;         ///< With context lines: lines of the file were left out before this one.
+};
+
+/**
+ * @brief Receives the results of a search.
+ *
+ * Searchers deliver results in batches, each holding consecutive matched (and context) lines
+ * of one file in line order. consume() is called concurrently from the search workers; the batches of
+ * one file are delivered one after another and in file order.
+ */
+class ResultSink {
+public:
+    virtual ~ResultSink() = default;
+
+    /**
+     * @brief Receives a batch of results of one file.
+     *
+     * @param results     The results; the sink may move from them.
+     * @param threadIdStr Identifier of the worker that found them.
+     */
+    virtual void consume(std::vector<SearchResult>& results, const std::string& threadIdStr) = 0;
+};
+
+/**
+ * @brief ResultSink that passes every result to a callback, one call at a time.
+ *
+ * Calls are serialized, so the callback needs no synchronization of its own.
+ */
+class CallbackResultSink : public ResultSink {
+public:
+    using Callback = std::function<void(const SearchResult&)>;
+
+    explicit CallbackResultSink(Callback callback) : callback_(std::move(callback)) {}
+
+    void consume(std::vector<SearchResult>& results, const std::string& /*threadIdStr*/) override {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (const auto& result : results)
+            callback_(result);
+    }
+
+private:
+    Callback callback_;
+    std::mutex mutex_;
+};
+
+#endif  // SEARCHRESULT_HPP
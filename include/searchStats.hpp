@@ -0,0 +1,168 @@
+#ifndef SEARCHSTATS_HPP
+#define SEARCHSTATS_HPP
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <ostream>
+
+/**
+ * @brief Counters and timers of the hot paths of a search: walk, open, read, match, output.
+ *
+ * Instrumented code records with the static add() and with Timer, without knowing whether
+ * anything collects. Between start() and stop() of a SearchStats, each thread that records
+ * gets its own block of counters on first use (one lock per thread and search) and then
+ * increments it without synchronization; the report sums the blocks. While no SearchStats
+ * collects, add() and Timer cost one atomic load and a branch, and timers never read the clock.
+ *
+ * Timers measure exclusive time: what a nested timer of the same thread measures (e.g. output
+ * handed over while matching a file) is not counted again by the enclosing one. All times are
+ * summed over the threads, so they can add up to more than the wall time.
+ *
+ * One SearchStats collects at a time; start() takes over from any other. stop() must be
+ * called once the threads of the search are done recording, and before the object is destroyed.
+ */
+class SearchStats {
+    struct ThreadCounters;
+
+public:
+    using Clock = std::chrono::steady_clock;
+
+    enum class Counter : std::size_t {
+        DirectoriesRead,        ///< Directories listed by the walker.
+        FilesWalked,            ///< Files the walker handed over for searching.
+        WalkNs,                 ///< Listing directories and handing over their files.
+        FilesSearched,          ///< Files taken by the search (split files count once).
+        BytesRead,              ///< Bytes of files opened as a whole (mapped files are paged in while matching).
+        OpenNs,                 ///< Opening files and reading their size.
+        ReadNs,                 ///< Reading or mapping file contents.
+        LineCountNs,            ///< Counting the lines of the ranges of split files (pages mapped files in).
+        LiteralBytes,           ///< Bytes scanned by literal (including case-insensitive) patterns.
+        LiteralMatchNs,
+        RegexBytes,             ///< Bytes scanned by regular expressions.
+        RegexMatchNs,
+        RegexLinesVerified,     ///< Candidate lines the regex had to be run on.
+        MatchedLines,
+        DecompressNs,           ///< Decompressing, including waiting for the search to take chunks.
+        OutputNs,               ///< Formatting results.
+        OutputWaitNs,           ///< Waiting for the output lock, or for the writer to make room.
+        WriteNs,                ///< Writing output to the destination stream.
+        MemoryWaitNs,           ///< Waiting for the files in flight to fit into the memory limit.
+    };
+    static constexpr std::size_t kCounters = static_cast<std::size_t>(Counter::MemoryWaitNs) + 1;
+
+    /**
+     * @brief Adds the exclusive time of its scope to a counter, if stats are being collected.
+     */
+    class Timer {
+    public:
+        explicit Timer(Counter counter) : counters_(local()), counter_(counter) {
+            if (counters_) {
+                timedBefore_ = counters_->timedNs;
+                start_ = Clock::now();
+            }
+        }
+
+        ~Timer() {
+            if (!counters_)
+                return;
+            const auto elapsed = static_cast<std::uint64_t>(
+                std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start_).count());
+            const std::uint64_t nested = counters_->timedNs - timedBefore_;
+            counters_->values[index(counter_)] += elapsed - std::min(nested, elapsed);
+            counters_->timedNs = timedBefore_ + elapsed;
+        }
+
+        Timer(const Timer&) = delete;
+        Timer& operator=(const Timer&) = delete;
+
+    private:
+        ThreadCounters* counters_;
+        Counter counter_;
+        std::uint64_t timedBefore_ = 0;
+        Clock::time_point start_;
+    };
+
+    SearchStats() = default;
+    SearchStats(const SearchStats&) = delete;
+    SearchStats& operator=(const SearchStats&) = delete;
+
+    /**
+     * @brief Discards earlier counts and starts collecting from every thread.
+     */
+    void start();
+
+    /**
+     * @brief Stops collecting and records the wall time since start().
+     */
+    void stop();
+
+    /**
+     * @brief Adds to a counter of the calling thread, if stats are being collected.
+     */
+    static void add(Counter counter, std::uint64_t amount = 1) {
+        if (ThreadCounters* counters = local())
+            counters->values[index(counter)] += amount;
+    }
+
+    /**
+     * @brief The sum of a counter over all threads.
+     */
+    std::uint64_t total(Counter counter) const;
+
+    /**
+     * @brief The number of threads that recorded anything.
+     */
+    std::size_t threads() const;
+
+    /**
+     * @brief The wall time between start() and stop().
+     */
+    std::chrono::nanoseconds elapsed() const { return elapsed_; }
+
+    /**
+     * @brief The name of a counter in the JSON report, e.g. "files_walked".
+     */
+    static const char* name(Counter counter);
+
+    /**
+     * @brief Writes a readable report, a few lines grouped by stage.
+     */
+    void print(std::ostream& out) const;
+
+    /**
+     * @brief Writes the report as one JSON object: wall time, threads and every counter.
+     */
+    void printJson(std::ostream& out) const;
+
+private:
+    struct alignas(64) ThreadCounters {
+        std::array<std::uint64_t, kCounters> values{};
+        std::uint64_t timedNs = 0;      ///< Time measured by the timers of the thread so far.
+    };
+
+    static constexpr std::size_t index(Counter counter) { return static_cast<std::size_t>(counter); }
+
+    /// The counters of the calling thread, or nullptr when nothing collects.
+    static ThreadCounters* local() {
+        SearchStats* active = active_.load(std::memory_order_acquire);
+        return active ? active->countersOfThisThread() : nullptr;
+    }
+
+    ThreadCounters* countersOfThisThread();
+
+    static std::atomic<SearchStats*> active_;
+
+    mutable std::mutex mutex_;
+    std::deque<ThreadCounters> threads_;    ///< Never reallocates: blocks stay where threads found them.
+    std::uint64_t generation_ = 0;          ///< Tells threads that cached the blocks of an earlier start() apart.
+    Clock::time_point started_{};
+    std::chrono::nanoseconds elapsed_{0};
+};
+
+#endif  // SEARCHSTATS_HPP
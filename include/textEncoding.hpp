@@ -0,0 +1,69 @@
+#ifndef TEXTENCODING_HPP
+#define TEXTENCODING_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+/**
+ * @brief How the contents of a file are to be interpreted.
+ */
+enum class TextEncoding {
+    Text,       ///< Bytes searched as they are (ASCII, UTF-8, Latin-1, ...).
+    Utf16LE,    ///< UTF-16, little endian, announced by a byte order mark.
+    Utf16BE,    ///< UTF-16, big endian, announced by a byte order mark.
+    Binary      ///< Not text: a NUL byte in the first block.
+};
+
+/**
+ * @brief What a search does with binary files.
+ */
+enum class BinaryPolicy {
+    Skip,       ///< Do not search them.
+    Report,     ///< Report "Binary file ... matches" once instead of the matched lines.
+    Text        ///< Search them like text files.
+};
+
+///< Bytes at the start of a file inspected by detectEncoding().
+constexpr std::size_t kEncodingSniffSize = 64 * 1024;
+
+/**
+ * @brief Classifies a file from its first bytes (only the first kEncodingSniffSize are read).
+ *
+ * A UTF-16 byte order mark selects UTF-16; otherwise a NUL byte marks the file as binary,
+ * since text files do not contain NUL bytes but almost every binary format does.
+ */
+TextEncoding detectEncoding(std::string_view head);
+
+/**
+ * @brief Streaming UTF-16 to UTF-8 transcoder.
+ *
+ * Input may be split at any byte: an odd trailing byte or a high surrogate at the end of a
+ * chunk is carried over to the next. Unpaired surrogates become U+FFFD. A byte order mark at
+ * the very start is dropped.
+ */
+class Utf16Decoder {
+public:
+    explicit Utf16Decoder(bool bigEndian) : bigEndian_(bigEndian) {}
+
+    /**
+     * @brief Appends the UTF-8 encoding of the next chunk of UTF-16 input to output.
+     */
+    void decode(std::string_view input, std::string& output);
+
+    /**
+     * @brief Ends the input: an incomplete trailing code unit or surrogate pair becomes U+FFFD.
+     */
+    void finish(std::string& output);
+
+private:
+    void emit(std::uint16_t unit, std::string& output);
+
+    bool bigEndian_;
+    bool started_ = false;          ///< Whether the first code unit (a possible BOM) was seen.
+    int pendingByte_ = -1;          ///< First byte of a code unit split across chunks.
+    std::uint16_t highSurrogate_ = 0;
+};
+
+#endif  // TEXTENCODING_HPP
@@ -0,0 +1,130 @@
+#ifndef TRIGRAMINDEX_HPP
+#define TRIGRAMINDEX_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "fileBuffer.hpp"
+#include "pathFilter.hpp"
+
+class CompiledPattern;
+
+/**
+ * @brief Persistent trigram index of a directory tree, used to skip files that cannot match.
+ *
+ * build() walks a tree and records, for every regular file, its path (relative to the root),
+ * size and modification time, and for every trigram (three consecutive bytes, with ASCII
+ * letters folded to lower case) the sorted list of files containing it; UTF-16 files are
+ * indexed as the UTF-8 text the search transcodes them to. The posting lists
+ * are stored delta- and varint-encoded; the file table and the sorted trigram table have
+ * fixed-size entries, so an opened index is used in place from a FileBuffer (memory-mapped
+ * for large indexes) without being parsed.
+ *
+ * A query is reduced to the trigrams its matches must contain: those of a literal query, of
+ * each pattern of a pattern list (any of which may match), or of the literal every match of
+ * an automaton regex contains. Case-insensitive queries only use trigrams made of ASCII bytes
+ * other than 'k' and 's', since non-ASCII characters can fold to those two. Queries without
+ * such trigrams (short literals, std::regex) are not narrowed.
+ *
+ * The index only ever rules files out: a file that is not in the index, or whose size or
+ * modification time changed since it was indexed, is always searched, so searching with the
+ * index gives the same results as a full scan.
+ *
+ * File layout (native byte order): a Header, fileCount FileEntry records, the path bytes,
+ * trigramCount TrigramEntry records sorted by trigram, then the posting lists.
+ */
+class TrigramIndex {
+public:
+    ///< Files read in parallel per batch while building; bounds the memory for unmerged trigrams.
+    static constexpr std::size_t kBuildBatchSize = 1024;
+
+    /**
+     * @brief Indexes the tree below root and writes the index file.
+     *
+     * The index is written to a temporary file that replaces indexFile when complete, so
+     * searches never see a partial index. Unreadable directories and files are reported on
+     * std::cerr and left out (they are then always searched).
+     *
+     * @param root           The directory to index.
+     * @param indexFile      Where to write the index.
+     * @param numThreads     Number of threads walking and reading the tree.
+     * @param followSymlinks Whether to descend into symlinks to directories.
+     * @param filter         Restricts the indexed files (nullptr: all files).
+     * @return The number of files indexed, or std::nullopt if the index could not be written.
+     */
+    static std::optional<std::size_t> build(const std::filesystem::path& root, const std::filesystem::path& indexFile,
+                                            std::size_t numThreads, bool followSymlinks = false,
+                                            std::shared_ptr<const PathFilter> filter = nullptr);
+
+    /**
+     * @brief Opens an index file, replacing any index opened before.
+     *
+     * @return false if the file cannot be read or is not a valid index; error() says why.
+     */
+    bool open(const std::filesystem::path& indexFile);
+
+    const std::string& error() const { return error_; }
+
+    /// Canonical path of the indexed directory.
+    const std::filesystem::path& root() const { return root_; }
+
+    std::size_t fileCount() const { return fileCount_; }
+    std::size_t trigramCount() const { return trigramCount_; }
+
+    /**
+     * @brief The indexed files that may contain a match of the pattern.
+     *
+     * @return One flag per file id, or std::nullopt if the pattern cannot be narrowed.
+     */
+    std::optional<std::vector<bool>> candidates(const CompiledPattern& pattern) const;
+
+    /**
+     * @brief Id of the file at a path relative to the root, or npos if it is not indexed.
+     */
+    std::size_t findFile(std::string_view relativePath) const;
+
+    /**
+     * @brief Whether a file still has the size and modification time it was indexed with.
+     */
+    bool isFresh(std::size_t fileId, const std::filesystem::path& filePath) const;
+
+    /**
+     * @brief Trigram key of three bytes, with ASCII letters folded to lower case.
+     */
+    static std::uint32_t trigramKey(unsigned char a, unsigned char b, unsigned char c);
+
+    /**
+     * @brief Modification time of a file as stored in the index (0 if it cannot be read).
+     */
+    static std::int64_t modificationTime(const std::filesystem::path& filePath);
+
+private:
+    struct Header;
+    struct FileEntry;
+    struct TrigramEntry;
+
+    std::string_view filePath(std::size_t fileId) const;
+    FileEntry fileEntry(std::size_t fileId) const;
+    std::vector<std::uint32_t> postings(std::uint32_t trigram) const;
+    static std::vector<std::vector<std::uint32_t>> requiredTrigrams(const CompiledPattern& pattern);
+
+    FileBuffer buffer_;
+    std::string error_;
+    std::filesystem::path root_;
+    std::size_t fileCount_ = 0;
+    std::size_t trigramCount_ = 0;
+    const char* files_ = nullptr;
+    const char* paths_ = nullptr;
+    const char* trigrams_ = nullptr;
+    const char* postings_ = nullptr;
+    std::size_t postingsSize_ = 0;
+    std::size_t pathsSize_ = 0;
+};
+
+#endif  // TRIGRAMINDEX_HPP
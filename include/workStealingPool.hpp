@@ -0,0 +1,103 @@
+#ifndef WORKSTEALINGPOOL_HPP
+#define WORKSTEALINGPOOL_HPP
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief Fixed-size thread pool with one task deque per worker and work stealing.
+ *
+ * Tasks submitted from outside the pool are dealt round-robin to the workers' deques; tasks
+ * submitted by a running task go to the submitting worker's own deque. A worker pops from the
+ * back of its own deque (most recently split work first, which keeps its data hot) and, when
+ * that is empty, steals from the front of the other workers' deques, so one worker that drew
+ * a large piece of work never leaves the others idle while work remains.
+ *
+ * Each task receives the index of the worker running it, which callers use to label output
+ * and to keep per-worker state without locking.
+ */
+class WorkStealingPool {
+public:
+    using Task = std::function<void(std::size_t workerIndex)>;
+
+    /// What a worker did since the pool started.
+    struct WorkerStats {
+        std::size_t tasks = 0;                  ///< Tasks run.
+        std::size_t stolen = 0;                 ///< Tasks taken from another worker's deque.
+        std::chrono::nanoseconds busy{0};       ///< Time spent running tasks.
+    };
+
+    /**
+     * @brief Starts the workers.
+     *
+     * @param numThreads Number of worker threads (at least 1).
+     */
+    explicit WorkStealingPool(std::size_t numThreads);
+
+    /**
+     * @brief Waits for queued tasks to finish, then stops and joins the workers.
+     */
+    ~WorkStealingPool();
+
+    WorkStealingPool(const WorkStealingPool&) = delete;
+    WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+    /**
+     * @brief Queues a task; may be called from any thread, including from inside a task.
+     */
+    void submit(Task task);
+
+    /**
+     * @brief Blocks until every submitted task (and every task those submitted) has finished.
+     *
+     * If a task threw, the first exception is rethrown here.
+     */
+    void wait();
+
+    std::size_t size() const { return workers_.size(); }
+
+    /**
+     * @brief Per-worker statistics; only consistent once wait() has returned.
+     */
+    std::vector<WorkerStats> stats() const;
+
+    /// Time since the pool was started.
+    std::chrono::nanoseconds elapsed() const { return std::chrono::steady_clock::now() - started_; }
+
+private:
+    struct Worker {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+        WorkerStats stats;
+    };
+
+    void run(std::size_t index);
+    bool popLocal(std::size_t index, Task& task);
+    bool steal(std::size_t thief, Task& task);
+    void finishTask();
+
+    std::vector<std::unique_ptr<Worker>> workers_;
+    std::vector<std::thread> threads_;
+    std::chrono::steady_clock::time_point started_;
+
+    std::mutex mutex_;                       ///< Guards sleeping, stopping_ and error_.
+    std::condition_variable workAvailable_;
+    std::condition_variable allDone_;
+    std::atomic<std::size_t> queued_{0};     ///< Tasks sitting in any deque; raised before the push.
+    std::atomic<std::size_t> sleepers_{0};   ///< Workers waiting for work; raised under mutex_.
+    std::atomic<std::size_t> pending_{0};    ///< Tasks submitted and not finished yet.
+    std::atomic<std::size_t> nextWorker_{0}; ///< Round-robin target for external submissions.
+    bool stopping_ = false;
+    std::exception_ptr error_;
+};
+
+#endif  // WORKSTEALINGPOOL_HPP
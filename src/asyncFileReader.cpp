@@ -0,0 +1,476 @@
+#include "asyncFileReader.hpp"
+#include "searchStats.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <system_error>
+#include <utility>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+#define FILESEARCHER_HAVE_IO_URING 1
+#include <atomic>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#endif
+
+namespace {
+
+/// The step a submission belongs to, kept in the low bits of its user data.
+enum Step : std::uint64_t { Stat = 0, Open = 1, Read = 2 };
+constexpr unsigned kStepBits = 2;
+constexpr std::uint64_t kStepMask = (1u << kStepBits) - 1;
+
+}  // namespace
+
+/**
+ * @brief A file being read: the File handed out by take(), and what its reads need meanwhile.
+ */
+struct AsyncFileReader::Slot {
+    File file;
+    std::string pathString;         ///< The path as the kernel reads it.
+    int fd = -1;
+    std::size_t size = 0;           ///< Size reported by stat; reading continues past it if the file grew.
+    std::size_t used = 0;           ///< Bytes read so far.
+    char* data = nullptr;           ///< The block reserved in file.buffer.
+#ifdef FILESEARCHER_HAVE_IO_URING
+    struct statx stat {};
+#endif
+};
+
+#ifdef FILESEARCHER_HAVE_IO_URING
+
+/**
+ * @brief An io_uring instance: the shared submission and completion rings and the submission entries.
+ */
+struct AsyncFileReader::Ring {
+    int fd = -1;
+    void* sqMap = MAP_FAILED;
+    std::size_t sqMapSize = 0;
+    void* cqMap = MAP_FAILED;
+    std::size_t cqMapSize = 0;
+    io_uring_sqe* sqes = static_cast<io_uring_sqe*>(MAP_FAILED);
+    std::size_t sqesSize = 0;
+
+    unsigned* sqTail = nullptr;
+    unsigned sqMask = 0;
+    unsigned* sqArray = nullptr;
+    unsigned* cqHead = nullptr;
+    unsigned* cqTail = nullptr;
+    unsigned cqMask = 0;
+    io_uring_cqe* cqes = nullptr;
+    unsigned prepared = 0;          ///< Entries written since the last submission.
+
+    ~Ring() {
+        if (sqes != MAP_FAILED)
+            ::munmap(sqes, sqesSize);
+        if (cqMap != MAP_FAILED && cqMap != sqMap)
+            ::munmap(cqMap, cqMapSize);
+        if (sqMap != MAP_FAILED)
+            ::munmap(sqMap, sqMapSize);
+        if (fd >= 0)
+            ::close(fd);
+    }
+
+    /**
+     * @brief Sets up a ring with room for `entries` submissions, or nullptr if io_uring is unusable.
+     */
+    static std::unique_ptr<Ring> create(unsigned entries) {
+        io_uring_params params{};
+        auto ring = std::make_unique<Ring>();
+        ring->fd = static_cast<int>(::syscall(__NR_io_uring_setup, entries, &params));
+        if (ring->fd < 0 || !ring->supportsSteps())
+            return nullptr;
+
+        ring->sqMapSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        ring->cqMapSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        if (params.features & IORING_FEAT_SINGLE_MMAP)
+            ring->sqMapSize = ring->cqMapSize = std::max(ring->sqMapSize, ring->cqMapSize);
+        ring->sqMap = ::mmap(nullptr, ring->sqMapSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd,
+                             IORING_OFF_SQ_RING);
+        if (ring->sqMap == MAP_FAILED)
+            return nullptr;
+        ring->cqMap = params.features & IORING_FEAT_SINGLE_MMAP
+                          ? ring->sqMap
+                          : ::mmap(nullptr, ring->cqMapSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                                   ring->fd, IORING_OFF_CQ_RING);
+        if (ring->cqMap == MAP_FAILED)
+            return nullptr;
+        ring->sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+        void* sqes = ::mmap(nullptr, ring->sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd,
+                            IORING_OFF_SQES);
+        if (sqes == MAP_FAILED)
+            return nullptr;
+        ring->sqes = static_cast<io_uring_sqe*>(sqes);
+
+        char* sq = static_cast<char*>(ring->sqMap);
+        ring->sqTail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+        ring->sqMask = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+        ring->sqArray = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+        char* cq = static_cast<char*>(ring->cqMap);
+        ring->cqHead = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+        ring->cqTail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+        ring->cqMask = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+        ring->cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+        return ring;
+    }
+
+    /// Whether the kernel knows statx, openat and read (5.6 and later).
+    bool supportsSteps() const {
+        constexpr unsigned kOps = 256;
+        std::vector<char> storage(sizeof(io_uring_probe) + kOps * sizeof(io_uring_probe_op));
+        auto* probe = reinterpret_cast<io_uring_probe*>(storage.data());
+        if (::syscall(__NR_io_uring_register, fd, IORING_REGISTER_PROBE, probe, kOps) < 0)
+            return false;
+        for (const unsigned op : {IORING_OP_STATX, IORING_OP_OPENAT, IORING_OP_READ}) {
+            if (op > probe->last_op || !(probe->ops[op].flags & IO_URING_OP_SUPPORTED))
+                return false;
+        }
+        return true;
+    }
+
+    /// A cleared submission entry; the reader never has more operations pending than the ring holds.
+    io_uring_sqe& prepare(std::uint64_t userData) {
+        const unsigned tail = *sqTail;
+        const unsigned index = tail & sqMask;
+        io_uring_sqe& sqe = sqes[index];
+        sqe = io_uring_sqe{};
+        sqe.user_data = userData;
+        sqArray[index] = index;
+        std::atomic_ref<unsigned>(*sqTail).store(tail + 1, std::memory_order_release);
+        ++prepared;
+        return sqe;
+    }
+};
+
+#else
+
+struct AsyncFileReader::Ring {};
+
+#endif
+
+/**
+ * @brief Constructor; sets up the ring unless told not to.
+ */
+AsyncFileReader::AsyncFileReader(std::size_t depth, std::size_t maxSize, bool useUring, BufferPool* buffers)
+    : maxSize_(maxSize), buffers_(buffers) {
+    depth = std::max<std::size_t>(depth, 1);
+    for (std::size_t i = 0; i < depth; ++i) {
+        slots_.push_back(std::make_unique<Slot>());
+        free_.push_back(depth - 1 - i);
+    }
+#ifdef FILESEARCHER_HAVE_IO_URING
+    // Every file has one operation pending at a time.
+    if (useUring)
+        ring_ = Ring::create(static_cast<unsigned>(depth));
+#else
+    (void)useUring;
+#endif
+}
+
+/**
+ * @brief Waits for the reads still in flight and closes the ring.
+ */
+AsyncFileReader::~AsyncFileReader() {
+#ifdef FILESEARCHER_HAVE_IO_URING
+    while (ring_ && inFlight_ > 0) {
+        if (enter(1))
+            reap();
+    }
+#endif
+#ifndef _WIN32
+    for (const auto& slot : slots_) {
+        if (slot->fd >= 0)
+            ::close(slot->fd);
+    }
+#endif
+    if (buffers_) {
+        for (const auto& slot : slots_)
+            buffers_->recycle(std::move(slot->file.buffer), std::exchange(slot->file.charged, 0));
+    }
+}
+
+/**
+ * @brief Whether this system can set up an io_uring with the operations the reader needs.
+ */
+bool AsyncFileReader::uringAvailable() {
+#ifdef FILESEARCHER_HAVE_IO_URING
+    static const bool available = Ring::create(2) != nullptr;
+    return available;
+#else
+    return false;
+#endif
+}
+
+/**
+ * @brief Starts reading a file: prepares its stat, or reads it at once without a ring.
+ */
+void AsyncFileReader::add(std::filesystem::path path) {
+    const std::size_t index = free_.back();
+    free_.pop_back();
+    Slot& slot = *slots_[index];
+    slot.file.path = std::move(path);
+    slot.file.loaded = false;
+    slot.file.error = 0;
+    slot.size = 0;
+    slot.used = 0;
+    slot.data = nullptr;
+    if (!ring_) {
+        readNow(slot);
+        done_.push_back(index);
+        return;
+    }
+#ifdef FILESEARCHER_HAVE_IO_URING
+    slot.pathString = slot.file.path.string();
+    io_uring_sqe& sqe = ring_->prepare(index << kStepBits | Stat);
+    sqe.opcode = IORING_OP_STATX;
+    sqe.fd = AT_FDCWD;
+    sqe.addr = reinterpret_cast<std::uint64_t>(slot.pathString.c_str());
+    sqe.len = STATX_TYPE | STATX_SIZE;
+    sqe.statx_flags = AT_STATX_SYNC_AS_STAT;
+    sqe.off = reinterpret_cast<std::uint64_t>(&slot.stat);
+    ++inFlight_;
+#endif
+}
+
+/**
+ * @brief Takes a file whose read is done, in completion order.
+ */
+bool AsyncFileReader::take(File& file, bool wait) {
+#ifdef FILESEARCHER_HAVE_IO_URING
+    if (ring_) {
+        reap();
+        if (ring_->prepared > 0 && enter(0))
+            reap();
+        while (wait && done_.empty() && inFlight_ > 0) {
+            SearchStats::Timer waiting(SearchStats::Counter::ReadNs);
+            if (enter(1))
+                reap();
+        }
+    }
+#else
+    (void)wait;
+#endif
+    if (done_.empty())
+        return false;
+    const std::size_t index = done_.front();
+    done_.pop_front();
+    Slot& slot = *slots_[index];
+    file.path = std::move(slot.file.path);
+    file.buffer = std::move(slot.file.buffer);
+    file.loaded = slot.file.loaded;
+    file.error = slot.file.error;
+    file.charged = std::exchange(slot.file.charged, 0);
+    free_.push_back(index);
+    return true;
+}
+
+/**
+ * @brief Reserves the block of a slot's buffer, from the pool on first use, and charges it.
+ */
+char* AsyncFileReader::reserve(Slot& slot, std::size_t capacity, std::size_t keep) {
+    if (!buffers_)
+        return slot.file.buffer.reserve(capacity, keep);
+    if (slot.file.buffer.capacity() == 0)
+        slot.file.buffer = buffers_->acquire();
+    char* data = slot.file.buffer.reserve(capacity, keep);
+    buffers_->account(slot.file.buffer, slot.file.charged);
+    return data;
+}
+
+/**
+ * @brief Reads a file with stat, open and pread, as the ring would.
+ */
+void AsyncFileReader::readNow(Slot& slot) {
+#ifdef _WIN32
+    std::error_code ec;
+    if (!std::filesystem::is_regular_file(slot.file.path, ec) ||
+        std::filesystem::file_size(slot.file.path, ec) >= maxSize_ || ec)
+        return;
+    if (!slot.file.buffer.open(slot.file.path)) {
+        slot.file.error = EIO;
+        return;
+    }
+    slot.file.loaded = true;
+#else
+    struct stat st {};
+    if (::stat(slot.file.path.c_str(), &st) != 0) {
+        slot.file.error = errno;
+        return;
+    }
+    if (!S_ISREG(st.st_mode) || static_cast<std::size_t>(st.st_size) >= maxSize_)
+        return;
+
+    const int fd = ::open(slot.file.path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        slot.file.error = errno;
+        return;
+    }
+    std::size_t used = 0;
+    char* data = reserve(slot, static_cast<std::size_t>(st.st_size) + 1);
+    while (true) {
+        if (used == slot.file.buffer.capacity())
+            data = reserve(slot, used * 2, used);
+        const ssize_t got = ::pread(fd, data + used, slot.file.buffer.capacity() - used, static_cast<off_t>(used));
+        if (got < 0 && errno == EINTR)
+            continue;
+        if (got < 0) {
+            slot.file.error = errno;
+            break;
+        }
+        if (got == 0)
+            break;
+        used += static_cast<std::size_t>(got);
+    }
+    ::close(fd);
+    if (slot.file.error == 0) {
+        slot.file.buffer.commitRead(used);
+        slot.file.loaded = true;
+        SearchStats::add(SearchStats::Counter::BytesRead, used);
+    }
+#endif
+}
+
+#ifdef FILESEARCHER_HAVE_IO_URING
+
+void AsyncFileReader::submitOpen(std::size_t index) {
+    Slot& slot = *slots_[index];
+    io_uring_sqe& sqe = ring_->prepare(index << kStepBits | Open);
+    sqe.opcode = IORING_OP_OPENAT;
+    sqe.fd = AT_FDCWD;
+    sqe.addr = reinterpret_cast<std::uint64_t>(slot.pathString.c_str());
+    sqe.open_flags = O_RDONLY | O_CLOEXEC;
+    ++inFlight_;
+}
+
+/**
+ * @brief Reads the rest of the reserved block, doubling it first if it is full.
+ */
+void AsyncFileReader::submitRead(std::size_t index) {
+    Slot& slot = *slots_[index];
+    if (slot.used == slot.file.buffer.capacity())
+        slot.data = reserve(slot, slot.used * 2, slot.used);
+    io_uring_sqe& sqe = ring_->prepare(index << kStepBits | Read);
+    sqe.opcode = IORING_OP_READ;
+    sqe.fd = slot.fd;
+    sqe.addr = reinterpret_cast<std::uint64_t>(slot.data + slot.used);
+    sqe.len = static_cast<unsigned>(std::min<std::size_t>(slot.file.buffer.capacity() - slot.used, 1u << 30));
+    sqe.off = slot.used;
+    ++inFlight_;
+}
+
+/**
+ * @brief Moves a file on to its next step once an operation completes.
+ *
+ * A read shorter than requested ends the file once the size from stat is reached; a read
+ * of nothing always does.
+ */
+void AsyncFileReader::complete(std::uint64_t userData, int result) {
+    const std::size_t index = static_cast<std::size_t>(userData >> kStepBits);
+    const auto step = static_cast<Step>(userData & kStepMask);
+    Slot& slot = *slots_[index];
+    --inFlight_;
+    if ((result == -EINTR || result == -EAGAIN) && step != Stat) {
+        if (step == Read)
+            submitRead(index);
+        else
+            submitOpen(index);
+        return;
+    }
+    if (result < 0) {
+        slot.file.error = -result;
+        finish(index);
+        return;
+    }
+
+    switch (step) {
+    case Stat:
+        slot.size = static_cast<std::size_t>(slot.stat.stx_size);
+        if (!S_ISREG(slot.stat.stx_mode) || slot.size >= maxSize_) {
+            finish(index);
+            return;
+        }
+        submitOpen(index);
+        return;
+    case Open:
+        slot.fd = result;
+        slot.data = reserve(slot, slot.size + 1);
+        submitRead(index);
+        return;
+    case Read: {
+        const std::size_t requested = std::min<std::size_t>(slot.file.buffer.capacity() - slot.used, 1u << 30);
+        slot.used += static_cast<std::size_t>(result);
+        if (result == 0 || (static_cast<std::size_t>(result) < requested && slot.used >= slot.size)) {
+            slot.file.buffer.commitRead(slot.used);
+            slot.file.loaded = true;
+            SearchStats::add(SearchStats::Counter::BytesRead, slot.used);
+            finish(index);
+            return;
+        }
+        submitRead(index);
+        return;
+    }
+    }
+}
+
+/**
+ * @brief Closes the file of a slot and queues it for take().
+ */
+void AsyncFileReader::finish(std::size_t index) {
+    Slot& slot = *slots_[index];
+    if (slot.fd >= 0) {
+        ::close(slot.fd);
+        slot.fd = -1;
+    }
+    done_.push_back(index);
+}
+
+/**
+ * @brief Submits the prepared operations and waits for `minComplete` completions.
+ *
+ * @return false if interrupted by a signal.
+ */
+bool AsyncFileReader::enter(unsigned minComplete) {
+    const unsigned flags = minComplete > 0 ? IORING_ENTER_GETEVENTS : 0;
+    const long submitted =
+        ::syscall(__NR_io_uring_enter, ring_->fd, ring_->prepared, minComplete, flags, nullptr, 0);
+    if (submitted < 0) {
+        if (errno == EINTR || errno == EAGAIN || errno == EBUSY)
+            return false;
+        throw std::system_error(errno, std::generic_category(), "io_uring_enter");
+    }
+    ring_->prepared -= static_cast<unsigned>(submitted);
+    return true;
+}
+
+/**
+ * @brief Handles every completion the kernel has posted.
+ */
+void AsyncFileReader::reap() {
+    unsigned head = *ring_->cqHead;
+    const unsigned tail = std::atomic_ref<unsigned>(*ring_->cqTail).load(std::memory_order_acquire);
+    while (head != tail) {
+        const io_uring_cqe& cqe = ring_->cqes[head & ring_->cqMask];
+        const std::uint64_t userData = cqe.user_data;
+        const int result = cqe.res;
+        ++head;
+        std::atomic_ref<unsigned>(*ring_->cqHead).store(head, std::memory_order_release);
+        complete(userData, result);
+    }
+}
+
+#else
+
+void AsyncFileReader::submitOpen(std::size_t) {}
+void AsyncFileReader::submitRead(std::size_t) {}
+void AsyncFileReader::complete(std::uint64_t, int) {}
+void AsyncFileReader::finish(std::size_t) {}
+bool AsyncFileReader::enter(unsigned) { return false; }
+void AsyncFileReader::reap() {}
+
+#endif
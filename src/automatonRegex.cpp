@@ -0,0 +1,1125 @@
+#include "automatonRegex.hpp"
+#include <algorithm>
+#include <atomic>
+#include <map>
+#include <memory>
+#include <unordered_map>
+#include <utility>
+
+namespace {
+
+using ByteSet = AutomatonRegex::ByteSet;
+using AssertKind = AutomatonRegex::AssertKind;
+using Instruction = AutomatonRegex::Instruction;
+using Op = AutomatonRegex::Op;
+
+constexpr int kUnbounded = -1;
+/// Deepest group nesting accepted; keeps the recursive parser and compiler off the stack limit.
+constexpr int kMaxNesting = 500;
+/// Longest literal kept while extracting required literals.
+constexpr std::size_t kMaxLiteral = 256;
+
+const char* const kUseStdEngine = " (use --regex-engine=std for this pattern)";
+
+inline void addByte(ByteSet& set, unsigned char c) {
+    set[c >> 6] |= std::uint64_t{1} << (c & 63);
+}
+
+inline bool hasByte(const ByteSet& set, unsigned char c) {
+    return (set[c >> 6] >> (c & 63)) & 1;
+}
+
+inline void addRange(ByteSet& set, unsigned char first, unsigned char last) {
+    for (unsigned c = first; c <= last; ++c)
+        addByte(set, static_cast<unsigned char>(c));
+}
+
+inline void addSet(ByteSet& set, const ByteSet& other) {
+    for (std::size_t i = 0; i < set.size(); ++i)
+        set[i] |= other[i];
+}
+
+inline ByteSet negated(const ByteSet& set) {
+    ByteSet result;
+    for (std::size_t i = 0; i < set.size(); ++i)
+        result[i] = ~set[i];
+    return result;
+}
+
+inline std::size_t popCount(const ByteSet& set) {
+    std::size_t count = 0;
+    for (std::uint64_t word : set)
+        count += static_cast<std::size_t>(__builtin_popcountll(word));
+    return count;
+}
+
+inline bool isWordByte(unsigned char c) {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_';
+}
+
+ByteSet wordSet() {
+    ByteSet set{};
+    for (unsigned c = 0; c < 256; ++c)
+        if (isWordByte(static_cast<unsigned char>(c)))
+            addByte(set, static_cast<unsigned char>(c));
+    return set;
+}
+
+ByteSet digitSet() {
+    ByteSet set{};
+    addRange(set, '0', '9');
+    return set;
+}
+
+/// Whitespace of the classic "C" locale, which is what std::regex uses by default.
+ByteSet spaceSet() {
+    ByteSet set{};
+    for (char c : {' ', '\t', '\n', '\v', '\f', '\r'})
+        addByte(set, static_cast<unsigned char>(c));
+    return set;
+}
+
+/// Adds the other ASCII case of every letter in the set.
+void foldAsciiCase(ByteSet& set) {
+    for (unsigned c = 'a'; c <= 'z'; ++c) {
+        const auto lower = static_cast<unsigned char>(c);
+        const auto upper = static_cast<unsigned char>(c - 'a' + 'A');
+        if (hasByte(set, lower) || hasByte(set, upper)) {
+            addByte(set, lower);
+            addByte(set, upper);
+        }
+    }
+}
+
+/**
+ * @brief Regex syntax tree; groups are flattened away since captures are not reported.
+ */
+struct Node {
+    enum class Kind { Empty, Set, Concat, Alternate, Repeat, Assert };
+
+    Kind kind = Kind::Empty;
+    ByteSet set{};
+    AssertKind assertKind = AssertKind::LineStart;
+    std::vector<Node> children;
+    int min = 0;
+    int max = 0;
+    bool greedy = true;
+};
+
+Node makeSet(const ByteSet& set) {
+    Node node;
+    node.kind = Node::Kind::Set;
+    node.set = set;
+    return node;
+}
+
+/**
+ * @brief Recursive-descent parser for the supported ECMAScript subset.
+ */
+class Parser {
+public:
+    Parser(std::string_view pattern, bool caseSensitive)
+        : pattern_(pattern), caseSensitive_(caseSensitive) {}
+
+    Node parse() {
+        Node node = parseAlternation(0);
+        if (pos_ < pattern_.size())
+            fail("unmatched ')'");
+        return node;
+    }
+
+private:
+    [[noreturn]] void fail(const std::string& what) const {
+        throw RegexError("Invalid regex at offset " + std::to_string(pos_) + ": " + what);
+    }
+
+    [[noreturn]] void unsupported(const std::string& what) const {
+        throw RegexError(what + " cannot be matched in linear time and is not supported by the "
+                         "automaton engine" + kUseStdEngine);
+    }
+
+    bool atEnd() const { return pos_ >= pattern_.size(); }
+    char peek() const { return pattern_[pos_]; }
+
+    Node parseAlternation(int depth) {
+        if (depth > kMaxNesting)
+            fail("groups nested too deeply");
+
+        Node alternation;
+        alternation.kind = Node::Kind::Alternate;
+        alternation.children.push_back(parseConcatenation(depth));
+        while (!atEnd() && peek() == '|') {
+            ++pos_;
+            alternation.children.push_back(parseConcatenation(depth));
+        }
+        if (alternation.children.size() == 1)
+            return std::move(alternation.children.front());
+        return alternation;
+    }
+
+    Node parseConcatenation(int depth) {
+        Node concat;
+        concat.kind = Node::Kind::Concat;
+        while (!atEnd() && peek() != '|' && peek() != ')') {
+            Node atom = parseAtom(depth);
+            concat.children.push_back(parseQuantifiers(std::move(atom)));
+        }
+        return concat;
+    }
+
+    Node parseQuantifiers(Node atom) {
+        while (!atEnd()) {
+            int min;
+            int max;
+            const char c = peek();
+            if (c == '*') {
+                min = 0;
+                max = kUnbounded;
+                ++pos_;
+            }
+            else if (c == '+') {
+                min = 1;
+                max = kUnbounded;
+                ++pos_;
+            }
+            else if (c == '?') {
+                min = 0;
+                max = 1;
+                ++pos_;
+            }
+            else if (c == '{') {
+                parseBraces(min, max);
+            }
+            else {
+                break;
+            }
+
+            if (atom.kind == Node::Kind::Assert)
+                fail("nothing to repeat");
+
+            Node repeat;
+            repeat.kind = Node::Kind::Repeat;
+            repeat.min = min;
+            repeat.max = max;
+            if (!atEnd() && peek() == '?') {
+                repeat.greedy = false;
+                ++pos_;
+            }
+            repeat.children.push_back(std::move(atom));
+            atom = std::move(repeat);
+        }
+        return atom;
+    }
+
+    int parseCount() {
+        if (atEnd() || peek() < '0' || peek() > '9')
+            fail("expected a number in '{}'");
+        long value = 0;
+        while (!atEnd() && peek() >= '0' && peek() <= '9') {
+            value = value * 10 + (peek() - '0');
+            if (value > static_cast<long>(AutomatonRegex::kMaxProgramSize))
+                fail("repeat count too large");
+            ++pos_;
+        }
+        return static_cast<int>(value);
+    }
+
+    void parseBraces(int& min, int& max) {
+        ++pos_;  // '{'
+        min = parseCount();
+        max = min;
+        if (!atEnd() && peek() == ',') {
+            ++pos_;
+            max = (!atEnd() && peek() == '}') ? kUnbounded : parseCount();
+        }
+        if (atEnd() || peek() != '}')
+            fail("unterminated '{'");
+        ++pos_;
+        if (max != kUnbounded && max < min)
+            fail("invalid range in '{}'");
+    }
+
+    Node literal(unsigned char c) const {
+        ByteSet set{};
+        addByte(set, c);
+        if (!caseSensitive_)
+            foldAsciiCase(set);
+        return makeSet(set);
+    }
+
+    Node literalString(const std::string& bytes) const {
+        Node concat;
+        concat.kind = Node::Kind::Concat;
+        for (char c : bytes)
+            concat.children.push_back(literal(static_cast<unsigned char>(c)));
+        return concat;
+    }
+
+    Node parseAtom(int depth) {
+        const char c = peek();
+        ++pos_;
+        switch (c) {
+        case '(': {
+            if (!atEnd() && peek() == '?') {
+                ++pos_;
+                if (atEnd())
+                    fail("unterminated group");
+                if (peek() == '=' || peek() == '!')
+                    unsupported("Lookahead");
+                if (peek() == '<')
+                    unsupported("Lookbehind");
+                if (peek() != ':')
+                    fail("unknown group type");
+                ++pos_;
+            }
+            Node inner = parseAlternation(depth + 1);
+            if (atEnd() || peek() != ')')
+                fail("missing ')'");
+            ++pos_;
+            return inner;
+        }
+        case '[':
+            return parseClass();
+        case '.': {
+            ByteSet set{};
+            addByte(set, '\n');
+            addByte(set, '\r');
+            return makeSet(negated(set));
+        }
+        case '^':
+        case '$': {
+            Node node;
+            node.kind = Node::Kind::Assert;
+            node.assertKind = c == '^' ? AssertKind::LineStart : AssertKind::LineEnd;
+            return node;
+        }
+        case '\\':
+            return parseEscape();
+        case '*':
+        case '+':
+        case '?':
+        case '{':
+            --pos_;
+            fail("nothing to repeat");
+        default:
+            return literal(static_cast<unsigned char>(c));
+        }
+    }
+
+    unsigned hexDigits(int count) {
+        unsigned value = 0;
+        for (int i = 0; i < count; ++i) {
+            if (atEnd())
+                fail("truncated hexadecimal escape");
+            const char h = peek();
+            unsigned digit;
+            if (h >= '0' && h <= '9')
+                digit = static_cast<unsigned>(h - '0');
+            else if (h >= 'a' && h <= 'f')
+                digit = static_cast<unsigned>(h - 'a' + 10);
+            else if (h >= 'A' && h <= 'F')
+                digit = static_cast<unsigned>(h - 'A' + 10);
+            else
+                fail("invalid hexadecimal escape");
+            value = value * 16 + digit;
+            ++pos_;
+        }
+        return value;
+    }
+
+    static std::string encodeUtf8(unsigned codePoint) {
+        std::string out;
+        if (codePoint < 0x80) {
+            out += static_cast<char>(codePoint);
+        }
+        else if (codePoint < 0x800) {
+            out += static_cast<char>(0xC0 | (codePoint >> 6));
+            out += static_cast<char>(0x80 | (codePoint & 0x3F));
+        }
+        else {
+            out += static_cast<char>(0xE0 | (codePoint >> 12));
+            out += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+            out += static_cast<char>(0x80 | (codePoint & 0x3F));
+        }
+        return out;
+    }
+
+    /**
+     * @brief Parses the escapes shared by atoms and classes into a byte set.
+     *
+     * @return false if the escape is not a single character or a character class.
+     */
+    bool parseCharacterEscape(char c, ByteSet& set, std::string& multiByte) {
+        switch (c) {
+        case 'd': set = digitSet(); return true;
+        case 'D': set = negated(digitSet()); return true;
+        case 'w': set = wordSet(); return true;
+        case 'W': set = negated(wordSet()); return true;
+        case 's': set = spaceSet(); return true;
+        case 'S': set = negated(spaceSet()); return true;
+        case 'n': addByte(set, '\n'); return true;
+        case 'r': addByte(set, '\r'); return true;
+        case 't': addByte(set, '\t'); return true;
+        case 'f': addByte(set, '\f'); return true;
+        case 'v': addByte(set, '\v'); return true;
+        case '0': addByte(set, 0); return true;
+        case 'x': addByte(set, static_cast<unsigned char>(hexDigits(2))); return true;
+        case 'u': {
+            const unsigned codePoint = hexDigits(4);
+            if (codePoint < 0x80)
+                addByte(set, static_cast<unsigned char>(codePoint));
+            else
+                multiByte = encodeUtf8(codePoint);
+            return true;
+        }
+        case 'c':
+            if (atEnd() || !((peek() >= 'a' && peek() <= 'z') || (peek() >= 'A' && peek() <= 'Z')))
+                fail("invalid control escape");
+            addByte(set, static_cast<unsigned char>(peek() % 32));
+            ++pos_;
+            return true;
+        default:
+            if ((c >= '1' && c <= '9'))
+                unsupported("Backreference '\\" + std::string(1, c) + "'");
+            if ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9'))
+                fail(std::string("unknown escape '\\") + c + "'");
+            addByte(set, static_cast<unsigned char>(c));  // identity escape
+            return true;
+        }
+    }
+
+    Node parseEscape() {
+        if (atEnd())
+            fail("trailing backslash");
+        const char c = peek();
+        ++pos_;
+        if (c == 'b' || c == 'B') {
+            Node node;
+            node.kind = Node::Kind::Assert;
+            node.assertKind = c == 'b' ? AssertKind::WordBoundary : AssertKind::NotWordBoundary;
+            return node;
+        }
+
+        ByteSet set{};
+        std::string multiByte;
+        parseCharacterEscape(c, set, multiByte);
+        if (!multiByte.empty())
+            return literalString(multiByte);
+        if (!caseSensitive_)
+            foldAsciiCase(set);
+        return makeSet(set);
+    }
+
+    bool parsePosixClass(ByteSet& set) {
+        const std::size_t close = pattern_.find(":]", pos_ + 2);
+        if (close == std::string_view::npos)
+            return false;
+        const std::string_view name = pattern_.substr(pos_ + 2, close - pos_ - 2);
+        ByteSet named{};
+        for (unsigned c = 0; c < 128; ++c) {
+            const auto b = static_cast<unsigned char>(c);
+            const bool upper = b >= 'A' && b <= 'Z';
+            const bool lower = b >= 'a' && b <= 'z';
+            const bool digit = b >= '0' && b <= '9';
+            const bool space = hasByte(spaceSet(), b);
+            const bool control = b < 0x20 || b == 0x7F;
+            const bool graph = b > 0x20 && b < 0x7F;
+            bool in;
+            if (name == "alpha") in = upper || lower;
+            else if (name == "digit" || name == "d") in = digit;
+            else if (name == "alnum") in = upper || lower || digit;
+            else if (name == "upper") in = upper;
+            else if (name == "lower") in = lower;
+            else if (name == "space" || name == "s") in = space;
+            else if (name == "blank") in = b == ' ' || b == '\t';
+            else if (name == "punct") in = graph && !(upper || lower || digit);
+            else if (name == "xdigit") in = digit || (b >= 'a' && b <= 'f') || (b >= 'A' && b <= 'F');
+            else if (name == "word" || name == "w") in = isWordByte(b);
+            else if (name == "cntrl") in = control;
+            else if (name == "print") in = graph || b == ' ';
+            else if (name == "graph") in = graph;
+            else fail("unknown character class '" + std::string(name) + "'");
+            if (in)
+                addByte(named, b);
+        }
+        addSet(set, named);
+        pos_ = close + 2;
+        return true;
+    }
+
+    /**
+     * @brief Reads one class member: a byte (returned) or a whole class (added to `set`, -1).
+     */
+    int parseClassMember(ByteSet& set) {
+        if (atEnd())
+            fail("missing ']'");
+        if (peek() == '[' && pos_ + 1 < pattern_.size() && pattern_[pos_ + 1] == ':' && parsePosixClass(set))
+            return -1;
+
+        const char c = peek();
+        ++pos_;
+        if (c != '\\')
+            return static_cast<unsigned char>(c);
+
+        if (atEnd())
+            fail("trailing backslash");
+        const char e = peek();
+        ++pos_;
+        if (e == 'b')
+            return '\b';
+        if (e == 'B')
+            fail("'\\B' inside a class");
+
+        ByteSet escaped{};
+        std::string multiByte;
+        parseCharacterEscape(e, escaped, multiByte);
+        if (!multiByte.empty())
+            fail("non-ASCII '\\u' escape inside a class");
+        if (popCount(escaped) == 1) {
+            for (unsigned b = 0; b < 256; ++b)
+                if (hasByte(escaped, static_cast<unsigned char>(b)))
+                    return static_cast<int>(b);
+        }
+        addSet(set, escaped);
+        return -1;
+    }
+
+    Node parseClass() {
+        bool negate = false;
+        if (!atEnd() && peek() == '^') {
+            negate = true;
+            ++pos_;
+        }
+
+        ByteSet set{};
+        bool first = true;
+        while (true) {
+            if (atEnd())
+                fail("missing ']'");
+            if (peek() == ']' && !first)
+                break;
+            first = false;
+
+            const int low = parseClassMember(set);
+            if (low >= 0 && pos_ + 1 < pattern_.size() && peek() == '-' && pattern_[pos_ + 1] != ']') {
+                ++pos_;
+                const int high = parseClassMember(set);
+                if (high < 0)
+                    fail("invalid class range");
+                if (high < low)
+                    fail("class range out of order");
+                addRange(set, static_cast<unsigned char>(low), static_cast<unsigned char>(high));
+            }
+            else if (low >= 0) {
+                addByte(set, static_cast<unsigned char>(low));
+            }
+        }
+        ++pos_;  // ']'
+
+        if (!caseSensitive_)
+            foldAsciiCase(set);
+        return makeSet(negate ? negated(set) : set);
+    }
+
+    std::string_view pattern_;
+    std::size_t pos_ = 0;
+    bool caseSensitive_;
+};
+
+/**
+ * @brief Emits the Thompson program for a syntax tree.
+ */
+class Compiler {
+public:
+    Compiler(std::vector<Instruction>& program, std::vector<ByteSet>& sets)
+        : program_(program), sets_(sets) {}
+
+    void compile(const Node& root) {
+        emit(root);
+        push({Op::Match});
+    }
+
+private:
+    std::uint32_t push(Instruction instruction) {
+        if (program_.size() >= AutomatonRegex::kMaxProgramSize)
+            throw RegexError("Regex is too large for the automaton engine" + std::string(kUseStdEngine));
+        program_.push_back(instruction);
+        return static_cast<std::uint32_t>(program_.size() - 1);
+    }
+
+    std::uint32_t next() const { return static_cast<std::uint32_t>(program_.size()); }
+
+    std::uint32_t setIndex(const ByteSet& set) {
+        auto [it, inserted] = setIndex_.try_emplace(set, static_cast<std::uint32_t>(sets_.size()));
+        if (inserted)
+            sets_.push_back(set);
+        return it->second;
+    }
+
+    /// Points a split at the body and the exit, preferring the body when greedy.
+    void patchSplit(std::uint32_t pc, std::uint32_t body, std::uint32_t exit, bool greedy) {
+        program_[pc].x = greedy ? body : exit;
+        program_[pc].y = greedy ? exit : body;
+    }
+
+    void emit(const Node& node) {
+        switch (node.kind) {
+        case Node::Kind::Empty:
+            break;
+        case Node::Kind::Set: {
+            Instruction instruction{Op::ByteSet};
+            instruction.x = setIndex(node.set);
+            push(instruction);
+            break;
+        }
+        case Node::Kind::Assert: {
+            Instruction instruction{Op::Assert};
+            instruction.assertKind = node.assertKind;
+            push(instruction);
+            break;
+        }
+        case Node::Kind::Concat:
+            for (const Node& child : node.children)
+                emit(child);
+            break;
+        case Node::Kind::Alternate: {
+            std::vector<std::uint32_t> jumps;
+            for (std::size_t i = 0; i + 1 < node.children.size(); ++i) {
+                const std::uint32_t split = push({Op::Split});
+                emit(node.children[i]);
+                jumps.push_back(push({Op::Jump}));
+                patchSplit(split, split + 1, next(), true);
+            }
+            emit(node.children.back());
+            for (std::uint32_t jump : jumps)
+                program_[jump].x = next();
+            break;
+        }
+        case Node::Kind::Repeat:
+            emitRepeat(node);
+            break;
+        }
+    }
+
+    void emitRepeat(const Node& node) {
+        const Node& body = node.children.front();
+        for (int i = 0; i < node.min; ++i)
+            emit(body);
+
+        if (node.max == kUnbounded) {
+            // loop: split body, exit; body; jump loop
+            const std::uint32_t loop = push({Op::Split});
+            emit(body);
+            Instruction jump{Op::Jump};
+            jump.x = loop;
+            push(jump);
+            patchSplit(loop, loop + 1, next(), node.greedy);
+            return;
+        }
+
+        // Optional copies nest: (body (body ...)?)?; every split exits to the common end.
+        std::vector<std::uint32_t> splits;
+        for (int i = node.min; i < node.max; ++i) {
+            splits.push_back(push({Op::Split}));
+            emit(body);
+        }
+        for (std::uint32_t split : splits)
+            patchSplit(split, split + 1, next(), node.greedy);
+    }
+
+    std::vector<Instruction>& program_;
+    std::vector<ByteSet>& sets_;
+    std::map<ByteSet, std::uint32_t> setIndex_;
+};
+
+/**
+ * @brief Literal facts about the strings a node can match (see AutomatonRegex::requiredLiteral).
+ */
+struct LiteralInfo {
+    bool isExact = false;   ///< The node matches exactly `exact` and nothing else.
+    std::string exact;
+    std::string prefix;     ///< Every match starts with this.
+    std::string suffix;     ///< Every match ends with this.
+    std::string inner;      ///< Every match contains this.
+};
+
+const std::string& longer(const std::string& a, const std::string& b) {
+    return b.size() > a.size() ? b : a;
+}
+
+std::string capped(std::string s) {
+    if (s.size() > kMaxLiteral)
+        s.resize(kMaxLiteral);
+    return s;
+}
+
+/**
+ * @brief Byte the set stands for if it is a single literal character.
+ *
+ * Case-insensitive patterns only treat ASCII as literal, folded to lower case, so that the
+ * extracted literal can be handed to the case-folding matcher.
+ */
+int singleByte(const ByteSet& set, bool caseSensitive) {
+    const std::size_t count = popCount(set);
+    for (unsigned b = 0; b < 256; ++b) {
+        const auto c = static_cast<unsigned char>(b);
+        if (!hasByte(set, c))
+            continue;
+        if (caseSensitive)
+            return count == 1 ? static_cast<int>(c) : -1;
+        if (c >= 0x80)
+            return -1;
+        const bool letter = (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z');
+        if (count == 1 && !letter)
+            return static_cast<int>(c);
+        if (count == 2 && letter)
+            return static_cast<int>(c | 0x20);
+        return -1;
+    }
+    return -1;
+}
+
+LiteralInfo exactly(std::string s) {
+    LiteralInfo info;
+    info.isExact = true;
+    info.exact = s;
+    info.prefix = s;
+    info.suffix = s;
+    info.inner = std::move(s);
+    return info;
+}
+
+LiteralInfo concatenate(const LiteralInfo& a, const LiteralInfo& b) {
+    if (a.isExact && b.isExact && a.exact.size() + b.exact.size() <= kMaxLiteral)
+        return exactly(a.exact + b.exact);
+
+    LiteralInfo info;
+    info.prefix = capped(a.isExact ? a.exact + b.prefix : a.prefix);
+    info.suffix = b.isExact ? a.suffix + b.exact : b.suffix;
+    if (info.suffix.size() > kMaxLiteral)
+        info.suffix.erase(0, info.suffix.size() - kMaxLiteral);
+    info.inner = longer(longer(a.inner, b.inner), capped(a.suffix + b.prefix));
+    return info;
+}
+
+LiteralInfo extractLiterals(const Node& node, bool caseSensitive) {
+    switch (node.kind) {
+    case Node::Kind::Empty:
+    case Node::Kind::Assert:
+        return exactly("");
+    case Node::Kind::Set: {
+        const int c = singleByte(node.set, caseSensitive);
+        return c < 0 ? LiteralInfo{} : exactly(std::string(1, static_cast<char>(c)));
+    }
+    case Node::Kind::Concat: {
+        LiteralInfo info = exactly("");
+        for (const Node& child : node.children)
+            info = concatenate(info, extractLiterals(child, caseSensitive));
+        return info;
+    }
+    case Node::Kind::Alternate: {
+        LiteralInfo first = extractLiterals(node.children.front(), caseSensitive);
+        LiteralInfo info;
+        info.isExact = first.isExact;
+        info.exact = first.exact;
+        info.prefix = first.prefix;
+        info.suffix = first.suffix;
+        for (std::size_t i = 1; i < node.children.size(); ++i) {
+            const LiteralInfo other = extractLiterals(node.children[i], caseSensitive);
+            info.isExact = info.isExact && other.isExact && other.exact == info.exact;
+            const auto prefixEnd = std::mismatch(info.prefix.begin(), info.prefix.end(),
+                                                 other.prefix.begin(), other.prefix.end()).first;
+            info.prefix.erase(prefixEnd, info.prefix.end());
+            const auto suffixEnd = std::mismatch(info.suffix.rbegin(), info.suffix.rend(),
+                                                 other.suffix.rbegin(), other.suffix.rend()).first;
+            info.suffix.erase(info.suffix.begin(), suffixEnd.base());
+        }
+        if (info.isExact)
+            return exactly(info.exact);
+        info.inner = longer(info.prefix, info.suffix);
+        return info;
+    }
+    case Node::Kind::Repeat: {
+        if (node.max == 0)
+            return exactly("");
+        if (node.min == 0)
+            return {};
+        const LiteralInfo body = extractLiterals(node.children.front(), caseSensitive);
+        if (body.isExact && node.min == node.max &&
+            body.exact.size() * static_cast<std::size_t>(node.min) <= kMaxLiteral) {
+            std::string repeated;
+            for (int i = 0; i < node.min; ++i)
+                repeated += body.exact;
+            return exactly(std::move(repeated));
+        }
+        LiteralInfo info;
+        info.prefix = body.isExact ? body.exact : body.prefix;
+        info.suffix = body.isExact ? body.exact : body.suffix;
+        info.inner = longer(body.inner, longer(info.prefix, info.suffix));
+        return info;
+    }
+    }
+    return {};
+}
+
+/// Whether every match of the node must begin at a `^`.
+bool anchoredAtLineStart(const Node& node) {
+    switch (node.kind) {
+    case Node::Kind::Assert:
+        return node.assertKind == AssertKind::LineStart;
+    case Node::Kind::Concat:
+        return !node.children.empty() && anchoredAtLineStart(node.children.front());
+    case Node::Kind::Alternate:
+        return std::all_of(node.children.begin(), node.children.end(),
+                           [](const Node& child) { return anchoredAtLineStart(child); });
+    case Node::Kind::Repeat:
+        return node.min > 0 && anchoredAtLineStart(node.children.front());
+    default:
+        return false;
+    }
+}
+
+/**
+ * @brief Evaluates a zero-width assertion between two positions of a line.
+ *
+ * @param atLineStart Whether the position is the start of the line.
+ * @param prevWord    Whether the byte before the position is a word byte.
+ * @param atLineEnd   Whether the position is the end of the line.
+ * @param nextWord    Whether the byte at the position is a word byte.
+ */
+inline bool assertionHolds(AssertKind kind, bool atLineStart, bool prevWord, bool atLineEnd, bool nextWord) {
+    switch (kind) {
+    case AssertKind::LineStart: return atLineStart;
+    case AssertKind::LineEnd: return atLineEnd;
+    case AssertKind::WordBoundary: return prevWord != nextWord;
+    case AssertKind::NotWordBoundary: return prevWord == nextWord;
+    }
+    return false;
+}
+
+/**
+ * @brief Visited marks for one epsilon closure; clearing is O(1) by bumping the generation.
+ */
+class VisitedSet {
+public:
+    void reset(std::size_t size) {
+        if (marks_.size() < size)
+            marks_.resize(size, 0);
+        if (++generation_ == 0) {
+            std::fill(marks_.begin(), marks_.end(), 0);
+            generation_ = 1;
+        }
+    }
+
+    /// Marks pc; returns false if it was already marked in this generation.
+    bool insert(std::uint32_t pc) {
+        if (marks_[pc] == generation_)
+            return false;
+        marks_[pc] = generation_;
+        return true;
+    }
+
+private:
+    std::vector<std::uint32_t> marks_;
+    std::uint32_t generation_ = 0;
+};
+
+std::atomic<std::uint64_t> nextRegexId{1};
+
+}  // namespace
+
+/**
+ * @brief Lazily built DFA over the NFA of one AutomatonRegex, answering search().
+ *
+ * A DFA state is the set of NFA instructions waiting to consume the next byte, plus the two
+ * facts assertions need about the previous position (start of line, previous byte is a word
+ * byte). Epsilon closures are taken when a transition is computed, once the next byte and
+ * therefore every assertion is known. Because the search is unanchored, the start instruction
+ * is re-added to every state, unless every match has to begin at `^`; in that case states
+ * can die, which ends the scan of a line early.
+ */
+class AutomatonDfa {
+public:
+    explicit AutomatonDfa(const AutomatonRegex& regex)
+        : regex_(regex), stride_(regex.classCount_ + 1) {
+        classIsWord_.resize(regex.classCount_);
+        classByte_.resize(regex.classCount_);
+        for (unsigned b = 256; b-- > 0;) {
+            const std::uint8_t cls = regex.byteClass_[b];
+            classByte_[cls] = static_cast<unsigned char>(b);
+            classIsWord_[cls] = isWordByte(static_cast<unsigned char>(b));
+        }
+        flush();
+    }
+
+    /**
+     * @brief Returns the DFA of the regex for the calling thread, building it on first use.
+     */
+    static AutomatonDfa& forThread(const AutomatonRegex& regex) {
+        // Keyed by id rather than address: ids are never reused, so a DFA left behind by a
+        // destroyed regex can never be picked up by a new one.
+        thread_local std::unordered_map<std::uint64_t, std::unique_ptr<AutomatonDfa>> cache;
+        auto it = cache.find(regex.id_);
+        if (it != cache.end())
+            return *it->second;
+        if (cache.size() >= kMaxCachedRegexes)
+            cache.clear();
+        return *cache.emplace(regex.id_, std::make_unique<AutomatonDfa>(regex)).first->second;
+    }
+
+    bool search(std::string_view line) {
+        std::uint32_t state = start_;
+        for (unsigned char c : line) {
+            if (states_[state].pcs.empty())
+                return false;
+            std::int32_t t = transitions_[state * stride_ + regex_.byteClass_[c]];
+            if (t < 0)
+                t = computeTransition(state, regex_.byteClass_[c]);
+            if (t & 1)
+                return true;
+            state = static_cast<std::uint32_t>(t >> 1);
+        }
+        std::int32_t t = transitions_[state * stride_ + regex_.classCount_];
+        if (t < 0)
+            t = computeTransition(state, static_cast<std::uint32_t>(regex_.classCount_));
+        return t & 1;
+    }
+
+private:
+    static constexpr std::size_t kMaxCachedRegexes = 16;
+
+    static constexpr std::uint8_t kPrevWord = 1;
+    static constexpr std::uint8_t kAtLineStart = 2;
+
+    struct State {
+        std::vector<std::uint32_t> pcs;  ///< Sorted.
+        std::uint8_t flags = 0;
+
+        bool operator<(const State& other) const {
+            return flags != other.flags ? flags < other.flags : pcs < other.pcs;
+        }
+    };
+
+    void flush() {
+        states_.clear();
+        index_.clear();
+        transitions_.clear();
+        State initial;
+        initial.pcs.push_back(0);
+        initial.flags = kAtLineStart;
+        start_ = intern(std::move(initial));
+    }
+
+    std::uint32_t intern(State state) {
+        auto it = index_.find(state);
+        if (it != index_.end())
+            return it->second;
+        const auto id = static_cast<std::uint32_t>(states_.size());
+        index_.emplace(state, id);
+        states_.push_back(std::move(state));
+        transitions_.resize(transitions_.size() + stride_, -1);
+        return id;
+    }
+
+    /**
+     * @brief Computes (and caches) the transition of `state` on a byte class or end of line.
+     *
+     * @return (target state << 1) | (a match ended before this symbol).
+     */
+    std::int32_t computeTransition(std::uint32_t state, std::uint32_t symbol) {
+        const bool atLineEnd = symbol == regex_.classCount_;
+        const bool nextWord = !atLineEnd && classIsWord_[symbol];
+        const bool atLineStart = states_[state].flags & kAtLineStart;
+        const bool prevWord = states_[state].flags & kPrevWord;
+
+        State target;
+        target.flags = nextWord ? kPrevWord : 0;
+        bool accept = false;
+
+        visited_.reset(regex_.program_.size());
+        stack_.assign(states_[state].pcs.rbegin(), states_[state].pcs.rend());
+        while (!stack_.empty()) {
+            const std::uint32_t pc = stack_.back();
+            stack_.pop_back();
+            if (!visited_.insert(pc))
+                continue;
+            const Instruction& instruction = regex_.program_[pc];
+            switch (instruction.op) {
+            case Op::ByteSet:
+                if (!atLineEnd && hasByte(regex_.sets_[instruction.x], classByte_[symbol]))
+                    target.pcs.push_back(pc + 1);
+                break;
+            case Op::Split:
+                stack_.push_back(instruction.y);
+                stack_.push_back(instruction.x);
+                break;
+            case Op::Jump:
+                stack_.push_back(instruction.x);
+                break;
+            case Op::Assert:
+                if (assertionHolds(instruction.assertKind, atLineStart, prevWord, atLineEnd, nextWord))
+                    stack_.push_back(pc + 1);
+                break;
+            case Op::Match:
+                accept = true;
+                break;
+            }
+        }
+
+        if (!regex_.startNeedsLineStart_)
+            target.pcs.push_back(0);
+        std::sort(target.pcs.begin(), target.pcs.end());
+        target.pcs.erase(std::unique(target.pcs.begin(), target.pcs.end()), target.pcs.end());
+
+        if (!atLineEnd && states_.size() >= AutomatonRegex::kMaxDfaStates && !index_.count(target)) {
+            // Cache full: start over, keeping only the state the caller is in.
+            State current = states_[state];
+            flush();
+            state = intern(std::move(current));
+        }
+        const std::uint32_t next = atLineEnd ? state : intern(std::move(target));
+        const auto encoded = static_cast<std::int32_t>((next << 1) | (accept ? 1u : 0u));
+        transitions_[state * stride_ + symbol] = encoded;
+        return encoded;
+    }
+
+    const AutomatonRegex& regex_;
+    std::size_t stride_;                     ///< Byte classes plus the end-of-line symbol.
+    std::vector<bool> classIsWord_;
+    std::vector<unsigned char> classByte_;   ///< A representative byte of each class.
+
+    std::vector<State> states_;
+    std::map<State, std::uint32_t> index_;
+    std::vector<std::int32_t> transitions_;  ///< -1 = not computed yet.
+    std::uint32_t start_ = 0;
+
+    VisitedSet visited_;
+    std::vector<std::uint32_t> stack_;
+};
+
+/**
+ * @brief Parses the pattern, compiles it and extracts its required literal.
+ */
+AutomatonRegex::AutomatonRegex(std::string_view pattern, bool caseSensitive)
+    : caseSensitive_(caseSensitive), id_(nextRegexId.fetch_add(1, std::memory_order_relaxed)) {
+    const Node root = Parser(pattern, caseSensitive).parse();
+    Compiler(program_, sets_).compile(root);
+    startNeedsLineStart_ = anchoredAtLineStart(root);
+
+    const LiteralInfo literals = extractLiterals(root, caseSensitive);
+    requiredLiteral_ = longer(literals.inner, longer(literals.prefix, literals.suffix));
+
+    // Partition bytes into classes that no set (nor \b) can tell apart.
+    std::vector<ByteSet> distinctions = sets_;
+    distinctions.push_back(wordSet());
+    classCount_ = 1;
+    for (const ByteSet& set : distinctions) {
+        std::array<int, 512> remap;
+        remap.fill(-1);
+        std::size_t count = 0;
+        for (unsigned b = 0; b < 256; ++b) {
+            const unsigned key = byteClass_[b] * 2u + (hasByte(set, static_cast<unsigned char>(b)) ? 1u : 0u);
+            if (remap[key] < 0)
+                remap[key] = static_cast<int>(count++);
+            byteClass_[b] = static_cast<std::uint8_t>(remap[key]);
+        }
+        classCount_ = count;
+        if (classCount_ == 256)
+            break;
+    }
+}
+
+/**
+ * @brief Whether the line contains a match, using the lazily built DFA of this thread.
+ */
+bool AutomatonRegex::search(std::string_view line) const {
+    return AutomatonDfa::forThread(*this).search(line);
+}
+
+/**
+ * @brief Leftmost-first match at or after `from`, using a Pike VM.
+ *
+ * Threads are kept in priority order; a thread reaching Match records the match and cuts off
+ * every lower-priority thread, while higher-priority ones keep running and may replace it.
+ * New threads are only started until the first match is found, which makes it leftmost.
+ */
+MatchSpan AutomatonRegex::find(std::string_view line, std::size_t from) const {
+    if (from > line.size())
+        return {};
+
+    struct Thread {
+        std::uint32_t pc;
+        std::size_t start;
+    };
+    thread_local std::vector<Thread> current;
+    thread_local std::vector<Thread> next;
+    thread_local std::vector<std::uint32_t> stack;
+    thread_local VisitedSet visited;
+
+    const auto* bytes = reinterpret_cast<const unsigned char*>(line.data());
+
+    // Adds the closure of pc at position pos to the list, in priority order.
+    auto addThread = [&](std::vector<Thread>& list, std::uint32_t pc, std::size_t start, std::size_t pos) {
+        const bool atLineStart = pos == 0;
+        const bool prevWord = pos > 0 && isWordByte(bytes[pos - 1]);
+        const bool atLineEnd = pos == line.size();
+        const bool nextWord = !atLineEnd && isWordByte(bytes[pos]);
+        stack.assign(1, pc);
+        while (!stack.empty()) {
+            const std::uint32_t p = stack.back();
+            stack.pop_back();
+            if (!visited.insert(p))
+                continue;
+            const Instruction& instruction = program_[p];
+            switch (instruction.op) {
+            case Op::ByteSet:
+            case Op::Match:
+                list.push_back({p, start});
+                break;
+            case Op::Split:
+                stack.push_back(instruction.y);
+                stack.push_back(instruction.x);
+                break;
+            case Op::Jump:
+                stack.push_back(instruction.x);
+                break;
+            case Op::Assert:
+                if (assertionHolds(instruction.assertKind, atLineStart, prevWord, atLineEnd, nextWord))
+                    stack.push_back(p + 1);
+                break;
+            }
+        }
+    };
+
+    MatchSpan match;
+    current.clear();
+    visited.reset(program_.size());
+    addThread(current, 0, from, from);
+
+    for (std::size_t pos = from;; ++pos) {
+        const bool atLineEnd = pos == line.size();
+        next.clear();
+        visited.reset(program_.size());
+        for (const Thread& thread : current) {
+            const Instruction& instruction = program_[thread.pc];
+            if (instruction.op == Op::Match) {
+                match = {thread.start, pos - thread.start};
+                break;
+            }
+            if (!atLineEnd && hasByte(sets_[instruction.x], bytes[pos]))
+                addThread(next, thread.pc + 1, thread.start, pos + 1);
+        }
+        if (atLineEnd)
+            break;
+        if (!match) {
+            if (startNeedsLineStart_ && next.empty())
+                break;
+            addThread(next, 0, pos + 1, pos + 1);
+        }
+        else if (next.empty()) {
+            break;
+        }
+        current.swap(next);
+    }
+    return match;
+}
@@ -0,0 +1,124 @@
+#include "bufferPool.hpp"
+#include "searchStats.hpp"
+#include <algorithm>
+#include <utility>
+
+namespace {
+
+/// The memory a buffer holds: its block, and the mapped file while it is mapped.
+std::size_t memoryOf(const FileBuffer& buffer) {
+    const std::size_t mapped = buffer.source() == FileBuffer::Source::Mapped ? buffer.size() : 0;
+    return buffer.capacity() + mapped;
+}
+
+}  // namespace
+
+/**
+ * @brief An empty buffer, with the block of a recycled one if there is one.
+ */
+FileBuffer BufferPool::acquire() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (idle_.empty())
+        return FileBuffer();
+    FileBuffer buffer = std::move(idle_.back());
+    idle_.pop_back();
+    return buffer;
+}
+
+/**
+ * @brief Takes a buffer back for reuse and releases the bytes charged for it.
+ *
+ * The buffer is cleared outside the lock, as unmapping a file may take a while.
+ */
+void BufferPool::recycle(FileBuffer buffer, std::size_t charged) {
+    buffer.clear();
+    const bool keep = buffer.capacity() > 0 && buffer.capacity() <= kMaxPooledCapacity;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        releaseLocked(charged);
+        if (keep && idle_.size() < maxIdle_) {
+            idle_.push_back(std::move(buffer));
+            return;
+        }
+    }
+    // Dropped (too large, or enough kept): released here, outside the lock.
+}
+
+/**
+ * @brief Charges (or releases) the difference between the buffer's memory and what was charged for it.
+ */
+void BufferPool::account(const FileBuffer& buffer, std::size_t& charged) {
+    const std::size_t memory = memoryOf(buffer);
+    if (memory > charged)
+        charge(memory - charged);
+    else if (memory < charged)
+        release(charged - memory);
+    charged = memory;
+}
+
+/**
+ * @brief Charges memory held outside of a FileBuffer.
+ */
+void BufferPool::charge(std::size_t bytes) {
+    if (bytes == 0)
+        return;
+    std::lock_guard<std::mutex> lock(mutex_);
+    inUse_ += bytes;
+    peak_ = std::max(peak_, inUse_);
+}
+
+/**
+ * @brief Releases charged memory.
+ */
+void BufferPool::release(std::size_t bytes) {
+    if (bytes == 0)
+        return;
+    std::lock_guard<std::mutex> lock(mutex_);
+    releaseLocked(bytes);
+}
+
+void BufferPool::releaseLocked(std::size_t bytes) {
+    if (bytes == 0)
+        return;
+    inUse_ -= std::min(bytes, inUse_);
+    if (limit_ > 0 && inUse_ < limit_)
+        hasRoom_.notify_all();
+}
+
+/**
+ * @brief Blocks while the charged bytes are at or above the limit.
+ */
+void BufferPool::waitForRoom() {
+    if (limit_ == 0)
+        return;
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (inUse_ < limit_)
+        return;
+    SearchStats::Timer timer(SearchStats::Counter::MemoryWaitNs);
+    hasRoom_.wait(lock, [this] { return inUse_ < limit_; });
+}
+
+/**
+ * @brief Whether waitForRoom() would return at once.
+ */
+bool BufferPool::hasRoom() const {
+    if (limit_ == 0)
+        return true;
+    std::lock_guard<std::mutex> lock(mutex_);
+    return inUse_ < limit_;
+}
+
+std::size_t BufferPool::inUse() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return inUse_;
+}
+
+std::size_t BufferPool::peak() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return peak_;
+}
+
+std::size_t BufferPool::idle() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return idle_.size();
+}
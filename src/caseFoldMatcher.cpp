@@ -0,0 +1,682 @@
+#include "caseFoldMatcher.hpp"
+#include "byteFrequency.hpp"
+#include <algorithm>
+#include <cstring>
+#include <utility>
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define CASEFOLDMATCHER_X86 1
+#include <immintrin.h>
+#endif
+
+namespace {
+
+/// Invalid UTF-8 bytes decode to kInvalidBase + byte, outside the Unicode range.
+constexpr std::uint32_t kInvalidBase = 0x110000;
+/// Highest code point with a simple case folding in foldCodePoint().
+constexpr std::uint32_t kLastFoldedCodePoint = 0x1E921;
+
+inline unsigned char asciiLower(unsigned char c) {
+    return (c >= 'A' && c <= 'Z') ? static_cast<unsigned char>(c | 0x20) : c;
+}
+
+inline bool isAsciiLetter(unsigned char c) {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
+}
+
+/**
+ * @brief Decodes one UTF-8 character; invalid or truncated sequences decode one byte.
+ */
+inline std::uint32_t decodeUtf8(const unsigned char* p, std::size_t available, std::size_t& length) {
+    const unsigned char lead = p[0];
+    length = 1;
+    if (lead < 0x80) {
+        return lead;
+    }
+
+    std::size_t need;
+    std::uint32_t codePoint;
+    std::uint32_t minimum;
+    if ((lead & 0xE0) == 0xC0) {
+        need = 2; codePoint = lead & 0x1F; minimum = 0x80;
+    } else if ((lead & 0xF0) == 0xE0) {
+        need = 3; codePoint = lead & 0x0F; minimum = 0x800;
+    } else if ((lead & 0xF8) == 0xF0) {
+        need = 4; codePoint = lead & 0x07; minimum = 0x10000;
+    } else {
+        return kInvalidBase + lead;
+    }
+    if (available < need) {
+        return kInvalidBase + lead;
+    }
+    for (std::size_t i = 1; i < need; ++i) {
+        if ((p[i] & 0xC0) != 0x80) {
+            return kInvalidBase + lead;
+        }
+        codePoint = (codePoint << 6) | (p[i] & 0x3F);
+    }
+    if (codePoint < minimum || codePoint > 0x10FFFF || (codePoint >= 0xD800 && codePoint <= 0xDFFF)) {
+        return kInvalidBase + lead;
+    }
+    length = need;
+    return codePoint;
+}
+
+inline unsigned char utf8LeadByte(std::uint32_t codePoint) {
+    if (codePoint >= kInvalidBase) return static_cast<unsigned char>(codePoint - kInvalidBase);
+    if (codePoint < 0x80) return static_cast<unsigned char>(codePoint);
+    if (codePoint < 0x800) return static_cast<unsigned char>(0xC0 | (codePoint >> 6));
+    if (codePoint < 0x10000) return static_cast<unsigned char>(0xE0 | (codePoint >> 12));
+    return static_cast<unsigned char>(0xF0 | (codePoint >> 18));
+}
+
+/// Folds cp if it is the upper-case (even) member of an even/odd pair in [first, last].
+inline bool foldEvenPair(std::uint32_t& cp, std::uint32_t first, std::uint32_t last) {
+    if (cp >= first && cp <= last) {
+        if ((cp & 1) == 0) ++cp;
+        return true;
+    }
+    return false;
+}
+
+/// Folds cp if it is the upper-case (odd) member of an odd/even pair in [first, last].
+inline bool foldOddPair(std::uint32_t& cp, std::uint32_t first, std::uint32_t last) {
+    if (cp >= first && cp <= last) {
+        if ((cp & 1) == 1) ++cp;
+        return true;
+    }
+    return false;
+}
+
+inline bool foldRange(std::uint32_t& cp, std::uint32_t first, std::uint32_t last, std::int32_t delta) {
+    if (cp >= first && cp <= last) {
+        cp = static_cast<std::uint32_t>(static_cast<std::int32_t>(cp) + delta);
+        return true;
+    }
+    return false;
+}
+
+}  // namespace
+
+/**
+ * @brief Unicode simple case folding of one code point.
+ */
+std::uint32_t CaseFoldMatcher::foldCodePoint(std::uint32_t cp) {
+    if (cp < 0x80) {
+        return asciiLower(static_cast<unsigned char>(cp));
+    }
+    if (cp > kLastFoldedCodePoint) {
+        return cp;
+    }
+
+    if (cp < 0x100) {                                   // Latin-1 Supplement
+        if (cp == 0xB5) return 0x3BC;
+        if (cp >= 0xC0 && cp <= 0xDE && cp != 0xD7) return cp + 32;
+        return cp;
+    }
+    if (cp < 0x180) {                                   // Latin Extended-A
+        switch (cp) {
+        case 0x130: case 0x131: case 0x138: case 0x149: return cp;
+        case 0x178: return 0xFF;
+        case 0x17F: return 's';
+        default: break;
+        }
+        if ((cp >= 0x139 && cp <= 0x148) || (cp >= 0x179 && cp <= 0x17E)) {
+            return (cp & 1) ? cp + 1 : cp;
+        }
+        return (cp & 1) ? cp : cp + 1;
+    }
+    if (cp < 0x250) {                                   // Latin Extended-B
+        switch (cp) {
+        case 0x181: return 0x253;
+        case 0x186: return 0x254;
+        case 0x189: return 0x256;
+        case 0x18A: return 0x257;
+        case 0x18E: return 0x1DD;
+        case 0x18F: return 0x259;
+        case 0x190: return 0x25B;
+        case 0x193: return 0x260;
+        case 0x194: return 0x263;
+        case 0x196: return 0x269;
+        case 0x197: return 0x268;
+        case 0x19C: return 0x26F;
+        case 0x19D: return 0x272;
+        case 0x19F: return 0x275;
+        case 0x1A6: return 0x280;
+        case 0x1A9: return 0x283;
+        case 0x1AE: return 0x288;
+        case 0x1B1: return 0x28A;
+        case 0x1B2: return 0x28B;
+        case 0x1B7: return 0x292;
+        case 0x182: case 0x184: case 0x187: case 0x18B: case 0x191: case 0x198:
+        case 0x1A0: case 0x1A2: case 0x1A4: case 0x1A7: case 0x1AC: case 0x1AF:
+        case 0x1B3: case 0x1B5: case 0x1B8: case 0x1BC: case 0x1F4: case 0x23B:
+        case 0x241: return cp + 1;
+        case 0x1C4: case 0x1C5: return 0x1C6;
+        case 0x1C7: case 0x1C8: return 0x1C9;
+        case 0x1CA: case 0x1CB: return 0x1CC;
+        case 0x1F1: case 0x1F2: return 0x1F3;
+        case 0x1F6: return 0x195;
+        case 0x1F7: return 0x1BF;
+        case 0x220: return 0x19E;
+        case 0x23A: return 0x2C65;
+        case 0x23D: return 0x19A;
+        case 0x23E: return 0x2C66;
+        case 0x243: return 0x180;
+        case 0x244: return 0x289;
+        case 0x245: return 0x28C;
+        default: break;
+        }
+        foldOddPair(cp, 0x1CD, 0x1DC) || foldEvenPair(cp, 0x1DE, 0x1EF) ||
+            foldEvenPair(cp, 0x1F8, 0x21F) || foldEvenPair(cp, 0x222, 0x233) ||
+            foldEvenPair(cp, 0x246, 0x24F);
+        return cp;
+    }
+    if (cp < 0x400) {                                   // Greek and Coptic
+        switch (cp) {
+        case 0x345: return 0x3B9;
+        case 0x376: return 0x377;
+        case 0x37F: return 0x3F3;
+        case 0x386: return 0x3AC;
+        case 0x38C: return 0x3CC;
+        case 0x38E: return 0x3CD;
+        case 0x38F: return 0x3CE;
+        case 0x3C2: return 0x3C3;
+        case 0x3CF: return 0x3D7;
+        case 0x3D0: return 0x3B2;
+        case 0x3D1: return 0x3B8;
+        case 0x3D5: return 0x3C6;
+        case 0x3D6: return 0x3C0;
+        case 0x3F0: return 0x3BA;
+        case 0x3F1: return 0x3C1;
+        case 0x3F4: return 0x3B8;
+        case 0x3F5: return 0x3B5;
+        case 0x3F7: return 0x3F8;
+        case 0x3F9: return 0x3F2;
+        case 0x3FA: return 0x3FB;
+        default: break;
+        }
+        foldEvenPair(cp, 0x370, 0x373) || foldRange(cp, 0x388, 0x38A, 37) || foldRange(cp, 0x391, 0x3A1, 32) ||
+            foldRange(cp, 0x3A3, 0x3AB, 32) || foldEvenPair(cp, 0x3D8, 0x3EF) ||
+            foldRange(cp, 0x3FD, 0x3FF, -130);
+        return cp;
+    }
+    if (cp < 0x530) {                                   // Cyrillic and Cyrillic Supplement
+        if (cp == 0x4C0) return 0x4CF;
+        foldRange(cp, 0x400, 0x40F, 80) || foldRange(cp, 0x410, 0x42F, 32) ||
+            foldEvenPair(cp, 0x460, 0x481) || foldEvenPair(cp, 0x48A, 0x4BF) ||
+            foldOddPair(cp, 0x4C1, 0x4CE) || foldEvenPair(cp, 0x4D0, 0x52F);
+        return cp;
+    }
+    if (cp < 0x1000) {                                  // Armenian
+        foldRange(cp, 0x531, 0x556, 48);
+        return cp;
+    }
+    if (cp < 0x1E00) {                                  // Georgian, Cherokee, Cyrillic Extended-C
+        switch (cp) {
+        case 0x10C7: return 0x2D27;
+        case 0x10CD: return 0x2D2D;
+        case 0x1C80: return 0x432;
+        case 0x1C81: return 0x434;
+        case 0x1C82: return 0x43E;
+        case 0x1C83: return 0x441;
+        case 0x1C84: case 0x1C85: return 0x442;
+        case 0x1C86: return 0x44A;
+        case 0x1C87: return 0x463;
+        case 0x1C88: return 0xA64B;
+        default: break;
+        }
+        foldRange(cp, 0x10A0, 0x10C5, 0x2D00 - 0x10A0) || foldRange(cp, 0x13F8, 0x13FD, -8) ||
+            foldRange(cp, 0x1C90, 0x1CBA, 0x10D0 - 0x1C90) || foldRange(cp, 0x1CBD, 0x1CBF, 0x10FD - 0x1CBD);
+        return cp;
+    }
+    if (cp < 0x1F00) {                                  // Latin Extended Additional
+        if (cp == 0x1E9B) return 0x1E61;
+        if (cp == 0x1E9E) return 0xDF;
+        foldEvenPair(cp, 0x1E00, 0x1E95) || foldEvenPair(cp, 0x1EA0, 0x1EFF);
+        return cp;
+    }
+    if (cp < 0x2000) {                                  // Greek Extended
+        switch (cp) {
+        case 0x1F59: case 0x1F5B: case 0x1F5D: case 0x1F5F: return cp - 8;
+        case 0x1FBC: return 0x1FB3;
+        case 0x1FBE: return 0x3B9;
+        case 0x1FCC: return 0x1FC3;
+        case 0x1FEC: return 0x1FE5;
+        case 0x1FFC: return 0x1FF3;
+        default: break;
+        }
+        foldRange(cp, 0x1F08, 0x1F0F, -8) || foldRange(cp, 0x1F18, 0x1F1D, -8) ||
+            foldRange(cp, 0x1F28, 0x1F2F, -8) || foldRange(cp, 0x1F38, 0x1F3F, -8) ||
+            foldRange(cp, 0x1F48, 0x1F4D, -8) || foldRange(cp, 0x1F68, 0x1F6F, -8) ||
+            foldRange(cp, 0x1F88, 0x1F8F, -8) || foldRange(cp, 0x1F98, 0x1F9F, -8) ||
+            foldRange(cp, 0x1FA8, 0x1FAF, -8) || foldRange(cp, 0x1FB8, 0x1FB9, -8) ||
+            foldRange(cp, 0x1FBA, 0x1FBB, -74) || foldRange(cp, 0x1FC8, 0x1FCB, -86) ||
+            foldRange(cp, 0x1FD8, 0x1FD9, -8) || foldRange(cp, 0x1FDA, 0x1FDB, -100) ||
+            foldRange(cp, 0x1FE8, 0x1FE9, -8) || foldRange(cp, 0x1FEA, 0x1FEB, -112) ||
+            foldRange(cp, 0x1FF8, 0x1FF9, -128) || foldRange(cp, 0x1FFA, 0x1FFB, -126);
+        return cp;
+    }
+    if (cp < 0x2D00) {      // Letter-like, numerals, circled, Glagolitic, Latin Extended-C, Coptic
+        switch (cp) {
+        case 0x2126: return 0x3C9;
+        case 0x212A: return 'k';
+        case 0x212B: return 0xE5;
+        case 0x2132: return 0x214E;
+        case 0x2183: return 0x2184;
+        case 0x2C60: case 0x2C72: case 0x2C75: case 0x2CF2: return cp + 1;
+        case 0x2C62: return 0x26B;
+        case 0x2C63: return 0x1D7D;
+        case 0x2C64: return 0x27D;
+        case 0x2C6D: return 0x251;
+        case 0x2C6E: return 0x271;
+        case 0x2C6F: return 0x250;
+        case 0x2C70: return 0x252;
+        case 0x2C7E: return 0x23F;
+        case 0x2C7F: return 0x240;
+        default: break;
+        }
+        foldRange(cp, 0x2160, 0x216F, 16) || foldRange(cp, 0x24B6, 0x24CF, 26) ||
+            foldRange(cp, 0x2C00, 0x2C2F, 48) || foldOddPair(cp, 0x2C67, 0x2C6C) ||
+            foldEvenPair(cp, 0x2C80, 0x2CE3) || foldOddPair(cp, 0x2CEB, 0x2CEE);
+        return cp;
+    }
+    if (cp >= 0xA640 && cp < 0xA800) {                  // Cyrillic Extended-B, Latin Extended-D
+        if (foldEvenPair(cp, 0xA640, 0xA66D) || foldEvenPair(cp, 0xA680, 0xA69B) ||
+            foldEvenPair(cp, 0xA722, 0xA72F) || foldEvenPair(cp, 0xA732, 0xA76F) ||
+            foldOddPair(cp, 0xA779, 0xA77C) || foldEvenPair(cp, 0xA77E, 0xA787) ||
+            foldEvenPair(cp, 0xA790, 0xA793) || foldEvenPair(cp, 0xA796, 0xA7A9) ||
+            foldEvenPair(cp, 0xA7B4, 0xA7C3) || foldOddPair(cp, 0xA7C7, 0xA7CA) ||
+            foldEvenPair(cp, 0xA7D0, 0xA7D1) || foldEvenPair(cp, 0xA7D6, 0xA7D9)) {
+            return cp;
+        }
+        switch (cp) {
+        case 0xA77D: return 0x1D79;
+        case 0xA78B: return 0xA78C;
+        case 0xA78D: return 0x265;
+        case 0xA7AA: return 0x266;
+        case 0xA7AB: return 0x25C;
+        case 0xA7AC: return 0x261;
+        case 0xA7AD: return 0x26C;
+        case 0xA7AE: return 0x26A;
+        case 0xA7B0: return 0x29E;
+        case 0xA7B1: return 0x287;
+        case 0xA7B2: return 0x29D;
+        case 0xA7B3: return 0xAB53;
+        case 0xA7C4: return 0xA794;
+        case 0xA7C5: return 0x282;
+        case 0xA7C6: return 0x1D8E;
+        case 0xA7F5: return 0xA7F6;
+        default: return cp;
+        }
+    }
+    if (foldRange(cp, 0xAB70, 0xABBF, 0x13A0 - 0xAB70) ||      // Cherokee Supplement
+        foldRange(cp, 0xFF21, 0xFF3A, 32) ||                   // Full-width Latin
+        foldRange(cp, 0x10400, 0x10427, 40) ||                 // Deseret
+        foldRange(cp, 0x104B0, 0x104D3, 40) ||                 // Osage
+        foldRange(cp, 0x10570, 0x1057A, 39) ||                 // Vithkuqi
+        foldRange(cp, 0x1057C, 0x1058A, 39) ||
+        foldRange(cp, 0x1058C, 0x10592, 39) ||
+        foldRange(cp, 0x10594, 0x10595, 39) ||
+        foldRange(cp, 0x10C80, 0x10CB2, 64) ||                 // Old Hungarian
+        foldRange(cp, 0x118A0, 0x118BF, 32) ||                 // Warang Citi
+        foldRange(cp, 0x16E40, 0x16E5F, 32) ||                 // Medefaidrin
+        foldRange(cp, 0x1E900, 0x1E921, 34)) {                 // Adlam
+        return cp;
+    }
+    return cp;
+}
+
+/**
+ * @brief Builds a matcher for the given needle using the best kernel for this CPU.
+ */
+CaseFoldMatcher::CaseFoldMatcher(std::string needle)
+    : CaseFoldMatcher(std::move(needle), LiteralMatcher::bestKernel()) {}
+
+/**
+ * @brief Folds the needle and prepares the candidate filter for the chosen path.
+ */
+CaseFoldMatcher::CaseFoldMatcher(std::string needle, Kernel kernel)
+    : needle_(std::move(needle)), kernel_(kernel) {
+    if (static_cast<int>(kernel_) > static_cast<int>(LiteralMatcher::bestKernel())) {
+        kernel_ = LiteralMatcher::bestKernel();
+    }
+
+    const auto* bytes = reinterpret_cast<const unsigned char*>(needle_.data());
+    for (std::size_t i = 0; i < needle_.size();) {
+        std::size_t length;
+        foldedCodePoints_.push_back(foldCodePoint(decodeUtf8(bytes + i, needle_.size() - i, length)));
+        i += length;
+    }
+
+    asciiNeedle_ = std::all_of(foldedCodePoints_.begin(), foldedCodePoints_.end(),
+                               [](std::uint32_t cp) { return cp < 0x80; });
+    ascii_ = asciiNeedle_ && std::none_of(foldedCodePoints_.begin(), foldedCodePoints_.end(),
+                                          [](std::uint32_t cp) { return cp == 'k' || cp == 's'; });
+
+    if (asciiNeedle_) {
+        for (std::uint32_t cp : foldedCodePoints_) {
+            foldedAscii_.push_back(static_cast<char>(cp));
+        }
+        // Letters match in either case, so rank them by their lower-case frequency.
+        auto rank = [&](std::size_t i) { return byteRank(static_cast<unsigned char>(foldedAscii_[i])); };
+        for (std::size_t i = 1; i < foldedAscii_.size(); ++i) {
+            if (rank(i) < rank(rareOffset1_)) {
+                rareOffset1_ = i;
+            }
+        }
+        rareOffset2_ = rareOffset1_ == 0 ? std::min<std::size_t>(1, foldedAscii_.size() - 1) : 0;
+        for (std::size_t i = 0; i < foldedAscii_.size(); ++i) {
+            if (i != rareOffset1_ && rank(i) < rank(rareOffset2_)) {
+                rareOffset2_ = i;
+            }
+        }
+    }
+    if (ascii_) {
+        return;
+    }
+
+    // Every character folding to the same code point as the needle's first character can
+    // start a match; collect the UTF-8 lead bytes they can begin with.
+    const std::uint32_t first = foldedCodePoints_.front();
+    leadBytes_.push_back(utf8LeadByte(first));
+    if (first < kInvalidBase) {
+        for (std::uint32_t cp = 0; cp <= kLastFoldedCodePoint; ++cp) {
+            if ((cp < 0xD800 || cp > 0xDFFF) && foldCodePoint(cp) == first) {
+                leadBytes_.push_back(utf8LeadByte(cp));
+            }
+        }
+    }
+    std::sort(leadBytes_.begin(), leadBytes_.end());
+    leadBytes_.erase(std::unique(leadBytes_.begin(), leadBytes_.end()), leadBytes_.end());
+}
+
+/**
+ * @brief Finds the first case-insensitive occurrence at or after the given offset.
+ */
+CaseFoldMatcher::Match CaseFoldMatcher::find(std::string_view haystack, std::size_t from) const {
+    if (from > haystack.size()) {
+        return {};
+    }
+    if (needle_.empty()) {
+        return {from, 0};
+    }
+    if (ascii_) {
+        return findAscii(haystack, from);
+    }
+    if (!asciiNeedle_) {
+        return findUtf8(haystack, from, haystack.size());
+    }
+
+    // ASCII needle containing 'k' or 's': only KELVIN SIGN (E2 84 AA) and LONG S (C5 BF) can
+    // match it outside ASCII, so windows free of those lead bytes take the ASCII path.
+    static constexpr unsigned char exoticLeads[] = {0xC5, 0xE2};
+    const std::size_t n = foldedAscii_.size();
+    std::size_t pos = from;
+    while (pos < haystack.size()) {
+        const std::size_t windowEnd = std::min(haystack.size(), pos + kWindowSize);
+        const std::size_t regionEnd = std::min(haystack.size(), windowEnd + 3 * n);
+        const std::string_view region = haystack.substr(0, regionEnd);
+
+        Match match;
+        if (findAnyByte(region, pos, exoticLeads, 2) == std::string_view::npos) {
+            match = findAscii(haystack.substr(0, std::min(haystack.size(), windowEnd + n - 1)), pos);
+        } else {
+            match = findUtf8(haystack, pos, windowEnd);
+        }
+        if (match) {
+            return match;
+        }
+        pos = windowEnd;
+    }
+    return {};
+}
+
+namespace {
+
+inline bool asciiEqualFolded(const unsigned char* text, const char* folded, std::size_t n) {
+    for (std::size_t i = 0; i < n; ++i) {
+        if (asciiLower(text[i]) != static_cast<unsigned char>(folded[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+#ifdef CASEFOLDMATCHER_X86
+
+/// Lanes whose byte equals `value` once bits in `orMask` (0x20 for letters) are set.
+__attribute__((target("avx2"), always_inline))
+inline __m256i avx2FoldedEq(const char* p, __m256i orMask, __m256i value) {
+    const __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+    return _mm256_cmpeq_epi8(_mm256_or_si256(block, orMask), value);
+}
+
+__attribute__((target("sse2"), always_inline))
+inline __m128i sse2FoldedEq(const char* p, __m128i orMask, __m128i value) {
+    const __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+    return _mm_cmpeq_epi8(_mm_or_si128(block, orMask), value);
+}
+
+struct AsciiPairScan {
+    const char* base;
+    const char* folded;
+    std::size_t n;
+    std::size_t last;
+    std::size_t offset1;
+    std::size_t offset2;
+
+    __attribute__((target("avx2")))
+    std::size_t avx2(std::size_t& pos) const {
+        const auto c1 = static_cast<unsigned char>(folded[offset1]);
+        const auto c2 = static_cast<unsigned char>(folded[offset2]);
+        const __m256i value1 = _mm256_set1_epi8(static_cast<char>(c1));
+        const __m256i value2 = _mm256_set1_epi8(static_cast<char>(c2));
+        const __m256i mask1 = _mm256_set1_epi8(isAsciiLetter(c1) ? 0x20 : 0);
+        const __m256i mask2 = _mm256_set1_epi8(isAsciiLetter(c2) ? 0x20 : 0);
+        const auto* text = reinterpret_cast<const unsigned char*>(base);
+
+        for (; pos + 31 <= last; pos += 32) {
+            const __m256i hits = _mm256_and_si256(avx2FoldedEq(base + pos + offset1, mask1, value1),
+                                                  avx2FoldedEq(base + pos + offset2, mask2, value2));
+            auto bits = static_cast<std::uint32_t>(_mm256_movemask_epi8(hits));
+            while (bits != 0) {
+                const std::size_t candidate = pos + static_cast<std::size_t>(__builtin_ctz(bits));
+                if (asciiEqualFolded(text + candidate, folded, n)) {
+                    return candidate;
+                }
+                bits &= bits - 1;
+            }
+        }
+        return std::string_view::npos;
+    }
+
+    __attribute__((target("sse2")))
+    std::size_t sse2(std::size_t& pos) const {
+        const auto c1 = static_cast<unsigned char>(folded[offset1]);
+        const auto c2 = static_cast<unsigned char>(folded[offset2]);
+        const __m128i value1 = _mm_set1_epi8(static_cast<char>(c1));
+        const __m128i value2 = _mm_set1_epi8(static_cast<char>(c2));
+        const __m128i mask1 = _mm_set1_epi8(isAsciiLetter(c1) ? 0x20 : 0);
+        const __m128i mask2 = _mm_set1_epi8(isAsciiLetter(c2) ? 0x20 : 0);
+        const auto* text = reinterpret_cast<const unsigned char*>(base);
+
+        for (; pos + 15 <= last; pos += 16) {
+            const __m128i hits = _mm_and_si128(sse2FoldedEq(base + pos + offset1, mask1, value1),
+                                               sse2FoldedEq(base + pos + offset2, mask2, value2));
+            auto bits = static_cast<std::uint32_t>(_mm_movemask_epi8(hits));
+            while (bits != 0) {
+                const std::size_t candidate = pos + static_cast<std::size_t>(__builtin_ctz(bits));
+                if (asciiEqualFolded(text + candidate, folded, n)) {
+                    return candidate;
+                }
+                bits &= bits - 1;
+            }
+        }
+        return std::string_view::npos;
+    }
+};
+
+/// Position of the first byte equal to any of `values` (at most 4), scanning [pos, end).
+__attribute__((target("avx2")))
+std::size_t avx2FindAny(const unsigned char* base, std::size_t& pos, std::size_t end,
+                        const unsigned char* values, std::size_t count) {
+    __m256i v[4];
+    for (std::size_t i = 0; i < 4; ++i) {
+        v[i] = _mm256_set1_epi8(static_cast<char>(values[i < count ? i : 0]));
+    }
+    for (; pos + 32 <= end; pos += 32) {
+        const __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(base + pos));
+        const __m256i hits = _mm256_or_si256(
+            _mm256_or_si256(_mm256_cmpeq_epi8(block, v[0]), _mm256_cmpeq_epi8(block, v[1])),
+            _mm256_or_si256(_mm256_cmpeq_epi8(block, v[2]), _mm256_cmpeq_epi8(block, v[3])));
+        const auto bits = static_cast<std::uint32_t>(_mm256_movemask_epi8(hits));
+        if (bits != 0) {
+            return pos + static_cast<std::size_t>(__builtin_ctz(bits));
+        }
+    }
+    return std::string_view::npos;
+}
+
+__attribute__((target("sse2")))
+std::size_t sse2FindAny(const unsigned char* base, std::size_t& pos, std::size_t end,
+                        const unsigned char* values, std::size_t count) {
+    __m128i v[4];
+    for (std::size_t i = 0; i < 4; ++i) {
+        v[i] = _mm_set1_epi8(static_cast<char>(values[i < count ? i : 0]));
+    }
+    for (; pos + 16 <= end; pos += 16) {
+        const __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(base + pos));
+        const __m128i hits = _mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi8(block, v[0]), _mm_cmpeq_epi8(block, v[1])),
+            _mm_or_si128(_mm_cmpeq_epi8(block, v[2]), _mm_cmpeq_epi8(block, v[3])));
+        const auto bits = static_cast<std::uint32_t>(_mm_movemask_epi8(hits));
+        if (bits != 0) {
+            return pos + static_cast<std::size_t>(__builtin_ctz(bits));
+        }
+    }
+    return std::string_view::npos;
+}
+
+#endif
+
+}  // namespace
+
+/**
+ * @brief ASCII fast path: vectorised two-byte candidate scan in both cases, then verification.
+ */
+CaseFoldMatcher::Match CaseFoldMatcher::findAscii(std::string_view haystack, std::size_t from) const {
+    const std::size_t n = foldedAscii_.size();
+    if (haystack.size() - from < n) {
+        return {};
+    }
+    const std::size_t last = haystack.size() - n;
+    const auto* text = reinterpret_cast<const unsigned char*>(haystack.data());
+    std::size_t pos = from;
+
+#ifdef CASEFOLDMATCHER_X86
+    if (n > 1 && kernel_ != Kernel::Scalar) {
+        const AsciiPairScan scan{haystack.data(), foldedAscii_.data(), n, last, rareOffset1_, rareOffset2_};
+        std::size_t hit = std::string_view::npos;
+        if (kernel_ == Kernel::Avx2) {
+            hit = scan.avx2(pos);
+        }
+        if (hit == std::string_view::npos) {
+            hit = scan.sse2(pos);
+        }
+        if (hit != std::string_view::npos) {
+            return {hit, n};
+        }
+    }
+#endif
+
+    const auto rare = static_cast<unsigned char>(foldedAscii_[rareOffset1_]);
+    for (; pos <= last; ++pos) {
+        if (asciiLower(text[pos + rareOffset1_]) == rare && asciiEqualFolded(text + pos, foldedAscii_.data(), n)) {
+            return {pos, n};
+        }
+    }
+    return {};
+}
+
+/**
+ * @brief Position of the first byte in [from, haystack.size()) equal to any of `values`.
+ */
+std::size_t CaseFoldMatcher::findAnyByte(std::string_view haystack, std::size_t from,
+                                         const unsigned char* values, std::size_t count) const {
+    const auto* text = reinterpret_cast<const unsigned char*>(haystack.data());
+    const std::size_t end = haystack.size();
+    if (from >= end) {
+        return std::string_view::npos;
+    }
+
+    if (count == 1) {
+        const void* hit = std::memchr(text + from, values[0], end - from);
+        return hit ? static_cast<std::size_t>(static_cast<const unsigned char*>(hit) - text)
+                   : std::string_view::npos;
+    }
+
+    std::size_t pos = from;
+#ifdef CASEFOLDMATCHER_X86
+    if (count <= 4 && kernel_ != Kernel::Scalar) {
+        std::size_t hit = std::string_view::npos;
+        if (kernel_ == Kernel::Avx2) {
+            hit = avx2FindAny(text, pos, end, values, count);
+        }
+        if (hit == std::string_view::npos) {
+            hit = sse2FindAny(text, pos, end, values, count);
+        }
+        if (hit != std::string_view::npos) {
+            return hit;
+        }
+    }
+#endif
+
+    for (; pos < end; ++pos) {
+        if (std::find(values, values + count, text[pos]) != values + count) {
+            return pos;
+        }
+    }
+    return std::string_view::npos;
+}
+
+/**
+ * @brief Length in haystack bytes of a match starting at position, or npos if none starts there.
+ */
+std::size_t CaseFoldMatcher::matchUtf8At(std::string_view haystack, std::size_t position) const {
+    const auto* text = reinterpret_cast<const unsigned char*>(haystack.data());
+    std::size_t pos = position;
+    for (std::uint32_t expected : foldedCodePoints_) {
+        if (pos >= haystack.size()) {
+            return std::string_view::npos;
+        }
+        std::size_t length;
+        const std::uint32_t cp = decodeUtf8(text + pos, haystack.size() - pos, length);
+        if (foldCodePoint(cp) != expected) {
+            return std::string_view::npos;
+        }
+        pos += length;
+    }
+    return pos - position;
+}
+
+/**
+ * @brief UTF-8 path: scan for candidate lead bytes before `limit` and verify by folding code points.
+ */
+CaseFoldMatcher::Match CaseFoldMatcher::findUtf8(std::string_view haystack, std::size_t from,
+                                                 std::size_t limit) const {
+    const std::string_view candidates = haystack.substr(0, limit);
+    std::size_t pos = from;
+    while (pos < limit) {
+        const std::size_t candidate = findAnyByte(candidates, pos, leadBytes_.data(), leadBytes_.size());
+        if (candidate == std::string_view::npos) {
+            break;
+        }
+        const std::size_t length = matchUtf8At(haystack, candidate);
+        if (length != std::string_view::npos) {
+            return {candidate, length};
+        }
+        pos = candidate + 1;
+    }
+    return {};
+}
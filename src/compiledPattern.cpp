@@ -0,0 +1,195 @@
+#include "compiledPattern.hpp"
+#include "automatonRegex.hpp"
+#include "caseFoldMatcher.hpp"
+#include "literalMatcher.hpp"
+#include "multiLiteralMatcher.hpp"
+#include <algorithm>
+#include <utility>
+
+/**
+ * @brief Compiles the query into a literal matcher, an AutomatonRegex or a std::regex.
+ */
+CompiledPattern::CompiledPattern(std::string query, bool caseSensitive, bool useRegex, RegexEngine engine)
+    : query_(std::move(query)), caseSensitive_(caseSensitive), useRegex_(useRegex), engine_(engine) {
+    if (!useRegex_) {
+        if (caseSensitive_)
+            literal_ = std::make_unique<const LiteralMatcher>(query_);
+        else
+            folded_ = std::make_unique<const CaseFoldMatcher>(query_);
+        return;
+    }
+
+    if (engine_ == RegexEngine::Automaton) {
+        try {
+            automaton_ = std::make_unique<const AutomatonRegex>(query_, caseSensitive_);
+        }
+        catch (const RegexError& e) {
+            valid_ = false;
+            error_ = e.what();
+            return;
+        }
+        const std::string& required = automaton_->requiredLiteral();
+        if (!required.empty()) {
+            if (caseSensitive_)
+                prefilter_ = std::make_unique<const LiteralMatcher>(required);
+            else
+                foldedPrefilter_ = std::make_unique<const CaseFoldMatcher>(required);
+        }
+        return;
+    }
+
+    std::regex_constants::syntax_option_type flags = std::regex::ECMAScript;
+    if (!caseSensitive_)
+        flags |= std::regex::icase;
+    try {
+        regex_ = std::regex(query_, flags);
+    }
+    catch (const std::regex_error& e) {
+        valid_ = false;
+        error_ = e.what();
+    }
+}
+
+/**
+ * @brief Compiles a pattern list into a MultiLiteralMatcher (or a literal matcher for one pattern).
+ */
+CompiledPattern::CompiledPattern(std::vector<std::string> patterns, bool caseSensitive)
+    : caseSensitive_(caseSensitive), useRegex_(false), engine_(RegexEngine::Automaton), patternList_(true) {
+    patterns.erase(std::remove(patterns.begin(), patterns.end(), std::string()), patterns.end());
+    patterns_ = std::move(patterns);
+    for (const auto& pattern : patterns_) {
+        if (!query_.empty())
+            query_ += '\n';
+        query_ += pattern;
+    }
+
+    if (patterns_.size() == 1) {
+        if (caseSensitive_)
+            literal_ = std::make_unique<const LiteralMatcher>(query_);
+        else
+            folded_ = std::make_unique<const CaseFoldMatcher>(query_);
+        return;
+    }
+    multi_ = std::make_unique<const MultiLiteralMatcher>(patterns_, caseSensitive_);
+}
+
+CompiledPattern::~CompiledPattern() = default;
+
+/**
+ * @brief Finds the next match at or after `from`.
+ */
+MatchSpan CompiledPattern::find(std::string_view text, std::size_t from) const {
+    if (from > text.size() || !valid_)
+        return {};
+
+    if (literal_) {
+        const std::size_t position = literal_->find(text, from);
+        return position == std::string_view::npos ? MatchSpan{} : MatchSpan{position, query_.size()};
+    }
+    if (folded_) {
+        const auto match = folded_->find(text, from);
+        return {match.position, match.length};
+    }
+    if (automaton_)
+        return automaton_->find(text, from);
+    if (multi_)
+        return multi_->find(text, from);
+
+    std::cmatch match;
+    const auto flags = from > 0 ? std::regex_constants::match_prev_avail : std::regex_constants::match_default;
+    if (!std::regex_search(text.data() + from, text.data() + text.size(), match, regex_, flags))
+        return {};
+    return {from + static_cast<std::size_t>(match.position(0)), static_cast<std::size_t>(match.length(0))};
+}
+
+/**
+ * @brief Whether the line contains a match.
+ */
+bool CompiledPattern::matchesLine(std::string_view line) const {
+    if (!valid_)
+        return false;
+    if (automaton_)
+        return automaton_->search(line);
+    if (useRegex_)
+        return std::regex_search(line.data(), line.data() + line.size(), regex_);
+    return static_cast<bool>(find(line));
+}
+
+/**
+ * @brief A string every match contains, if the regex engine knows one.
+ */
+std::string_view CompiledPattern::requiredLiteral() const {
+    return automaton_ ? std::string_view(automaton_->requiredLiteral()) : std::string_view();
+}
+
+/**
+ * @brief Offset of the next place in a buffer where a match may be.
+ */
+std::size_t CompiledPattern::findCandidate(std::string_view text, std::size_t from) const {
+    if (from > text.size() || !valid_)
+        return std::string_view::npos;
+    if (!useRegex_)
+        return find(text, from).position;
+    if (prefilter_)
+        return prefilter_->find(text, from);
+    if (foldedPrefilter_)
+        return foldedPrefilter_->find(text, from).position;
+    return from;
+}
+
+/**
+ * @brief Constructor.
+ */
+PatternCache::PatternCache(std::size_t capacity)
+    : capacity_(std::max<std::size_t>(capacity, 1)) {}
+
+/**
+ * @brief Returns the compiled pattern for the query and options, compiling it on a miss.
+ *
+ * Compilation happens outside the lock so a slow regex does not block other lookups; if two
+ * threads miss on the same key concurrently, the first insertion wins.
+ */
+std::shared_ptr<const CompiledPattern> PatternCache::get(const std::string& query, bool caseSensitive,
+                                                         bool useRegex, RegexEngine engine) {
+    Key key{query, caseSensitive, useRegex, engine};
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = index_.find(key);
+        if (it != index_.end()) {
+            entries_.splice(entries_.begin(), entries_, it->second);
+            return it->second->second;
+        }
+    }
+
+    auto compiled = std::make_shared<const CompiledPattern>(query, caseSensitive, useRegex, engine);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = index_.find(key);
+    if (it != index_.end()) {
+        entries_.splice(entries_.begin(), entries_, it->second);
+        return it->second->second;
+    }
+    entries_.emplace_front(key, compiled);
+    index_.emplace(std::move(key), entries_.begin());
+    if (entries_.size() > capacity_) {
+        index_.erase(entries_.back().first);
+        entries_.pop_back();
+    }
+    return compiled;
+}
+
+std::size_t PatternCache::size() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return entries_.size();
+}
+
+void PatternCache::clear() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    entries_.clear();
+    index_.clear();
+}
+
+PatternCache& PatternCache::global() {
+    static PatternCache cache;
+    return cache;
+}
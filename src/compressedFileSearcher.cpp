@@ -0,0 +1,314 @@
+#include "compressedFileSearcher.hpp"
+#include "boundedQueue.hpp"
+#include "fileBuffer.hpp"
+#include "searchStats.hpp"
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <optional>
+#include <thread>
+
+#ifdef FILESEARCHER_HAVE_ZLIB
+#include <zlib.h>
+#endif
+#ifdef FILESEARCHER_HAVE_LZMA
+#include <lzma.h>
+#endif
+#ifdef FILESEARCHER_HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+namespace {
+
+/// Receives a decompressed chunk; returning false stops the decompression.
+using Emit = std::function<bool(std::string)>;
+
+constexpr unsigned char kGzipMagic[] = {0x1F, 0x8B};
+constexpr unsigned char kXzMagic[] = {0xFD, '7', 'z', 'X', 'Z', 0x00};
+constexpr unsigned char kZstdMagic[] = {0x28, 0xB5, 0x2F, 0xFD};
+
+template <size_t N>
+bool startsWith(std::string_view data, const unsigned char (&magic)[N]) {
+    return data.size() >= N && std::memcmp(data.data(), magic, N) == 0;
+}
+
+#ifdef FILESEARCHER_HAVE_ZLIB
+/// Inflates gzip members one after another; returns an error message, or an empty string.
+std::string inflateGzip(std::string_view input, const Emit& emit) {
+    z_stream stream{};
+    if (inflateInit2(&stream, 15 + 16) != Z_OK)
+        return "zlib initialization failed";
+
+    std::string error;
+    size_t fed = 0;         // input bytes handed to zlib so far (avail_in is 32-bit)
+    for (;;) {
+        if (stream.avail_in == 0 && fed < input.size()) {
+            const size_t piece = std::min<size_t>(input.size() - fed, UINT_MAX);
+            stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(input.data() + fed));
+            stream.avail_in = static_cast<uInt>(piece);
+            fed += piece;
+        }
+        std::string chunk(CompressedFileSearcher::kChunkSize, '\0');
+        stream.next_out = reinterpret_cast<Bytef*>(chunk.data());
+        stream.avail_out = static_cast<uInt>(chunk.size());
+        const int status = inflate(&stream, Z_NO_FLUSH);
+        chunk.resize(chunk.size() - stream.avail_out);
+        if (!chunk.empty() && !emit(std::move(chunk)))
+            break;
+
+        if (status == Z_STREAM_END) {
+            // Another member may follow; anything else after the last member is ignored, as gzip does.
+            const size_t consumed = fed - stream.avail_in;
+            if (!startsWith(input.substr(consumed), kGzipMagic))
+                break;
+            inflateReset(&stream);
+        } else if (status == Z_BUF_ERROR && stream.avail_in == 0 && fed == input.size()) {
+            error = "unexpected end of data";
+            break;
+        } else if (status != Z_OK && status != Z_BUF_ERROR) {
+            error = stream.msg ? stream.msg : "corrupt data";
+            break;
+        }
+    }
+    inflateEnd(&stream);
+    return error;
+}
+#endif
+
+#ifdef FILESEARCHER_HAVE_LZMA
+/// Decodes concatenated xz streams; returns an error message, or an empty string.
+std::string decodeXz(std::string_view input, const Emit& emit) {
+    lzma_stream stream = LZMA_STREAM_INIT;
+    if (lzma_stream_decoder(&stream, UINT64_MAX, LZMA_CONCATENATED) != LZMA_OK)
+        return "liblzma initialization failed";
+
+    stream.next_in = reinterpret_cast<const uint8_t*>(input.data());
+    stream.avail_in = input.size();
+    std::string error;
+    for (;;) {
+        std::string chunk(CompressedFileSearcher::kChunkSize, '\0');
+        stream.next_out = reinterpret_cast<uint8_t*>(chunk.data());
+        stream.avail_out = chunk.size();
+        const lzma_ret status = lzma_code(&stream, LZMA_FINISH);
+        chunk.resize(chunk.size() - stream.avail_out);
+        if (!chunk.empty() && !emit(std::move(chunk)))
+            break;
+        if (status == LZMA_STREAM_END)
+            break;
+        if (status != LZMA_OK) {
+            error = status == LZMA_MEM_ERROR   ? "out of memory"
+                    : status == LZMA_BUF_ERROR ? "unexpected end of data"
+                                               : "corrupt data";
+            break;
+        }
+    }
+    lzma_end(&stream);
+    return error;
+}
+#endif
+
+#ifdef FILESEARCHER_HAVE_ZSTD
+/// Decodes zstd frames one after another; returns an error message, or an empty string.
+std::string decodeZstd(std::string_view input, const Emit& emit) {
+    ZSTD_DStream* stream = ZSTD_createDStream();
+    if (stream == nullptr || ZSTD_isError(ZSTD_initDStream(stream))) {
+        ZSTD_freeDStream(stream);
+        return "libzstd initialization failed";
+    }
+
+    ZSTD_inBuffer in{input.data(), input.size(), 0};
+    std::string error;
+    size_t status = 0;
+    for (;;) {
+        std::string chunk(CompressedFileSearcher::kChunkSize, '\0');
+        ZSTD_outBuffer out{chunk.data(), chunk.size(), 0};
+        status = ZSTD_decompressStream(stream, &out, &in);
+        if (ZSTD_isError(status)) {
+            error = ZSTD_getErrorName(status);
+            break;
+        }
+        const bool flushed = out.pos < out.size;
+        chunk.resize(out.pos);
+        if (!chunk.empty() && !emit(std::move(chunk)))
+            break;
+        if (in.pos == in.size && flushed) {
+            if (status != 0)
+                error = "unexpected end of data";
+            break;
+        }
+    }
+    ZSTD_freeDStream(stream);
+    return error;
+}
+#endif
+
+}  // namespace
+
+CompressedFileSearcher::Compression CompressedFileSearcher::detectCompression(std::string_view head) {
+    if (startsWith(head, kGzipMagic))
+        return Compression::Gzip;
+    if (startsWith(head, kXzMagic))
+        return Compression::Xz;
+    if (startsWith(head, kZstdMagic))
+        return Compression::Zstd;
+    return Compression::None;
+}
+
+bool CompressedFileSearcher::isSupported(Compression compression) {
+    switch (compression) {
+#ifdef FILESEARCHER_HAVE_ZLIB
+    case Compression::Gzip: return true;
+#endif
+#ifdef FILESEARCHER_HAVE_LZMA
+    case Compression::Xz: return true;
+#endif
+#ifdef FILESEARCHER_HAVE_ZSTD
+    case Compression::Zstd: return true;
+#endif
+    default: return false;
+    }
+}
+
+bool CompressedFileSearcher::requiresWholeFile(std::string_view head) const {
+    return isSupported(detectCompression(head)) || text_.requiresWholeFile(head);
+}
+
+/**
+ * @brief Searches a file, decompressing it on the fly if it is compressed in a supported format.
+ *
+ * @param filePath       The path to the file to search.
+ * @param pattern        The compiled query.
+ * @param sink           Receives the results.
+ * @param threadIdStr    Identifier of the calling worker.
+ */
+void CompressedFileSearcher::search(const std::filesystem::path& filePath, const CompiledPattern& pattern,
+                                    ResultSink& sink, const std::string& threadIdStr) {
+    std::error_code ec;
+    FileBuffer input;
+    if (!pattern.valid() || !std::filesystem::is_regular_file(filePath, ec) || !input.open(filePath)) {
+        text_.search(filePath, pattern, sink, threadIdStr);   // streams non-regular files, reports errors
+        return;
+    }
+    searchContents(filePath, input.view(), pattern, sink, threadIdStr);
+}
+
+void CompressedFileSearcher::searchContents(const std::filesystem::path& filePath, std::string_view contents,
+                                            const CompiledPattern& pattern, ResultSink& sink,
+                                            const std::string& threadIdStr) {
+    const Compression compression = detectCompression(contents);
+    if (!pattern.valid() || !isSupported(compression)) {
+        text_.searchContents(filePath, contents, pattern, sink, threadIdStr);
+        return;
+    }
+    searchCompressed(filePath.string(), contents, compression, pattern, sink, threadIdStr);
+}
+
+void CompressedFileSearcher::searchRange(const std::filesystem::path& filePath, std::string_view range,
+                                         size_t firstLineNumber, size_t byteOffset, const CompiledPattern& pattern,
+                                         std::vector<SearchResult>& results) {
+    text_.searchRange(filePath, range, firstLineNumber, byteOffset, pattern, results);
+}
+
+/**
+ * @brief Decompresses on a producer thread and searches the complete lines of every chunk.
+ *
+ * The first chunk decides how the contents are treated (see detectEncoding()). Binary
+ * contents that are skipped, or reported as soon as one line matches, close the queue, which
+ * stops the decompression early; so does a file that is done by the report mode or max count.
+ * The last lines of a chunk are kept in front of the next one for the context lines.
+ */
+void CompressedFileSearcher::searchCompressed(const std::string& path, std::string_view input,
+                                              Compression compression, const CompiledPattern& pattern,
+                                              ResultSink& sink, const std::string& threadIdStr) {
+    BoundedQueue<std::string> chunks(kQueueDepth);
+    std::string error;
+    std::chrono::steady_clock::duration decompressing{};    // recorded by this thread, not a thread per file
+    std::thread producer([&] {
+        const auto started = std::chrono::steady_clock::now();
+        const Emit emit = [&chunks](std::string chunk) { return chunks.push(std::move(chunk)); };
+        switch (compression) {
+#ifdef FILESEARCHER_HAVE_ZLIB
+        case Compression::Gzip: error = inflateGzip(input, emit); break;
+#endif
+#ifdef FILESEARCHER_HAVE_LZMA
+        case Compression::Xz: error = decodeXz(input, emit); break;
+#endif
+#ifdef FILESEARCHER_HAVE_ZSTD
+        case Compression::Zstd: error = decodeZstd(input, emit); break;
+#endif
+        default: break;
+        }
+        chunks.close();
+        decompressing = std::chrono::steady_clock::now() - started;
+    });
+
+    const BinaryPolicy binaryPolicy = text_.binaryPolicy();
+    TextFileSearcher::FileTally tally = text_.startFile();
+    std::optional<TextEncoding> encoding;
+    std::optional<Utf16Decoder> utf16;
+    std::string pending;        // decompressed text whose last line is not complete yet
+    std::vector<SearchResult> results;
+    size_t lineNumber = 1;      // of the first line of pending
+    size_t byteOffset = 0;      // of pending in the decompressed contents
+    size_t searched = 0;        // the lines kept at the front of pending for the context
+    std::string chunk;
+    for (bool more = true; more && !tally.done();) {
+        more = chunks.pop(chunk);
+        if (!encoding) {
+            encoding = detectEncoding(more ? chunk : std::string_view());
+            if (*encoding == TextEncoding::Binary && binaryPolicy == BinaryPolicy::Skip)
+                break;
+            if (*encoding == TextEncoding::Utf16LE || *encoding == TextEncoding::Utf16BE)
+                utf16.emplace(*encoding == TextEncoding::Utf16BE);
+        }
+        if (utf16) {
+            if (more)
+                utf16->decode(chunk, pending);
+            else
+                utf16->finish(pending);
+        } else if (more) {
+            pending += chunk;
+        }
+
+        // rfind() yields npos when no line is complete yet, making `complete` 0.
+        const size_t complete = more ? pending.rfind('\n') + 1 : pending.size();
+        if (complete <= searched)
+            continue;
+        const std::string_view lines(pending.data(), complete);
+        if (*encoding == TextEncoding::Binary && binaryPolicy == BinaryPolicy::Report && tally.collect) {
+            if (containsMatch(lines.substr(searched), pattern)) {
+                SearchResult& result = results.emplace_back();
+                result.path = path;
+                result.binary = true;
+                break;
+            }
+        } else {
+            text_.searchBuffer(path, lines, searched, pattern, lineNumber, byteOffset, tally, results, nullptr,
+                               threadIdStr);
+            if (!results.empty()) {
+                sink.consume(results, threadIdStr);
+                results.clear();
+            }
+        }
+        const size_t kept = text_.historyStart(lines);
+        lineNumber += std::count(lines.begin(), lines.begin() + kept, '\n');
+        byteOffset += kept;
+        pending.erase(0, kept);
+        searched = complete - kept;
+    }
+    chunks.close();
+    producer.join();
+    SearchStats::add(SearchStats::Counter::DecompressNs,
+                     std::chrono::duration_cast<std::chrono::nanoseconds>(decompressing).count());
+
+    text_.finishFile(path, tally, results);
+    if (!results.empty())
+        sink.consume(results, threadIdStr);
+    if (!error.empty()) {
+        std::lock_guard<std::mutex> lock(TextFileSearcher::coutMutex);
+        std::cerr << "Error: Could not decompress file: " << path << " (" << error << ")" << std::endl;
+    }
+}
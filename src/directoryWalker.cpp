@@ -0,0 +1,327 @@
+#include "directoryWalker.hpp"
+#include "searchStats.hpp"
+#include <algorithm>
+#include <thread>
+#include <utility>
+
+#ifdef __linux__
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#else
+#include <fstream>
+#include <iterator>
+#endif
+
+namespace {
+
+#ifdef __linux__
+/// Size of the getdents64 buffer; one call returns a few hundred entries.
+constexpr std::size_t kDirentBufferSize = 64 * 1024;
+
+/// Record layout returned by getdents64 (not exported by glibc headers).
+struct LinuxDirent64 {
+    std::uint64_t d_ino;
+    std::int64_t d_off;
+    unsigned short d_reclen;
+    unsigned char d_type;
+    char d_name[1];
+};
+
+std::error_code lastError() {
+    return {errno, std::generic_category()};
+}
+
+std::string identity(const struct stat& st) {
+    return std::to_string(st.st_dev) + ":" + std::to_string(st.st_ino);
+}
+
+/// Reads a file of the directory open as dirFd; false if it does not exist or cannot be read.
+bool readFileAt(int dirFd, const char* name, std::string& contents) {
+    const int fd = ::openat(dirFd, name, O_RDONLY | O_CLOEXEC | O_NOCTTY);
+    if (fd < 0)
+        return false;
+    contents.clear();
+    char buffer[16 * 1024];
+    bool ok = true;
+    while (true) {
+        const ssize_t bytes = ::read(fd, buffer, sizeof(buffer));
+        if (bytes < 0 && errno == EINTR)
+            continue;
+        if (bytes <= 0) {
+            ok = bytes == 0;
+            break;
+        }
+        contents.append(buffer, static_cast<std::size_t>(bytes));
+    }
+    ::close(fd);
+    return ok;
+}
+#else
+bool readFile(const std::filesystem::path& path, std::string& contents) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open())
+        return false;
+    contents.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    return true;
+}
+#endif
+
+}  // namespace
+
+/**
+ * @brief Constructor.
+ */
+DirectoryWalker::DirectoryWalker(std::size_t numThreads, bool followSymlinks)
+    : numThreads_(std::max<std::size_t>(numThreads, 1)), followSymlinks_(followSymlinks) {}
+
+void DirectoryWalker::setFilter(std::shared_ptr<const PathFilter> filter) {
+    filter_ = filter && filter->active() ? std::move(filter) : nullptr;
+}
+
+/**
+ * @brief Walks the tree below root on the walker threads, blocking until it is done.
+ */
+void DirectoryWalker::walk(const std::filesystem::path& root, const FileCallback& onFile,
+                           const ErrorCallback& onError) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        pending_.clear();
+        visited_.clear();
+        active_ = 0;
+        openCount_ = 0;
+        pending_.push_back({root, -1, {}, nullptr});
+    }
+
+    std::vector<std::thread> threads;
+    for (std::size_t i = 1; i < numThreads_; ++i)
+        threads.emplace_back(&DirectoryWalker::runWorker, this, std::cref(onFile), std::cref(onError));
+    runWorker(onFile, onError);
+    for (auto& thread : threads)
+        thread.join();
+}
+
+/**
+ * @brief Reads pending directories until none are pending and none are being read.
+ */
+void DirectoryWalker::runWorker(const FileCallback& onFile, const ErrorCallback& onError) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+        workAvailable_.wait(lock, [this] { return !pending_.empty() || active_ == 0; });
+        if (pending_.empty())
+            return;
+
+        PendingDirectory directory = std::move(pending_.back());
+        pending_.pop_back();
+        if (directory.fd >= 0)
+            --openCount_;
+        ++active_;
+        lock.unlock();
+
+        if (cancellation_ && cancellation_->cancelled()) {
+            dropDirectory(directory);
+        }
+        else {
+            SearchStats::Timer timer(SearchStats::Counter::WalkNs);
+            SearchStats::add(SearchStats::Counter::DirectoriesRead);
+            readDirectory(std::move(directory), onFile, onError);
+        }
+
+        lock.lock();
+        if (--active_ == 0 && pending_.empty())
+            workAvailable_.notify_all();
+    }
+}
+
+void DirectoryWalker::pushDirectory(PendingDirectory directory) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        pending_.push_back(std::move(directory));
+    }
+    workAvailable_.notify_one();
+}
+
+/**
+ * @brief Releases a pending directory that will not be read.
+ */
+void DirectoryWalker::dropDirectory(PendingDirectory& directory) {
+#ifdef __linux__
+    if (directory.fd >= 0)
+        ::close(directory.fd);
+#endif
+    directory.fd = -1;
+}
+
+/**
+ * @brief Records a directory as entered; false if it had been entered before.
+ */
+bool DirectoryWalker::firstVisit(const std::string& identity) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return visited_.insert(identity).second;
+}
+
+#ifdef __linux__
+
+/**
+ * @brief Lists one directory with getdents64, reporting files and queueing subdirectories.
+ */
+void DirectoryWalker::readDirectory(PendingDirectory directory, const FileCallback& onFile,
+                                    const ErrorCallback& onError) {
+    int fd = directory.fd;
+    if (fd < 0) {
+        fd = ::open(directory.path.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        if (fd < 0) {
+            onError(directory.path, lastError());
+            return;
+        }
+    }
+
+    if (followSymlinks_) {
+        struct stat st;
+        if (::fstat(fd, &st) == 0 && !firstVisit(identity(st))) {
+            ::close(fd);
+            return;
+        }
+    }
+
+    std::shared_ptr<const IgnoreRules> rules;
+    if (filter_) {
+        rules = filter_->enterDirectory(directory.rules, directory.relative,
+                                        [fd](const char* name, std::string& contents) {
+                                            return readFileAt(fd, name, contents);
+                                        });
+    }
+    std::string relative;
+
+    thread_local std::vector<char> buffer(kDirentBufferSize);
+    while (true) {
+        const long bytes = ::syscall(SYS_getdents64, fd, buffer.data(), buffer.size());
+        if (bytes < 0) {
+            onError(directory.path, lastError());
+            break;
+        }
+        if (bytes == 0)
+            break;
+
+        for (long offset = 0; offset < bytes;) {
+            const auto* entry = reinterpret_cast<const LinuxDirent64*>(buffer.data() + offset);
+            offset += entry->d_reclen;
+
+            const char* name = entry->d_name;
+            if (name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0')))
+                continue;
+
+            unsigned char type = entry->d_type;
+            bool viaSymlink = type == DT_LNK;
+            if (type == DT_UNKNOWN || type == DT_LNK) {
+                struct stat st;
+                if (type == DT_UNKNOWN && ::fstatat(fd, name, &st, AT_SYMLINK_NOFOLLOW) == 0 && S_ISLNK(st.st_mode))
+                    viaSymlink = true;
+                // Symlinks are resolved; a dangling one (or an entry that vanished) is skipped.
+                if (::fstatat(fd, name, &st, 0) != 0)
+                    continue;
+                type = S_ISREG(st.st_mode) ? DT_REG : S_ISDIR(st.st_mode) ? DT_DIR : DT_UNKNOWN;
+            }
+
+            if (type != DT_REG && (type != DT_DIR || (viaSymlink && !followSymlinks_)))
+                continue;
+            if (filter_) {
+                relative.assign(directory.relative).append(name);
+                const bool accepted = type == DT_REG ? filter_->acceptsFile(rules.get(), relative)
+                                                     : filter_->acceptsDirectory(rules.get(), relative);
+                if (!accepted)
+                    continue;
+            }
+            if (type == DT_REG) {
+                SearchStats::add(SearchStats::Counter::FilesWalked);
+                onFile(directory.path / name);
+                continue;
+            }
+
+            // Open the subdirectory relative to this one while the descriptor budget allows.
+            PendingDirectory child{directory.path / name, -1, {}, nullptr};
+            if (filter_) {
+                child.relative = relative + '/';
+                child.rules = rules;
+            }
+            bool keepOpen;
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                keepOpen = openCount_ < kMaxOpenDirectories;
+                if (keepOpen)
+                    ++openCount_;
+            }
+            if (keepOpen) {
+                const int flags = O_RDONLY | O_DIRECTORY | O_CLOEXEC | (viaSymlink ? 0 : O_NOFOLLOW);
+                child.fd = ::openat(fd, name, flags);
+                if (child.fd < 0) {
+                    const std::error_code error = lastError();
+                    {
+                        std::lock_guard<std::mutex> lock(mutex_);
+                        --openCount_;
+                    }
+                    onError(child.path, error);
+                    continue;
+                }
+            }
+            pushDirectory(std::move(child));
+        }
+    }
+    ::close(fd);
+}
+
+#else
+
+/**
+ * @brief Lists one directory with std::filesystem, reporting files and queueing subdirectories.
+ */
+void DirectoryWalker::readDirectory(PendingDirectory directory, const FileCallback& onFile,
+                                    const ErrorCallback& onError) {
+    std::error_code ec;
+    if (followSymlinks_) {
+        const auto canonical = std::filesystem::canonical(directory.path, ec);
+        if (!ec && !firstVisit(canonical.string()))
+            return;
+    }
+
+    std::filesystem::directory_iterator it(directory.path, ec);
+    if (ec) {
+        onError(directory.path, ec);
+        return;
+    }
+
+    std::shared_ptr<const IgnoreRules> rules;
+    if (filter_) {
+        rules = filter_->enterDirectory(directory.rules, directory.relative,
+                                        [&directory](const char* name, std::string& contents) {
+                                            return readFile(directory.path / name, contents);
+                                        });
+    }
+    for (const std::filesystem::directory_iterator end; it != end; it.increment(ec)) {
+        if (ec) {
+            onError(directory.path, ec);
+            return;
+        }
+        std::error_code entryError;
+        const std::string relative = filter_ ? directory.relative + it->path().filename().generic_string() : "";
+        if (it->is_regular_file(entryError)) {
+            if (!filter_ || filter_->acceptsFile(rules.get(), relative)) {
+                SearchStats::add(SearchStats::Counter::FilesWalked);
+                onFile(it->path());
+            }
+        }
+        else if (it->is_directory(entryError) && (followSymlinks_ || !it->is_symlink(entryError))) {
+            if (!filter_)
+                pushDirectory({it->path(), -1, {}, nullptr});
+            else if (filter_->acceptsDirectory(rules.get(), relative))
+                pushDirectory({it->path(), -1, relative + '/', rules});
+        }
+    }
+}
+
+#endif
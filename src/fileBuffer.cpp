@@ -0,0 +1,258 @@
+#include "fileBuffer.hpp"
+#include "searchStats.hpp"
+#include <algorithm>
+#include <cstring>
+#include <new>
+#include <utility>
+
+#ifdef _WIN32
+#include <fstream>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+constexpr std::align_val_t kAlignment{FileBuffer::kBlockSize};
+
+std::size_t roundUpToBlock(std::size_t size) {
+    return (size + FileBuffer::kBlockSize - 1) / FileBuffer::kBlockSize * FileBuffer::kBlockSize;
+}
+
+}  // namespace
+
+FileBuffer::~FileBuffer() {
+    close();
+}
+
+FileBuffer::FileBuffer(FileBuffer&& other) noexcept {
+    *this = std::move(other);
+}
+
+FileBuffer& FileBuffer::operator=(FileBuffer&& other) noexcept {
+    if (this != &other) {
+        close();
+        data_ = std::exchange(other.data_, nullptr);
+        size_ = std::exchange(other.size_, 0);
+        source_ = std::exchange(other.source_, Source::None);
+        mapping_ = std::exchange(other.mapping_, nullptr);
+        mappingSize_ = std::exchange(other.mappingSize_, 0);
+        storage_ = std::exchange(other.storage_, nullptr);
+        capacity_ = std::exchange(other.capacity_, 0);
+    }
+    return *this;
+}
+
+void FileBuffer::close() {
+    clear();
+    releaseStorage();
+}
+
+/**
+ * @brief Releases the contents but keeps the block of the read path.
+ */
+void FileBuffer::clear() {
+#ifndef _WIN32
+    if (mapping_) {
+        ::munmap(mapping_, mappingSize_);
+    }
+#endif
+    mapping_ = nullptr;
+    mappingSize_ = 0;
+    data_ = nullptr;
+    size_ = 0;
+    source_ = Source::None;
+}
+
+/**
+ * @brief Makes room to read a file into, keeping the first `keep` bytes of an earlier reserve().
+ */
+char* FileBuffer::reserve(std::size_t capacity, std::size_t keep) {
+    if (source_ == Source::Mapped) {
+        keep = 0;
+    }
+    clear();
+    capacity = roundUpToBlock(std::max<std::size_t>(capacity, 1));
+    if (capacity > capacity_) {
+        char* bigger = static_cast<char*>(::operator new[](capacity, kAlignment));
+        if (keep > 0 && storage_) {
+            std::memcpy(bigger, storage_, std::min(keep, capacity_));
+        }
+        releaseStorage();
+        storage_ = bigger;
+        capacity_ = capacity;
+    }
+    return storage_;
+}
+
+/**
+ * @brief Makes the first `size` bytes of the reserved block the contents.
+ */
+void FileBuffer::commitRead(std::size_t size) {
+    data_ = storage_;
+    size_ = std::min(size, capacity_);
+    source_ = Source::Read;
+}
+
+/**
+ * @brief Makes the block at least `capacity` bytes, discarding its contents.
+ */
+void FileBuffer::allocate(std::size_t capacity) {
+    capacity = roundUpToBlock(capacity);
+    if (capacity <= capacity_) {
+        return;
+    }
+    releaseStorage();
+    storage_ = static_cast<char*>(::operator new[](capacity, kAlignment));
+    capacity_ = capacity;
+}
+
+void FileBuffer::releaseStorage() {
+    if (storage_) {
+        ::operator delete[](storage_, kAlignment);
+    }
+    storage_ = nullptr;
+    capacity_ = 0;
+}
+
+#ifdef _WIN32
+
+/**
+ * @brief Loads the file at the given path, replacing any previous contents.
+ *
+ * Windows build: the file is read in one go into an aligned buffer.
+ */
+bool FileBuffer::open(const std::filesystem::path& filePath) {
+    clear();
+
+    std::ifstream file;
+    std::size_t size = 0;
+    {
+        SearchStats::Timer timer(SearchStats::Counter::OpenNs);
+        file.open(filePath, std::ios::binary | std::ios::ate);
+        if (!file.is_open()) {
+            return false;
+        }
+        size = static_cast<std::size_t>(file.tellg());
+        file.seekg(0);
+    }
+
+    SearchStats::Timer timer(SearchStats::Counter::ReadNs);
+    if (size > 0) {
+        allocate(size);
+        if (!file.read(storage_, static_cast<std::streamsize>(size))) {
+            close();
+            return false;
+        }
+    }
+    data_ = storage_;
+    size_ = size;
+    source_ = Source::Read;
+    SearchStats::add(SearchStats::Counter::BytesRead, size_);
+    return true;
+}
+
+bool FileBuffer::readBlocks(int, std::size_t) {
+    return false;
+}
+
+#else
+
+/**
+ * @brief Loads the file at the given path, replacing any previous contents.
+ *
+ * Files of at least kMapThreshold bytes are mapped read-only with a sequential access hint;
+ * smaller ones are read into an aligned buffer with block-sized read() calls. A file whose
+ * mapping fails falls back to the read path.
+ */
+bool FileBuffer::open(const std::filesystem::path& filePath) {
+    clear();
+
+    int fd = -1;
+    struct stat st {};
+    {
+        SearchStats::Timer timer(SearchStats::Counter::OpenNs);
+        fd = ::open(filePath.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            return false;
+        }
+        if (::fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+            ::close(fd);
+            return false;
+        }
+    }
+
+    SearchStats::Timer timer(SearchStats::Counter::ReadNs);
+    const auto fileSize = static_cast<std::size_t>(st.st_size);
+    bool ok = false;
+
+    if (fileSize >= kMapThreshold) {
+        void* mapping = ::mmap(nullptr, fileSize, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapping != MAP_FAILED) {
+            ::madvise(mapping, fileSize, MADV_SEQUENTIAL);
+            mapping_ = mapping;
+            mappingSize_ = fileSize;
+            data_ = static_cast<const char*>(mapping);
+            size_ = fileSize;
+            source_ = Source::Mapped;
+            ok = true;
+        }
+    }
+
+    if (!ok) {
+        ok = readBlocks(fd, fileSize);
+    }
+
+    ::close(fd);
+    if (ok) {
+        SearchStats::add(SearchStats::Counter::BytesRead, size_);
+    }
+    return ok;
+}
+
+/**
+ * @brief Reads the whole file with block-sized reads until end of file.
+ *
+ * The size reported by fstat is only a hint: the buffer grows if the file turns out to be
+ * longer (e.g. a zero-sized /proc entry) and the final size is whatever was actually read.
+ */
+bool FileBuffer::readBlocks(int fd, std::size_t sizeHint) {
+    allocate(std::max(sizeHint + 1, kBlockSize));
+
+    std::size_t used = 0;
+    while (true) {
+        if (used == capacity_) {
+            const std::size_t grown = capacity_ * 2;
+            char* bigger = static_cast<char*>(::operator new[](grown, kAlignment));
+            std::memcpy(bigger, storage_, used);
+            releaseStorage();
+            storage_ = bigger;
+            capacity_ = grown;
+        }
+
+        const std::size_t want = std::min(kBlockSize, capacity_ - used);
+        const ssize_t got = ::read(fd, storage_ + used, want);
+        if (got < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            close();
+            return false;
+        }
+        if (got == 0) {
+            break;
+        }
+        used += static_cast<std::size_t>(got);
+    }
+
+    data_ = storage_;
+    size_ = used;
+    source_ = Source::Read;
+    return true;
+}
+
+#endif
@@ -0,0 +1,260 @@
+#include "globMatcher.hpp"
+#include <algorithm>
+#include <bit>
+#include <cstring>
+
+const std::string GlobMatcher::kEmpty;
+
+GlobMatcher::GlobMatcher(std::string_view glob) : glob_(glob) {
+    auto addChar = [this](unsigned char c) {
+        states_.push_back({State::Char, c, 0});
+        if (c == '/')
+            containsSlash_ = true;
+    };
+
+    for (std::size_t i = 0; i < glob.size();) {
+        const char c = glob[i];
+        if (c == '\\') {
+            addChar(static_cast<unsigned char>(i + 1 < glob.size() ? glob[i + 1] : '\\'));
+            i += 2;
+        } else if (c == '*') {
+            std::size_t end = i;
+            while (end < glob.size() && glob[end] == '*')
+                ++end;
+            const bool wholeComponent = end - i >= 2 && (i == 0 || glob[i - 1] == '/');
+            if (wholeComponent && end < glob.size() && glob[end] == '/') {
+                states_.push_back({State::DirsStart});
+                states_.push_back({State::DirsInside});
+                containsSlash_ = true;
+                ++end;
+            } else if (wholeComponent && end == glob.size()) {
+                states_.push_back({State::DoubleStar});
+            } else {
+                states_.push_back({State::Star});
+            }
+            i = end;
+        } else if (c == '?') {
+            states_.push_back({State::Any});
+            ++i;
+        } else if (c == '[') {
+            // A class; an unterminated '[' stands for itself.
+            std::bitset<256> members;
+            std::size_t j = i + 1;
+            const bool negated = j < glob.size() && (glob[j] == '!' || glob[j] == '^');
+            if (negated)
+                ++j;
+            bool terminated = false;
+            for (bool first = true; j < glob.size(); first = false) {
+                if (glob[j] == ']' && !first) {
+                    terminated = true;
+                    break;
+                }
+                auto next = [&glob, &j]() {
+                    if (glob[j] == '\\' && j + 1 < glob.size())
+                        ++j;
+                    return static_cast<unsigned char>(glob[j++]);
+                };
+                const unsigned char low = next();
+                unsigned char high = low;
+                if (j + 1 < glob.size() && glob[j] == '-' && glob[j + 1] != ']') {
+                    ++j;
+                    high = next();
+                }
+                for (unsigned member = low; member <= high; ++member)
+                    members.set(member);
+            }
+            if (!terminated) {
+                addChar('[');
+                ++i;
+                continue;
+            }
+            if (negated)
+                members.flip();
+            members.reset('/');
+            states_.push_back({State::Class, 0, static_cast<std::uint16_t>(classes_.size())});
+            classes_.push_back(members);
+            i = j + 1;
+        } else {
+            addChar(static_cast<unsigned char>(c));
+            ++i;
+        }
+    }
+
+    // Recognize the shapes that need no automaton.
+    auto literalFrom = [this](std::size_t first, std::size_t last, bool allowSlash) {
+        std::string text;
+        for (std::size_t i = first; i < last; ++i) {
+            if (states_[i].type != State::Char || (!allowSlash && states_[i].c == '/'))
+                return false;
+            text += static_cast<char>(states_[i].c);
+        }
+        text_ = std::move(text);
+        return true;
+    };
+    const std::size_t n = states_.size();
+    if (literalFrom(0, n, true))
+        kind_ = Kind::Literal;
+    else if (n == 1 && states_[0].type == State::Star)
+        kind_ = Kind::Name;
+    else if (states_[0].type == State::Star && literalFrom(1, n, false))
+        kind_ = Kind::Suffix;
+    else if (states_[n - 1].type == State::Star && literalFrom(0, n - 1, false))
+        kind_ = Kind::Prefix;
+}
+
+bool GlobMatcher::isExtension(std::string_view suffix) {
+    return suffix.size() >= 1 && suffix[0] == '.' && suffix.find_first_of("./", 1) == std::string_view::npos;
+}
+
+bool GlobMatcher::matches(std::string_view path) const {
+    switch (kind_) {
+    case Kind::Literal:
+        return path == text_;
+    case Kind::Suffix:
+        return path.size() >= text_.size() && path.substr(path.size() - text_.size()) == text_ &&
+               std::memchr(path.data(), '/', path.size() - text_.size()) == nullptr;
+    case Kind::Prefix:
+        return path.substr(0, text_.size()) == text_ && path.find('/', text_.size()) == std::string_view::npos;
+    case Kind::Name:
+        return path.find('/') == std::string_view::npos;
+    default:
+        return matchesAutomaton(path);
+    }
+}
+
+/**
+ * @brief Simulates the NFA on the path with one bit per state.
+ *
+ * `*`, `**` and the `**` + `/` group may match nothing, which is an epsilon move to the state
+ * after them; all epsilon moves go forward, so one ascending pass closes a state set.
+ */
+bool GlobMatcher::matchesAutomaton(std::string_view path) const {
+    const std::size_t n = states_.size();
+    const std::size_t words = (n + 1 + 63) / 64;
+    thread_local std::vector<std::uint64_t> current, next;
+    current.assign(words, 0);
+    next.assign(words, 0);
+
+    auto test = [](const std::vector<std::uint64_t>& set, std::size_t i) { return (set[i / 64] >> (i % 64)) & 1; };
+    auto add = [](std::vector<std::uint64_t>& set, std::size_t i) { set[i / 64] |= std::uint64_t(1) << (i % 64); };
+    auto close = [&](std::vector<std::uint64_t>& set) {
+        for (std::size_t i = 0; i < n; ++i) {
+            if (!test(set, i))
+                continue;
+            const State::Type type = states_[i].type;
+            if (type == State::Star || type == State::DoubleStar)
+                add(set, i + 1);
+            else if (type == State::DirsStart)
+                add(set, i + 2);
+        }
+    };
+
+    add(current, 0);
+    close(current);
+    for (const char ch : path) {
+        const auto c = static_cast<unsigned char>(ch);
+        std::fill(next.begin(), next.end(), 0);
+        for (std::size_t word = 0; word < words; ++word) {
+            for (std::uint64_t bits = current[word]; bits != 0; bits &= bits - 1) {
+                const std::size_t i = word * 64 + static_cast<std::size_t>(std::countr_zero(bits));
+                if (i >= n)
+                    continue;
+                const State& state = states_[i];
+                switch (state.type) {
+                case State::Char:
+                    if (c == state.c)
+                        add(next, i + 1);
+                    break;
+                case State::Any:
+                    if (c != '/')
+                        add(next, i + 1);
+                    break;
+                case State::Class:
+                    if (classes_[state.classIndex].test(c))
+                        add(next, i + 1);
+                    break;
+                case State::Star:
+                    if (c != '/')
+                        add(next, i);
+                    break;
+                case State::DoubleStar:
+                    add(next, i);
+                    break;
+                case State::DirsStart:
+                    add(next, c == '/' ? i + 2 : i + 1);
+                    break;
+                case State::DirsInside:
+                    add(next, i);
+                    if (c == '/')
+                        add(next, i + 1);
+                    break;
+                }
+            }
+        }
+        if (std::all_of(next.begin(), next.end(), [](std::uint64_t bits) { return bits == 0; }))
+            return false;
+        close(next);
+        current.swap(next);
+    }
+    return test(current, n);
+}
+
+std::size_t GlobSet::add(std::string_view glob, bool directoryOnly) {
+    return add(glob, directoryOnly, false);
+}
+
+std::size_t GlobSet::addAnchored(std::string_view glob, bool directoryOnly) {
+    return add(glob, directoryOnly, true);
+}
+
+std::size_t GlobSet::add(std::string_view glob, bool directoryOnly, bool anchored) {
+    const std::size_t index = entries_.size();
+    Entry& entry = entries_.emplace_back(Entry{GlobMatcher(glob), directoryOnly, false});
+    entry.wholePath = anchored || entry.glob.containsSlash();
+    if (!entry.wholePath && !entry.glob.literal().empty())
+        names_[entry.glob.literal()].push_back(index);
+    else if (!entry.wholePath && !entry.glob.extension().empty())
+        extensions_[entry.glob.extension()].push_back(index);
+    else
+        others_.push_back(index);
+    return index;
+}
+
+std::size_t GlobSet::lastHashed(const std::unordered_map<std::string, std::vector<std::size_t>>& table,
+                                std::string_view key, bool isDirectory) const {
+    const auto found = table.find(std::string(key));
+    if (found == table.end())
+        return npos;
+    for (auto it = found->second.rbegin(); it != found->second.rend(); ++it) {
+        if (isDirectory || !entries_[*it].directoryOnly)
+            return *it;
+    }
+    return npos;
+}
+
+std::size_t GlobSet::lastMatch(std::string_view path, bool isDirectory) const {
+    const std::size_t slash = path.rfind('/');
+    const std::string_view name = slash == std::string_view::npos ? path : path.substr(slash + 1);
+
+    std::size_t best = npos;
+    auto consider = [&best](std::size_t index) {
+        if (index != npos && (best == npos || index > best))
+            best = index;
+    };
+    if (!names_.empty())
+        consider(lastHashed(names_, name, isDirectory));
+    const std::size_t dot = name.rfind('.');
+    if (!extensions_.empty() && dot != std::string_view::npos)
+        consider(lastHashed(extensions_, name.substr(dot), isDirectory));
+
+    for (auto it = others_.rbegin(); it != others_.rend(); ++it) {
+        if (best != npos && *it < best)
+            break;
+        const Entry& entry = entries_[*it];
+        if (entry.directoryOnly && !isDirectory)
+            continue;
+        if (entry.glob.matches(entry.wholePath ? path : name))
+            return *it;
+    }
+    return best;
+}
@@ -1,5 +1,13 @@
 #include "grepLikeUtility.hpp"
+#include "boundedQueue.hpp"
+#include "directoryWalker.hpp"
+#include "fileBuffer.hpp"
+#include "searchStats.hpp"
 #include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <chrono>
+#include <optional>
 #include <iostream>
 #include <fstream>
 #include <string>
@@ -7,7 +15,8 @@
 #include <thread>
 #include <mutex>
 #include <locale>
-#include <regex>
+#include <semaphore>
+#include <utility>
 
 // ANSI escape codes for coloring text in the terminal
 #define COLOR_YELLOW "\033[33m"
@@ -16,12 +25,81 @@
 // Define a static mutex for safe concurrent console output
 std::mutex TextFileSearcher::coutMutex;
 
+namespace {
+
+/**
+ * @brief ResultSink passing the first `limit` results on to another sink, then cancelling the search.
+ *
+ * Context lines are passed on with the results they surround but not counted.
+ */
+class LimitingResultSink : public ResultSink {
+public:
+    LimitingResultSink(ResultSink& sink, size_t limit, CancellationToken& token)
+        : sink_(sink), limit_(limit), token_(token) {}
+
+    void consume(std::vector<SearchResult>& results, const std::string& threadIdStr) override {
+        const size_t counted = static_cast<size_t>(std::count_if(
+            results.begin(), results.end(), [](const SearchResult& result) { return !result.context; }));
+        const size_t before = delivered_.fetch_add(counted, std::memory_order_relaxed);
+        if (before >= limit_) {
+            results.clear();
+            return;
+        }
+        if (counted >= limit_ - before) {
+            // Keep everything up to the last result within the limit.
+            size_t keep = 0;
+            for (size_t left = limit_ - before; left > 0; ++keep) {
+                if (!results[keep].context)
+                    --left;
+            }
+            results.resize(keep);
+            token_.cancel();
+        }
+        sink_.consume(results, threadIdStr);
+    }
+
+private:
+    ResultSink& sink_;
+    size_t limit_;
+    CancellationToken& token_;
+    std::atomic<size_t> delivered_{0};
+};
+
+/**
+ * @brief Appends a number in decimal, without a temporary string.
+ */
+void appendNumber(size_t number, std::string& output) {
+    char digits[20];
+    const auto end = std::to_chars(digits, digits + sizeof(digits), number).ptr;
+    output.append(digits, end);
+}
+
+/**
+ * @brief Records what a matching loop went through in the search stats.
+ */
+void recordMatching(const CompiledPattern& pattern, size_t bytes, size_t matchedLines, size_t verifiedLines) {
+    SearchStats::add(pattern.isRegex() ? SearchStats::Counter::RegexBytes : SearchStats::Counter::LiteralBytes,
+                     bytes);
+    SearchStats::add(SearchStats::Counter::MatchedLines, matchedLines);
+    SearchStats::add(SearchStats::Counter::RegexLinesVerified, verifiedLines);
+}
+
+/**
+ * @brief The stats counter for the time spent matching a pattern.
+ */
+SearchStats::Counter matchTime(const CompiledPattern& pattern) {
+    return pattern.isRegex() ? SearchStats::Counter::RegexMatchNs : SearchStats::Counter::LiteralMatchNs;
+}
+
+}  // namespace
+
 /**
  * @brief Highlights matching substrings in a given line.
  * 
  * This function adds ANSI color codes around the matched query in a line.
  * It works in both plain string mode and regex mode, and it can be configured
- * to ignore case sensitivity.
+ * to ignore case sensitivity. The compiled pattern comes from the global PatternCache,
+ * so repeated calls with the same query do not recompile it.
  *
  * @param line The line of text to search and highlight.
  * @param query The string or regex pattern to search for.
@@ -30,216 +108,1069 @@ std::mutex TextFileSearcher::coutMutex;
  * @return A new string with matching parts wrapped in color codes.
  */
 std::string highlightMatches(const std::string& line, const std::string& query, bool caseSensitive, bool useRegex) {
+    return highlightMatches(line, *PatternCache::global().get(query, caseSensitive, useRegex));
+}
+
+/**
+ * @brief Highlights matches of an already compiled pattern in a given line.
+ *
+ * @param line The line of text to search and highlight.
+ * @param pattern The compiled query.
+ * @return A new string with matching parts wrapped in color codes.
+ */
+std::string highlightMatches(std::string_view line, const CompiledPattern& pattern) {
+    if (!pattern.valid())
+        return std::string(line) + " [regex error]";
+
+    std::vector<MatchSpan> spans;
+    findMatchSpans(line, pattern, spans);
+    return highlightSpans(line, spans);
+}
+
+/**
+ * @brief Highlights the given match spans in a line.
+ *
+ * @param line The line of text.
+ * @param spans Non-overlapping spans in the line, in order.
+ * @return A new string with the spans wrapped in color codes.
+ */
+std::string highlightSpans(std::string_view line, const std::vector<MatchSpan>& spans) {
     std::string result;
+    appendHighlighted(line, spans, result);
+    return result;
+}
+
+/**
+ * @brief Appends a line with the given match spans wrapped in color codes to output.
+ */
+void appendHighlighted(std::string_view line, const std::vector<MatchSpan>& spans, std::string& output) {
+    size_t pos = 0;
+    for (const MatchSpan& span : spans) {
+        output.append(line, pos, span.position - pos); // unmatched part
+        output += COLOR_YELLOW;
+        output.append(line, span.position, span.length);
+        output += COLOR_RESET;
+        pos = span.position + span.length;
+    }
+
+    output.append(line, pos);  // remaining unmatched
+}
 
-    if (!useRegex) {
-        const std::string& searchBase = caseSensitive ? line : [&] {
-            static thread_local std::string lowered;
-            lowered = line;
-            std::transform(lowered.begin(), lowered.end(), lowered.begin(), ::tolower);
-            return lowered;
-        }();
+/**
+ * @brief Appends the non-empty matches of the pattern in a line, starting at `from`, to spans.
+ */
+void findMatchSpans(std::string_view line, const CompiledPattern& pattern, std::vector<MatchSpan>& spans,
+                    size_t from) {
+    if (pattern.query().empty() && !pattern.isRegex())
+        return;
 
-        std::string loweredQuery = query;
-        if (!caseSensitive) {
-            std::transform(loweredQuery.begin(), loweredQuery.end(), loweredQuery.begin(), ::tolower);
+    size_t searchFrom = from;
+    while (searchFrom <= line.size()) {
+        MatchSpan match = pattern.find(line, searchFrom);
+        if (!match)
+            break;
+
+        if (match.length == 0) {
+            // Empty regex match: nothing to color, keep scanning after this position
+            searchFrom = match.position + 1;
+            continue;
         }
 
-        size_t pos = 0;
-        while (true) {
-            size_t found = searchBase.find(loweredQuery, pos);
-            if (found == std::string::npos) {
-                result += line.substr(pos);  // append remaining unmatched
-                break;
-            }
+        spans.push_back(match);
+        searchFrom = match.position + match.length;
+    }
+}
+
+/**
+ * @brief Whether any line of a buffer matches the pattern, found like TextFileSearcher finds lines.
+ */
+bool containsMatch(std::string_view text, const CompiledPattern& pattern) {
+    if (!pattern.valid())
+        return false;
+
+    size_t pos = 0;
+    while (pos < text.size()) {
+        MatchSpan hit;
+        if (pattern.isRegex())
+            hit.position = pattern.findCandidate(text, pos);
+        else
+            hit = pattern.find(text, pos);
+        if (!hit)
+            return false;
+
+        const size_t lineEnd = std::min(text.find('\n', hit.position), text.size());
+        if (hit.position + hit.length <= lineEnd) {
+            if (!pattern.isRegex())
+                return true;
+            size_t lineStart = hit.position;
+            while (lineStart > pos && text[lineStart - 1] != '\n')
+                --lineStart;
+            if (pattern.matchesLine(text.substr(lineStart, lineEnd - lineStart)))
+                return true;
+        }
+        pos = lineEnd + 1;
+    }
+    return false;
+}
+
+/**
+ * @brief Searches the specified file for the pattern and prints the matched lines.
+ *
+ * @param filePath       The path to the file to search.
+ * @param pattern        The compiled query.
+ * @param highlight      Whether to highlight matches in the output.
+ * @param threadIdStr    Identifier of the calling worker.
+ */
+void FileSearcher::search(const std::filesystem::path& filePath, const CompiledPattern& pattern,
+                          bool highlight, const std::string& threadIdStr)
+{
+    ConsoleFormatter formatter(highlight);
+    search(filePath, pattern, formatter, threadIdStr);
+}
+
+/**
+ * @brief Searches the specified file for the pattern.
+ *
+ * Regular files are loaded into a FileBuffer and searched as a single buffer; anything else
+ * (pipes, character devices) is streamed line by line. Binary files are handled according to
+ * the BinaryPolicy, and UTF-16 files are transcoded. Matched lines are collected with their
+ * match spans and delivered to the sink in batches.
+ *
+ * @param filePath       The path to the file to search.
+ * @param pattern        The compiled query.
+ * @param sink           Receives the results.
+ * @param threadIdStr    Identifier of the calling worker.
+ */
+void TextFileSearcher::search(const std::filesystem::path &filePath, const CompiledPattern &pattern,
+                              ResultSink& sink, const std::string &threadIdStr)
+{
+    if (!pattern.valid())
+        return;
 
-            result += line.substr(pos, found - pos); // unmatched part
-            result += COLOR_YELLOW + line.substr(found, query.length()) + COLOR_RESET;
-            pos = found + query.length();
+    const std::string path = filePath.string();
+    std::vector<SearchResult> results;
+    FileTally tally = startFile();
+    std::error_code ec;
+    if (!std::filesystem::is_regular_file(filePath, ec)) {
+        std::ifstream file(filePath);
+        if (!file.is_open()) {
+            std::lock_guard<std::mutex> lock(coutMutex);
+            std::cerr << "Error: Could not open file: " << filePath << std::endl;
+            return;
+        }
+        searchStream(path, file, pattern, tally, results, sink, threadIdStr);
+    }
+    else {
+        FileBuffer buffer;
+        if (!buffer.open(filePath)) {
+            std::lock_guard<std::mutex> lock(coutMutex);
+            std::cerr << "Error: Could not open file: " << filePath << std::endl;
+            return;
         }
+        searchText(path, buffer.view(), pattern, tally, results, sink, threadIdStr);
+    }
+    finishFile(path, tally, results);
+    if (!results.empty())
+        sink.consume(results, threadIdStr);
+}
 
-    } else {
-        std::regex_constants::syntax_option_type flags = std::regex::ECMAScript;
-        if (!caseSensitive) flags |= std::regex::icase;
+/**
+ * @brief Searches the contents of a file that are already in memory, as search() would.
+ */
+void TextFileSearcher::searchContents(const std::filesystem::path& filePath, std::string_view contents,
+                                      const CompiledPattern& pattern, ResultSink& sink,
+                                      const std::string& threadIdStr)
+{
+    if (!pattern.valid())
+        return;
 
-        try {
-            std::regex pattern(query, flags);
-            std::sregex_iterator it(line.begin(), line.end(), pattern);
-            std::sregex_iterator end;
-            size_t lastPos = 0;
+    const std::string path = filePath.string();
+    std::vector<SearchResult> results;
+    FileTally tally = startFile();
+    searchText(path, contents, pattern, tally, results, sink, threadIdStr);
+    finishFile(path, tally, results);
+    if (!results.empty())
+        sink.consume(results, threadIdStr);
+}
 
-            for (; it != end; ++it) {
-                result += line.substr(lastPos, it->position() - lastPos);           // unmatched part
-                result += COLOR_YELLOW + it->str() + COLOR_RESET;                  // matched part
-                lastPos = it->position() + it->length();
-            }
+/**
+ * @brief A tally for a new file, done when the report mode and the max count say so.
+ */
+TextFileSearcher::FileTally TextFileSearcher::startFile() const
+{
+    FileTally tally;
+    if (reportMode_ == ReportMode::FilesWithMatches)
+        tally.limit = 1;
+    else if (maxCount_ > 0)
+        tally.limit = maxCount_;
+    tally.collect = reportMode_ == ReportMode::Lines;
+    return tally;
+}
 
-            result += line.substr(lastPos);  // remaining unmatched
+/**
+ * @brief Appends the summary result of a file with matches, outside of ReportMode::Lines.
+ */
+void TextFileSearcher::finishFile(const std::string& path, const FileTally& tally,
+                                  std::vector<SearchResult>& results) const
+{
+    if (tally.collect || tally.matched == 0)
+        return;
+    SearchResult& result = results.emplace_back();
+    result.path = path;
+    result.matchCount = tally.matched;
+}
 
-        } catch (const std::regex_error&) {
-            return line + " [regex error]";
+/**
+ * @brief Searches a whole file's contents according to their encoding and the binary policy.
+ */
+void TextFileSearcher::searchText(const std::string& path, std::string_view text, const CompiledPattern& pattern,
+                                  FileTally& tally, std::vector<SearchResult>& results, ResultSink& sink,
+                                  const std::string& threadIdStr)
+{
+    const TextEncoding encoding = detectEncoding(text);
+    if (encoding == TextEncoding::Binary && binaryPolicy_ == BinaryPolicy::Skip)
+        return;
+    if (encoding == TextEncoding::Binary && binaryPolicy_ == BinaryPolicy::Report && tally.collect) {
+        if (containsMatch(text, pattern)) {
+            SearchResult& result = results.emplace_back();
+            result.path = path;
+            result.binary = true;
         }
     }
+    else if (encoding == TextEncoding::Utf16LE || encoding == TextEncoding::Utf16BE) {
+        searchUtf16(path, text, encoding == TextEncoding::Utf16BE, pattern, tally, results, sink, threadIdStr);
+    }
+    else {
+        searchBuffer(path, text, 0, pattern, 1, 0, tally, results, &sink, threadIdStr);
+    }
+}
 
+/**
+ * @brief Searches one newline-aligned byte range of a file that is already in memory.
+ *
+ * @param filePath        The path of the file the range belongs to.
+ * @param range           The bytes of the range.
+ * @param firstLineNumber Line number of the first line of the range.
+ * @param byteOffset      Offset of the range in the file.
+ * @param pattern         The compiled query.
+ * @param results         Receives the matched lines.
+ */
+void TextFileSearcher::searchRange(const std::filesystem::path& filePath, std::string_view range,
+                                   size_t firstLineNumber, size_t byteOffset, const CompiledPattern& pattern,
+                                   std::vector<SearchResult>& results)
+{
+    if (!pattern.valid())
+        return;
+    FileTally unlimited;
+    searchBuffer(filePath.string(), range, 0, pattern, firstLineNumber, byteOffset, unlimited, results, nullptr, "");
+}
+
+/**
+ * @brief Appends a matched or context line to the results and records it as the last one delivered.
+ */
+SearchResult& TextFileSearcher::appendLine(const std::string& path, std::string_view line, size_t lineNumber,
+                                           size_t byteOffset, bool context, FileTally& tally,
+                                           std::vector<SearchResult>& results) const
+{
+    SearchResult& result = results.emplace_back();
+    result.path = path;
+    result.lineNumber = lineNumber;
+    result.byteOffset = byteOffset;
+    result.line = line;
+    result.context = context;
+    result.gapBefore = withContext_ && tally.lastLine != 0 && lineNumber > tally.lastLine + 1;
+    tally.lastLine = lineNumber;
     return result;
 }
 
 /**
- * @brief Searches the specified file for the query.
+ * @brief Where the last contextBefore_ lines of searched text start.
  *
- * Reads the file line by line, searches for matches according to the provided options,
- * and prints matched lines to the console (highlighted if requested).
+ * Sources searched a chunk at a time keep these lines in front of the next chunk, so the
+ * lines before a match at its start can still be delivered.
  *
- * @param filePath       The path to the file to search.
- * @param query          The query string or regex pattern.
- * @param caseSensitive  Whether the search should be case-sensitive.
- * @param highlight      Whether to highlight matches in the output.
- * @param useRegex       Whether to interpret the query as a regex.
+ * @param lines Searched text, starting at a line start and ending after a newline.
  */
-void TextFileSearcher::search(const std::filesystem::path &filePath, const std::string &query,
-                              bool caseSensitive, bool highlight, bool useRegex, const std::string &threadIdStr)
+size_t TextFileSearcher::historyStart(std::string_view lines) const
 {
-    std::ifstream file(filePath);
-    if (!file.is_open()) {
-        std::lock_guard<std::mutex> lock(coutMutex);
-        std::cerr << "Error: Could not open file: " << filePath << std::endl;
-        return;
+    size_t start = lines.size();
+    for (size_t kept = 0; kept < contextBefore_ && start > 0; ++kept) {
+        const size_t newline = start >= 2 ? lines.rfind('\n', start - 2) : std::string_view::npos;
+        start = newline == std::string_view::npos ? 0 : newline + 1;
     }
+    return start;
+}
 
-    std::regex pattern;
-    std::string loweredQuery;
-    bool validRegex = true;
+/**
+ * @brief Searches a whole file buffer without splitting it into lines up front.
+ *
+ * Literal patterns are located directly in the buffer; only around a hit are the enclosing
+ * line boundaries found and the newlines since the previous hit counted. Regex patterns jump
+ * from candidate to candidate (occurrences of the literal every match must contain, or every
+ * line when there is none) and only the candidate lines are run through the regex, in place,
+ * without copying them out of the buffer.
+ *
+ * Matched lines are appended to results; with a sink, every kResultBatchSize of them are
+ * handed over as soon as they are complete, so a file with many matches is not held whole.
+ * Lines that are only counted cost neither a result nor line numbers. The search stops once
+ * the tally is done.
+ *
+ * With context lines, the lines before a matched line are found by scanning back from it
+ * (the text before `start` is kept from the previous chunk for that), and the lines after it
+ * are matched one at a time while the window of the tally is open, which may carry over from
+ * the previous chunk.
+ *
+ * @param text            The text; starts at a line start.
+ * @param start           Offset in the text of the first line to search; the lines before it
+ *                        were searched already.
+ * @param firstLineNumber Line number of the first line of the text.
+ * @param byteOffset      Offset of the text in the file.
+ */
+void TextFileSearcher::searchBuffer(const std::string& path, std::string_view text, size_t start,
+                                    const CompiledPattern& pattern, size_t firstLineNumber, size_t byteOffset,
+                                    FileTally& tally, std::vector<SearchResult>& results, ResultSink* sink,
+                                    const std::string& threadIdStr)
+{
+    SearchStats::Timer timer(matchTime(pattern));
+    const size_t matchedBefore = tally.matched;
+    size_t verified = 0;                 // candidate lines run through the regex
+    auto verify = [&](std::string_view line) {
+        ++verified;
+        return pattern.matchesLine(line);
+    };
+
+    const char* const base = text.data();
+    size_t pos = start;                  // start of the current line
+    size_t lineNumber = firstLineNumber; // line number of the line starting at pos (if collecting)
+    if (tally.collect && start > 0)
+        lineNumber += std::count(base, base + start, '\n');
+
+    auto handOver = [&]() {
+        if (sink && results.size() >= kResultBatchSize) {
+            sink->consume(results, threadIdStr);
+            results.clear();
+        }
+    };
+
+    while (pos < text.size()) {
+        // The lines after a matched line: context, or matched lines that extend the window.
+        while (tally.after > 0 && pos < text.size()) {
+            const size_t lineEnd = std::min(text.find('\n', pos), text.size());
+            const std::string_view line = text.substr(pos, lineEnd - pos);
+            if (!tally.limitReached() && pattern.matchesLine(line)) {
+                ++tally.matched;
+                SearchResult& result = appendLine(path, line, lineNumber, byteOffset + pos, false, tally, results);
+                findMatchSpans(line, pattern, result.spans);
+                tally.after = contextAfter_;
+            } else {
+                appendLine(path, line, lineNumber, byteOffset + pos, true, tally, results);
+                --tally.after;
+            }
+            handOver();
+            pos = lineEnd + 1;
+            ++lineNumber;
+        }
+        if (pos >= text.size() || tally.limitReached())
+            break;
+
+        MatchSpan hit;
+        if (pattern.isRegex())
+            hit.position = pattern.findCandidate(text, pos);
+        else
+            hit = pattern.find(text, pos);
+        if (!hit)
+            break;
 
-    // Preprocess pattern or loweredQuery outside loop
-    if (useRegex) {
-        std::regex_constants::syntax_option_type flags = std::regex::ECMAScript;
-        if (!caseSensitive)
-            flags |= std::regex::icase;
-        try {
-            pattern = std::regex(query, flags);
+        size_t lineEnd = std::min(text.find('\n', hit.position), text.size());
+        if (hit.position + hit.length > lineEnd) {
+            // The hit spans a line break, which line-based matching can never produce:
+            // resume at the next line.
+            if (tally.collect)
+                lineNumber += std::count(base + pos, base + lineEnd, '\n') + 1;
+            pos = lineEnd + 1;
+            continue;
         }
-        catch (...) {
-            validRegex = false;
+
+        size_t lineStart = pos;
+        for (size_t i = hit.position; i > pos; --i) {
+            if (base[i - 1] == '\n') {
+                lineStart = i;
+                break;
+            }
+        }
+        const std::string_view line = text.substr(lineStart, lineEnd - lineStart);
+        if (!tally.collect) {
+            if (!pattern.isRegex() || verify(line))
+                ++tally.matched;
+            pos = lineEnd + 1;
+            continue;
+        }
+        lineNumber += std::count(base + pos, base + lineStart, '\n');
+
+        if (!pattern.isRegex() || verify(line)) {
+            ++tally.matched;
+            if (contextBefore_ > 0) {
+                // Scan back over the lines not delivered yet, then deliver them in order.
+                const size_t wanted = std::min(contextBefore_, lineNumber - 1 - tally.lastLine);
+                size_t first = lineStart;
+                size_t found = 0;
+                for (; found < wanted && first > 0; ++found) {
+                    const size_t newline = first >= 2 ? text.rfind('\n', first - 2) : std::string_view::npos;
+                    first = newline == std::string_view::npos ? 0 : newline + 1;
+                }
+                for (size_t number = lineNumber - found; first < lineStart; ++number) {
+                    const size_t end = text.find('\n', first);
+                    appendLine(path, text.substr(first, end - first), number, byteOffset + first, true, tally,
+                               results);
+                    first = end + 1;
+                }
+            }
+            SearchResult& result = appendLine(path, line, lineNumber, byteOffset + lineStart, false, tally, results);
+            size_t spansFrom = 0;
+            if (!pattern.isRegex() && hit.length > 0) {
+                // The hit that found the line is its first span; only the rest is searched for.
+                result.spans.push_back({hit.position - lineStart, hit.length, hit.pattern});
+                spansFrom = hit.position - lineStart + hit.length;
+            }
+            findMatchSpans(line, pattern, result.spans, spansFrom);
+            tally.after = contextAfter_;
+            handOver();
         }
+        pos = lineEnd + 1;
+        ++lineNumber;
     }
-    else if (!caseSensitive) {
-        loweredQuery = query;
-        std::transform(loweredQuery.begin(), loweredQuery.end(), loweredQuery.begin(), ::tolower);
+    recordMatching(pattern, text.size() - start, tally.matched - matchedBefore, verified);
+}
+
+/**
+ * @brief Transcodes a UTF-16 buffer to UTF-8 chunk by chunk and searches the complete lines of each.
+ *
+ * Only one chunk, the incomplete line at its end and the lines kept for the context are held
+ * in transcoded form at a time.
+ */
+void TextFileSearcher::searchUtf16(const std::string& path, std::string_view text, bool bigEndian,
+                                   const CompiledPattern& pattern, FileTally& tally,
+                                   std::vector<SearchResult>& results, ResultSink& sink,
+                                   const std::string& threadIdStr)
+{
+    Utf16Decoder decoder(bigEndian);
+    std::string decoded;
+    size_t lineNumber = 1;      // of the first line of decoded
+    size_t byteOffset = 0;      // of decoded in the transcoded text
+    size_t searched = 0;        // the lines kept at the front of decoded for the context
+    for (size_t start = 0; start < text.size() && !tally.done(); start += kTranscodeChunkSize) {
+        decoder.decode(text.substr(start, kTranscodeChunkSize), decoded);
+        const bool last = text.size() - start <= kTranscodeChunkSize;
+        if (last)
+            decoder.finish(decoded);
+        // rfind() yields npos when no line is complete yet, making `complete` 0.
+        const size_t complete = last ? decoded.size() : decoded.rfind('\n') + 1;
+        if (complete <= searched)
+            continue;
+        const std::string_view lines(decoded.data(), complete);
+        searchBuffer(path, lines, searched, pattern, lineNumber, byteOffset, tally, results, &sink, threadIdStr);
+        const size_t kept = historyStart(lines);
+        lineNumber += std::count(lines.begin(), lines.begin() + kept, '\n');
+        byteOffset += kept;
+        decoded.erase(0, kept);
+        searched = complete - kept;
     }
+}
 
-    std::string line;
-    int lineNumber = 0;
-    while (std::getline(file, line)) {
+/**
+ * @brief Searches a stream line by line; used for files that cannot be loaded as a buffer.
+ *
+ * Lines are read into a ring of contextBefore_ + 1 line buffers, so the lines before a match
+ * are still at hand without copying every line.
+ */
+void TextFileSearcher::searchStream(const std::string& path, std::istream& input,
+                                    const CompiledPattern& pattern, FileTally& tally,
+                                    std::vector<SearchResult>& results, ResultSink& sink,
+                                    const std::string& threadIdStr)
+{
+    struct Line {
+        std::string text;
+        size_t byteOffset = 0;
+    };
+    SearchStats::Timer timer(matchTime(pattern));
+    const size_t matchedBefore = tally.matched;
+    std::vector<Line> ring(tally.collect ? contextBefore_ + 1 : 1);
+    size_t lineNumber = 0;
+    size_t byteOffset = 0;
+    while (!tally.done()) {
+        Line& current = ring[lineNumber % ring.size()];     // line lineNumber + 1
+        if (!std::getline(input, current.text))
+            break;
         ++lineNumber;
-        bool matched = false;
+        current.byteOffset = byteOffset;
+        byteOffset += current.text.size() + 1;
+
+        if (!tally.limitReached() && pattern.matchesLine(current.text)) {
+            ++tally.matched;
+            if (!tally.collect)
+                continue;
+            const size_t window = std::min(contextBefore_, lineNumber - 1 - tally.lastLine);
+            for (size_t number = lineNumber - window; number < lineNumber; ++number) {
+                const Line& before = ring[(number - 1) % ring.size()];
+                appendLine(path, before.text, number, before.byteOffset, true, tally, results);
+            }
+            SearchResult& result = appendLine(path, current.text, lineNumber, current.byteOffset, false, tally,
+                                              results);
+            findMatchSpans(current.text, pattern, result.spans);
+            tally.after = contextAfter_;
+        } else if (tally.after > 0) {
+            appendLine(path, current.text, lineNumber, current.byteOffset, true, tally, results);
+            --tally.after;
+        } else {
+            continue;
+        }
+        if (results.size() >= kResultBatchSize) {
+            sink.consume(results, threadIdStr);
+            results.clear();
+        }
+    }
+    SearchStats::add(SearchStats::Counter::BytesRead, byteOffset);
+    recordMatching(pattern, byteOffset, tally.matched - matchedBefore, pattern.isRegex() ? lineNumber : 0);
+}
 
-        if (useRegex && validRegex) {
-            matched = std::regex_search(line, pattern);
+/**
+ * @brief Appends `[pattern: a, b] ` naming the distinct patterns matched in a result.
+ */
+void ConsoleFormatter::appendPatternNames(const SearchResult& result, std::string& output) const
+{
+    std::vector<size_t> matched;
+    for (const MatchSpan& span : result.spans) {
+        if (std::find(matched.begin(), matched.end(), span.pattern) == matched.end())
+            matched.push_back(span.pattern);
+    }
+
+    output += "[pattern: ";
+    for (size_t i = 0; i < matched.size(); ++i) {
+        if (i > 0)
+            output += ", ";
+        if (matched[i] < patternNames_->size())
+            output += (*patternNames_)[matched[i]];
+    }
+    output += "] ";
+}
+
+/**
+ * @brief Formats a batch of results into one string and writes it.
+ */
+void ConsoleFormatter::consume(std::vector<SearchResult>& results, const std::string& threadIdStr)
+{
+    if (results.empty())
+        return;
+
+    SearchStats::Timer timer(SearchStats::Counter::OutputNs);
+    std::string output;
+    for (const SearchResult& result : results) {
+        if (result.binary) {
+            output += "Binary file ";
+            output += result.path;
+            output += " matches\n";
+            continue;
         }
-        else if (!useRegex && !caseSensitive) {
-            std::string loweredLine = line;
-            std::transform(loweredLine.begin(), loweredLine.end(), loweredLine.begin(), ::tolower);
-            matched = loweredLine.find(loweredQuery) != std::string::npos;
+        if (result.matchCount > 0) {
+            output += result.path;
+            if (reportMode_ == ReportMode::Count) {
+                output += ':';
+                appendNumber(result.matchCount, output);
+            }
+            output += '\n';
+            continue;
         }
-        else if (!useRegex) {
-            matched = line.find(query) != std::string::npos;
+        if (result.gapBefore)
+            output += "--\n";
+        const char separator = result.context ? '-' : ':';
+        output += result.path;
+        output += separator;
+        appendNumber(result.lineNumber, output);
+        output += separator;
+        output += ' ';
+        if (!threadIdStr.empty()) {     // ordered output has no worker label
+            output += "[Thread ";
+            output += threadIdStr;
+            output += "] ";
         }
+        if (patternNames_ && !result.context)
+            appendPatternNames(result, output);
+        if (highlight_)
+            appendHighlighted(result.line, result.spans, output);
+        else
+            output += result.line;
+        output += '\n';
+    }
 
-        if (matched) {
-            std::lock_guard<std::mutex> lock(coutMutex);
-            std::cout << filePath.string() << ":" << lineNumber << ": [Thread " << threadIdStr << "] ";
-            if (highlight)
-                std::cout << highlightMatches(line, query, caseSensitive, useRegex) << std::endl;
-            else
-                std::cout << line << std::endl;
+    if (writer_) {
+        writer_->write(results.front().path, std::move(output));
+    }
+    else {
+        std::unique_lock<std::mutex> lock(TextFileSearcher::coutMutex, std::defer_lock);
+        {
+            SearchStats::Timer waiting(SearchStats::Counter::OutputWaitNs);
+            lock.lock();
         }
+        SearchStats::Timer writing(SearchStats::Counter::WriteNs);
+        std::cout << output << std::flush;
     }
 }
 
 /**
  * @brief Constructs the SearchManager.
  *
+ * The query is compiled once here (or taken from the global PatternCache) and then shared
+ * read-only by every worker thread.
+ *
  * @param searcher       A unique pointer to a FileSearcher implementation.
  * @param query          The search term or pattern.
  * @param caseSensitive  Whether the search should be case-sensitive.
  * @param highlight      Whether to highlight the matches.
  * @param useRegex       Whether the query is a regex pattern.
+ * @param engine         Backend for regex queries.
  */
 SearchManager::SearchManager(std::unique_ptr<FileSearcher> searcher,
                              const std::string& query,
                              bool caseSensitive,
                              bool highlight,
-                             bool useRegex)
-    : searcher_(std::move(searcher)), query_(query),
-      caseSensitive_(caseSensitive), highlight_(highlight), useRegex_(useRegex) {}
+                             bool useRegex,
+                             RegexEngine engine)
+    : SearchManager(std::move(searcher), PatternCache::global().get(query, caseSensitive, useRegex, engine),
+                    highlight) {}
+
+/**
+ * @brief Constructs the SearchManager from an already compiled pattern.
+ *
+ * @param searcher       A unique pointer to a FileSearcher implementation.
+ * @param pattern        The compiled query.
+ * @param highlight      Whether to highlight the matches.
+ */
+SearchManager::SearchManager(std::unique_ptr<FileSearcher> searcher,
+                             std::shared_ptr<const CompiledPattern> pattern,
+                             bool highlight)
+    : searcher_(std::move(searcher)), pattern_(std::move(pattern)), highlight_(highlight) {}
+
+/**
+ * @brief Sets the number of worker threads; 0 selects std::thread::hardware_concurrency().
+ */
+void SearchManager::setNumThreads(size_t numThreads) {
+    numThreads_ = numThreads > 0 ? numThreads : std::thread::hardware_concurrency();
+}
+
+/**
+ * @brief Sets the size of the byte ranges large files are split into.
+ */
+void SearchManager::setRangeSize(size_t rangeSize) {
+    rangeSize_ = std::max<size_t>(rangeSize, 1);
+}
+
+/**
+ * @brief Delivers every result of subsequent searches to the callback.
+ */
+void SearchManager::setResultCallback(CallbackResultSink::Callback callback) {
+    setResultSink(std::make_shared<CallbackResultSink>(std::move(callback)));
+}
+
+/**
+ * @brief What a worker keeps from file to file: the block it reads files into, and its label.
+ *
+ * Aligned to a cache line, so workers never share one.
+ */
+struct alignas(64) SearchManager::WorkerArena {
+    FileBuffer buffer;
+    std::string label;      ///< The worker in the output.
+};
 
 /**
  * @brief Performs recursive search across all files in the directory.
  *
- * Scans the directory recursively for regular files, then uses multiple threads to search
- * through those files in parallel. Each thread receives an even slice of files.
+ * Walks the directory tree in parallel and searches the regular files as they are found,
+ * on a pool of worker threads that steal work from each other. Unreadable directories are
+ * reported and skipped. Results go to the result sink if one is set. Otherwise they are
+ * printed through one OutputWriter for the whole search, which is finished before the
+ * per-worker utilization report is printed (to std::cerr with ordered output, so that stdout
+ * holds nothing but the reproducible matches).
  *
  * @param dirPath The path to the root directory for searching.
  */
 void SearchManager::searchInDirectory(const std::filesystem::path& dirPath) {
-    if (!std::filesystem::is_directory(dirPath)) {
+    const bool singleFile = std::filesystem::is_regular_file(dirPath);
+    if (!singleFile && !std::filesystem::is_directory(dirPath)) {
         std::cerr << "Error: Invalid directory - " << dirPath << std::endl;
         return;
     }
 
-    // Recursively gather all regular files in the directory 
-    std::vector<std::filesystem::path> files;
-    for (const auto& entry : std::filesystem::recursive_directory_iterator(dirPath)) {
-        if (entry.is_regular_file()) {
-            files.emplace_back(entry.path());
-        }
+    if (!pattern_->valid()) {
+        std::cerr << "Error: Invalid regex - " << pattern_->error() << std::endl;
+        return;
     }
 
-    size_t threadCount = std::min(numThreads_, files.size());
-    size_t filesPerThread = files.size() / threadCount;
-    size_t remainingFiles = files.size() % threadCount;
+    if (stats_)
+        stats_->start();
+    // A quarter of the memory limit for the queued output, the rest for the files in flight.
+    size_t outputLimit = OutputWriter::kMaxQueuedBytes;
+    if (memoryLimit_ > 0)
+        outputLimit = std::clamp<size_t>(memoryLimit_ / 4, 1, OutputWriter::kMaxQueuedBytes);
+    BufferPool buffers(memoryLimit_ > 0 ? std::max<size_t>(memoryLimit_ - outputLimit, 1) : 0);
+    OutputWriter writer(stdout, orderedOutput_, outputLimit);
+    ConsoleFormatter formatter(highlight_, &writer, pattern_->isPatternList() ? &pattern_->patterns() : nullptr);
+    formatter.setReportMode(searcher_->reportMode());
+    sink_ = resultSink_ ? resultSink_.get() : &formatter;
+    const bool printReport = !resultSink_;
 
-    std::vector<std::thread> threads;
-    auto beginIt = files.begin();
-
-    for (size_t i = 0; i < threadCount; ++i) {
-        // Calculate start and end iterators for each thread
-        auto endIt = beginIt + filesPerThread + (i < remainingFiles ? 1 : 0);
+    CancellationToken cancellation;
+    std::optional<LimitingResultSink> limiter;
+    if (resultLimit_ > 0) {
+        limiter.emplace(*sink_, resultLimit_, cancellation);
+        sink_ = &*limiter;
+    }
+    cancellation_ = &cancellation;
 
-        threads.emplace_back([this, beginItCopy = beginIt, endItCopy = endIt]() {
-            std::thread::id thisId = std::this_thread::get_id();
-            int threadNumber;
+    const size_t threadCount = std::max<size_t>(numThreads_, 1);
+    std::vector<WorkerArena> arenas(threadCount);
+    for (size_t i = 0; i < threadCount; ++i)
+        arenas[i].label = orderedOutput_ ? std::string() : std::to_string(i + 1);
+    buffers_ = &buffers;
+    arenas_ = arenas.data();
 
-            {
-                std::lock_guard<std::mutex> lock(threadIdMutex_);
-                auto [it, inserted] = threadIdMap_.try_emplace(thisId, nextThreadId_++);
-                threadNumber = it->second;
-            }
+    WorkStealingPool pool(threadCount);
+    if (singleFile) {
+        pool.submit([this, &pool, &dirPath](size_t workerIndex) { searchFile(pool, dirPath, workerIndex); });
+        pool.wait();
+        writer.finish();
+        if (stats_)
+            stats_->stop();
+        sink_ = nullptr;
+        cancellation_ = nullptr;
+        buffers_ = nullptr;
+        arenas_ = nullptr;
+        if (printReport)
+            printUtilization(pool, orderedOutput_ ? std::cerr : std::cout);
+        return;
+    }
 
-            // {
-            //     std::lock_guard<std::mutex> lock(TextFileSearcher::coutMutex);
-            //     std::cout << "Thread " << threadNumber << " assigned files: ";
-            //     for (auto it = beginItCopy; it != endItCopy; ++it)
-            //         std::cout << "  " << it->string() << "\n";
-            // }
+    // Files the index rules out are dropped as they are found, unless they changed since.
+    std::optional<std::vector<bool>> candidates;
+    if (index_) {
+        std::error_code ec;
+        if (std::filesystem::canonical(dirPath, ec) == index_->root())
+            candidates = index_->candidates(*pattern_);
+        else
+            std::cerr << "Warning: The index was built for " << index_->root() << "; searching without it" << std::endl;
+    }
+    std::atomic<size_t> skipped{0};
+    auto mustSearch = [this, &dirPath, &candidates, &skipped](const std::filesystem::path& file) {
+        if (!candidates)
+            return true;
+        const size_t fileId = index_->findFile(file.lexically_relative(dirPath).generic_string());
+        if (fileId == std::string_view::npos || (*candidates)[fileId] || !index_->isFresh(fileId, file))
+            return true;
+        skipped.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    };
 
-            {
+    // Walk the tree in the background; files stream to the workers as directories are read.
+    BoundedQueue<std::filesystem::path> files(kWalkQueueCapacity);
+    std::thread walkerThread([this, &dirPath, &files, &mustSearch, &cancellation, threadCount]() {
+        DirectoryWalker walker(threadCount, followSymlinks_);
+        walker.setFilter(pathFilter_);
+        walker.setCancellationToken(&cancellation);
+        walker.walk(
+            dirPath,
+            [&files, &mustSearch](std::filesystem::path file) {
+                if (mustSearch(file))
+                    files.push(std::move(file));
+            },
+            [](const std::filesystem::path& path, std::error_code ec) {
                 std::lock_guard<std::mutex> lock(TextFileSearcher::coutMutex);
-                std::cout << "Thread " << threadNumber << " assigned " 
-                          << std::distance(beginItCopy, endItCopy) << " file(s)\n";
-            }
+                std::cerr << "Error: Could not read directory: " << path << " (" << ec.message() << ")"
+                          << std::endl;
+            });
+        files.close();
+    });
+
+    // Bound the file tasks waiting in the pool, so the walker is throttled by the queue.
+    std::counting_semaphore<> slots(static_cast<std::ptrdiff_t>(threadCount * kFilesInFlightPerThread));
+    struct SlotRelease {
+        std::counting_semaphore<>& slots;
+        ~SlotRelease() { slots.release(); }
+    };
+    std::optional<AsyncFileReader> reader;
+    if (ioBackend_ == IoBackend::Uring && AsyncFileReader::uringAvailable()) {
+        // Files that would be split are left to the workers, which map them.
+        reader.emplace(AsyncFileReader::kDefaultDepth, std::min(FileBuffer::kMapThreshold, 2 * rangeSize_), true,
+                       &buffers);
+    }
 
-            for (auto it = beginItCopy; it != endItCopy; ++it) {
-                searcher_->search(*it, query_, caseSensitive_, highlight_, useRegex_, std::to_string(threadNumber));
+    std::filesystem::path file;
+    if (!reader) {
+        while (files.pop(file)) {
+            if (cancellation.cancelled()) {
+                files.close();      // the walker stops too; what it still pushes is dropped
+                break;
             }
-        });
+            buffers.waitForRoom();
+            slots.acquire();
+            pool.submit([this, &pool, &slots, file = std::move(file)](size_t workerIndex) {
+                SlotRelease release{slots};
+                searchFile(pool, file, workerIndex);
+            });
+        }
+    }
+    else {
+        // Keep the reader full, waiting for the walker (or for memory) only while no file is
+        // being read; over the memory limit, only the reads started already are taken.
+        using PopResult = BoundedQueue<std::filesystem::path>::PopResult;
+        bool walking = true;
+        while (walking || reader->pending() > 0) {
+            if (cancellation.cancelled()) {
+                files.close();
+                break;
+            }
+            if (walking && !reader->full() && (reader->pending() == 0 || buffers.hasRoom())) {
+                PopResult popped = PopResult::Popped;
+                if (reader->pending() > 0) {
+                    popped = files.tryPop(file);
+                } else {
+                    buffers.waitForRoom();
+                    if (!files.pop(file))
+                        popped = PopResult::Closed;
+                }
+                if (popped == PopResult::Popped) {
+                    reader->add(std::move(file));
+                    continue;
+                }
+                walking = popped == PopResult::Empty;
+            }
+            auto read = std::make_shared<AsyncFileReader::File>();
+            if (!reader->take(*read, true))
+                continue;
+            slots.acquire();
+            pool.submit([this, &pool, &slots, read](size_t workerIndex) {
+                SlotRelease release{slots};
+                searchReadFile(pool, *read, workerIndex);
+            });
+        }
+    }
+    reader.reset();     // hands the buffers of files it still holds back to the pool
+    walkerThread.join();
+    pool.wait();
+    writer.finish();
+    if (stats_)
+        stats_->stop();
+    sink_ = nullptr;
+    cancellation_ = nullptr;
+    buffers_ = nullptr;
+    arenas_ = nullptr;
+    if (printReport) {
+        std::ostream& report = orderedOutput_ ? std::cerr : std::cout;
+        if (candidates)
+            report << "Index: skipped " << skipped.load() << " of " << index_->fileCount() << " indexed files\n";
+        printUtilization(pool, report);
+    }
+}
+
+/**
+ * @brief Label of a worker in the output; empty with ordered output, which must not depend on scheduling.
+ */
+const std::string& SearchManager::threadLabel(size_t workerIndex) const {
+    return arenas_[workerIndex].label;
+}
+
+/**
+ * @brief Prints how many tasks each worker ran and how busy it was.
+ */
+void SearchManager::printUtilization(const WorkStealingPool& pool, std::ostream& out) {
+    const auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(pool.elapsed());
+    const auto stats = pool.stats();
+    std::lock_guard<std::mutex> lock(TextFileSearcher::coutMutex);
+    for (size_t i = 0; i < stats.size(); ++i) {
+        const auto busy = std::chrono::duration_cast<std::chrono::milliseconds>(stats[i].busy);
+        const long long utilization = elapsed.count() > 0 ? busy.count() * 100 / elapsed.count() : 100;
+        out << "Thread " << i + 1 << ": " << stats[i].tasks << " task(s), " << stats[i].stolen
+                  << " stolen, busy " << busy.count() << " ms of " << elapsed.count() << " ms ("
+                  << utilization << "%)\n";
+    }
+}
+
+/**
+ * @brief A large file being searched as ranges, shared by its range tasks.
+ *
+ * Each range is processed in two steps: a count task counts its newlines, and once every
+ * range is counted the line numbers are prefix-summed and the search tasks are submitted.
+ * Search results are buffered per range and handed to the sink in range order as soon as all
+ * earlier ranges are done. Every search task takes the next range in file order, whichever
+ * worker runs it (workers pop their own tasks newest first), so results only wait for the
+ * earlier ranges being searched at the same time, never for the whole file.
+ */
+struct SearchManager::SplitFile {
+    explicit SplitFile(BufferPool& buffers) : buffers(buffers) {}
+    ~SplitFile() { buffers.release(charged); }
+
+    BufferPool& buffers;
+    size_t charged = 0;                       ///< Bytes of the buffer charged to the pool.
+    std::filesystem::path path;
+    FileBuffer buffer;
+    std::vector<std::string_view> ranges;
+    std::vector<size_t> firstLineNumbers;     ///< Newline counts until the prefix sum.
+    std::vector<std::vector<SearchResult>> results;
+    std::vector<size_t> workers;              ///< Worker that searched each range.
+    std::vector<char> searched;
+    std::atomic<size_t> uncounted{0};
+    std::atomic<size_t> nextToSearch{0};
+    std::mutex emitMutex;
+    size_t nextToEmit = 0;
+};
+
+/**
+ * @brief Searches one file, or splits it into newline-aligned byte ranges if it is large.
+ *
+ * Splitting only looks for the newline after every range boundary; counting and searching
+ * the ranges happens in pool tasks that idle workers steal. The file buffer is released when
+ * the last task of the file finishes.
+ *
+ * @param pool        The pool running the search, for the range tasks.
+ * @param filePath    The file to search.
+ * @param workerIndex Index of the calling worker.
+ */
+void SearchManager::searchFile(WorkStealingPool& pool, const std::filesystem::path& filePath,
+                               size_t workerIndex) {
+    if (cancellation_->cancelled())
+        return;
+    SearchStats::add(SearchStats::Counter::FilesSearched);
+    std::error_code ec;
+    uintmax_t fileSize = 0;
+    {
+        SearchStats::Timer timer(SearchStats::Counter::OpenNs);
+        fileSize = std::filesystem::file_size(filePath, ec);
+    }
+    if (ec) {
+        searcher_->search(filePath, *pattern_, *sink_, threadLabel(workerIndex));  // streams it, or reports the error
+        return;
+    }
+    if (fileSize / 2 < rangeSize_ || !searcher_->supportsRanges()) {
+        searchWholeFile(filePath, workerIndex);
+        return;
+    }
 
-        beginIt = endIt; // Advance to next chunk
+    auto split = std::make_shared<SplitFile>(*buffers_);
+    split->path = filePath;
+    if (!split->buffer.open(filePath)) {
+        searcher_->search(filePath, *pattern_, *sink_, threadLabel(workerIndex));  // reports the error
+        return;
     }
+    buffers_->account(split->buffer, split->charged);
+
+    const std::string_view text = split->buffer.view();
+    if (searcher_->requiresWholeFile(text)) {
+        // E.g. binary and UTF-16 files, which the searcher handles as a whole: from the
+        // buffer already open, rather than reading the file again.
+        searcher_->searchContents(filePath, text, *pattern_, *sink_, threadLabel(workerIndex));
+        return;
+    }
+    for (size_t start = 0; start < text.size();) {
+        size_t end = text.size();
+        if (text.size() - start > rangeSize_) {
+            const size_t newline = text.find('\n', start + rangeSize_ - 1);
+            if (newline != std::string_view::npos)
+                end = newline + 1;
+        }
+        split->ranges.push_back(text.substr(start, end - start));
+        start = end;
+    }
+
+    const size_t count = split->ranges.size();
+    split->firstLineNumbers.resize(count);
+    split->results.resize(count);
+    split->workers.resize(count);
+    split->searched.assign(count, 0);
+    split->uncounted = count;
+    for (size_t i = 0; i < count; ++i) {
+        pool.submit([this, &pool, split, i](size_t) { countRange(pool, split, i); });
+    }
+}
 
-    // Wait for all threads to complete execution
-    for (auto& thread : threads) {
-        thread.join();
+/**
+ * @brief Searches a file in the worker's arena: its block is reused for every file the worker reads.
+ *
+ * The buffer is charged to the pool while the file is searched. Mapped files are unmapped
+ * afterwards, and a block grown beyond what the pool keeps is released.
+ */
+void SearchManager::searchWholeFile(const std::filesystem::path& filePath, size_t workerIndex) {
+    WorkerArena& arena = arenas_[workerIndex];
+    if (!arena.buffer.open(filePath)) {
+        searcher_->search(filePath, *pattern_, *sink_, arena.label);    // reports the error
+        return;
     }
+    size_t charged = 0;
+    buffers_->account(arena.buffer, charged);
+    searcher_->searchContents(filePath, arena.buffer.view(), *pattern_, *sink_, arena.label);
+    if (arena.buffer.capacity() > BufferPool::kMaxPooledCapacity)
+        arena.buffer.close();
+    else
+        arena.buffer.clear();
+    buffers_->release(charged);
 }
 
+/**
+ * @brief Searches a file the AsyncFileReader read; the files it did not read are searched as usual.
+ *
+ * The buffer goes back to the pool either way.
+ */
+void SearchManager::searchReadFile(WorkStealingPool& pool, AsyncFileReader::File& file, size_t workerIndex) {
+    if (file.loaded && !cancellation_->cancelled()) {
+        SearchStats::add(SearchStats::Counter::FilesSearched);
+        searcher_->searchContents(file.path, file.buffer.view(), *pattern_, *sink_, threadLabel(workerIndex));
+    }
+    buffers_->recycle(std::move(file.buffer), std::exchange(file.charged, 0));
+    if (!file.loaded)
+        searchFile(pool, file.path, workerIndex);     // streams, maps or splits it, or reports the error
+}
+
+/**
+ * @brief Counts the newlines of one range; the last range counted starts the search pass.
+ */
+void SearchManager::countRange(WorkStealingPool& pool, const std::shared_ptr<SplitFile>& split, size_t index) {
+    const std::string_view range = split->ranges[index];
+    {
+        SearchStats::Timer timer(SearchStats::Counter::LineCountNs);
+        split->firstLineNumbers[index] = std::count(range.begin(), range.end(), '\n');
+    }
+    if (split->uncounted.fetch_sub(1, std::memory_order_acq_rel) != 1)
+        return;
+
+    size_t lineNumber = 1;
+    for (size_t& first : split->firstLineNumbers) {
+        const size_t newlines = first;
+        first = lineNumber;
+        lineNumber += newlines;
+    }
+    for (size_t i = 0; i < split->ranges.size(); ++i) {
+        pool.submit([this, split](size_t workerIndex) {
+            searchSplitRange(split, split->nextToSearch.fetch_add(1, std::memory_order_relaxed), workerIndex);
+        });
+    }
+}
+
+/**
+ * @brief Searches one range into its buffer, then delivers every finished range in file order.
+ */
+void SearchManager::searchSplitRange(const std::shared_ptr<SplitFile>& split, size_t index, size_t workerIndex) {
+    const std::string_view range = split->ranges[index];
+    const size_t byteOffset = static_cast<size_t>(range.data() - split->ranges.front().data());
+    if (!cancellation_->cancelled()) {
+        searcher_->searchRange(split->path, range, split->firstLineNumbers[index], byteOffset, *pattern_,
+                               split->results[index]);
+    }
+    split->workers[index] = workerIndex;
+
+    std::lock_guard<std::mutex> lock(split->emitMutex);
+    split->searched[index] = 1;
+    while (split->nextToEmit < split->ranges.size() && split->searched[split->nextToEmit]) {
+        const size_t next = split->nextToEmit++;
+        std::vector<SearchResult>& results = split->results[next];
+        if (!results.empty())
+            sink_->consume(results, threadLabel(split->workers[next]));
+        std::vector<SearchResult>().swap(results);
+    }
+}
@@ -0,0 +1,249 @@
+#include "literalMatcher.hpp"
+#include "byteFrequency.hpp"
+#include <cstdint>
+#include <cstring>
+#include <tuple>
+#include <utility>
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define LITERALMATCHER_X86 1
+#include <immintrin.h>
+#endif
+
+namespace {
+
+/**
+ * @brief Rank below which a byte is rare enough for libc memchr alone to be the best prefilter.
+ *
+ * memchr skips runs without the byte faster than the two-probe vector loop, but degrades when
+ * the byte is common; the pair filter is only worth it for needles made of common bytes.
+ */
+constexpr std::uint8_t kMemchrRankThreshold = 70;
+
+/// Offsets of the two rarest bytes of the needle; both are 0 for needles shorter than 2.
+std::pair<std::size_t, std::size_t> selectRareOffsets(std::string_view needle) {
+    std::size_t first = 0;
+    std::size_t second = 0;
+    if (needle.size() < 2) {
+        return {first, second};
+    }
+
+    auto rank = [&](std::size_t i) { return byteRank(static_cast<unsigned char>(needle[i])); };
+    second = 1;
+    if (rank(second) < rank(first)) {
+        std::swap(first, second);
+    }
+    for (std::size_t i = 2; i < needle.size(); ++i) {
+        if (rank(i) < rank(first)) {
+            second = first;
+            first = i;
+        } else if (rank(i) < rank(second)) {
+            second = i;
+        }
+    }
+    return {first, second};
+}
+
+/// Candidate verification; kept inline so the vector loops make no calls.
+inline bool bytesEqual(const char* a, const char* b, std::size_t n) {
+    for (std::size_t i = 0; i < n; ++i) {
+        if (a[i] != b[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+}  // namespace
+
+/**
+ * @brief Builds a matcher for the given needle using the best kernel for this CPU.
+ */
+LiteralMatcher::LiteralMatcher(std::string needle)
+    : LiteralMatcher(std::move(needle), bestKernel()) {}
+
+/**
+ * @brief Builds a matcher with an explicit kernel, downgraded to what the CPU supports.
+ */
+LiteralMatcher::LiteralMatcher(std::string needle, Kernel kernel)
+    : needle_(std::move(needle)), kernel_(kernel) {
+    if (static_cast<int>(kernel_) > static_cast<int>(bestKernel())) {
+        kernel_ = bestKernel();
+    }
+    std::tie(rareOffset1_, rareOffset2_) = selectRareOffsets(needle_);
+}
+
+LiteralMatcher::Kernel LiteralMatcher::bestKernel() {
+#ifdef LITERALMATCHER_X86
+    static const Kernel best = [] {
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2"))
+            return Kernel::Avx2;
+        if (__builtin_cpu_supports("sse2"))
+            return Kernel::Sse2;
+        return Kernel::Scalar;
+    }();
+    return best;
+#else
+    return Kernel::Scalar;
+#endif
+}
+
+/**
+ * @brief Finds the first occurrence of the needle at or after the given offset.
+ */
+std::size_t LiteralMatcher::find(std::string_view haystack, std::size_t from) const {
+    if (from > haystack.size() || haystack.size() - from < needle_.size()) {
+        return std::string_view::npos;
+    }
+    if (needle_.empty()) {
+        return from;
+    }
+    if (needle_.size() == 1) {
+        // libc memchr is already vectorised.
+        const void* hit = std::memchr(haystack.data() + from, needle_[0], haystack.size() - from);
+        return hit ? static_cast<std::size_t>(static_cast<const char*>(hit) - haystack.data())
+                   : std::string_view::npos;
+    }
+
+    if (byteRank(static_cast<unsigned char>(needle_[rareOffset1_])) < kMemchrRankThreshold) {
+        return findScalar(haystack, from);
+    }
+
+    switch (kernel_) {
+    case Kernel::Avx2:
+        return findAvx2(haystack, from);
+    case Kernel::Sse2:
+        return findSse2(haystack, from);
+    case Kernel::Scalar:
+        break;
+    }
+    return findScalar(haystack, from);
+}
+
+/**
+ * @brief Scalar kernel: memchr for the rarest byte, then verify the candidate.
+ */
+std::size_t LiteralMatcher::findScalar(std::string_view haystack, std::size_t from) const {
+    const char* const base = haystack.data();
+    const std::size_t n = needle_.size();
+    const std::size_t last = haystack.size() - n;   // last valid match start
+    const char rare = needle_[rareOffset1_];
+
+    std::size_t pos = from;
+    while (pos <= last) {
+        const void* hit = std::memchr(base + pos + rareOffset1_, rare, last - pos + 1);
+        if (!hit) {
+            break;
+        }
+        const std::size_t candidate = static_cast<std::size_t>(static_cast<const char*>(hit) - base) - rareOffset1_;
+        if (base[candidate + rareOffset2_] == needle_[rareOffset2_] &&
+            std::memcmp(base + candidate, needle_.data(), n) == 0) {
+            return candidate;
+        }
+        pos = candidate + 1;
+    }
+    return std::string_view::npos;
+}
+
+#ifdef LITERALMATCHER_X86
+
+namespace {
+
+/// Lanes where both rare bytes sit at their needle offsets (probes are pre-shifted by them).
+__attribute__((target("avx2"), always_inline))
+inline __m256i avx2Candidates(const char* probe1, const char* probe2, __m256i rare1, __m256i rare2) {
+    const __m256i block1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(probe1));
+    const __m256i block2 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(probe2));
+    return _mm256_and_si256(_mm256_cmpeq_epi8(block1, rare1), _mm256_cmpeq_epi8(block2, rare2));
+}
+
+}  // namespace
+
+/**
+ * @brief SSE2 kernel: 16 candidate positions per iteration filtered on both rare bytes.
+ */
+__attribute__((target("sse2")))
+std::size_t LiteralMatcher::findSse2(std::string_view haystack, std::size_t from) const {
+    const char* const base = haystack.data();
+    const std::size_t n = needle_.size();
+    const std::size_t last = haystack.size() - n;
+    const __m128i rare1 = _mm_set1_epi8(needle_[rareOffset1_]);
+    const __m128i rare2 = _mm_set1_epi8(needle_[rareOffset2_]);
+
+    std::size_t pos = from;
+    for (; pos + 15 <= last; pos += 16) {
+        const __m128i block1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(base + pos + rareOffset1_));
+        const __m128i block2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(base + pos + rareOffset2_));
+        auto mask = static_cast<std::uint32_t>(
+            _mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(block1, rare1), _mm_cmpeq_epi8(block2, rare2))));
+        while (mask != 0) {
+            const std::size_t candidate = pos + static_cast<std::size_t>(__builtin_ctz(mask));
+            if (bytesEqual(base + candidate, needle_.data(), n)) {
+                return candidate;
+            }
+            mask &= mask - 1;
+        }
+    }
+    return pos <= last ? findScalar(haystack, pos) : std::string_view::npos;
+}
+
+/**
+ * @brief AVX2 kernel: 64 candidate positions per iteration filtered on both rare bytes.
+ *
+ * The loop body makes no calls so the broadcast needle bytes stay in registers; candidates
+ * are verified inline.
+ */
+__attribute__((target("avx2")))
+std::size_t LiteralMatcher::findAvx2(std::string_view haystack, std::size_t from) const {
+    const char* const base = haystack.data();
+    const char* const needle = needle_.data();
+    const std::size_t n = needle_.size();
+    const std::size_t last = haystack.size() - n;
+    const char* const probe1 = base + rareOffset1_;
+    const char* const probe2 = base + rareOffset2_;
+    const __m256i rare1 = _mm256_set1_epi8(needle_[rareOffset1_]);
+    const __m256i rare2 = _mm256_set1_epi8(needle_[rareOffset2_]);
+
+    std::size_t pos = from;
+    while (pos + 31 <= last) {
+        std::uint64_t mask;
+        std::size_t step;
+        if (pos + 63 <= last) {
+            const __m256i low = avx2Candidates(probe1 + pos, probe2 + pos, rare1, rare2);
+            const __m256i high = avx2Candidates(probe1 + pos + 32, probe2 + pos + 32, rare1, rare2);
+            if (_mm256_testz_si256(_mm256_or_si256(low, high), _mm256_or_si256(low, high))) {
+                pos += 64;
+                continue;
+            }
+            mask = static_cast<std::uint32_t>(_mm256_movemask_epi8(low)) |
+                   (static_cast<std::uint64_t>(static_cast<std::uint32_t>(_mm256_movemask_epi8(high))) << 32);
+            step = 64;
+        } else {
+            mask = static_cast<std::uint32_t>(_mm256_movemask_epi8(avx2Candidates(probe1 + pos, probe2 + pos, rare1, rare2)));
+            step = 32;
+        }
+
+        while (mask != 0) {
+            const std::size_t candidate = pos + static_cast<std::size_t>(__builtin_ctzll(mask));
+            if (bytesEqual(base + candidate, needle, n)) {
+                return candidate;
+            }
+            mask &= mask - 1;
+        }
+        pos += step;
+    }
+    return pos <= last ? findSse2(haystack, pos) : std::string_view::npos;
+}
+
+#else
+
+std::size_t LiteralMatcher::findSse2(std::string_view haystack, std::size_t from) const {
+    return findScalar(haystack, from);
+}
+
+std::size_t LiteralMatcher::findAvx2(std::string_view haystack, std::size_t from) const {
+    return findScalar(haystack, from);
+}
+
+#endif
@@ -1,48 +1,434 @@
 #include "grepLikeUtility.hpp"
+#include "compressedFileSearcher.hpp"
+#include "searchDaemon.hpp"
 #include <iostream>
+#include <fstream>
 #include <string>
+#include <vector>
 #include <filesystem>
 #include <memory>
 #include <locale>
+#include <csignal>
+#include <cctype>
+#include <charconv>
+#include <optional>
+
+namespace {
+
+SearchDaemon* runningDaemon = nullptr;
+
+///< Most worker threads --threads accepts.
+constexpr size_t kMaxThreads = 1024;
+
+void stopDaemon(int) {
+    if (runningDaemon)
+        runningDaemon->requestStop();
+}
+
+/**
+ * @brief Parses a non-negative decimal count; signs, blanks and trailing characters are rejected.
+ */
+std::optional<size_t> parseCount(const std::string& text) {
+    size_t value = 0;
+    const char* end = text.data() + text.size();
+    const auto [next, ec] = std::from_chars(text.data(), end, value);
+    if (text.empty() || ec != std::errc() || next != end)
+        return std::nullopt;
+    return value;
+}
+
+/**
+ * @brief Parses a size in bytes with an optional K, M or G suffix (powers of 1024).
+ */
+std::optional<size_t> parseSize(const std::string& text) {
+    size_t size = 0;
+    const auto [next, ec] = std::from_chars(text.data(), text.data() + text.size(), size);
+    if (ec != std::errc())
+        return std::nullopt;  // also signs and leading blanks, which std::stoul would take
+    const std::string suffix(next, text.data() + text.size());
+    int shift = 0;
+    if (suffix == "K" || suffix == "k")
+        shift = 10;
+    else if (suffix == "M" || suffix == "m")
+        shift = 20;
+    else if (suffix == "G" || suffix == "g")
+        shift = 30;
+    else if (!suffix.empty())
+        return std::nullopt;
+    if (size > (static_cast<size_t>(-1) >> shift))
+        return std::nullopt;
+    return size << shift;
+}
+
+}  // namespace
 
 int main(int argc, char* argv[]) {
     std::setlocale(LC_ALL, "en_US.UTF-8");
 
-    if (argc < 3 || argc > 5) {
-        std::cout << "Usage: " << argv[0] << " <directory_path> <query> [-i] [--regex]" << std::endl;
-        std::cout << "  <directory_path>: Path to the directory to search in\n"
+    if (argc < 3) {
+        std::cout << "Usage: " << argv[0] << " <directory_path> (<query> | -f <patterns_file>) [-i] [--regex] [--regex-engine=<engine>] [--threads=<n>] [--follow-symlinks] [--include=<glob>] [--exclude=<glob>] [--type=<type>] [--no-ignore] [-l | -c] [--max-count=<n>] [--limit=<n>] [-A <n>] [-B <n>] [-C <n>] [--sort=path] [--binary=skip|report|text] [--decompress] [--io=sync|uring] [--memory-limit=<size>] [--stats[=json]] [--index=<index_file>] [--connect=<socket> [--timeout=<ms>]]" << std::endl;
+        std::cout << "       " << argv[0] << " <directory_path> --build-index=<index_file> [--threads=<n>] [--follow-symlinks] [<filters>]" << std::endl;
+        std::cout << "       " << argv[0] << " <directory_path> --daemon=<socket> [--threads=<n>] [--follow-symlinks] [<filters>]" << std::endl;
+        std::cout << "  <directory_path>: Path to the directory (or single file) to search in\n"
                   << "  <query>: The search query or regex pattern\n"
+                  << "  -f <patterns_file>: Search for every line of the file (literal strings) in one pass\n"
                   << "  [--ignore-case]: Optional flag for case-insensitive search\n"
                   << "  [--regex]: Optional flag to treat the query as a regular expression\n"
+                  << "  [--regex-engine=automaton|std]: Regex backend (default: automaton, linear time;\n"
+                  << "                                  std supports backreferences and lookaround)\n"
+                  << "  [--threads=<n>]: Number of worker threads (1 to 1024; default: one per hardware thread)\n"
+                  << "  [--follow-symlinks]: Descend into symlinks to directories (loops are skipped)\n"
+                  << "  [--include=<glob>]: Only search files matching the glob (repeatable; a glob without '/'\n"
+                  << "                      matches the file name, e.g. \"*.log\", others the path below the directory)\n"
+                  << "  [--exclude=<glob>]: Skip files and directories matching the glob (repeatable)\n"
+                  << "  [--type=<type>]: Only search files of the type (repeatable; --type=list lists the types)\n"
+                  << "  [--no-ignore]: Also search what .gitignore/.ignore files exclude, and .git directories\n"
+                  << "  [-l, --files-with-matches]: Print only the paths of the files with a match\n"
+                  << "  [-c, --count]: Print the number of matched lines of every file with a match\n"
+                  << "  [--max-count=<n>]: Stop reading a file after <n> matched lines\n"
+                  << "  [--limit=<n>]: Stop the search after <n> results (lines, or files with -l/-c)\n"
+                  << "  [-A <n>, --after-context=<n>]: Also print <n> lines after every matched line\n"
+                  << "  [-B <n>, --before-context=<n>]: Also print <n> lines before every matched line\n"
+                  << "  [-C <n>, --context=<n>]: Also print <n> lines before and after every matched line\n"
+                  << "  [--sort=path]: Print the matches sorted by file path once the search is done\n"
+                  << "  [--binary=skip|report|text]: Binary files (NUL in the first block): skip them, report\n"
+                  << "                               \"Binary file ... matches\" (default), or search them as text\n"
+                  << "  [--decompress]: Search inside gzip, xz and zstd compressed files (line numbers refer\n"
+                  << "                  to the decompressed text)\n"
+                  << "  [--io=sync|uring]: Read files on the workers (default), or read small files ahead\n"
+                  << "                     with io_uring, many at a time (falls back to sync without it)\n"
+                  << "  [--memory-limit=<size>]: Bound the memory of the files being read and searched and of\n"
+                  << "                           the queued output, e.g. 256M (K, M, G suffixes); reading\n"
+                  << "                           and the directory walk wait while it is reached\n"
+                  << "  [--stats[=json]]: Print counters and timings of the walk, I/O, matching and output to\n"
+                  << "                    stderr after the search, as text or as one JSON object\n"
+                  << "  [--index=<index_file>]: Skip the files a trigram index of the directory rules out\n"
+                  << "  --build-index=<index_file>: Build (or rebuild) the trigram index of the directory\n"
+                  << "  --daemon=<socket>: Serve searches of the directory on a Unix domain socket\n"
+                  << "  [--connect=<socket>]: Send the search to a daemon serving the directory\n"
+                  << "  [--timeout=<ms>]: With --connect, cancel the search after this many milliseconds\n"
                   << "Example: " << argv[0] << " ./test_dir \"search_term\" -i --regex\n";
         return 1;
     }
 
     std::filesystem::path directoryPath = argv[1];
     std::string query = argv[2];
+    std::string patternsFile;
+    std::string buildIndexFile;
+    std::string indexFile;
+    std::string daemonSocket;
+    std::string connectSocket;
+    size_t timeoutMs = 0;
+    int firstFlag = 3;
+    if (query.rfind("--build-index=", 0) == 0) {
+        buildIndexFile = query.substr(14);
+    } else if (query.rfind("--daemon=", 0) == 0) {
+        daemonSocket = query.substr(9);
+    } else if (query == "-f") {
+        if (argc < 4) {
+            std::cout << "Missing patterns file after -f" << std::endl;
+            return 1;
+        }
+        patternsFile = argv[3];
+        firstFlag = 4;
+    }
     bool caseSensitive = true;
     bool useRegex = false;
+    RegexEngine engine = RegexEngine::Automaton;
+    size_t numThreads = 0;
+    bool followSymlinks = false;
+    bool sortByPath = false;
+    BinaryPolicy binaryPolicy = BinaryPolicy::Report;
+    bool decompress = false;
+    ReportMode reportMode = ReportMode::Lines;
+    size_t maxCount = 0;
+    size_t resultLimit = 0;
+    size_t contextBefore = 0;
+    size_t contextAfter = 0;
+    bool contextGiven = false;  // even -C 0 separates non-adjacent matches with --
+    IoBackend ioBackend = IoBackend::Sync;
+    size_t memoryLimit = 0;
+    bool stats = false;
+    bool statsJson = false;
+    auto pathFilter = std::make_shared<PathFilter>();
+    pathFilter->setUseIgnoreFiles(true);
+    bool filterGiven = false;
 
-    for (int i = 3; i < argc; ++i) {
+    for (int i = firstFlag; i < argc; ++i) {
         std::string flag = argv[i];
         if (flag == "--ignore-case") {
             caseSensitive = false;
         } else if (flag == "--regex") {
             useRegex = true;
+        } else if (flag == "--regex-engine=automaton") {
+            engine = RegexEngine::Automaton;
+        } else if (flag == "--regex-engine=std") {
+            engine = RegexEngine::Std;
+        } else if (flag == "--follow-symlinks") {
+            followSymlinks = true;
+        } else if (flag.rfind("--include=", 0) == 0) {
+            pathFilter->addInclude(flag.substr(10));
+            filterGiven = true;
+        } else if (flag.rfind("--exclude=", 0) == 0) {
+            pathFilter->addExclude(flag.substr(10));
+            filterGiven = true;
+        } else if (flag == "--type=list") {
+            for (const std::string& type : PathFilter::typeNames())
+                std::cout << type << std::endl;
+            return 0;
+        } else if (flag.rfind("--type=", 0) == 0) {
+            if (!pathFilter->addType(flag.substr(7))) {
+                std::cout << "Unknown file type: " << flag.substr(7) << " (--type=list lists the types)" << std::endl;
+                return 1;
+            }
+            filterGiven = true;
+        } else if (flag == "--no-ignore") {
+            pathFilter->setUseIgnoreFiles(false);
+            filterGiven = true;
+        } else if (flag == "-l" || flag == "--files-with-matches") {
+            reportMode = ReportMode::FilesWithMatches;
+        } else if (flag == "-c" || flag == "--count") {
+            reportMode = ReportMode::Count;
+        } else if (flag.rfind("--max-count=", 0) == 0) {
+            const auto count = parseCount(flag.substr(12));
+            if (!count) {
+                std::cout << "Invalid max count: " << flag << std::endl;
+                return 1;
+            }
+            maxCount = *count;
+        } else if (flag.rfind("--limit=", 0) == 0) {
+            const auto count = parseCount(flag.substr(8));
+            if (!count) {
+                std::cout << "Invalid result limit: " << flag << std::endl;
+                return 1;
+            }
+            resultLimit = *count;
+        } else if (flag == "-A" || flag == "-B" || flag == "-C" || flag.rfind("--after-context=", 0) == 0 ||
+                   flag.rfind("--before-context=", 0) == 0 || flag.rfind("--context=", 0) == 0) {
+            const bool separate = flag.size() == 2;
+            if (separate && i + 1 == argc) {
+                std::cout << "Missing line count after " << flag << std::endl;
+                return 1;
+            }
+            const auto lines = parseCount(separate ? std::string(argv[++i]) : flag.substr(flag.find('=') + 1));
+            if (!lines) {
+                std::cout << "Invalid context line count: " << flag << std::endl;
+                return 1;
+            }
+            contextGiven = true;
+            // -A/--after-context, -B/--before-context, -C/--context
+            const char kind = separate ? flag[1] : static_cast<char>(std::toupper(flag[2]));
+            if (kind == 'A' || kind == 'C')
+                contextAfter = *lines;
+            if (kind == 'B' || kind == 'C')
+                contextBefore = *lines;
+        } else if (flag == "--sort=path") {
+            sortByPath = true;
+        } else if (flag == "--binary=skip") {
+            binaryPolicy = BinaryPolicy::Skip;
+        } else if (flag == "--binary=report") {
+            binaryPolicy = BinaryPolicy::Report;
+        } else if (flag == "--binary=text") {
+            binaryPolicy = BinaryPolicy::Text;
+        } else if (flag == "--decompress") {
+            decompress = true;
+        } else if (flag == "--io=sync") {
+            ioBackend = IoBackend::Sync;
+        } else if (flag == "--io=uring") {
+            ioBackend = IoBackend::Uring;
+        } else if (flag.rfind("--memory-limit=", 0) == 0) {
+            const auto size = parseSize(flag.substr(15));
+            if (!size) {
+                std::cout << "Invalid memory limit: " << flag << std::endl;
+                return 1;
+            }
+            memoryLimit = *size;
+        } else if (flag == "--stats") {
+            stats = true;
+        } else if (flag == "--stats=json") {
+            stats = true;
+            statsJson = true;
+        } else if (flag.rfind("--index=", 0) == 0) {
+            indexFile = flag.substr(8);
+        } else if (flag.rfind("--connect=", 0) == 0) {
+            connectSocket = flag.substr(10);
+        } else if (flag.rfind("--timeout=", 0) == 0) {
+            const auto timeout = parseCount(flag.substr(10));
+            if (!timeout) {
+                std::cout << "Invalid timeout: " << flag << std::endl;
+                return 1;
+            }
+            timeoutMs = *timeout;
+        } else if (flag.rfind("--threads=", 0) == 0) {
+            const auto count = parseCount(flag.substr(10));
+            if (!count || *count < 1 || *count > kMaxThreads) {
+                std::cout << "Invalid thread count: " << flag << " (1 to " << kMaxThreads << ")" << std::endl;
+                return 1;
+            }
+            numThreads = *count;
         } else {
             std::cout << "Unknown option: " << flag << std::endl;
             return 1;
         }
     }
 
+    if (!buildIndexFile.empty()) {
+        const auto indexed = TrigramIndex::build(directoryPath, buildIndexFile,
+                                                 numThreads > 0 ? numThreads : std::thread::hardware_concurrency(),
+                                                 followSymlinks, pathFilter);
+        if (!indexed)
+            return 1;
+        std::cout << "Indexed " << *indexed << " files of " << directoryPath << " into " << buildIndexFile << std::endl;
+        return 0;
+    }
+
+    if (!daemonSocket.empty()) {
+        SearchDaemon daemon(directoryPath, numThreads, followSymlinks);
+        daemon.setPathFilter(pathFilter);
+        if (!daemon.listen(daemonSocket)) {
+            std::cout << "Could not start the daemon: " << daemon.error() << std::endl;
+            return 1;
+        }
+        std::cout << "Serving " << daemon.root() << " (" << daemon.fileCount() << " files) on " << daemonSocket
+                  << std::endl;
+        runningDaemon = &daemon;
+        std::signal(SIGINT, stopDaemon);
+        std::signal(SIGTERM, stopDaemon);
+        daemon.run();
+        runningDaemon = nullptr;
+        return 0;
+    }
+
+    std::shared_ptr<TrigramIndex> index;
+    if (!indexFile.empty()) {
+        if (decompress) {
+            std::cout << "The index holds the compressed bytes of files; --index is not supported with --decompress"
+                      << std::endl;
+            return 1;
+        }
+        index = std::make_shared<TrigramIndex>();
+        if (!index->open(indexFile)) {
+            std::cout << "Could not open index: " << index->error() << std::endl;
+            return 1;
+        }
+    }
+
+    std::vector<std::string> patterns;
+    if (!patternsFile.empty()) {
+        if (useRegex) {
+            std::cout << "-f patterns are literal strings; --regex is not supported with -f" << std::endl;
+            return 1;
+        }
+        std::ifstream file(patternsFile);
+        if (!file.is_open()) {
+            std::cout << "Could not open patterns file: " << patternsFile << std::endl;
+            return 1;
+        }
+        std::string line;
+        while (std::getline(file, line)) {
+            if (!line.empty() && line.back() == '\r')
+                line.pop_back();
+            if (!line.empty())
+                patterns.push_back(line);
+        }
+    }
+
     std::cout << "Searching in directory: " << directoryPath << std::endl;
-    std::cout << "Search query: \"" << query << "\"" << std::endl;
+    if (patternsFile.empty())
+        std::cout << "Search query: \"" << query << "\"" << std::endl;
+    else
+        std::cout << "Patterns file: " << patternsFile << " (" << patterns.size() << " patterns)" << std::endl;
     std::cout << "Case-sensitive search: " << (caseSensitive ? "Yes" : "No") << std::endl;
     std::cout << "Regex search: " << (useRegex ? "Yes" : "No") << std::endl;
+    if (useRegex)
+        std::cout << "Regex engine: " << (engine == RegexEngine::Std ? "std" : "automaton") << std::endl;
+    if (index)
+        std::cout << "Index: " << indexFile << " (" << index->fileCount() << " files)" << std::endl;
+    if (!connectSocket.empty())
+        std::cout << "Daemon: " << connectSocket << std::endl;
 
-    std::unique_ptr<FileSearcher> textFileSearcher = std::make_unique<TextFileSearcher>();
-    SearchManager searchManager(std::move(textFileSearcher), query, caseSensitive, true, useRegex);
+    if (!connectSocket.empty()) {
+        if (!patternsFile.empty()) {
+            std::cout << "-f is not supported with --connect" << std::endl;
+            return 1;
+        }
+        if (reportMode != ReportMode::Lines || maxCount > 0 || resultLimit > 0 || contextGiven || stats ||
+            ioBackend != IoBackend::Sync || memoryLimit > 0) {
+            std::cout << "-l, -c, --max-count, --limit, context lines, --io, --memory-limit and --stats are not "
+                         "supported with --connect"
+                      << std::endl;
+            return 1;
+        }
+        if (filterGiven) {
+            std::cout << "The daemon applies the filters it was started with; they cannot be given with --connect"
+                      << std::endl;
+            return 1;
+        }
+        DaemonRequest request;
+        request.query = query;
+        request.caseSensitive = caseSensitive;
+        request.useRegex = useRegex;
+        request.engine = engine;
+        request.path = std::filesystem::absolute(directoryPath);
+        request.timeout = std::chrono::milliseconds(timeoutMs);
+        request.binaryPolicy = binaryPolicy;
+        request.decompress = decompress;
+        std::string error;
+        std::optional<size_t> matches;
+        {
+            OutputWriter writer(stdout, sortByPath);
+            ConsoleFormatter formatter(true, &writer);
+            matches = SearchDaemon::query(connectSocket, request, formatter, error);
+        }
+        if (!matches) {
+            std::cerr << "Error: " << error << std::endl;
+            return 1;
+        }
+        return 0;
+    }
+
+    std::unique_ptr<FileSearcher> textFileSearcher;
+    if (decompress) {
+        auto searcher = std::make_unique<CompressedFileSearcher>(binaryPolicy);
+        searcher->setReportMode(reportMode);
+        searcher->setMaxCount(maxCount);
+        if (contextGiven)
+            searcher->setContext(contextBefore, contextAfter);
+        textFileSearcher = std::move(searcher);
+    } else {
+        auto searcher = std::make_unique<TextFileSearcher>(binaryPolicy);
+        searcher->setReportMode(reportMode);
+        searcher->setMaxCount(maxCount);
+        if (contextGiven)
+            searcher->setContext(contextBefore, contextAfter);
+        textFileSearcher = std::move(searcher);
+    }
+    std::shared_ptr<const CompiledPattern> pattern =
+        patternsFile.empty() ? PatternCache::global().get(query, caseSensitive, useRegex, engine)
+                             : std::make_shared<const CompiledPattern>(std::move(patterns), caseSensitive);
+    SearchManager searchManager(std::move(textFileSearcher), std::move(pattern), true);
+    searchManager.setNumThreads(numThreads);
+    searchManager.setFollowSymlinks(followSymlinks);
+    searchManager.setPathFilter(pathFilter);
+    searchManager.setOrderedOutput(sortByPath);
+    searchManager.setIndex(index);
+    searchManager.setResultLimit(resultLimit);
+    if (ioBackend == IoBackend::Uring && !AsyncFileReader::uringAvailable())
+        std::cerr << "Warning: io_uring is not available; files are read by the workers" << std::endl;
+    searchManager.setIoBackend(ioBackend);
+    searchManager.setMemoryLimit(memoryLimit);
+    std::shared_ptr<SearchStats> searchStats;
+    if (stats) {
+        searchStats = std::make_shared<SearchStats>();
+        searchManager.setStats(searchStats);
+    }
     searchManager.searchInDirectory(directoryPath);
+    if (searchStats) {
+        if (statsJson)
+            searchStats->printJson(std::cerr);
+        else
+            searchStats->print(std::cerr);
+    }
 
     return 0;
 }
@@ -0,0 +1,176 @@
+#include "multiLiteralMatcher.hpp"
+#include <algorithm>
+#include <limits>
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define MULTILITERALMATCHER_X86 1
+#include <immintrin.h>
+#endif
+
+namespace {
+
+constexpr std::uint32_t kNoState = std::numeric_limits<std::uint32_t>::max();
+
+unsigned char foldAscii(unsigned char c) {
+    return c >= 'A' && c <= 'Z' ? static_cast<unsigned char>(c + ('a' - 'A')) : c;
+}
+
+#ifdef MULTILITERALMATCHER_X86
+/// Offset of the next of up to three bytes at or after `from`, 16 bytes at a time.
+__attribute__((target("sse2")))
+std::size_t scanSse2(const unsigned char* text, std::size_t size, std::size_t from, const std::string& bytes,
+                     const std::array<bool, 256>& isStart) {
+    const __m128i byte0 = _mm_set1_epi8(bytes[0]);
+    const __m128i byte1 = _mm_set1_epi8(bytes[bytes.size() > 1 ? 1 : 0]);
+    const __m128i byte2 = _mm_set1_epi8(bytes[bytes.size() > 2 ? 2 : 0]);
+    for (; from + 16 <= size; from += 16) {
+        const __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(text + from));
+        const __m128i hits = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(block, byte0), _mm_cmpeq_epi8(block, byte1)),
+                                          _mm_cmpeq_epi8(block, byte2));
+        const auto mask = static_cast<std::uint32_t>(_mm_movemask_epi8(hits));
+        if (mask != 0)
+            return from + static_cast<std::size_t>(__builtin_ctz(mask));
+    }
+    while (from < size && !isStart[text[from]])
+        ++from;
+    return from;
+}
+#endif
+
+}  // namespace
+
+/**
+ * @brief Builds the trie over byte classes, then resolves failure links into a dense DFA.
+ */
+MultiLiteralMatcher::MultiLiteralMatcher(const std::vector<std::string>& patterns, bool caseSensitive) {
+    auto key = [caseSensitive](char c) {
+        const auto byte = static_cast<unsigned char>(c);
+        return caseSensitive ? byte : foldAscii(byte);
+    };
+
+    // Byte classes: one per (folded) byte used by a pattern, class 0 for all other bytes.
+    std::array<bool, 256> used{};
+    for (const auto& pattern : patterns)
+        for (char c : pattern)
+            used[key(c)] = true;
+    std::array<std::uint16_t, 256> classOfKey{};
+    for (std::size_t b = 0; b < 256; ++b)
+        if (used[b])
+            classOfKey[b] = static_cast<std::uint16_t>(classCount_++);
+    for (std::size_t b = 0; b < 256; ++b)
+        classes_[b] = classOfKey[key(static_cast<char>(b))];
+
+    auto addState = [this]() {
+        transitions_.insert(transitions_.end(), classCount_, kNoState);
+        matchLength_.push_back(0);
+        matchPattern_.push_back(0);
+        return static_cast<std::uint32_t>(matchLength_.size() - 1);
+    };
+    addState();
+
+    for (std::size_t i = 0; i < patterns.size(); ++i) {
+        const std::string& pattern = patterns[i];
+        if (pattern.empty())
+            continue;
+        std::uint32_t state = 0;
+        for (char c : pattern) {
+            const std::size_t slot = state * classCount_ + classes_[static_cast<unsigned char>(c)];
+            if (transitions_[slot] == kNoState) {
+                const std::uint32_t next = addState();
+                transitions_[slot] = next;
+            }
+            state = transitions_[slot];
+        }
+        if (matchLength_[state] == 0) {
+            matchLength_[state] = static_cast<std::uint32_t>(pattern.size());
+            matchPattern_[state] = static_cast<std::uint32_t>(i);
+            maxLength_ = std::max(maxLength_, pattern.size());
+        }
+    }
+
+    // Breadth-first, so the failure state of every state is complete before it is used.
+    std::vector<std::uint32_t> fail(matchLength_.size(), 0);
+    std::vector<std::uint32_t> queue;
+    for (std::size_t c = 0; c < classCount_; ++c) {
+        std::uint32_t& next = transitions_[c];
+        if (next == kNoState)
+            next = 0;
+        else
+            queue.push_back(next);
+    }
+    for (std::size_t head = 0; head < queue.size(); ++head) {
+        const std::uint32_t state = queue[head];
+        for (std::size_t c = 0; c < classCount_; ++c) {
+            const std::uint32_t fallback = transitions_[fail[state] * classCount_ + c];
+            std::uint32_t& next = transitions_[state * classCount_ + c];
+            if (next == kNoState) {
+                next = fallback;
+                continue;
+            }
+            fail[next] = fallback;
+            if (matchLength_[next] == 0) {
+                // No pattern ends here itself: report the longest one ending in a suffix.
+                matchLength_[next] = matchLength_[fallback];
+                matchPattern_[next] = matchPattern_[fallback];
+            }
+            queue.push_back(next);
+        }
+    }
+
+    for (std::size_t b = 0; b < 256; ++b) {
+        startByte_[b] = transitions_[classes_[b]] != 0;
+        if (startByte_[b])
+            vectorStartBytes_ += static_cast<char>(b);
+    }
+    if (vectorStartBytes_.size() > kMaxVectorStartBytes)
+        vectorStartBytes_.clear();
+}
+
+/**
+ * @brief Finds the leftmost (then longest) match at or after `from`.
+ *
+ * Matches are detected at their end; once one is found, scanning continues only as long as a
+ * match that starts earlier (or at the same offset but is longer) could still end.
+ */
+MatchSpan MultiLiteralMatcher::find(std::string_view text, std::size_t from) const {
+    if (from > text.size() || maxLength_ == 0)
+        return {};
+
+    const auto* bytes = reinterpret_cast<const unsigned char*>(text.data());
+    const std::size_t size = text.size();
+    std::uint32_t state = 0;
+    MatchSpan best;
+    for (std::size_t i = from; i < size; ++i) {
+        if (state == 0) {
+            if (best)
+                break;  // nothing in progress could start before the match found
+            i = skipToStart(text, i);
+            if (i == size)
+                break;
+        }
+        state = transitions_[state * classCount_ + classes_[bytes[i]]];
+        const std::uint32_t length = matchLength_[state];
+        if (length != 0) {
+            const std::size_t start = i + 1 - length;
+            if (!best || start < best.position || (start == best.position && length > best.length))
+                best = {start, length, matchPattern_[state]};
+        }
+        if (best && i + 2 > best.position + maxLength_)
+            break;
+    }
+    return best;
+}
+
+/**
+ * @brief Offset of the next byte at or after `from` that can begin a pattern (or the text size).
+ */
+std::size_t MultiLiteralMatcher::skipToStart(std::string_view text, std::size_t from) const {
+    const auto* bytes = reinterpret_cast<const unsigned char*>(text.data());
+#ifdef MULTILITERALMATCHER_X86
+    if (!vectorStartBytes_.empty())
+        return scanSse2(bytes, text.size(), from, vectorStartBytes_, startByte_);
+#endif
+    while (from < text.size() && !startByte_[bytes[from]])
+        ++from;
+    return from;
+}
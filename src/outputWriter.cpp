@@ -0,0 +1,113 @@
+#include "outputWriter.hpp"
+#include "searchStats.hpp"
+#include <utility>
+
+/**
+ * @brief Constructor; starts the writer thread in streaming mode.
+ */
+OutputWriter::OutputWriter(std::FILE* out, bool orderedByPath, std::size_t maxQueuedBytes)
+    : out_(out), orderedByPath_(orderedByPath), maxQueuedBytes_(maxQueuedBytes) {
+    if (!orderedByPath_)
+        writer_ = std::thread(&OutputWriter::run, this);
+}
+
+OutputWriter::~OutputWriter() {
+    finish();
+}
+
+/**
+ * @brief Queues a chunk of formatted output belonging to a file.
+ */
+void OutputWriter::write(const std::string& path, std::string chunk) {
+    if (chunk.empty())
+        return;
+
+    std::unique_lock<std::mutex> lock(mutex_, std::defer_lock);
+    {
+        SearchStats::Timer waiting(SearchStats::Counter::OutputWaitNs);
+        lock.lock();
+        if (!orderedByPath_)
+            hasRoom_.wait(lock, [this] { return queuedBytes_ < maxQueuedBytes_ || finished_; });
+    }
+    if (finished_) {
+        emit(chunk);  // late output: written directly, still serialized by the lock
+        return;
+    }
+    if (orderedByPath_) {
+        byPath_[path] += chunk;
+        return;
+    }
+
+    queuedBytes_ += chunk.size();
+    queue_.push_back(std::move(chunk));
+    lock.unlock();
+    hasOutput_.notify_one();
+}
+
+/**
+ * @brief Writes everything still queued and stops the writer thread.
+ */
+void OutputWriter::finish() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (finished_)
+            return;
+        finished_ = true;
+    }
+    hasOutput_.notify_one();
+    hasRoom_.notify_all();
+    if (writer_.joinable())
+        writer_.join();
+
+    if (orderedByPath_) {
+        std::string batch;
+        for (auto& [path, output] : byPath_) {
+            batch += output;
+            std::string().swap(output);
+            if (batch.size() >= kBatchSize) {
+                emit(batch);
+                batch.clear();
+            }
+        }
+        emit(batch);
+        byPath_.clear();
+    }
+}
+
+/**
+ * @brief Writer thread: drains the queue in batches until finish() is called and it is empty.
+ */
+void OutputWriter::run() {
+    std::vector<std::string> chunks;
+    std::string batch;
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            hasOutput_.wait(lock, [this] { return !queue_.empty() || finished_; });
+            if (queue_.empty())
+                return;
+            chunks.swap(queue_);
+            queuedBytes_ = 0;
+        }
+        hasRoom_.notify_all();
+
+        if (chunks.size() == 1) {
+            emit(chunks.front());
+        }
+        else {
+            batch.clear();
+            for (const auto& chunk : chunks)
+                batch += chunk;
+            emit(batch);
+        }
+        chunks.clear();
+    }
+}
+
+void OutputWriter::emit(const std::string& batch) {
+    if (batch.empty())
+        return;
+    SearchStats::Timer timer(SearchStats::Counter::WriteNs);
+    std::fwrite(batch.data(), 1, batch.size(), out_);
+    std::fflush(out_);
+}
@@ -0,0 +1,162 @@
+#include "pathFilter.hpp"
+#include <utility>
+
+namespace {
+
+struct FileType {
+    std::string_view name;
+    std::vector<std::string_view> globs;
+};
+
+const std::vector<FileType>& fileTypes() {
+    static const std::vector<FileType> types = {
+        {"c", {"*.c", "*.h"}},
+        {"cmake", {"CMakeLists.txt", "*.cmake"}},
+        {"cpp", {"*.cpp", "*.cc", "*.cxx", "*.hpp", "*.hh", "*.hxx", "*.h", "*.inl"}},
+        {"css", {"*.css", "*.scss"}},
+        {"go", {"*.go"}},
+        {"html", {"*.html", "*.htm"}},
+        {"java", {"*.java"}},
+        {"js", {"*.js", "*.jsx", "*.mjs", "*.cjs"}},
+        {"json", {"*.json"}},
+        {"log", {"*.log"}},
+        {"md", {"*.md", "*.markdown"}},
+        {"py", {"*.py", "*.pyi"}},
+        {"rust", {"*.rs"}},
+        {"sh", {"*.sh", "*.bash", "*.zsh"}},
+        {"ts", {"*.ts", "*.tsx"}},
+        {"txt", {"*.txt"}},
+        {"xml", {"*.xml"}},
+        {"yaml", {"*.yaml", "*.yml"}},
+    };
+    return types;
+}
+
+std::string_view trimTrailingSpaces(std::string_view line) {
+    // Trailing spaces are dropped unless escaped with a backslash.
+    while (!line.empty() && line.back() == ' ') {
+        std::size_t backslashes = 0;
+        for (std::size_t i = line.size() - 1; i > 0 && line[i - 1] == '\\'; --i)
+            ++backslashes;
+        if (backslashes % 2 == 1)
+            break;
+        line.remove_suffix(1);
+    }
+    return line;
+}
+
+}  // namespace
+
+IgnoreRules::IgnoreRules(std::shared_ptr<const IgnoreRules> parent, std::string directory)
+    : parent_(std::move(parent)), directory_(std::move(directory)) {}
+
+void IgnoreRules::add(std::string_view contents) {
+    while (!contents.empty()) {
+        const std::size_t newline = contents.find('\n');
+        std::string_view line = contents.substr(0, newline);
+        contents.remove_prefix(newline == std::string_view::npos ? contents.size() : newline + 1);
+
+        if (!line.empty() && line.back() == '\r')
+            line.remove_suffix(1);
+        line = trimTrailingSpaces(line);
+        if (line.empty() || line[0] == '#')
+            continue;
+
+        const bool negated = line[0] == '!';
+        if (negated)
+            line.remove_prefix(1);
+        const bool directoryOnly = !line.empty() && line.back() == '/';
+        if (directoryOnly)
+            line.remove_suffix(1);
+        if (line.empty())
+            continue;
+
+        // A '/' anywhere but at the end anchors the rule to this directory.
+        if (line.find('/') != std::string_view::npos) {
+            if (line[0] == '/')
+                line.remove_prefix(1);
+            globs_.addAnchored(line, directoryOnly);
+        } else {
+            globs_.add(line, directoryOnly);
+        }
+        negated_.push_back(negated);
+    }
+}
+
+bool IgnoreRules::ignored(std::string_view path, bool isDirectory) const {
+    for (const IgnoreRules* rules = this; rules != nullptr; rules = rules->parent_.get()) {
+        if (rules->empty() || path.substr(0, rules->directory_.size()) != rules->directory_)
+            continue;
+        const std::size_t match = rules->globs_.lastMatch(path.substr(rules->directory_.size()), isDirectory);
+        if (match != GlobSet::npos)
+            return !rules->negated_[match];
+    }
+    return false;
+}
+
+bool PathFilter::addType(std::string_view name) {
+    for (const FileType& type : fileTypes()) {
+        if (type.name == name) {
+            for (const std::string_view glob : type.globs)
+                types_.add(glob);
+            return true;
+        }
+    }
+    return false;
+}
+
+std::vector<std::string> PathFilter::typeNames() {
+    std::vector<std::string> names;
+    for (const FileType& type : fileTypes()) {
+        std::string line(type.name);
+        for (std::size_t i = 0; i < type.globs.size(); ++i)
+            line += (i == 0 ? ": " : ", ") + std::string(type.globs[i]);
+        names.push_back(std::move(line));
+    }
+    return names;
+}
+
+bool PathFilter::active() const {
+    return useIgnoreFiles_ || !includes_.empty() || !excludes_.empty() || !types_.empty();
+}
+
+std::shared_ptr<const IgnoreRules> PathFilter::enterDirectory(const std::shared_ptr<const IgnoreRules>& parent,
+                                                              const std::string& directory,
+                                                              const ReadFile& readFile) const {
+    if (!useIgnoreFiles_)
+        return parent;
+
+    std::shared_ptr<IgnoreRules> rules;
+    std::string contents;
+    for (const char* name : kIgnoreFileNames) {
+        if (!readFile(name, contents))
+            continue;
+        if (!rules)
+            rules = std::make_shared<IgnoreRules>(parent, directory);
+        rules->add(contents);
+    }
+    if (!rules || rules->empty())
+        return parent;
+    return rules;
+}
+
+bool PathFilter::acceptsDirectory(const IgnoreRules* rules, std::string_view path) const {
+    if (useIgnoreFiles_) {
+        const std::size_t slash = path.rfind('/');
+        if (path.substr(slash == std::string_view::npos ? 0 : slash + 1) == ".git")
+            return false;
+    }
+    if (excludes_.matches(path, true))
+        return false;
+    return rules == nullptr || !rules->ignored(path, true);
+}
+
+bool PathFilter::acceptsFile(const IgnoreRules* rules, std::string_view path) const {
+    if (!excludes_.empty() && excludes_.matches(path, false))
+        return false;
+    if (!includes_.empty() && !includes_.matches(path, false))
+        return false;
+    if (!types_.empty() && !types_.matches(path, false))
+        return false;
+    return rules == nullptr || !rules->ignored(path, false);
+}
@@ -0,0 +1,863 @@
+#include "searchDaemon.hpp"
+#include "compressedFileSearcher.hpp"
+#include "directoryWalker.hpp"
+#include "outputWriter.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <limits>
+#include <thread>
+#include <utility>
+
+#ifndef _WIN32
+#include <poll.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+namespace {
+
+std::string escapeField(std::string_view field) {
+    std::string escaped;
+    escaped.reserve(field.size());
+    for (const char c : field) {
+        switch (c) {
+        case '\\': escaped += "\\\\"; break;
+        case '\t': escaped += "\\t"; break;
+        case '\n': escaped += "\\n"; break;
+        default: escaped += c;
+        }
+    }
+    return escaped;
+}
+
+std::string unescapeField(std::string_view field) {
+    std::string text;
+    text.reserve(field.size());
+    for (std::size_t i = 0; i < field.size(); ++i) {
+        if (field[i] != '\\' || i + 1 == field.size()) {
+            text += field[i];
+            continue;
+        }
+        const char next = field[++i];
+        text += next == 't' ? '\t' : next == 'n' ? '\n' : next;
+    }
+    return text;
+}
+
+std::vector<std::string_view> splitFields(std::string_view line, char separator = '\t') {
+    std::vector<std::string_view> fields;
+    std::size_t start = 0;
+    for (;;) {
+        const std::size_t end = line.find(separator, start);
+        fields.push_back(line.substr(start, end == std::string_view::npos ? std::string_view::npos : end - start));
+        if (end == std::string_view::npos)
+            return fields;
+        start = end + 1;
+    }
+}
+
+bool parseNumber(std::string_view text, std::size_t& value) {
+    const auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), value);
+    return error == std::errc() && end == text.data() + text.size() && !text.empty();
+}
+
+/**
+ * @brief Formats results as `match` lines for the OutputWriter of a search, until it is cancelled.
+ */
+class DaemonResultSink : public ResultSink {
+public:
+    DaemonResultSink(OutputWriter& writer, const CancellationToken& token) : writer_(writer), token_(token) {}
+
+    void consume(std::vector<SearchResult>& results, const std::string& /*threadIdStr*/) override {
+        if (results.empty() || token_.cancelled())
+            return;
+        std::string output;
+        for (const SearchResult& result : results) {
+            if (result.binary) {
+                output += "binary\t";
+                output += escapeField(result.path);
+                output += '\n';
+                continue;
+            }
+            output += "match\t";
+            output += escapeField(result.path);
+            output += '\t';
+            output += std::to_string(result.lineNumber);
+            output += '\t';
+            output += std::to_string(result.byteOffset);
+            output += '\t';
+            for (std::size_t i = 0; i < result.spans.size(); ++i) {
+                if (i > 0)
+                    output += ',';
+                output += std::to_string(result.spans[i].position);
+                output += ':';
+                output += std::to_string(result.spans[i].length);
+            }
+            output += '\t';
+            output += escapeField(result.line);
+            output += '\n';
+        }
+        matches_.fetch_add(results.size(), std::memory_order_relaxed);
+        writer_.write(results.front().path, std::move(output));
+    }
+
+    std::size_t matches() const { return matches_.load(std::memory_order_relaxed); }
+
+private:
+    OutputWriter& writer_;
+    const CancellationToken& token_;
+    std::atomic<std::size_t> matches_{0};
+};
+
+#ifndef _WIN32
+
+bool sendAll(int fd, std::string_view data) {
+    while (!data.empty()) {
+        const ssize_t sent = ::send(fd, data.data(), data.size(), MSG_NOSIGNAL);
+        if (sent < 0 && errno == EINTR)
+            continue;
+        if (sent <= 0)
+            return false;
+        data.remove_prefix(static_cast<std::size_t>(sent));
+    }
+    return true;
+}
+
+/// Reads the next line (without its newline) into line; false on end of stream, error or an overlong line.
+bool readLine(int fd, std::string& inbox, std::string& line, std::size_t maxLength) {
+    std::size_t scanned = 0;
+    for (;;) {
+        const std::size_t newline = inbox.find('\n', scanned);
+        if (newline != std::string::npos) {
+            line.assign(inbox, 0, newline);
+            inbox.erase(0, newline + 1);
+            return true;
+        }
+        if (inbox.size() > maxLength)
+            return false;
+        scanned = inbox.size();
+        char chunk[64 * 1024];
+        const ssize_t received = ::read(fd, chunk, sizeof(chunk));
+        if (received < 0 && errno == EINTR)
+            continue;
+        if (received <= 0)
+            return false;
+        inbox.append(chunk, static_cast<std::size_t>(received));
+    }
+}
+
+bool socketAddress(const std::filesystem::path& socketPath, sockaddr_un& address, std::string& error) {
+    const std::string name = socketPath.string();
+    address = {};
+    address.sun_family = AF_UNIX;
+    if (name.empty() || name.size() >= sizeof(address.sun_path)) {
+        error = "Invalid socket path - " + name;
+        return false;
+    }
+    std::memcpy(address.sun_path, name.c_str(), name.size() + 1);
+    return true;
+}
+
+int connectTo(const std::filesystem::path& socketPath, std::string& error) {
+    sockaddr_un address;
+    if (!socketAddress(socketPath, address, error))
+        return -1;
+    const int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        error = std::string("Could not create a socket: ") + std::strerror(errno);
+        return -1;
+    }
+    if (::connect(fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0) {
+        error = "Could not connect to " + socketPath.string() + ": " + std::strerror(errno);
+        ::close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+#endif
+
+}  // namespace
+
+/// A client connection and the search it is running.
+struct SearchDaemon::Connection {
+    int fd = -1;
+    std::string inbox;                              ///< Received bytes not yet handled.
+    bool disconnected = false;
+    std::mutex mutex;                               ///< Guards token.
+    std::shared_ptr<CancellationToken> token;       ///< Token of the running search, if any.
+};
+
+std::string DaemonRequest::encode() const {
+    if (kind == Kind::Rescan)
+        return "rescan";
+
+    std::string options;
+    auto addOption = [&options](const std::string& option) {
+        if (!options.empty())
+            options += ',';
+        options += option;
+    };
+    if (!caseSensitive)
+        addOption("ignore-case");
+    if (useRegex)
+        addOption("regex");
+    if (engine == RegexEngine::Std)
+        addOption("engine=std");
+    if (timeout.count() > 0)
+        addOption("timeout-ms=" + std::to_string(timeout.count()));
+    if (binaryPolicy == BinaryPolicy::Skip)
+        addOption("binary=skip");
+    else if (binaryPolicy == BinaryPolicy::Text)
+        addOption("binary=text");
+    if (decompress)
+        addOption("decompress");
+    return "search\t" + options + '\t' + escapeField(path.string()) + '\t' + escapeField(query);
+}
+
+std::optional<DaemonRequest> DaemonRequest::decode(std::string_view line, std::string& error) {
+    const std::vector<std::string_view> fields = splitFields(line);
+    DaemonRequest request;
+    if (fields.size() == 1 && fields[0] == "rescan") {
+        request.kind = Kind::Rescan;
+        return request;
+    }
+    if (fields.size() != 4 || fields[0] != "search") {
+        error = "Malformed request - " + std::string(line.substr(0, 80));
+        return std::nullopt;
+    }
+
+    if (!fields[1].empty()) {
+        for (const std::string_view option : splitFields(fields[1], ',')) {
+            std::size_t milliseconds = 0;
+            if (option == "ignore-case") {
+                request.caseSensitive = false;
+            } else if (option == "regex") {
+                request.useRegex = true;
+            } else if (option == "engine=std") {
+                request.engine = RegexEngine::Std;
+            } else if (option == "engine=automaton") {
+                request.engine = RegexEngine::Automaton;
+            } else if (option == "binary=skip") {
+                request.binaryPolicy = BinaryPolicy::Skip;
+            } else if (option == "binary=report") {
+                request.binaryPolicy = BinaryPolicy::Report;
+            } else if (option == "binary=text") {
+                request.binaryPolicy = BinaryPolicy::Text;
+            } else if (option == "decompress") {
+                request.decompress = true;
+            } else if (option.substr(0, 11) == "timeout-ms=" && parseNumber(option.substr(11), milliseconds)) {
+                request.timeout = std::chrono::milliseconds(milliseconds);
+            } else {
+                error = "Unknown option - " + std::string(option);
+                return std::nullopt;
+            }
+        }
+    }
+    request.path = unescapeField(fields[2]);
+    request.query = unescapeField(fields[3]);
+    return request;
+}
+
+SearchDaemon::SearchDaemon(std::filesystem::path root, std::size_t numThreads, bool followSymlinks)
+    : root_(std::move(root)),
+      numThreads_(numThreads > 0 ? numThreads : std::max(1u, std::thread::hardware_concurrency())),
+      followSymlinks_(followSymlinks) {}
+
+SearchDaemon::~SearchDaemon() {
+#ifndef _WIN32
+    if (listenFd_ >= 0) {
+        ::close(listenFd_);
+        ::unlink(socketPath_.c_str());
+    }
+    for (const int fd : stopPipe_) {
+        if (fd >= 0)
+            ::close(fd);
+    }
+#endif
+}
+
+std::size_t SearchDaemon::fileCount() const {
+    const auto list = files();
+    return list ? list->size() : 0;
+}
+
+std::shared_ptr<const std::vector<std::string>> SearchDaemon::files() const {
+    std::lock_guard<std::mutex> lock(filesMutex_);
+    return files_;
+}
+
+/**
+ * @brief Walks the served directory and replaces the file list.
+ *
+ * Searches that already took the previous list keep using it.
+ */
+std::size_t SearchDaemon::rescan() {
+    auto found = std::make_shared<std::vector<std::string>>();
+    std::mutex foundMutex;
+    DirectoryWalker walker(numThreads_, followSymlinks_);
+    walker.setFilter(filter_);
+    walker.walk(
+        root_,
+        [&](std::filesystem::path file) {
+            std::string path = file.string();
+            std::lock_guard<std::mutex> lock(foundMutex);
+            found->push_back(std::move(path));
+        },
+        [&](const std::filesystem::path& path, std::error_code error) {
+            std::lock_guard<std::mutex> lock(foundMutex);
+            std::cerr << "Error: Could not read directory: " << path << " (" << error.message() << ")" << std::endl;
+        });
+    std::sort(found->begin(), found->end());
+
+    const std::size_t count = found->size();
+    std::lock_guard<std::mutex> lock(filesMutex_);
+    files_ = std::move(found);
+    return count;
+}
+
+bool SearchDaemon::listen(const std::filesystem::path& socketPath) {
+#ifdef _WIN32
+    (void)socketPath;
+    error_ = "The search daemon needs Unix domain sockets";
+    return false;
+#else
+    std::error_code ec;
+    const std::filesystem::path canonicalRoot = std::filesystem::canonical(root_, ec);
+    if (ec || !std::filesystem::is_directory(canonicalRoot)) {
+        error_ = "Invalid directory - " + root_.string();
+        return false;
+    }
+    root_ = canonicalRoot;
+
+    sockaddr_un address;
+    if (!socketAddress(socketPath, address, error_))
+        return false;
+
+    // A socket another daemon still answers on is left alone; a stale one is replaced.
+    std::string probeError;
+    const int probe = connectTo(socketPath, probeError);
+    if (probe >= 0) {
+        ::close(probe);
+        error_ = "Another daemon is listening on " + socketPath.string();
+        return false;
+    }
+    struct stat status;
+    if (::lstat(socketPath.c_str(), &status) == 0) {
+        if (!S_ISSOCK(status.st_mode)) {
+            error_ = "Not a socket - " + socketPath.string();
+            return false;
+        }
+        ::unlink(socketPath.c_str());
+    }
+
+    rescan();
+
+    const int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0 || ::bind(fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0) {
+        error_ = "Could not bind " + socketPath.string() + ": " + std::strerror(errno);
+        if (fd >= 0)
+            ::close(fd);
+        return false;
+    }
+    ::chmod(socketPath.c_str(), S_IRUSR | S_IWUSR);
+    if (::listen(fd, SOMAXCONN) != 0 || ::pipe(stopPipe_) != 0) {
+        error_ = "Could not listen on " + socketPath.string() + ": " + std::strerror(errno);
+        ::close(fd);
+        ::unlink(socketPath.c_str());
+        return false;
+    }
+    listenFd_ = fd;
+    socketPath_ = socketPath;
+    return true;
+#endif
+}
+
+void SearchDaemon::requestStop() {
+    stopping_.store(true);
+#ifndef _WIN32
+    if (stopPipe_[1] >= 0) {
+        const char wake = 0;
+        [[maybe_unused]] const ssize_t written = ::write(stopPipe_[1], &wake, 1);
+    }
+#endif
+}
+
+/**
+ * @brief Accepts connections, each served by its own thread, until a stop is requested.
+ *
+ * Results are written to clients through stdio streams, so SIGPIPE is ignored: a client that
+ * goes away makes the writes fail instead of killing the daemon.
+ */
+void SearchDaemon::run() {
+#ifndef _WIN32
+    if (listenFd_ < 0)
+        return;
+    ::signal(SIGPIPE, SIG_IGN);
+    pool_ = std::make_unique<WorkStealingPool>(numThreads_);
+    std::thread rescanner([this] { runRescans(); });
+
+    pollfd events[2] = {{listenFd_, POLLIN, 0}, {stopPipe_[0], POLLIN, 0}};
+    while (!stopping_.load()) {
+        if (::poll(events, 2, -1) < 0)
+            continue;
+        if (events[1].revents != 0)
+            break;
+        if ((events[0].revents & POLLIN) == 0)
+            continue;
+        const int fd = ::accept(listenFd_, nullptr, nullptr);
+        if (fd < 0)
+            continue;
+        auto connection = std::make_shared<Connection>();
+        connection->fd = fd;
+        {
+            std::lock_guard<std::mutex> lock(connectionsMutex_);
+            connections_.insert(connection);
+        }
+        std::thread([this, connection] { serveConnection(connection); }).detach();
+    }
+
+    {
+        std::unique_lock<std::mutex> lock(connectionsMutex_);
+        stopping_.store(true);
+        for (const auto& connection : connections_) {
+            std::lock_guard<std::mutex> connectionLock(connection->mutex);
+            if (connection->token)
+                connection->token->cancel();
+            ::shutdown(connection->fd, SHUT_RD);
+        }
+        connectionsChanged_.notify_all();
+        connectionsChanged_.wait(lock, [this] { return connections_.empty(); });
+    }
+    rescanner.join();
+    pool_.reset();
+#endif
+}
+
+void SearchDaemon::runRescans() {
+    std::unique_lock<std::mutex> lock(connectionsMutex_);
+    while (!connectionsChanged_.wait_for(lock, rescanInterval_, [this] { return stopping_.load(); })) {
+        lock.unlock();
+        rescan();
+        lock.lock();
+    }
+}
+
+/**
+ * @brief Handles the requests of one client, one at a time, until it disconnects.
+ */
+void SearchDaemon::serveConnection(const std::shared_ptr<Connection>& connection) {
+#ifndef _WIN32
+    std::string line;
+    while (!connection->disconnected && !stopping_.load() &&
+           readLine(connection->fd, connection->inbox, line, kMaxRequestLength)) {
+        if (line == "cancel")
+            continue;       // The search it was meant for has already finished.
+        std::string error;
+        const std::optional<DaemonRequest> request = DaemonRequest::decode(line, error);
+        if (!request) {
+            connection->disconnected = !sendAll(connection->fd, "error\t" + escapeField(error) + '\n');
+        } else if (request->kind == DaemonRequest::Kind::Rescan) {
+            connection->disconnected = !sendAll(connection->fd, "done\t" + std::to_string(rescan()) + '\n');
+        } else {
+            runSearch(*connection, *request);
+        }
+    }
+
+    const int fd = connection->fd;
+    {
+        std::lock_guard<std::mutex> lock(connectionsMutex_);
+        connections_.erase(connection);
+        connectionsChanged_.notify_all();
+    }
+    ::close(fd);
+#else
+    (void)connection;
+#endif
+}
+
+/**
+ * @brief Runs one search on the shared pool and streams its results to the client.
+ *
+ * While the workers search, the connection thread watches the client for a `cancel` line or
+ * a disconnect, and the clock for the deadline. Once the search is cancelled, the remaining
+ * tasks return without searching; if the client does not read the results already queued
+ * within kDrainTimeout, it is disconnected so the workers blocked on its output are released.
+ */
+void SearchDaemon::runSearch(Connection& connection, const DaemonRequest& request) {
+#ifndef _WIN32
+    const int fd = connection.fd;
+    const auto received = CancellationToken::Clock::now();
+    auto fail = [&](const std::string& message) {
+        connection.disconnected = !sendAll(fd, "error\t" + escapeField(message) + '\n');
+    };
+
+    std::string target = root_.string();
+    if (!request.path.empty()) {
+        std::error_code ec;
+        const std::filesystem::path path = std::filesystem::canonical(request.path, ec);
+        if (ec)
+            return fail("Invalid path - " + request.path.string());
+        const std::filesystem::path relative = path.lexically_relative(root_);
+        if (relative.empty() || *relative.begin() == "..")
+            return fail("Not below the served directory " + root_.string() + " - " + request.path.string());
+        target = path.string();
+    }
+
+    const std::shared_ptr<const CompiledPattern> pattern =
+        PatternCache::global().get(request.query, request.caseSensitive, request.useRegex, request.engine);
+    if (!pattern->valid())
+        return fail("Invalid regex - " + pattern->error());
+
+    // The target itself, or the files below it; they are contiguous in the sorted list except
+    // for siblings such as "target-2", which are skipped.
+    const std::shared_ptr<const std::vector<std::string>> list = files();
+    const std::string directory = target.back() == '/' ? target : target + '/';
+    std::vector<const std::string*> selected;
+    for (auto it = std::lower_bound(list->begin(), list->end(), target);
+         it != list->end() && it->compare(0, target.size(), target) == 0; ++it) {
+        if (it->size() == target.size() || it->compare(0, directory.size(), directory) == 0)
+            selected.push_back(&*it);
+    }
+
+    auto token = std::make_shared<CancellationToken>();
+    if (request.timeout.count() > 0)
+        token->setDeadline(received + request.timeout);
+    {
+        std::lock_guard<std::mutex> lock(connection.mutex);
+        connection.token = token;
+    }
+    if (stopping_.load())
+        token->cancel();
+
+    int donePipe[2];
+    std::FILE* out = nullptr;
+    const int outFd = ::dup(fd);
+    if (outFd < 0 || (out = ::fdopen(outFd, "w")) == nullptr || ::pipe(donePipe) != 0) {
+        if (out)
+            std::fclose(out);
+        else if (outFd >= 0)
+            ::close(outFd);
+        std::lock_guard<std::mutex> lock(connection.mutex);
+        connection.token.reset();
+        return fail(std::string("Could not start the search: ") + std::strerror(errno));
+    }
+
+    std::size_t matches = 0;
+    bool disconnected = false;
+    {
+        OutputWriter writer(out);
+        DaemonResultSink sink(writer, *token);
+        const std::size_t taskCount = (selected.size() + kFilesPerTask - 1) / kFilesPerTask;
+        std::atomic<std::size_t> pending{taskCount};
+        for (std::size_t task = 0; task < taskCount; ++task) {
+            pool_->submit([&, task, doneFd = donePipe[1]](std::size_t) {
+                const std::size_t end = std::min(selected.size(), (task + 1) * kFilesPerTask);
+                for (std::size_t i = task * kFilesPerTask; i < end && !token->cancelled(); ++i) {
+                    try {
+                        searchFile(*selected[i], *pattern, request, *token, sink);
+                    } catch (const std::exception& e) {
+                        std::lock_guard<std::mutex> lock(TextFileSearcher::coutMutex);
+                        std::cerr << "Error: Could not search " << *selected[i] << ": " << e.what() << std::endl;
+                    }
+                }
+                // Nothing of this search may be touched after the last task signals completion.
+                if (pending.fetch_sub(1) == 1) {
+                    const char done = 0;
+                    [[maybe_unused]] const ssize_t written = ::write(doneFd, &done, 1);
+                }
+            });
+        }
+
+        bool finished = taskCount == 0;
+        bool inputClosed = false;
+        std::optional<CancellationToken::Clock::time_point> cancelledAt;
+        while (!finished) {
+            const auto now = CancellationToken::Clock::now();
+            int timeoutMs = -1;
+            if (token->cancelled()) {
+                if (!cancelledAt)
+                    cancelledAt = now;
+                const auto waited = std::chrono::duration_cast<std::chrono::milliseconds>(now - *cancelledAt);
+                if (!disconnected && waited >= kDrainTimeout) {
+                    ::shutdown(fd, SHUT_RDWR);
+                    disconnected = true;
+                }
+                if (!disconnected)
+                    timeoutMs = static_cast<int>((kDrainTimeout - waited).count()) + 1;
+            } else if (request.timeout.count() > 0) {
+                const auto left = std::chrono::duration_cast<std::chrono::milliseconds>(received + request.timeout - now);
+                timeoutMs = static_cast<int>(std::max<std::chrono::milliseconds::rep>(left.count(), 0)) + 1;
+            }
+
+            pollfd events[2] = {{donePipe[0], POLLIN, 0}, {disconnected ? -1 : fd, static_cast<short>(inputClosed ? 0 : POLLIN), 0}};
+            if (::poll(events, 2, timeoutMs) < 0)
+                continue;
+            if (events[0].revents & POLLIN) {
+                char done;
+                finished = ::read(donePipe[0], &done, 1) == 1;
+            }
+            if (events[1].revents & POLLIN) {
+                char chunk[4096];
+                const ssize_t n = ::read(fd, chunk, sizeof(chunk));
+                if (n > 0) {
+                    connection.inbox.append(chunk, static_cast<std::size_t>(n));
+                    // Take the cancel lines out; anything else is the client's next request.
+                    std::string kept;
+                    std::size_t start = 0;
+                    for (std::size_t newline; (newline = connection.inbox.find('\n', start)) != std::string::npos;
+                         start = newline + 1) {
+                        const std::string_view line(connection.inbox.data() + start, newline - start);
+                        if (line == "cancel")
+                            token->cancel();
+                        else
+                            kept.append(line).push_back('\n');
+                    }
+                    kept.append(connection.inbox, start);
+                    connection.inbox = std::move(kept);
+                    if (connection.inbox.size() > kMaxRequestLength)
+                        inputClosed = true;
+                } else if (n == 0) {
+                    inputClosed = true;     // Half-closed: the client may still read the results.
+                } else if (errno != EINTR) {
+                    disconnected = true;
+                }
+            } else if (events[1].revents & (POLLHUP | POLLERR | POLLNVAL)) {
+                disconnected = true;
+            }
+            if (disconnected)
+                token->cancel();
+        }
+
+        writer.finish();
+        matches = sink.matches();
+    }
+    std::fclose(out);
+    ::close(donePipe[0]);
+    ::close(donePipe[1]);
+    {
+        std::lock_guard<std::mutex> lock(connection.mutex);
+        connection.token.reset();
+    }
+
+    if (disconnected) {
+        connection.disconnected = true;
+        return;
+    }
+    std::string status;
+    if (token->deadlineExpired())
+        status = "cancelled\tdeadline\n";
+    else if (token->cancelled())
+        status = stopping_.load() ? "cancelled\tshutdown\n" : "cancelled\tclient\n";
+    else
+        status = "done\t" + std::to_string(matches) + '\n';
+    connection.disconnected = !sendAll(fd, status);
+#else
+    (void)connection;
+    (void)request;
+#endif
+}
+
+/**
+ * @brief Searches one file in ranges of kRangeSize, stopping between ranges once cancelled.
+ *
+ * Files that vanished since the last walk are skipped silently. Binary files are handled
+ * according to the policy; UTF-16 files are left to a TextFileSearcher, which transcodes them,
+ * and compressed files (if the request asks for it) to a CompressedFileSearcher. Those are
+ * searched as a whole.
+ */
+void SearchDaemon::searchFile(const std::string& path, const CompiledPattern& pattern, const DaemonRequest& request,
+                              const CancellationToken& token, ResultSink& sink) {
+    const std::shared_ptr<const FileBuffer> buffer = mapFile(path);
+    if (!buffer)
+        return;
+
+    const std::string_view text = buffer->view();
+    const BinaryPolicy binaryPolicy = request.binaryPolicy;
+    if (request.decompress &&
+        CompressedFileSearcher::isSupported(CompressedFileSearcher::detectCompression(text))) {
+        CompressedFileSearcher(binaryPolicy).searchContents(path, text, pattern, sink);
+        return;
+    }
+    const TextEncoding encoding = detectEncoding(text);
+    if (encoding == TextEncoding::Binary && binaryPolicy != BinaryPolicy::Text) {
+        if (binaryPolicy == BinaryPolicy::Report && containsMatch(text, pattern)) {
+            std::vector<SearchResult> results(1);
+            results[0].path = path;
+            results[0].binary = true;
+            sink.consume(results, "");
+        }
+        return;
+    }
+    if (encoding == TextEncoding::Utf16LE || encoding == TextEncoding::Utf16BE) {
+        TextFileSearcher(binaryPolicy).searchContents(path, text, pattern, sink);
+        return;
+    }
+
+    std::vector<SearchResult> results;
+    std::size_t lineNumber = 1;
+    for (std::size_t start = 0; start < text.size() && !token.cancelled();) {
+        std::size_t end = text.size();
+        if (text.size() - start > kRangeSize) {
+            const std::size_t newline = text.find('\n', start + kRangeSize - 1);
+            end = newline == std::string_view::npos ? text.size() : newline + 1;
+        }
+        const std::string_view range = text.substr(start, end - start);
+        searcher_.searchRange(path, range, lineNumber, start, pattern, results);
+        if (!results.empty()) {
+            sink.consume(results, "");
+            results.clear();
+        }
+        if (end < text.size())
+            lineNumber += static_cast<std::size_t>(std::count(range.begin(), range.end(), '\n'));
+        start = end;
+    }
+}
+
+/**
+ * @brief The contents of a file, from the mapping cache if it is unchanged since it was mapped.
+ *
+ * Only memory-mapped files are cached: small files are read into heap buffers, which are
+ * cheap to read again from the page cache and would cost real memory to keep.
+ */
+std::shared_ptr<const FileBuffer> SearchDaemon::mapFile(const std::string& path) {
+#ifdef _WIN32
+    auto buffer = std::make_shared<FileBuffer>();
+    return buffer->open(path) ? buffer : nullptr;
+#else
+    struct stat status;
+    if (::stat(path.c_str(), &status) != 0 || !S_ISREG(status.st_mode))
+        return nullptr;
+    const auto size = static_cast<std::int64_t>(status.st_size);
+    const std::int64_t modificationTime =
+        static_cast<std::int64_t>(status.st_mtim.tv_sec) * 1000000000 + status.st_mtim.tv_nsec;
+
+    {
+        std::lock_guard<std::mutex> lock(cacheMutex_);
+        const auto found = cacheIndex_.find(path);
+        if (found != cacheIndex_.end()) {
+            const auto entry = found->second;
+            if (entry->size == size && entry->modificationTime == modificationTime) {
+                cache_.splice(cache_.begin(), cache_, entry);
+                return entry->buffer;
+            }
+            cachedBytes_ -= entry->buffer->size();
+            cacheIndex_.erase(found);
+            cache_.erase(entry);
+        }
+    }
+
+    auto buffer = std::make_shared<FileBuffer>();
+    if (!buffer->open(path)) {
+        std::lock_guard<std::mutex> lock(TextFileSearcher::coutMutex);
+        std::cerr << "Error: Could not open file: " << path << std::endl;
+        return nullptr;
+    }
+    if (buffer->source() != FileBuffer::Source::Mapped || buffer->size() > mappingBudget_)
+        return buffer;
+
+    std::lock_guard<std::mutex> lock(cacheMutex_);
+    if (cacheIndex_.count(path) > 0)
+        return buffer;      // Mapped by a concurrent search meanwhile.
+    cache_.push_front({path, buffer, size, modificationTime});
+    cacheIndex_.emplace(path, cache_.begin());
+    cachedBytes_ += buffer->size();
+    while (cachedBytes_ > mappingBudget_) {
+        cachedBytes_ -= cache_.back().buffer->size();
+        cacheIndex_.erase(cache_.back().path);
+        cache_.pop_back();
+    }
+    return buffer;
+#endif
+}
+
+std::optional<std::size_t> SearchDaemon::query(const std::filesystem::path& socketPath, const DaemonRequest& request,
+                                                ResultSink& sink, std::string& error) {
+#ifdef _WIN32
+    (void)socketPath;
+    (void)request;
+    (void)sink;
+    error = "The search daemon needs Unix domain sockets";
+    return std::nullopt;
+#else
+    const int fd = connectTo(socketPath, error);
+    if (fd < 0)
+        return std::nullopt;
+    if (!sendAll(fd, request.encode() + '\n')) {
+        error = "Could not send the request to " + socketPath.string();
+        ::close(fd);
+        return std::nullopt;
+    }
+
+    std::optional<std::size_t> answer;
+    bool finished = false;
+    std::vector<SearchResult> batch;
+    std::string inbox;
+    std::string line;
+    while (!finished && readLine(fd, inbox, line, std::numeric_limits<std::size_t>::max())) {
+        const std::vector<std::string_view> fields = splitFields(line);
+        if (fields[0] == "binary" && fields.size() == 2) {
+            SearchResult result;
+            result.path = unescapeField(fields[1]);
+            result.binary = true;
+            if (!batch.empty()) {
+                sink.consume(batch, "");
+                batch.clear();
+            }
+            batch.push_back(std::move(result));
+            continue;
+        }
+        if (fields[0] == "match" && fields.size() == 6) {
+            SearchResult result;
+            result.path = unescapeField(fields[1]);
+            parseNumber(fields[2], result.lineNumber);
+            parseNumber(fields[3], result.byteOffset);
+            if (!fields[4].empty()) {
+                for (const std::string_view span : splitFields(fields[4], ',')) {
+                    const std::size_t colon = span.find(':');
+                    MatchSpan matchSpan;
+                    if (colon != std::string_view::npos && parseNumber(span.substr(0, colon), matchSpan.position) &&
+                        parseNumber(span.substr(colon + 1), matchSpan.length))
+                        result.spans.push_back(matchSpan);
+                }
+            }
+            result.line = unescapeField(fields[5]);
+            if (!batch.empty() &&
+                (batch.back().path != result.path || batch.size() >= TextFileSearcher::kResultBatchSize)) {
+                sink.consume(batch, "");
+                batch.clear();
+            }
+            batch.push_back(std::move(result));
+            continue;
+        }
+
+        finished = true;
+        std::size_t number = 0;
+        if (fields[0] == "done" && fields.size() == 2 && parseNumber(fields[1], number))
+            answer = number;
+        else if (fields[0] == "cancelled" && fields.size() == 2)
+            error = "Search cancelled (" + std::string(fields[1]) + ")";
+        else if (fields[0] == "error" && fields.size() == 2)
+            error = unescapeField(fields[1]);
+        else
+            error = "Unexpected response - " + line.substr(0, 80);
+    }
+    if (!batch.empty())
+        sink.consume(batch, "");
+    if (!finished)
+        error = "The daemon closed the connection";
+    ::close(fd);
+    return answer;
+#endif
+}
@@ -0,0 +1,155 @@
+#include "searchStats.hpp"
+#include <iomanip>
+
+std::atomic<SearchStats*> SearchStats::active_{nullptr};
+
+namespace {
+
+/// Bumped by every start(), so no thread mistakes blocks of an earlier search for current ones.
+std::atomic<std::uint64_t> nextGeneration{1};
+
+/// The block of counters the calling thread records into, and the search it belongs to.
+thread_local void* localCounters = nullptr;
+thread_local std::uint64_t localGeneration = 0;
+
+constexpr const char* kNames[SearchStats::kCounters] = {
+    "directories_read", "files_walked", "walk_ns", "files_searched", "bytes_read", "open_ns",
+    "read_ns", "line_count_ns", "literal_bytes", "literal_match_ns", "regex_bytes", "regex_match_ns",
+    "regex_lines_verified", "matched_lines", "decompress_ns", "output_ns", "output_wait_ns",
+    "write_ns", "memory_wait_ns",
+};
+
+struct Milliseconds {
+    std::uint64_t ns;
+};
+
+std::ostream& operator<<(std::ostream& out, Milliseconds time) {
+    return out << std::fixed << std::setprecision(1) << static_cast<double>(time.ns) / 1e6 << " ms";
+}
+
+struct Mebibytes {
+    std::uint64_t bytes;
+};
+
+std::ostream& operator<<(std::ostream& out, Mebibytes size) {
+    return out << std::fixed << std::setprecision(1) << static_cast<double>(size.bytes) / (1024.0 * 1024.0)
+               << " MiB";
+}
+
+/// Throughput of a matching engine, or nothing when it did not run.
+struct Throughput {
+    std::uint64_t bytes;
+    std::uint64_t ns;
+};
+
+std::ostream& operator<<(std::ostream& out, Throughput rate) {
+    if (rate.ns == 0)
+        return out;
+    const double perSecond = static_cast<double>(rate.bytes) / (1024.0 * 1024.0) / (static_cast<double>(rate.ns) / 1e9);
+    return out << " (" << std::fixed << std::setprecision(1) << perSecond << " MiB/s)";
+}
+
+}  // namespace
+
+/**
+ * @brief Discards earlier counts and starts collecting from every thread.
+ */
+void SearchStats::start() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        threads_.clear();
+        generation_ = nextGeneration.fetch_add(1, std::memory_order_relaxed);
+        elapsed_ = std::chrono::nanoseconds(0);
+    }
+    started_ = Clock::now();
+    active_.store(this, std::memory_order_release);
+}
+
+/**
+ * @brief Stops collecting and records the wall time since start().
+ */
+void SearchStats::stop() {
+    SearchStats* self = this;
+    if (active_.compare_exchange_strong(self, nullptr, std::memory_order_acq_rel))
+        elapsed_ = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - started_);
+}
+
+/**
+ * @brief The block of the calling thread; registers one on the thread's first use in this search.
+ */
+SearchStats::ThreadCounters* SearchStats::countersOfThisThread() {
+    if (localGeneration == generation_)
+        return static_cast<ThreadCounters*>(localCounters);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    localCounters = &threads_.emplace_back();
+    localGeneration = generation_;
+    return static_cast<ThreadCounters*>(localCounters);
+}
+
+/**
+ * @brief The sum of a counter over all threads.
+ */
+std::uint64_t SearchStats::total(Counter counter) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::uint64_t sum = 0;
+    for (const auto& counters : threads_)
+        sum += counters.values[index(counter)];
+    return sum;
+}
+
+/**
+ * @brief The number of threads that recorded anything.
+ */
+std::size_t SearchStats::threads() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return threads_.size();
+}
+
+const char* SearchStats::name(Counter counter) {
+    return kNames[index(counter)];
+}
+
+/**
+ * @brief Writes a readable report, a few lines grouped by stage.
+ */
+void SearchStats::print(std::ostream& out) const {
+    std::array<std::uint64_t, kCounters> totals{};
+    for (std::size_t i = 0; i < kCounters; ++i)
+        totals[i] = total(static_cast<Counter>(i));
+    const auto at = [&totals](Counter counter) { return totals[index(counter)]; };
+
+    const auto flags = out.flags();
+    const auto precision = out.precision();
+    out << "Search statistics: " << Milliseconds{static_cast<std::uint64_t>(elapsed_.count())} << " wall time, "
+        << threads() << " thread(s); times are summed over threads\n"
+        << "  walk:       " << at(Counter::DirectoriesRead) << " directories, " << at(Counter::FilesWalked)
+        << " files in " << Milliseconds{at(Counter::WalkNs)} << "\n"
+        << "  files:      " << at(Counter::FilesSearched) << " searched, " << Mebibytes{at(Counter::BytesRead)}
+        << " read; open " << Milliseconds{at(Counter::OpenNs)} << ", read " << Milliseconds{at(Counter::ReadNs)}
+        << ", count lines " << Milliseconds{at(Counter::LineCountNs)} << "\n"
+        << "  literal:    " << Mebibytes{at(Counter::LiteralBytes)} << " in " << Milliseconds{at(Counter::LiteralMatchNs)}
+        << Throughput{at(Counter::LiteralBytes), at(Counter::LiteralMatchNs)} << "\n"
+        << "  regex:      " << Mebibytes{at(Counter::RegexBytes)} << " in " << Milliseconds{at(Counter::RegexMatchNs)}
+        << Throughput{at(Counter::RegexBytes), at(Counter::RegexMatchNs)} << ", "
+        << at(Counter::RegexLinesVerified) << " lines verified\n"
+        << "  matched:    " << at(Counter::MatchedLines) << " lines\n";
+    if (at(Counter::DecompressNs) > 0)
+        out << "  decompress: " << Milliseconds{at(Counter::DecompressNs)} << "\n";
+    out << "  output:     format " << Milliseconds{at(Counter::OutputNs)} << ", wait "
+        << Milliseconds{at(Counter::OutputWaitNs)} << ", write " << Milliseconds{at(Counter::WriteNs)} << "\n";
+    if (at(Counter::MemoryWaitNs) > 0)
+        out << "  memory:     wait " << Milliseconds{at(Counter::MemoryWaitNs)} << " for the limit\n";
+    out.flags(flags);
+    out.precision(precision);
+}
+
+/**
+ * @brief Writes the report as one JSON object: wall time, threads and every counter.
+ */
+void SearchStats::printJson(std::ostream& out) const {
+    out << "{\"wall_ns\":" << elapsed_.count() << ",\"threads\":" << threads();
+    for (std::size_t i = 0; i < kCounters; ++i)
+        out << ",\"" << kNames[i] << "\":" << total(static_cast<Counter>(i));
+    out << "}\n";
+}
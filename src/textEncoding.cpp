@@ -0,0 +1,93 @@
+#include "textEncoding.hpp"
+#include <cstring>
+
+namespace {
+
+void appendUtf8(std::uint32_t codePoint, std::string& output) {
+    if (codePoint < 0x80) {
+        output += static_cast<char>(codePoint);
+    } else if (codePoint < 0x800) {
+        output += static_cast<char>(0xC0 | (codePoint >> 6));
+        output += static_cast<char>(0x80 | (codePoint & 0x3F));
+    } else if (codePoint < 0x10000) {
+        output += static_cast<char>(0xE0 | (codePoint >> 12));
+        output += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+        output += static_cast<char>(0x80 | (codePoint & 0x3F));
+    } else {
+        output += static_cast<char>(0xF0 | (codePoint >> 18));
+        output += static_cast<char>(0x80 | ((codePoint >> 12) & 0x3F));
+        output += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+        output += static_cast<char>(0x80 | (codePoint & 0x3F));
+    }
+}
+
+constexpr std::uint32_t kReplacementCharacter = 0xFFFD;
+
+}  // namespace
+
+TextEncoding detectEncoding(std::string_view head) {
+    if (head.size() >= 2) {
+        const auto first = static_cast<unsigned char>(head[0]);
+        const auto second = static_cast<unsigned char>(head[1]);
+        if (first == 0xFF && second == 0xFE)
+            return TextEncoding::Utf16LE;
+        if (first == 0xFE && second == 0xFF)
+            return TextEncoding::Utf16BE;
+    }
+    const std::size_t size = head.size() < kEncodingSniffSize ? head.size() : kEncodingSniffSize;
+    return std::memchr(head.data(), '\0', size) ? TextEncoding::Binary : TextEncoding::Text;
+}
+
+void Utf16Decoder::decode(std::string_view input, std::string& output) {
+    output.reserve(output.size() + input.size());
+    std::size_t i = 0;
+    if (pendingByte_ >= 0 && !input.empty()) {
+        const auto second = static_cast<unsigned char>(input[0]);
+        const auto first = static_cast<unsigned char>(pendingByte_);
+        emit(static_cast<std::uint16_t>(bigEndian_ ? (first << 8) | second : (second << 8) | first), output);
+        pendingByte_ = -1;
+        i = 1;
+    }
+    for (; i + 1 < input.size(); i += 2) {
+        const auto a = static_cast<unsigned char>(input[i]);
+        const auto b = static_cast<unsigned char>(input[i + 1]);
+        const auto unit = static_cast<std::uint16_t>(bigEndian_ ? (a << 8) | b : (b << 8) | a);
+        if (unit < 0x80 && highSurrogate_ == 0 && started_)
+            output += static_cast<char>(unit);      // ASCII: the common case.
+        else
+            emit(unit, output);
+    }
+    if (i < input.size())
+        pendingByte_ = static_cast<unsigned char>(input[i]);
+}
+
+void Utf16Decoder::emit(std::uint16_t unit, std::string& output) {
+    if (!started_) {
+        started_ = true;
+        if (unit == 0xFEFF)
+            return;
+    }
+    if (highSurrogate_ != 0) {
+        if (unit >= 0xDC00 && unit <= 0xDFFF) {
+            appendUtf8(0x10000 + ((static_cast<std::uint32_t>(highSurrogate_) - 0xD800) << 10) + (unit - 0xDC00),
+                       output);
+            highSurrogate_ = 0;
+            return;
+        }
+        appendUtf8(kReplacementCharacter, output);
+        highSurrogate_ = 0;
+    }
+    if (unit >= 0xD800 && unit <= 0xDBFF)
+        highSurrogate_ = unit;
+    else if (unit >= 0xDC00 && unit <= 0xDFFF)
+        appendUtf8(kReplacementCharacter, output);
+    else
+        appendUtf8(unit, output);
+}
+
+void Utf16Decoder::finish(std::string& output) {
+    if (highSurrogate_ != 0 || pendingByte_ >= 0)
+        appendUtf8(kReplacementCharacter, output);
+    highSurrogate_ = 0;
+    pendingByte_ = -1;
+}
@@ -0,0 +1,504 @@
+#include "trigramIndex.hpp"
+#include "compiledPattern.hpp"
+#include "directoryWalker.hpp"
+#include "textEncoding.hpp"
+#include "workStealingPool.hpp"
+#include <algorithm>
+#include <array>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <iterator>
+#include <mutex>
+#include <unordered_map>
+
+namespace {
+
+constexpr char kMagic[8] = {'T', 'R', 'I', 'G', 'R', 'A', 'M', 'X'};
+constexpr std::uint32_t kVersion = 2;    ///< 2: UTF-16 files are indexed as their UTF-8 text.
+constexpr std::uint32_t kByteOrderMark = 0x01020304;
+
+/// Number of possible trigram keys (three bytes).
+constexpr std::size_t kTrigramSpace = std::size_t{1} << 24;
+
+constexpr std::array<unsigned char, 256> makeFoldTable() {
+    std::array<unsigned char, 256> table{};
+    for (std::size_t b = 0; b < 256; ++b)
+        table[b] = static_cast<unsigned char>(b >= 'A' && b <= 'Z' ? b + ('a' - 'A') : b);
+    return table;
+}
+
+constexpr std::array<unsigned char, 256> kFold = makeFoldTable();
+
+std::size_t alignUp(std::size_t offset) {
+    return (offset + 7) & ~std::size_t{7};
+}
+
+void appendVarint(std::string& out, std::uint32_t value) {
+    while (value >= 0x80) {
+        out += static_cast<char>((value & 0x7F) | 0x80);
+        value >>= 7;
+    }
+    out += static_cast<char>(value);
+}
+
+/// A posting list being built; file ids arrive in increasing order.
+struct PostingBuilder {
+    std::string bytes;
+    std::uint32_t last = 0;
+    std::uint32_t count = 0;
+
+    void add(std::uint32_t fileId) {
+        appendVarint(bytes, fileId - last);
+        last = fileId;
+        ++count;
+    }
+};
+
+/// Per-worker scratch for collecting the distinct trigrams of a file.
+struct TrigramSet {
+    std::vector<std::uint64_t> seen = std::vector<std::uint64_t>(kTrigramSpace / 64);
+
+    std::vector<std::uint32_t> collect(std::string_view text) {
+        std::vector<std::uint32_t> keys;
+        if (text.size() < 3)
+            return keys;
+        const auto* bytes = reinterpret_cast<const unsigned char*>(text.data());
+        std::uint32_t key = (std::uint32_t{kFold[bytes[0]]} << 8) | kFold[bytes[1]];
+        for (std::size_t i = 2; i < text.size(); ++i) {
+            key = ((key << 8) | kFold[bytes[i]]) & (kTrigramSpace - 1);
+            std::uint64_t& word = seen[key >> 6];
+            const std::uint64_t bit = std::uint64_t{1} << (key & 63);
+            if (!(word & bit)) {
+                word |= bit;
+                keys.push_back(key);
+            }
+        }
+        for (std::uint32_t k : keys)
+            seen[k >> 6] = 0;
+        std::sort(keys.begin(), keys.end());
+        return keys;
+    }
+};
+
+/// Distinct trigram keys of a literal, or none if it has no usable trigram.
+std::vector<std::uint32_t> literalTrigrams(std::string_view literal, bool caseSensitive) {
+    std::vector<std::uint32_t> keys;
+    for (std::size_t i = 0; i + 3 <= literal.size(); ++i) {
+        const auto a = static_cast<unsigned char>(literal[i]);
+        const auto b = static_cast<unsigned char>(literal[i + 1]);
+        const auto c = static_cast<unsigned char>(literal[i + 2]);
+        if (!caseSensitive) {
+            // Non-ASCII characters may fold to other byte sequences, and KELVIN SIGN and
+            // LONG S fold to 'k' and 's': only trigrams free of those are certain.
+            auto certain = [](unsigned char byte) {
+                return byte < 0x80 && kFold[byte] != 'k' && kFold[byte] != 's';
+            };
+            if (!certain(a) || !certain(b) || !certain(c))
+                continue;
+        }
+        keys.push_back(TrigramIndex::trigramKey(a, b, c));
+    }
+    std::sort(keys.begin(), keys.end());
+    keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+    return keys;
+}
+
+}  // namespace
+
+struct TrigramIndex::Header {
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t byteOrder;
+    std::uint64_t fileCount;
+    std::uint64_t trigramCount;
+    std::uint64_t filesOffset;
+    std::uint64_t pathsOffset;
+    std::uint64_t pathsSize;
+    std::uint64_t trigramsOffset;
+    std::uint64_t postingsOffset;
+    std::uint64_t postingsSize;
+    std::uint64_t rootOffset;       ///< Within the path bytes.
+    std::uint64_t rootLength;
+};
+
+struct TrigramIndex::FileEntry {
+    std::uint64_t size;
+    std::int64_t modificationTime;
+    std::uint64_t pathOffset;       ///< Within the path bytes.
+    std::uint64_t pathLength;
+};
+
+struct TrigramIndex::TrigramEntry {
+    std::uint32_t trigram;
+    std::uint32_t fileCount;
+    std::uint64_t postingsOffset;   ///< Within the posting lists.
+};
+
+/**
+ * @brief Trigram key of three bytes, with ASCII letters folded to lower case.
+ */
+std::uint32_t TrigramIndex::trigramKey(unsigned char a, unsigned char b, unsigned char c) {
+    return (std::uint32_t{kFold[a]} << 16) | (std::uint32_t{kFold[b]} << 8) | kFold[c];
+}
+
+/**
+ * @brief Modification time of a file as stored in the index (0 if it cannot be read).
+ */
+std::int64_t TrigramIndex::modificationTime(const std::filesystem::path& filePath) {
+    std::error_code ec;
+    const auto time = std::filesystem::last_write_time(filePath, ec);
+    return ec ? 0 : static_cast<std::int64_t>(time.time_since_epoch().count());
+}
+
+/**
+ * @brief Indexes the tree below root and writes the index file.
+ *
+ * Files are sorted by relative path (their id is their rank) and read in batches on a
+ * WorkStealingPool; each batch's trigram sets are merged into the posting lists in id order,
+ * so the lists come out sorted and only the compressed lists stay in memory.
+ */
+std::optional<std::size_t> TrigramIndex::build(const std::filesystem::path& root,
+                                               const std::filesystem::path& indexFile,
+                                               std::size_t numThreads, bool followSymlinks,
+                                               std::shared_ptr<const PathFilter> filter) {
+    std::error_code ec;
+    const std::filesystem::path canonicalRoot = std::filesystem::canonical(root, ec);
+    if (ec || !std::filesystem::is_directory(canonicalRoot)) {
+        std::cerr << "Error: Invalid directory - " << root << std::endl;
+        return std::nullopt;
+    }
+
+    struct Found {
+        std::filesystem::path path;
+        std::string relative;
+    };
+    std::vector<Found> found;
+    std::mutex foundMutex;
+    DirectoryWalker walker(numThreads, followSymlinks);
+    walker.setFilter(std::move(filter));
+    walker.walk(
+        root,
+        [&](std::filesystem::path file) {
+            std::string relative = file.lexically_relative(root).generic_string();
+            std::lock_guard<std::mutex> lock(foundMutex);
+            found.push_back({std::move(file), std::move(relative)});
+        },
+        [&](const std::filesystem::path& path, std::error_code error) {
+            std::lock_guard<std::mutex> lock(foundMutex);
+            std::cerr << "Error: Could not read directory: " << path << " (" << error.message() << ")" << std::endl;
+        });
+    std::sort(found.begin(), found.end(), [](const Found& a, const Found& b) { return a.relative < b.relative; });
+
+    struct Indexed {
+        bool ok = false;
+        FileEntry entry{};
+        std::vector<std::uint32_t> trigrams;
+    };
+
+    WorkStealingPool pool(numThreads);
+    std::vector<TrigramSet> scratch(pool.size());
+    std::unordered_map<std::uint32_t, PostingBuilder> postings;
+    std::vector<FileEntry> entries;
+    std::string paths;
+
+    for (std::size_t start = 0; start < found.size(); start += kBuildBatchSize) {
+        std::vector<Indexed> batch(std::min(kBuildBatchSize, found.size() - start));
+        for (std::size_t i = 0; i < batch.size(); ++i) {
+            pool.submit([&, i](std::size_t worker) {
+                const std::filesystem::path& path = found[start + i].path;
+                Indexed& indexed = batch[i];
+                // Size and time are taken before reading: a change during the read makes the
+                // entry stale rather than wrong.
+                std::error_code sizeError;
+                indexed.entry.size = std::filesystem::file_size(path, sizeError);
+                indexed.entry.modificationTime = modificationTime(path);
+                FileBuffer buffer;
+                if (sizeError || !buffer.open(path)) {
+                    std::lock_guard<std::mutex> lock(foundMutex);
+                    std::cerr << "Error: Could not open file: " << path << std::endl;
+                    return;
+                }
+                std::string_view text = buffer.view();
+                std::string transcoded;
+                const TextEncoding encoding = detectEncoding(text);
+                if (encoding == TextEncoding::Utf16LE || encoding == TextEncoding::Utf16BE) {
+                    // The search matches the UTF-8 text it transcodes the file to, not its bytes.
+                    Utf16Decoder decoder(encoding == TextEncoding::Utf16BE);
+                    decoder.decode(text, transcoded);
+                    decoder.finish(transcoded);
+                    text = transcoded;
+                }
+                indexed.trigrams = scratch[worker].collect(text);
+                indexed.ok = true;
+            });
+        }
+        pool.wait();
+
+        for (std::size_t i = 0; i < batch.size(); ++i) {
+            if (!batch[i].ok)
+                continue;
+            const auto fileId = static_cast<std::uint32_t>(entries.size());
+            FileEntry entry = batch[i].entry;
+            entry.pathOffset = paths.size();
+            entry.pathLength = found[start + i].relative.size();
+            paths += found[start + i].relative;
+            entries.push_back(entry);
+            for (std::uint32_t trigram : batch[i].trigrams)
+                postings[trigram].add(fileId);
+        }
+    }
+
+    std::vector<std::uint32_t> keys;
+    keys.reserve(postings.size());
+    for (const auto& [key, posting] : postings)
+        keys.push_back(key);
+    std::sort(keys.begin(), keys.end());
+
+    Header header{};
+    std::memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.version = kVersion;
+    header.byteOrder = kByteOrderMark;
+    header.fileCount = entries.size();
+    header.trigramCount = keys.size();
+    header.rootOffset = paths.size();
+    header.rootLength = canonicalRoot.string().size();
+    paths += canonicalRoot.string();
+    header.filesOffset = alignUp(sizeof(Header));
+    header.pathsOffset = header.filesOffset + entries.size() * sizeof(FileEntry);
+    header.pathsSize = paths.size();
+    header.trigramsOffset = alignUp(header.pathsOffset + paths.size());
+    header.postingsOffset = header.trigramsOffset + keys.size() * sizeof(TrigramEntry);
+
+    std::vector<TrigramEntry> table;
+    table.reserve(keys.size());
+    std::uint64_t postingsSize = 0;
+    for (std::uint32_t key : keys) {
+        const PostingBuilder& posting = postings[key];
+        table.push_back({key, posting.count, postingsSize});
+        postingsSize += posting.bytes.size();
+    }
+    header.postingsSize = postingsSize;
+
+    std::filesystem::path temporary = indexFile;
+    temporary += ".tmp";
+    std::FILE* out = std::fopen(temporary.c_str(), "wb");
+    if (!out) {
+        std::cerr << "Error: Could not write index: " << temporary << std::endl;
+        return std::nullopt;
+    }
+    bool ok = true;
+    std::size_t written = 0;
+    auto write = [&](const void* data, std::size_t size) {
+        ok = ok && std::fwrite(data, 1, size, out) == size;
+        written += size;
+    };
+    auto padTo = [&](std::size_t offset) {
+        static const char zeros[8] = {};
+        write(zeros, offset - written);
+    };
+    write(&header, sizeof(header));
+    padTo(header.filesOffset);
+    write(entries.data(), entries.size() * sizeof(FileEntry));
+    write(paths.data(), paths.size());
+    padTo(header.trigramsOffset);
+    write(table.data(), table.size() * sizeof(TrigramEntry));
+    for (std::uint32_t key : keys)
+        write(postings[key].bytes.data(), postings[key].bytes.size());
+    ok = std::fclose(out) == 0 && ok;
+
+    if (ok)
+        std::filesystem::rename(temporary, indexFile, ec);
+    if (!ok || ec) {
+        std::cerr << "Error: Could not write index: " << indexFile << std::endl;
+        std::filesystem::remove(temporary, ec);
+        return std::nullopt;
+    }
+    return entries.size();
+}
+
+/**
+ * @brief Opens an index file and checks that its tables lie within it.
+ */
+bool TrigramIndex::open(const std::filesystem::path& indexFile) {
+    fileCount_ = trigramCount_ = postingsSize_ = 0;
+    files_ = paths_ = trigrams_ = postings_ = nullptr;
+    root_.clear();
+    error_.clear();
+
+    if (!buffer_.open(indexFile)) {
+        error_ = "cannot read " + indexFile.string();
+        return false;
+    }
+    const std::string_view data = buffer_.view();
+    Header header{};
+    if (data.size() < sizeof(Header)) {
+        error_ = "not a trigram index: " + indexFile.string();
+        return false;
+    }
+    std::memcpy(&header, data.data(), sizeof(Header));
+    if (std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0) {
+        error_ = "not a trigram index: " + indexFile.string();
+        return false;
+    }
+    if (header.version != kVersion || header.byteOrder != kByteOrderMark) {
+        error_ = "unsupported index version or byte order: " + indexFile.string();
+        return false;
+    }
+
+    auto fits = [&](std::uint64_t offset, std::uint64_t count, std::uint64_t size) {
+        return offset <= data.size() && count <= (data.size() - offset) / size;
+    };
+    if (!fits(header.filesOffset, header.fileCount, sizeof(FileEntry)) ||
+        !fits(header.pathsOffset, header.pathsSize, 1) ||
+        !fits(header.trigramsOffset, header.trigramCount, sizeof(TrigramEntry)) ||
+        !fits(header.postingsOffset, header.postingsSize, 1) ||
+        header.rootOffset > header.pathsSize || header.rootLength > header.pathsSize - header.rootOffset) {
+        error_ = "truncated or corrupt index: " + indexFile.string();
+        return false;
+    }
+
+    fileCount_ = header.fileCount;
+    trigramCount_ = header.trigramCount;
+    files_ = data.data() + header.filesOffset;
+    paths_ = data.data() + header.pathsOffset;
+    trigrams_ = data.data() + header.trigramsOffset;
+    postings_ = data.data() + header.postingsOffset;
+    postingsSize_ = header.postingsSize;
+    pathsSize_ = header.pathsSize;
+    root_ = std::string(paths_ + header.rootOffset, header.rootLength);
+    return true;
+}
+
+TrigramIndex::FileEntry TrigramIndex::fileEntry(std::size_t fileId) const {
+    FileEntry entry;
+    std::memcpy(&entry, files_ + fileId * sizeof(FileEntry), sizeof(FileEntry));
+    return entry;
+}
+
+std::string_view TrigramIndex::filePath(std::size_t fileId) const {
+    const FileEntry entry = fileEntry(fileId);
+    if (entry.pathOffset > pathsSize_ || entry.pathLength > pathsSize_ - entry.pathOffset)
+        return {};
+    return {paths_ + entry.pathOffset, entry.pathLength};
+}
+
+/**
+ * @brief Id of the file at a path relative to the root (binary search), or npos.
+ */
+std::size_t TrigramIndex::findFile(std::string_view relativePath) const {
+    std::size_t low = 0;
+    std::size_t high = fileCount_;
+    while (low < high) {
+        const std::size_t middle = low + (high - low) / 2;
+        if (filePath(middle) < relativePath)
+            low = middle + 1;
+        else
+            high = middle;
+    }
+    return low < fileCount_ && filePath(low) == relativePath ? low : std::string_view::npos;
+}
+
+/**
+ * @brief Whether a file still has the size and modification time it was indexed with.
+ */
+bool TrigramIndex::isFresh(std::size_t fileId, const std::filesystem::path& filePath) const {
+    const FileEntry entry = fileEntry(fileId);
+    std::error_code ec;
+    const auto size = std::filesystem::file_size(filePath, ec);
+    return !ec && size == entry.size && modificationTime(filePath) == entry.modificationTime;
+}
+
+/**
+ * @brief Decodes the posting list of a trigram (empty if no file contains it).
+ */
+std::vector<std::uint32_t> TrigramIndex::postings(std::uint32_t trigram) const {
+    std::size_t low = 0;
+    std::size_t high = trigramCount_;
+    TrigramEntry entry{};
+    while (low < high) {
+        const std::size_t middle = low + (high - low) / 2;
+        std::memcpy(&entry, trigrams_ + middle * sizeof(TrigramEntry), sizeof(TrigramEntry));
+        if (entry.trigram < trigram)
+            low = middle + 1;
+        else
+            high = middle;
+    }
+    std::vector<std::uint32_t> ids;
+    if (low == trigramCount_)
+        return ids;
+    std::memcpy(&entry, trigrams_ + low * sizeof(TrigramEntry), sizeof(TrigramEntry));
+    if (entry.trigram != trigram)
+        return ids;
+
+    ids.reserve(entry.fileCount);
+    std::size_t offset = entry.postingsOffset;
+    std::uint32_t id = 0;
+    for (std::uint32_t i = 0; i < entry.fileCount && offset < postingsSize_; ++i) {
+        std::uint32_t delta = 0;
+        for (int shift = 0; offset < postingsSize_ && shift < 35; shift += 7) {
+            const auto byte = static_cast<unsigned char>(postings_[offset++]);
+            delta |= static_cast<std::uint32_t>(byte & 0x7F) << shift;
+            if (!(byte & 0x80))
+                break;
+        }
+        id += delta;
+        if (id >= fileCount_)
+            break;
+        ids.push_back(id);
+    }
+    return ids;
+}
+
+/**
+ * @brief Trigram sets, one per alternative, of which a matching file must contain one set fully.
+ *
+ * An empty set means the alternative could match without any known trigram.
+ */
+std::vector<std::vector<std::uint32_t>> TrigramIndex::requiredTrigrams(const CompiledPattern& pattern) {
+    std::vector<std::vector<std::uint32_t>> alternatives;
+    if (pattern.isPatternList()) {
+        for (const auto& literal : pattern.patterns())
+            alternatives.push_back(literalTrigrams(literal, pattern.caseSensitive()));
+    }
+    else if (!pattern.isRegex()) {
+        alternatives.push_back(literalTrigrams(pattern.query(), pattern.caseSensitive()));
+    }
+    else {
+        alternatives.push_back(literalTrigrams(pattern.requiredLiteral(), pattern.caseSensitive()));
+    }
+    return alternatives;
+}
+
+/**
+ * @brief The indexed files that may contain a match of the pattern.
+ *
+ * Each alternative's posting lists are intersected shortest first; the result is the union
+ * over the alternatives. An alternative without trigrams could match anywhere.
+ */
+std::optional<std::vector<bool>> TrigramIndex::candidates(const CompiledPattern& pattern) const {
+    if (!pattern.valid())
+        return std::nullopt;
+
+    std::vector<bool> result(fileCount_, false);
+    for (const auto& trigrams : requiredTrigrams(pattern)) {
+        if (trigrams.empty())
+            return std::nullopt;
+
+        std::vector<std::vector<std::uint32_t>> lists;
+        for (std::uint32_t trigram : trigrams)
+            lists.push_back(postings(trigram));
+        std::sort(lists.begin(), lists.end(),
+                  [](const auto& a, const auto& b) { return a.size() < b.size(); });
+
+        std::vector<std::uint32_t> ids = std::move(lists.front());
+        for (std::size_t i = 1; i < lists.size() && !ids.empty(); ++i) {
+            std::vector<std::uint32_t> both;
+            std::set_intersection(ids.begin(), ids.end(), lists[i].begin(), lists[i].end(), std::back_inserter(both));
+            ids = std::move(both);
+        }
+        for (std::uint32_t id : ids)
+            result[id] = true;
+    }
+    return result;
+}
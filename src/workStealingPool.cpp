@@ -0,0 +1,152 @@
+#include "workStealingPool.hpp"
+#include <algorithm>
+#include <utility>
+
+namespace {
+
+/// Pool and worker index of the calling thread, if it is a pool worker.
+thread_local const WorkStealingPool* currentPool = nullptr;
+thread_local std::size_t currentWorker = 0;
+
+}  // namespace
+
+/**
+ * @brief Starts the workers.
+ */
+WorkStealingPool::WorkStealingPool(std::size_t numThreads)
+    : started_(std::chrono::steady_clock::now()) {
+    numThreads = std::max<std::size_t>(numThreads, 1);
+    for (std::size_t i = 0; i < numThreads; ++i)
+        workers_.push_back(std::make_unique<Worker>());
+    for (std::size_t i = 0; i < numThreads; ++i)
+        threads_.emplace_back(&WorkStealingPool::run, this, i);
+}
+
+/**
+ * @brief Waits for queued tasks to finish, then stops and joins the workers.
+ */
+WorkStealingPool::~WorkStealingPool() {
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        allDone_.wait(lock, [this] { return pending_.load() == 0; });
+        stopping_ = true;
+    }
+    workAvailable_.notify_all();
+    for (auto& thread : threads_)
+        thread.join();
+}
+
+/**
+ * @brief Queues a task on the calling worker's deque, or round-robin from outside the pool.
+ *
+ * Only the worker's lock is taken, plus the pool's lock to wake a worker if one sleeps.
+ * queued_ is raised before the push, so the pop that takes the task never takes it below
+ * zero. A worker raises sleepers_ before it checks queued_ and sleeps, and this reads
+ * sleepers_ after raising queued_ (both sequentially consistent), so either the worker sees
+ * the task or this sees the worker and notifies it under the lock it waits with.
+ */
+void WorkStealingPool::submit(Task task) {
+    pending_.fetch_add(1);
+    const std::size_t target = currentPool == this
+                                   ? currentWorker
+                                   : nextWorker_.fetch_add(1, std::memory_order_relaxed) % workers_.size();
+    queued_.fetch_add(1);
+    {
+        Worker& worker = *workers_[target];
+        std::lock_guard<std::mutex> lock(worker.mutex);
+        worker.tasks.push_back(std::move(task));
+    }
+    if (sleepers_.load() > 0) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        workAvailable_.notify_one();
+    }
+}
+
+/**
+ * @brief Blocks until every submitted task has finished; rethrows the first task exception.
+ */
+void WorkStealingPool::wait() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    allDone_.wait(lock, [this] { return pending_.load() == 0; });
+    if (error_) {
+        std::exception_ptr error = std::exchange(error_, nullptr);
+        std::rethrow_exception(error);
+    }
+}
+
+std::vector<WorkStealingPool::WorkerStats> WorkStealingPool::stats() const {
+    std::vector<WorkerStats> result;
+    result.reserve(workers_.size());
+    for (const auto& worker : workers_)
+        result.push_back(worker->stats);
+    return result;
+}
+
+/**
+ * @brief Worker loop: own deque first, then steal, then sleep until work is queued.
+ */
+void WorkStealingPool::run(std::size_t index) {
+    currentPool = this;
+    currentWorker = index;
+    Worker& self = *workers_[index];
+
+    while (true) {
+        Task task;
+        if (popLocal(index, task) || steal(index, task)) {
+            const auto start = std::chrono::steady_clock::now();
+            try {
+                task(index);
+            }
+            catch (...) {
+                std::lock_guard<std::mutex> lock(mutex_);
+                if (!error_)
+                    error_ = std::current_exception();
+            }
+            self.stats.busy += std::chrono::steady_clock::now() - start;
+            ++self.stats.tasks;
+            finishTask();
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(mutex_);
+        sleepers_.fetch_add(1);
+        workAvailable_.wait(lock, [this] { return stopping_ || queued_.load() > 0; });
+        sleepers_.fetch_sub(1);
+        if (stopping_ && queued_.load() == 0)
+            return;
+    }
+}
+
+bool WorkStealingPool::popLocal(std::size_t index, Task& task) {
+    Worker& worker = *workers_[index];
+    std::lock_guard<std::mutex> lock(worker.mutex);
+    if (worker.tasks.empty())
+        return false;
+    task = std::move(worker.tasks.back());
+    worker.tasks.pop_back();
+    --queued_;
+    return true;
+}
+
+bool WorkStealingPool::steal(std::size_t thief, Task& task) {
+    for (std::size_t offset = 1; offset < workers_.size(); ++offset) {
+        Worker& victim = *workers_[(thief + offset) % workers_.size()];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (victim.tasks.empty())
+            continue;
+        task = std::move(victim.tasks.front());
+        victim.tasks.pop_front();
+        --queued_;
+        ++workers_[thief]->stats.stolen;
+        return true;
+    }
+    return false;
+}
+
+void WorkStealingPool::finishTask() {
+    if (pending_.fetch_sub(1) != 1)
+        return;
+    // Under the lock, so a waiter that just saw pending_ above zero is already waiting.
+    std::lock_guard<std::mutex> lock(mutex_);
+    allDone_.notify_all();
+}
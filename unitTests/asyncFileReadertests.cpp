@@ -0,0 +1,101 @@
+#include <gtest/gtest.h>
+#include "asyncFileReader.hpp"
+#include <cerrno>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <string>
+#include <vector>
+
+class AsyncFileReaderTest : public ::testing::TestWithParam<bool> {
+protected:
+    void SetUp() override {
+        if (GetParam() && !AsyncFileReader::uringAvailable())
+            GTEST_SKIP() << "io_uring is not available";
+        std::filesystem::create_directories("reader_examples/sub");
+        writeFile("empty.txt", "");
+        writeFile("small.txt", "one needle\n");
+        writeFile("block.txt", std::string(FileBuffer::kBlockSize, 'a'));
+        writeFile("block1.txt", std::string(FileBuffer::kBlockSize + 1, 'b'));
+        std::string lines;
+        for (int i = 0; lines.size() < 200 * 1024; ++i)
+            lines += "line " + std::to_string(i) + "\n";
+        writeFile("lines.txt", lines);
+        writeFile("large.txt", std::string(kMaxSize, 'c'));
+    }
+
+    void TearDown() override {
+        std::filesystem::remove_all("reader_examples");
+    }
+
+    void writeFile(const std::string& name, const std::string& content) {
+        std::ofstream("reader_examples/" + name, std::ios::binary) << content;
+        contents_[name] = content;
+    }
+
+    /// Reads every name through a reader of the given depth; files by name.
+    std::map<std::string, AsyncFileReader::File> readAll(const std::vector<std::string>& names, std::size_t depth) {
+        AsyncFileReader reader(depth, kMaxSize, GetParam());
+        EXPECT_EQ(reader.usesUring(), GetParam());
+        std::map<std::string, AsyncFileReader::File> files;
+        AsyncFileReader::File file;
+        const auto takeOne = [&](bool wait) {
+            if (!reader.take(file, wait))
+                return false;
+            const std::string name = file.path.filename().string();
+            files[name] = std::move(file);
+            file = AsyncFileReader::File{};
+            return true;
+        };
+        for (const auto& name : names) {
+            while (reader.full())
+                EXPECT_TRUE(takeOne(true));
+            reader.add("reader_examples/" + name);
+            takeOne(false);
+        }
+        while (takeOne(true)) {
+        }
+        EXPECT_EQ(reader.pending(), 0u);
+        return files;
+    }
+
+    static constexpr std::size_t kMaxSize = 256 * 1024;
+    std::map<std::string, std::string> contents_;
+};
+
+TEST_P(AsyncFileReaderTest, ReadsSmallRegularFiles) {
+    const std::vector<std::string> names = {"empty.txt", "small.txt", "block.txt", "block1.txt", "lines.txt"};
+    auto files = readAll(names, 2);
+    ASSERT_EQ(files.size(), names.size());
+    for (const auto& name : names) {
+        const auto& file = files[name];
+        EXPECT_TRUE(file.loaded) << name;
+        EXPECT_EQ(file.error, 0) << name;
+        EXPECT_EQ(file.buffer.view(), contents_[name]) << name;
+    }
+}
+
+TEST_P(AsyncFileReaderTest, LeavesOtherFilesUnreadAndReportsErrors) {
+    auto files = readAll({"large.txt", "sub", "missing.txt", "small.txt"}, 4);
+    ASSERT_EQ(files.size(), 4u);
+    EXPECT_FALSE(files["large.txt"].loaded);
+    EXPECT_EQ(files["large.txt"].error, 0);
+    EXPECT_FALSE(files["sub"].loaded);
+    EXPECT_EQ(files["sub"].error, 0);
+    EXPECT_FALSE(files["missing.txt"].loaded);
+    EXPECT_EQ(files["missing.txt"].error, ENOENT);
+    EXPECT_TRUE(files["small.txt"].loaded);
+    EXPECT_EQ(files["small.txt"].buffer.view(), "one needle\n");
+}
+
+TEST_P(AsyncFileReaderTest, DestroyingWithReadsInFlightIsSafe) {
+    AsyncFileReader reader(4, kMaxSize, GetParam());
+    reader.add("reader_examples/lines.txt");
+    reader.add("reader_examples/block1.txt");
+    AsyncFileReader::File file;
+    reader.take(file, false);
+    EXPECT_LE(reader.pending(), 2u);
+}
+
+INSTANTIATE_TEST_SUITE_P(Backends, AsyncFileReaderTest, ::testing::Values(true, false),
+                         [](const ::testing::TestParamInfo<bool>& info) { return info.param ? "Uring" : "Pread"; });
@@ -0,0 +1,133 @@
+#include <gtest/gtest.h>
+#include "automatonRegex.hpp"
+#include "compiledPattern.hpp"
+#include "grepLikeUtility.hpp"
+#include <chrono>
+#include <regex>
+#include <string>
+#include <vector>
+
+namespace {
+
+/// Compares search() and every find() step against std::regex on the same line.
+void expectSameAsStdRegex(const std::string& pattern, const std::string& line, bool caseSensitive) {
+    SCOPED_TRACE("pattern \"" + pattern + "\" on \"" + line + "\"");
+    AutomatonRegex automaton(pattern, caseSensitive);
+    auto flags = std::regex::ECMAScript;
+    if (!caseSensitive)
+        flags |= std::regex::icase;
+    std::regex reference(pattern, flags);
+
+    EXPECT_EQ(automaton.search(line), std::regex_search(line, reference));
+
+    std::size_t from = 0;
+    while (from <= line.size()) {
+        std::smatch expected;
+        const auto matchFlags = from > 0 ? std::regex_constants::match_prev_avail
+                                         : std::regex_constants::match_default;
+        const bool found = std::regex_search(line.cbegin() + static_cast<std::ptrdiff_t>(from), line.cend(),
+                                             expected, reference, matchFlags);
+        MatchSpan actual = automaton.find(line, from);
+        ASSERT_EQ(static_cast<bool>(actual), found) << "from " << from;
+        if (!found)
+            break;
+        EXPECT_EQ(actual.position, from + static_cast<std::size_t>(expected.position(0))) << "from " << from;
+        EXPECT_EQ(actual.length, static_cast<std::size_t>(expected.length(0))) << "from " << from;
+        from = actual.position + std::max<std::size_t>(actual.length, 1);
+    }
+}
+
+}  // namespace
+
+TEST(AutomatonRegexTest, AgreesWithStdRegex) {
+    const std::vector<std::string> patterns = {
+        "abc", "a|b|cd", "colou?r", "\\bco\\w+", "\\Bor\\B", "^The", "end$", "^$", "a*", "a+?b",
+        "(ab|a)(bc|c)", "x{2,3}", "x{2,}?", "[a-c]+[^a-c]", "\\d{3}-\\d{4}", "[[:alpha:]_][[:alnum:]_]*",
+        "\\s+\\S", ".*error.*", "(?:foo|bar)+baz", "a.c", "\\x41\\u0042", "[\\]\\-]", "(a|ab)(c|bcd)(d*)",
+    };
+    const std::vector<std::string> lines = {
+        "", "abc", "The color and the colour", "x xx xxx xxxx", "call 555-0199 now", "word boundaries or forbid",
+        "foo bar foobarbaz barfoobaz", "  leading space", "fatal error: disk", "ABC abc AbC", "abcd", "a-]b",
+        "this is the end", "snake_case identifier42",
+    };
+    for (const auto& pattern : patterns) {
+        for (const auto& line : lines) {
+            expectSameAsStdRegex(pattern, line, true);
+            expectSameAsStdRegex(pattern, line, false);
+        }
+    }
+}
+
+TEST(AutomatonRegexTest, PathologicalPatternRunsInLinearTime) {
+    // Catastrophic for a backtracking engine: 2^n ways to split the run of 'a's.
+    AutomatonRegex regex("(a*)*b", true);
+    const std::string line(20000, 'a');
+    const auto start = std::chrono::steady_clock::now();
+    EXPECT_FALSE(regex.search(line));
+    EXPECT_FALSE(regex.find(line));
+    EXPECT_TRUE(regex.search(line + "b"));
+    const auto elapsed = std::chrono::steady_clock::now() - start;
+    EXPECT_LT(elapsed, std::chrono::seconds(2));
+}
+
+TEST(AutomatonRegexTest, RejectsUnsupportedAndInvalidSyntax) {
+    EXPECT_THROW(AutomatonRegex("(a)\\1", true), RegexError);
+    EXPECT_THROW(AutomatonRegex("foo(?=bar)", true), RegexError);
+    EXPECT_THROW(AutomatonRegex("(unclosed", true), RegexError);
+    EXPECT_THROW(AutomatonRegex("*a", true), RegexError);
+    EXPECT_THROW(AutomatonRegex("a{3,1}", true), RegexError);
+    EXPECT_THROW(AutomatonRegex("(x{1000}){1000}", true), RegexError);
+
+    try {
+        AutomatonRegex("(a)\\1", true);
+    }
+    catch (const RegexError& e) {
+        EXPECT_NE(std::string(e.what()).find("--regex-engine=std"), std::string::npos);
+    }
+}
+
+TEST(AutomatonRegexTest, ExtractsRequiredLiteral) {
+    EXPECT_EQ(AutomatonRegex("\\w+Exception: .*", true).requiredLiteral(), "Exception: ");
+    EXPECT_EQ(AutomatonRegex("(get|set)Value\\(", true).requiredLiteral(), "etValue(");
+    EXPECT_EQ(AutomatonRegex("ERROR|WARN", true).requiredLiteral(), "");
+    EXPECT_EQ(AutomatonRegex("x{3}yz?", true).requiredLiteral(), "xxxy");
+    EXPECT_EQ(AutomatonRegex("Timeout\\d+", false).requiredLiteral(), "timeout");
+}
+
+TEST(AutomatonRegexTest, DfaCacheFlushKeepsResultsCorrect) {
+    // The n-th symbol from the end being 'a' needs 2^n DFA states, more than the cache holds.
+    AutomatonRegex regex("a[ab]{13}$", true);
+    std::string line;
+    std::uint32_t state = 12345;
+    for (int i = 0; i < 100000; ++i) {
+        state = state * 1103515245u + 12345u;
+        line += (state >> 16) & 1 ? 'a' : 'b';
+    }
+    const bool expected = line[line.size() - 14] == 'a';
+    EXPECT_EQ(regex.search(line), expected);
+    EXPECT_EQ(regex.search(line + "a"), line[line.size() - 13] == 'a');
+}
+
+TEST(AutomatonRegexTest, CompiledPatternSelectsEngine) {
+    CompiledPattern automaton("(a)\\1", true, true);
+    EXPECT_EQ(automaton.regexEngine(), RegexEngine::Automaton);
+    EXPECT_FALSE(automaton.valid());
+
+    CompiledPattern standard("(a)\\1", true, true, RegexEngine::Std);
+    EXPECT_TRUE(standard.valid());
+    EXPECT_TRUE(standard.matchesLine("xaa"));
+
+    PatternCache cache(4);
+    EXPECT_NE(cache.get("a+", true, true, RegexEngine::Automaton).get(),
+              cache.get("a+", true, true, RegexEngine::Std).get());
+}
+
+TEST(AutomatonRegexTest, FindCandidateSkipsToRequiredLiteral) {
+    CompiledPattern pattern("\\d+ms timeout", true, true);
+    const std::string text = "ok\nok\nafter 30ms timeout\n";
+    EXPECT_EQ(pattern.findCandidate(text), text.find("ms timeout"));
+    EXPECT_EQ(pattern.findCandidate(text, text.size() - 1), std::string::npos);
+
+    CompiledPattern noLiteral("\\d+", true, true);
+    EXPECT_EQ(noLiteral.findCandidate(text, 3), 3u);
+}
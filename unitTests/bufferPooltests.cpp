@@ -0,0 +1,75 @@
+#include <gtest/gtest.h>
+#include "bufferPool.hpp"
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+TEST(BufferPoolTest, RecycledBlocksAreHandedOutAgain) {
+    BufferPool pool(0, 2);
+    FileBuffer buffer = pool.acquire();
+    EXPECT_EQ(buffer.capacity(), 0u);
+    const char* block = buffer.reserve(1000);
+    pool.recycle(std::move(buffer));
+    EXPECT_EQ(pool.idle(), 1u);
+
+    FileBuffer again = pool.acquire();
+    EXPECT_EQ(pool.idle(), 0u);
+    EXPECT_EQ(again.reserve(10), block);
+    EXPECT_TRUE(again.view().empty());
+
+    // Blocks larger than the pool keeps, and blocks beyond maxIdle, are released.
+    FileBuffer large;
+    large.reserve(BufferPool::kMaxPooledCapacity + 1);
+    pool.recycle(std::move(large));
+    EXPECT_EQ(pool.idle(), 0u);
+    for (int i = 0; i < 3; ++i) {
+        FileBuffer small;
+        small.reserve(1);
+        pool.recycle(std::move(small));
+    }
+    EXPECT_EQ(pool.idle(), 2u);
+}
+
+TEST(BufferPoolTest, AccountChargesTheDifference) {
+    BufferPool pool;
+    FileBuffer buffer;
+    size_t charged = 0;
+    buffer.reserve(1);
+    pool.account(buffer, charged);
+    EXPECT_EQ(charged, FileBuffer::kBlockSize);
+    buffer.reserve(3 * FileBuffer::kBlockSize);
+    pool.account(buffer, charged);
+    EXPECT_EQ(charged, 3 * FileBuffer::kBlockSize);
+    EXPECT_EQ(pool.inUse(), 3 * FileBuffer::kBlockSize);
+
+    pool.charge(100);
+    EXPECT_EQ(pool.peak(), 3 * FileBuffer::kBlockSize + 100);
+    pool.release(100);
+    pool.recycle(std::move(buffer), charged);
+    EXPECT_EQ(pool.inUse(), 0u);
+    EXPECT_EQ(pool.peak(), 3 * FileBuffer::kBlockSize + 100);
+}
+
+TEST(BufferPoolTest, WaitForRoomBlocksAtTheLimit) {
+    BufferPool unlimited;
+    unlimited.charge(1 << 30);
+    EXPECT_TRUE(unlimited.hasRoom());
+    unlimited.waitForRoom();
+
+    BufferPool pool(1000);
+    pool.charge(999);
+    EXPECT_TRUE(pool.hasRoom());
+    pool.charge(1);
+    EXPECT_FALSE(pool.hasRoom());
+
+    std::atomic<bool> waited{false};
+    std::thread waiter([&] {
+        pool.waitForRoom();
+        waited = true;
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    EXPECT_FALSE(waited);
+    pool.release(1);
+    waiter.join();
+    EXPECT_TRUE(waited);
+}
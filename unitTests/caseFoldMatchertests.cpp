@@ -0,0 +1,121 @@
+#include <gtest/gtest.h>
+#include "caseFoldMatcher.hpp"
+#include <algorithm>
+#include <cctype>
+#include <random>
+#include <string>
+#include <string_view>
+
+namespace {
+
+const CaseFoldMatcher::Kernel kAllKernels[] = {
+    CaseFoldMatcher::Kernel::Scalar, CaseFoldMatcher::Kernel::Sse2, CaseFoldMatcher::Kernel::Avx2};
+
+}  // namespace
+
+TEST(CaseFoldMatcherTest, AsciiNeedleMatchesAnyCase) {
+    std::string haystack(200, '.');
+    haystack.replace(150, 5, "HeLLo");
+    for (auto kernel : kAllKernels) {
+        CaseFoldMatcher matcher("hello", kernel);
+        EXPECT_TRUE(matcher.asciiFastPath());
+        auto match = matcher.find(haystack);
+        ASSERT_TRUE(match);
+        EXPECT_EQ(match.position, 150u);
+        EXPECT_EQ(match.length, 5u);
+        EXPECT_FALSE(matcher.find(haystack, 151));
+    }
+}
+
+TEST(CaseFoldMatcherTest, AsciiFastPathAgreesWithLoweredFind) {
+    std::mt19937 rng(7);
+    std::uniform_int_distribution<int> letter(0, 5);
+    const char alphabet[] = "abcABC";
+    std::string haystack(3000, ' ');
+    for (auto& c : haystack) {
+        c = alphabet[letter(rng)];
+    }
+    std::string lowered = haystack;
+    std::transform(lowered.begin(), lowered.end(), lowered.begin(), ::tolower);
+
+    for (int trial = 0; trial < 100; ++trial) {
+        std::string needle(1 + trial % 5, ' ');
+        for (auto& c : needle) {
+            c = alphabet[letter(rng)];
+        }
+        std::string loweredNeedle = needle;
+        std::transform(loweredNeedle.begin(), loweredNeedle.end(), loweredNeedle.begin(), ::tolower);
+        const size_t expected = lowered.find(loweredNeedle, trial);
+        for (auto kernel : kAllKernels) {
+            EXPECT_EQ(CaseFoldMatcher(needle, kernel).find(haystack, trial).position, expected) << needle;
+        }
+    }
+}
+
+TEST(CaseFoldMatcherTest, FoldsNonAsciiLetters) {
+    for (auto kernel : kAllKernels) {
+        CaseFoldMatcher matcher("straße", kernel);
+        EXPECT_FALSE(matcher.asciiFastPath());
+        auto match = matcher.find("Die STRASSE und die STRAẞE");
+        ASSERT_TRUE(match);
+        EXPECT_EQ(match.position, std::string_view("Die STRASSE und die ").size());
+        EXPECT_EQ(match.length, std::string_view("STRAẞE").size());
+
+        EXPECT_TRUE(CaseFoldMatcher("ПРИВЕТ", kernel).find("скажи привет миру"));
+        EXPECT_TRUE(CaseFoldMatcher("σοφία", kernel).find("ΣΟΦΊΑ"));
+        EXPECT_TRUE(CaseFoldMatcher("élan", kernel).find("avec ÉLAN"));
+    }
+}
+
+TEST(CaseFoldMatcherTest, FoldsIrregularLatinExtendedLetters) {
+    for (auto kernel : kAllKernels) {
+        // Vietnamese: Ơ (U+01A0) and Ư (U+01AF) next to regular Latin-1 letters.
+        EXPECT_TRUE(CaseFoldMatcher("trương", kernel).find("HỌ TRƯƠNG"));
+        EXPECT_TRUE(CaseFoldMatcher("THƠ", kernel).find("bài thơ"));
+        // Azerbaijani: Ə (U+018F) folds to ə (U+0259), outside Latin Extended-B.
+        EXPECT_TRUE(CaseFoldMatcher("əsgər", kernel).find("ƏSGƏR"));
+        EXPECT_TRUE(CaseFoldMatcher("ƏMƏK", kernel).find("əmək"));
+        // Hausa Ɓ, Latin Extended-B Ⱥ and Latin Extended-C Ɑ fold across blocks.
+        EXPECT_TRUE(CaseFoldMatcher("ɓaƙi", kernel).find("ƁAƘI"));
+        EXPECT_TRUE(CaseFoldMatcher("ⱥɑ", kernel).find("ȺⱭ"));
+        EXPECT_FALSE(CaseFoldMatcher("ə", kernel).find("e"));
+    }
+    EXPECT_EQ(CaseFoldMatcher::foldCodePoint(0x1F7), 0x1BFu);
+    EXPECT_EQ(CaseFoldMatcher::foldCodePoint(0x220), 0x19Eu);
+    EXPECT_EQ(CaseFoldMatcher::foldCodePoint(0x24E), 0x24Fu);
+    EXPECT_EQ(CaseFoldMatcher::foldCodePoint(0x2C62), 0x26Bu);
+    EXPECT_EQ(CaseFoldMatcher::foldCodePoint(0x2C7F), 0x240u);
+}
+
+TEST(CaseFoldMatcherTest, AsciiNeedleMatchesKelvinAndLongS) {
+    // "K" (U+212A KELVIN SIGN) folds to 'k' and "ſ" (U+017F LONG S) folds to 's'.
+    CaseFoldMatcher matcher("kiss");
+    EXPECT_FALSE(matcher.asciiFastPath());
+    auto match = matcher.find("a Kiſs");
+    ASSERT_TRUE(match);
+    EXPECT_EQ(match.position, 2u);
+    EXPECT_EQ(match.length, std::string_view("Kiſs").size());
+}
+
+TEST(CaseFoldMatcherTest, InvalidUtf8OnlyMatchesItself) {
+    const std::string haystack = "ab\xff\xfe" "cd";
+    EXPECT_EQ(CaseFoldMatcher("\xff\xfe" "CD").find(haystack).position, 2u);
+    EXPECT_FALSE(CaseFoldMatcher("\xfe\xff").find(haystack));
+}
+
+TEST(CaseFoldMatcherTest, KAndSNeedlesSearchAcrossAsciiAndUtf8Windows) {
+    std::string haystack(200000, 'x');
+    haystack.replace(100000, 3, "\xE2\x80\x94");          // an em dash forces the UTF-8 path there
+    haystack.replace(150000, 6, "MAS\xE2\x84\xAA");       // "MAS" followed by KELVIN SIGN
+    haystack.replace(190000, 4, "TASK");
+
+    CaseFoldMatcher matcher("ask");
+    auto first = matcher.find(haystack);
+    ASSERT_TRUE(first);
+    EXPECT_EQ(first.position, 150001u);
+    EXPECT_EQ(first.length, 5u);
+    auto second = matcher.find(haystack, first.position + 1);
+    ASSERT_TRUE(second);
+    EXPECT_EQ(second.position, 190001u);
+    EXPECT_FALSE(matcher.find(haystack, second.position + 1));
+}
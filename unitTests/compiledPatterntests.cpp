@@ -0,0 +1,57 @@
+#include <gtest/gtest.h>
+#include "compiledPattern.hpp"
+#include "grepLikeUtility.hpp"
+#include <string>
+
+TEST(CompiledPatternTest, LiteralFindReportsPositionAndLength) {
+    CompiledPattern sensitive("World", true, false);
+    EXPECT_EQ(sensitive.find("Hello World").position, 6u);
+    EXPECT_FALSE(sensitive.find("hello world"));
+
+    CompiledPattern insensitive("world", false, false);
+    MatchSpan match = insensitive.find("Hello WORLD");
+    ASSERT_TRUE(match);
+    EXPECT_EQ(match.position, 6u);
+    EXPECT_EQ(match.length, 5u);
+}
+
+TEST(CompiledPatternTest, RegexFindContinuesFromOffset) {
+    CompiledPattern pattern("\\bco\\w+", true, true);
+    const std::string line = "colors and more colors";
+    MatchSpan first = pattern.find(line);
+    ASSERT_TRUE(first);
+    EXPECT_EQ(first.position, 0u);
+    MatchSpan second = pattern.find(line, first.position + first.length);
+    ASSERT_TRUE(second);
+    EXPECT_EQ(second.position, 16u);
+    EXPECT_EQ(second.length, 6u);
+}
+
+TEST(CompiledPatternTest, InvalidRegexNeverMatches) {
+    CompiledPattern pattern("(unclosed", true, true);
+    EXPECT_FALSE(pattern.valid());
+    EXPECT_FALSE(pattern.error().empty());
+    EXPECT_FALSE(pattern.matchesLine("(unclosed"));
+    EXPECT_EQ(highlightMatches("(unclosed", pattern), "(unclosed [regex error]");
+}
+
+TEST(PatternCacheTest, HitReturnsSharedInstance) {
+    PatternCache cache(4);
+    auto first = cache.get("needle", true, false);
+    auto second = cache.get("needle", true, false);
+    EXPECT_EQ(first.get(), second.get());
+    EXPECT_NE(first.get(), cache.get("needle", false, false).get());
+    EXPECT_EQ(cache.size(), 2u);
+}
+
+TEST(PatternCacheTest, EvictsLeastRecentlyUsed) {
+    PatternCache cache(2);
+    auto a = cache.get("a", true, false);
+    auto b = cache.get("b", true, false);
+    cache.get("a", true, false);           // "b" is now least recently used
+    cache.get("c", true, false);           // evicts "b"
+    EXPECT_EQ(cache.size(), 2u);
+    EXPECT_EQ(cache.get("a", true, false).get(), a.get());
+    EXPECT_NE(cache.get("b", true, false).get(), b.get());
+    EXPECT_EQ(b->query(), "b");            // evicted patterns stay valid while referenced
+}
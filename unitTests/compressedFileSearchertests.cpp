@@ -0,0 +1,246 @@
+#include <gtest/gtest.h>
+#include "compressedFileSearcher.hpp"
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#ifdef FILESEARCHER_HAVE_ZLIB
+#include <zlib.h>
+#endif
+#ifdef FILESEARCHER_HAVE_LZMA
+#include <lzma.h>
+#endif
+#ifdef FILESEARCHER_HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+namespace {
+
+class ResultList : public ResultSink {
+public:
+    void consume(std::vector<SearchResult>& batch, const std::string&) override {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (auto& result : batch)
+            results.push_back(std::move(result));
+    }
+
+    std::mutex mutex;
+    std::vector<SearchResult> results;
+};
+
+#ifdef FILESEARCHER_HAVE_ZLIB
+std::string gzip(const std::string& data) {
+    z_stream stream{};
+    deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY);
+    std::string out(deflateBound(&stream, data.size()), '\0');
+    stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data.data()));
+    stream.avail_in = data.size();
+    stream.next_out = reinterpret_cast<Bytef*>(out.data());
+    stream.avail_out = out.size();
+    deflate(&stream, Z_FINISH);
+    out.resize(stream.total_out);
+    deflateEnd(&stream);
+    return out;
+}
+#endif
+
+/// Lines "line <n>" numbered from 1, with "needle" on the given lines; large enough to span several chunks.
+std::string numberedLines(size_t count, const std::vector<size_t>& needles) {
+    std::string text;
+    for (size_t line = 1; line <= count; ++line) {
+        text += "line " + std::to_string(line);
+        if (std::find(needles.begin(), needles.end(), line) != needles.end())
+            text += " needle";
+        text += '\n';
+    }
+    return text;
+}
+
+}  // namespace
+
+class CompressedFileSearcherTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        std::filesystem::create_directories("compressed_examples");
+    }
+
+    void TearDown() override {
+        std::filesystem::remove_all("compressed_examples");
+    }
+
+    static std::string writeFile(const std::string& name, const std::string& content) {
+        const std::string path = "compressed_examples/" + name;
+        std::ofstream(path, std::ios::binary) << content;
+        return path;
+    }
+
+    static std::vector<SearchResult> search(const std::string& path, const std::string& query,
+                                            BinaryPolicy policy = BinaryPolicy::Report) {
+        ResultList sink;
+        CompressedFileSearcher(policy).search(path, CompiledPattern(query), sink);
+        return std::move(sink.results);
+    }
+};
+
+TEST_F(CompressedFileSearcherTest, DetectsFormatsByMagicBytes) {
+    using Compression = CompressedFileSearcher::Compression;
+    EXPECT_EQ(CompressedFileSearcher::detectCompression("\x1F\x8B\x08"), Compression::Gzip);
+    EXPECT_EQ(CompressedFileSearcher::detectCompression(std::string("\xFD" "7zXZ\0", 6)), Compression::Xz);
+    EXPECT_EQ(CompressedFileSearcher::detectCompression("\x28\xB5\x2F\xFD"), Compression::Zstd);
+    EXPECT_EQ(CompressedFileSearcher::detectCompression("plain text"), Compression::None);
+    EXPECT_EQ(CompressedFileSearcher::detectCompression("\x1F"), Compression::None);
+}
+
+TEST_F(CompressedFileSearcherTest, SearchesPlainFilesAsText) {
+    const std::string path = writeFile("plain.log", "first\nneedle here\n");
+    const auto results = search(path, "needle");
+    ASSERT_EQ(results.size(), 1u);
+    EXPECT_EQ(results[0].lineNumber, 2u);
+    EXPECT_EQ(results[0].line, "needle here");
+}
+
+#ifdef FILESEARCHER_HAVE_ZLIB
+TEST_F(CompressedFileSearcherTest, NumbersLinesOfTheDecompressedContentAcrossChunks) {
+    // About 3.5 MiB decompressed: several chunks, with lines split between them.
+    const std::vector<size_t> needles = {1, 123457, 250000, 300000};
+    const std::string text = numberedLines(300000, needles);
+    ASSERT_GT(text.size(), 3 * CompressedFileSearcher::kChunkSize);
+    const std::string path = writeFile("rotated.log.gz", gzip(text));
+
+    const auto results = search(path, "needle");
+    ASSERT_EQ(results.size(), needles.size());
+    for (size_t i = 0; i < needles.size(); ++i) {
+        EXPECT_EQ(results[i].lineNumber, needles[i]);
+        EXPECT_EQ(results[i].line, "line " + std::to_string(needles[i]) + " needle");
+        EXPECT_EQ(text.compare(results[i].byteOffset, results[i].line.size(), results[i].line), 0);
+        EXPECT_EQ(results[i].path, path);
+    }
+}
+
+TEST_F(CompressedFileSearcherTest, ReadsConcatenatedGzipMembers) {
+    const std::string path = writeFile("joined.gz", gzip("one\ntwo needle\n") + gzip("three needle\n"));
+    const auto results = search(path, "needle");
+    ASSERT_EQ(results.size(), 2u);
+    EXPECT_EQ(results[0].lineNumber, 2u);
+    EXPECT_EQ(results[1].lineNumber, 3u);
+    EXPECT_EQ(results[1].line, "three needle");
+}
+
+TEST_F(CompressedFileSearcherTest, AppliesTheBinaryPolicyToTheDecompressedContent) {
+    const std::string path = writeFile("archive.tar.gz", gzip(std::string("head\0er needle\n", 15)));
+    EXPECT_TRUE(search(path, "needle", BinaryPolicy::Skip).empty());
+    const auto reported = search(path, "needle", BinaryPolicy::Report);
+    ASSERT_EQ(reported.size(), 1u);
+    EXPECT_TRUE(reported[0].binary);
+    EXPECT_EQ(search(path, "needle", BinaryPolicy::Text).size(), 1u);
+}
+
+TEST_F(CompressedFileSearcherTest, KeepsMatchesFoundBeforeCorruption) {
+    std::string data = gzip(numberedLines(300000, {2}));
+    data.resize(data.size() / 2);
+    const std::string path = writeFile("truncated.gz", data);
+    testing::internal::CaptureStderr();
+    const auto results = search(path, "needle");
+    const std::string errors = testing::internal::GetCapturedStderr();
+    ASSERT_EQ(results.size(), 1u);
+    EXPECT_EQ(results[0].lineNumber, 2u);
+    EXPECT_NE(errors.find("Could not decompress file"), std::string::npos) << errors;
+}
+
+TEST_F(CompressedFileSearcherTest, CountsAndStopsAtTheMaxCount) {
+    const std::string path = writeFile("counted.log.gz", gzip(numberedLines(300000, {5, 6, 200000, 299999})));
+    CompressedFileSearcher searcher;
+    searcher.setReportMode(ReportMode::Count);
+    EXPECT_EQ(searcher.reportMode(), ReportMode::Count);
+    ResultList counted;
+    searcher.search(path, CompiledPattern("needle"), counted);
+    ASSERT_EQ(counted.results.size(), 1u);
+    EXPECT_EQ(counted.results[0].matchCount, 4u);
+
+    searcher.setReportMode(ReportMode::Lines);
+    searcher.setMaxCount(3);
+    ResultList lines;
+    searcher.search(path, CompiledPattern("needle"), lines);
+    ASSERT_EQ(lines.results.size(), 3u);
+    EXPECT_EQ(lines.results[2].lineNumber, 200000u);
+}
+
+TEST_F(CompressedFileSearcherTest, ContextLinesCrossChunks) {
+    const std::string text = numberedLines(300000, {1, 150000});
+    const std::string plain = writeFile("context.log", text);
+    const std::string zipped = writeFile("context.log.gz", gzip(text));
+
+    // Also match a line next to every chunk boundary, so its context straddles it.
+    std::string query = "needle";
+    for (size_t chunk = 1; chunk * CompressedFileSearcher::kChunkSize < text.size(); ++chunk) {
+        const size_t boundary = chunk * CompressedFileSearcher::kChunkSize;
+        const size_t line = std::count(text.begin(), text.begin() + boundary, '\n') + 1;
+        // Odd boundaries need the lines kept before a chunk, even ones the window carried over.
+        query += "|^line " + std::to_string(chunk % 2 == 1 ? line + 1 : line - 1) + "$";
+    }
+    const CompiledPattern pattern(query, true, true);
+    CompressedFileSearcher searcher;
+    searcher.setContext(3, 2);
+    ResultList expected;
+    ResultList actual;
+    searcher.search(plain, pattern, expected);
+    searcher.search(zipped, pattern, actual);
+    ASSERT_GT(expected.results.size(), 20u);
+    ASSERT_EQ(actual.results.size(), expected.results.size());
+    for (size_t i = 0; i < expected.results.size(); ++i) {
+        EXPECT_EQ(actual.results[i].lineNumber, expected.results[i].lineNumber);
+        EXPECT_EQ(actual.results[i].byteOffset, expected.results[i].byteOffset);
+        EXPECT_EQ(actual.results[i].line, expected.results[i].line);
+        EXPECT_EQ(actual.results[i].context, expected.results[i].context);
+        EXPECT_EQ(actual.results[i].gapBefore, expected.results[i].gapBefore);
+    }
+}
+
+TEST_F(CompressedFileSearcherTest, SearchManagerSearchesCompressedFilesInATree) {
+    writeFile("a.log", "plain needle\n");
+    writeFile("b.log.gz", gzip("zipped\nzipped needle\n"));
+    std::vector<std::string> found;
+    SearchManager manager(std::make_unique<CompressedFileSearcher>(), "needle");
+    manager.setNumThreads(2);
+    manager.setRangeSize(1);    // would split every file that does not require a whole search
+    manager.setResultCallback([&found](const SearchResult& result) {
+        found.push_back(std::filesystem::path(result.path).filename().string() + ":" +
+                        std::to_string(result.lineNumber));
+    });
+    manager.searchInDirectory("compressed_examples");
+    std::sort(found.begin(), found.end());
+    EXPECT_EQ(found, (std::vector<std::string>{"a.log:1", "b.log.gz:2"}));
+}
+#endif
+
+#ifdef FILESEARCHER_HAVE_LZMA
+TEST_F(CompressedFileSearcherTest, SearchesXzFiles) {
+    const std::string text = numberedLines(200000, {7, 199999});
+    std::string out(lzma_stream_buffer_bound(text.size()), '\0');
+    size_t size = 0;
+    ASSERT_EQ(lzma_easy_buffer_encode(1, LZMA_CHECK_CRC64, nullptr, reinterpret_cast<const uint8_t*>(text.data()),
+                                      text.size(), reinterpret_cast<uint8_t*>(out.data()), &size, out.size()),
+              LZMA_OK);
+    out.resize(size);
+    const auto results = search(writeFile("log.xz", out), "needle");
+    ASSERT_EQ(results.size(), 2u);
+    EXPECT_EQ(results[0].lineNumber, 7u);
+    EXPECT_EQ(results[1].lineNumber, 199999u);
+}
+#endif
+
+#ifdef FILESEARCHER_HAVE_ZSTD
+TEST_F(CompressedFileSearcherTest, SearchesZstdFiles) {
+    const std::string text = numberedLines(200000, {3, 150000});
+    std::string out(ZSTD_compressBound(text.size()), '\0');
+    out.resize(ZSTD_compress(out.data(), out.size(), text.data(), text.size(), 1));
+    const auto results = search(writeFile("log.zst", out + out), "needle");   // two frames
+    ASSERT_EQ(results.size(), 4u);
+    EXPECT_EQ(results[0].lineNumber, 3u);
+    EXPECT_EQ(results[1].lineNumber, 150000u);
+    EXPECT_EQ(results[2].lineNumber, 200003u);
+}
+#endif
@@ -0,0 +1,123 @@
+#include <gtest/gtest.h>
+#include "directoryWalker.hpp"
+#include "boundedQueue.hpp"
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+class DirectoryWalkerTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        std::filesystem::create_directories("walker_examples/a/b/c");
+        std::filesystem::create_directories("walker_examples/d");
+        writeFile("walker_examples/top.txt");
+        writeFile("walker_examples/a/one.txt");
+        writeFile("walker_examples/a/b/c/deep.txt");
+        writeFile("walker_examples/d/two.txt");
+    }
+
+    void TearDown() override {
+        std::error_code ec;
+        std::filesystem::permissions("walker_examples/locked", std::filesystem::perms::owner_all,
+                                     std::filesystem::perm_options::add, ec);
+        std::filesystem::remove_all("walker_examples");
+    }
+
+    static void writeFile(const std::string& path) {
+        std::ofstream(path) << "content\n";
+    }
+
+    /// Walks the tree and returns the sorted file paths and the number of reported errors.
+    static std::vector<std::string> walk(const std::string& root, bool followSymlinks, size_t* errors = nullptr) {
+        std::mutex mutex;
+        std::vector<std::string> files;
+        size_t errorCount = 0;
+        DirectoryWalker walker(3, followSymlinks);
+        walker.walk(
+            root,
+            [&](std::filesystem::path file) {
+                std::lock_guard<std::mutex> lock(mutex);
+                files.push_back(file.generic_string());
+            },
+            [&](const std::filesystem::path&, std::error_code) {
+                std::lock_guard<std::mutex> lock(mutex);
+                ++errorCount;
+            });
+        std::sort(files.begin(), files.end());
+        if (errors)
+            *errors = errorCount;
+        return files;
+    }
+};
+
+TEST_F(DirectoryWalkerTest, FindsEveryFileInTheTree) {
+    size_t errors = 0;
+    const auto files = walk("walker_examples", false, &errors);
+    const std::vector<std::string> expected = {
+        "walker_examples/a/b/c/deep.txt", "walker_examples/a/one.txt",
+        "walker_examples/d/two.txt", "walker_examples/top.txt",
+    };
+    EXPECT_EQ(files, expected);
+    EXPECT_EQ(errors, 0u);
+}
+
+TEST_F(DirectoryWalkerTest, SymlinkLoopIsWalkedOnce) {
+    std::error_code ec;
+    std::filesystem::create_directory_symlink("../..", "walker_examples/a/b/loop", ec);
+    if (ec)
+        GTEST_SKIP() << "symlinks not available: " << ec.message();
+
+    // Not followed by default; followed, the loop back to the root is detected.
+    EXPECT_EQ(walk("walker_examples", false).size(), 4u);
+    EXPECT_EQ(walk("walker_examples", true).size(), 4u);
+}
+
+TEST_F(DirectoryWalkerTest, UnreadableDirectoriesAreReportedAndSkipped) {
+    size_t errors = 0;
+    EXPECT_TRUE(walk("walker_examples/missing", false, &errors).empty());
+    EXPECT_EQ(errors, 1u);
+
+    std::filesystem::create_directory("walker_examples/locked");
+    writeFile("walker_examples/locked/hidden.txt");
+    std::filesystem::permissions("walker_examples/locked", std::filesystem::perms::all,
+                                 std::filesystem::perm_options::remove);
+    std::error_code ec;
+    std::filesystem::directory_iterator probe("walker_examples/locked", ec);
+    if (!ec)
+        GTEST_SKIP() << "permissions are not enforced for this user";
+
+    EXPECT_EQ(walk("walker_examples", false, &errors).size(), 4u);
+    EXPECT_EQ(errors, 1u);
+}
+
+TEST(BoundedQueueTest, ProducerBlocksUntilConsumerCatchesUp) {
+    BoundedQueue<int> queue(2);
+    std::thread producer([&queue] {
+        for (int i = 0; i < 100; ++i)
+            queue.push(i);
+        queue.close();
+    });
+    int expected = 0;
+    int value;
+    while (queue.pop(value))
+        EXPECT_EQ(value, expected++);
+    producer.join();
+    EXPECT_EQ(expected, 100);
+    EXPECT_FALSE(queue.push(1));
+}
+
+TEST(BoundedQueueTest, TryPopTellsEmptyFromClosed) {
+    using PopResult = BoundedQueue<int>::PopResult;
+    BoundedQueue<int> queue(4);
+    int value = 0;
+    EXPECT_EQ(queue.tryPop(value), PopResult::Empty);
+    queue.push(7);
+    queue.close();
+    EXPECT_EQ(queue.tryPop(value), PopResult::Popped);
+    EXPECT_EQ(value, 7);
+    EXPECT_EQ(queue.tryPop(value), PopResult::Closed);
+}
@@ -0,0 +1,101 @@
+#include <gtest/gtest.h>
+#include "fileBuffer.hpp"
+#include "grepLikeUtility.hpp"
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+class FileBufferTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        std::filesystem::create_directory("buffer_examples");
+    }
+
+    void TearDown() override {
+        std::filesystem::remove_all("buffer_examples");
+    }
+
+    static void writeFile(const std::string& filename, const std::string& content) {
+        std::ofstream file("buffer_examples/" + filename, std::ios::binary);
+        file << content;
+    }
+};
+
+TEST_F(FileBufferTest, SmallFileIsReadIntoBuffer) {
+    writeFile("small.txt", "first\nsecond\n");
+    FileBuffer buffer;
+    ASSERT_TRUE(buffer.open("buffer_examples/small.txt"));
+    EXPECT_EQ(buffer.source(), FileBuffer::Source::Read);
+    EXPECT_EQ(buffer.view(), "first\nsecond\n");
+}
+
+TEST_F(FileBufferTest, LargeFileIsMemoryMapped) {
+    std::string content(FileBuffer::kMapThreshold + 10, 'x');
+    writeFile("large.txt", content);
+    FileBuffer buffer;
+    ASSERT_TRUE(buffer.open("buffer_examples/large.txt"));
+    EXPECT_EQ(buffer.source(), FileBuffer::Source::Mapped);
+    EXPECT_EQ(buffer.size(), content.size());
+    EXPECT_EQ(buffer.view(), content);
+}
+
+TEST_F(FileBufferTest, ReservedBlockGrowsKeepingWhatWasRead) {
+    FileBuffer buffer;
+    char* data = buffer.reserve(10);
+    EXPECT_EQ(buffer.capacity(), FileBuffer::kBlockSize);
+    std::memcpy(data, "abc", 3);
+    data = buffer.reserve(FileBuffer::kBlockSize + 1, 3);
+    EXPECT_EQ(buffer.capacity(), 2 * FileBuffer::kBlockSize);
+    EXPECT_EQ(std::string(data, 3), "abc");
+    buffer.commitRead(3);
+    EXPECT_EQ(buffer.source(), FileBuffer::Source::Read);
+    EXPECT_EQ(buffer.view(), "abc");
+
+    // Reserving again reuses the block and empties the contents.
+    EXPECT_EQ(buffer.reserve(5), data);
+    EXPECT_TRUE(buffer.view().empty());
+}
+
+TEST_F(FileBufferTest, ReopeningReusesTheBlock) {
+    writeFile("first.txt", "first file\n");
+    writeFile("second.txt", "second\n");
+    writeFile("large.txt", std::string(FileBuffer::kMapThreshold, 'x'));
+    FileBuffer buffer;
+    ASSERT_TRUE(buffer.open("buffer_examples/first.txt"));
+    const char* block = buffer.view().data();
+    ASSERT_TRUE(buffer.open("buffer_examples/second.txt"));
+    EXPECT_EQ(buffer.view().data(), block);
+    EXPECT_EQ(buffer.view(), "second\n");
+
+    // A mapped file keeps the block for the next read; clear() keeps it too.
+    ASSERT_TRUE(buffer.open("buffer_examples/large.txt"));
+    EXPECT_EQ(buffer.source(), FileBuffer::Source::Mapped);
+    buffer.clear();
+    EXPECT_EQ(buffer.source(), FileBuffer::Source::None);
+    ASSERT_TRUE(buffer.open("buffer_examples/first.txt"));
+    EXPECT_EQ(buffer.view().data(), block);
+    EXPECT_EQ(buffer.view(), "first file\n");
+}
+
+TEST_F(FileBufferTest, MissingFileFailsToOpen) {
+    FileBuffer buffer;
+    EXPECT_FALSE(buffer.open("buffer_examples/does_not_exist.txt"));
+    EXPECT_EQ(buffer.source(), FileBuffer::Source::None);
+}
+
+TEST_F(FileBufferTest, LineNumbersAreCountedAcrossLargeMappedFile) {
+    std::string content;
+    for (int i = 1; i <= 50000; ++i) {
+        content += (i == 40000 ? "needle in line" : "filler line") + std::string("\n");
+    }
+    content += "last needle without newline";
+    writeFile("numbered.txt", content);
+
+    TextFileSearcher searcher;
+    testing::internal::CaptureStdout();
+    searcher.search("buffer_examples/numbered.txt", CompiledPattern("needle", true, false), false, "");
+    std::string output = testing::internal::GetCapturedStdout();
+    EXPECT_NE(output.find("buffer_examples/numbered.txt:40000: needle in line"), std::string::npos);
+    EXPECT_NE(output.find("buffer_examples/numbered.txt:50001: last needle without newline"), std::string::npos);
+}
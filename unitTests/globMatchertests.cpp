@@ -0,0 +1,89 @@
+#include <gtest/gtest.h>
+#include "globMatcher.hpp"
+#include <string>
+
+TEST(GlobMatcherTest, MatchesLiteralsAndSimpleShapes) {
+    EXPECT_TRUE(GlobMatcher("node_modules").matches("node_modules"));
+    EXPECT_FALSE(GlobMatcher("node_modules").matches("node_modules2"));
+    EXPECT_EQ(GlobMatcher("node_modules").literal(), "node_modules");
+
+    const GlobMatcher objects("*.o");
+    EXPECT_EQ(objects.extension(), ".o");
+    EXPECT_TRUE(objects.matches("main.o"));
+    EXPECT_TRUE(objects.matches(".o"));
+    EXPECT_FALSE(objects.matches("main.oo"));
+    EXPECT_FALSE(objects.matches("dir/main.o"));    // '*' does not cross directories
+
+    EXPECT_TRUE(GlobMatcher("build*").matches("build-debug"));
+    EXPECT_FALSE(GlobMatcher("build*").matches("build/x"));
+    EXPECT_TRUE(GlobMatcher("*").matches("anything"));
+    EXPECT_FALSE(GlobMatcher("*").matches("a/b"));
+}
+
+TEST(GlobMatcherTest, MatchesWildcardsAndClasses) {
+    EXPECT_TRUE(GlobMatcher("f?o.[ch]").matches("foo.c"));
+    EXPECT_TRUE(GlobMatcher("f?o.[ch]").matches("fxo.h"));
+    EXPECT_FALSE(GlobMatcher("f?o.[ch]").matches("foo.cc"));
+    EXPECT_TRUE(GlobMatcher("log[0-9][!0-9]").matches("log1a"));
+    EXPECT_FALSE(GlobMatcher("log[0-9][!0-9]").matches("log12"));
+    EXPECT_TRUE(GlobMatcher("[]x]").matches("]"));
+    EXPECT_TRUE(GlobMatcher("a*b*c").matches("aXXbYYbc"));
+    EXPECT_FALSE(GlobMatcher("a*b*c").matches("aXXbYYbcd"));
+    EXPECT_FALSE(GlobMatcher("a?c").matches("a/c"));
+    EXPECT_TRUE(GlobMatcher("\\*literal").matches("*literal"));
+    EXPECT_FALSE(GlobMatcher("\\*literal").matches("xliteral"));
+    EXPECT_TRUE(GlobMatcher("[unterminated").matches("[unterminated"));
+}
+
+TEST(GlobMatcherTest, DoubleStarSpansDirectories) {
+    const GlobMatcher anyDepth("**/foo");
+    EXPECT_TRUE(anyDepth.matches("foo"));
+    EXPECT_TRUE(anyDepth.matches("a/foo"));
+    EXPECT_TRUE(anyDepth.matches("a/b/foo"));
+    EXPECT_FALSE(anyDepth.matches("afoo"));
+    EXPECT_FALSE(anyDepth.matches("a/foo/bar"));
+
+    const GlobMatcher middle("a/**/b");
+    EXPECT_TRUE(middle.matches("a/b"));
+    EXPECT_TRUE(middle.matches("a/x/b"));
+    EXPECT_TRUE(middle.matches("a/x/y/b"));
+    EXPECT_FALSE(middle.matches("a/xb"));
+    EXPECT_FALSE(middle.matches("ab"));
+
+    const GlobMatcher below("logs/**");
+    EXPECT_TRUE(below.matches("logs/a"));
+    EXPECT_TRUE(below.matches("logs/a/b.txt"));
+    EXPECT_FALSE(below.matches("logs"));
+
+    EXPECT_TRUE(GlobMatcher("a**b").matches("aXb"));     // not a whole component: a plain '*'
+    EXPECT_FALSE(GlobMatcher("a**b").matches("a/b"));
+}
+
+TEST(GlobMatcherTest, HandlesGlobsLongerThanOneStateWord) {
+    std::string glob, path;
+    for (int i = 0; i < 40; ++i) {
+        glob += "?*";
+        path += "ab";
+    }
+    EXPECT_TRUE(GlobMatcher(glob).matches(path));
+    EXPECT_FALSE(GlobMatcher(glob + "?").matches(path.substr(0, 40)));
+}
+
+TEST(GlobSetTest, FindsTheLastMatchingGlob) {
+    GlobSet set;
+    EXPECT_EQ(set.add("*.log"), 0u);
+    EXPECT_EQ(set.add("debug.log"), 1u);
+    EXPECT_EQ(set.add("debug*"), 2u);
+    EXPECT_EQ(set.add("build", true), 3u);
+    EXPECT_EQ(set.add("src/*.log"), 4u);
+    EXPECT_EQ(set.addAnchored("top"), 5u);
+
+    EXPECT_EQ(set.lastMatch("a/app.log", false), 0u);
+    EXPECT_EQ(set.lastMatch("a/debug.log", false), 2u);
+    EXPECT_EQ(set.lastMatch("src/app.log", false), 4u);
+    EXPECT_EQ(set.lastMatch("x/build", true), 3u);
+    EXPECT_EQ(set.lastMatch("x/build", false), GlobSet::npos);   // directories only
+    EXPECT_EQ(set.lastMatch("top", false), 5u);
+    EXPECT_EQ(set.lastMatch("a/top", false), GlobSet::npos);     // anchored
+    EXPECT_FALSE(set.matches("readme.md", false));
+}
@@ -1,8 +1,11 @@
 #include <gtest/gtest.h>
 #include "grepLikeUtility.hpp"
+#include <algorithm>
 #include <filesystem>
 #include <fstream>
 #include <sstream>
+#include <mutex>
+#include <vector>
 
 // Helper function to create test files in examples/
 void createTestFile(const std::string& filename, const std::string& content) {
@@ -28,20 +31,20 @@ protected:
 TEST_F(GrepUtilityTest, CaseSensitiveSearchShouldMatchExact) {
     TextFileSearcher searcher;
     testing::internal::CaptureStdout();
-    searcher.search("examples/test1.txt", "Hello", true, false, false, "");  // Adding useRegex flag
+    searcher.search("examples/test1.txt", CompiledPattern("Hello", true, false), false, "");  // Adding useRegex flag
     std::string output = testing::internal::GetCapturedStdout();
-    EXPECT_TRUE(output.find("examples/test1.txt:1: [Thread ] Hello World") != std::string::npos);
-    EXPECT_FALSE(output.find("examples/test1.txt:2: [Thread ] hello earth") != std::string::npos);
+    EXPECT_TRUE(output.find("examples/test1.txt:1: Hello World") != std::string::npos);
+    EXPECT_FALSE(output.find("examples/test1.txt:2: hello earth") != std::string::npos);
 }
 
 TEST_F(GrepUtilityTest, CaseInsensitiveSearchShouldMatchAllVariants) {
     TextFileSearcher searcher;
     testing::internal::CaptureStdout();
-    searcher.search("examples/test1.txt", "hello", false, false, false, "");  // Adding useRegex flag
+    searcher.search("examples/test1.txt", CompiledPattern("hello", false, false), false, "");  // Adding useRegex flag
     std::string output = testing::internal::GetCapturedStdout();        
-    EXPECT_TRUE(output.find("examples/test1.txt:1: [Thread ] Hello World") != std::string::npos);
-    EXPECT_TRUE(output.find("examples/test1.txt:2: [Thread ] hello earth") != std::string::npos);
-    EXPECT_TRUE(output.find("examples/test1.txt:3: [Thread ] HELLO Galaxy") != std::string::npos);
+    EXPECT_TRUE(output.find("examples/test1.txt:1: Hello World") != std::string::npos);
+    EXPECT_TRUE(output.find("examples/test1.txt:2: hello earth") != std::string::npos);
+    EXPECT_TRUE(output.find("examples/test1.txt:3: HELLO Galaxy") != std::string::npos);
 }
 
 TEST_F(GrepUtilityTest, HighlightedOutputShouldContainColorCodes) {
@@ -54,24 +57,24 @@ TEST_F(GrepUtilityTest, HighlightedOutputShouldContainColorCodes) {
 TEST_F(GrepUtilityTest, RegexSearchShouldMatchPattern) {
     TextFileSearcher searcher;
     testing::internal::CaptureStdout();
-    searcher.search("examples/test2.txt", "colo.*", false, false, true, "");  // Adding useRegex flag
+    searcher.search("examples/test2.txt", CompiledPattern("colo.*", false, true), false, "");  // Adding useRegex flag
     std::string output = testing::internal::GetCapturedStdout();
-    EXPECT_TRUE(output.find("examples/test2.txt:1: [Thread ] Testing colors") != std::string::npos);
-    EXPECT_TRUE(output.find("examples/test2.txt:3: [Thread ] colors again") != std::string::npos);
+    EXPECT_TRUE(output.find("examples/test2.txt:1: Testing colors") != std::string::npos);
+    EXPECT_TRUE(output.find("examples/test2.txt:3: colors again") != std::string::npos);
 }
 
 TEST_F(GrepUtilityTest, RegexSearchWithCaseInsensitiveFlag) {
     TextFileSearcher searcher;
     testing::internal::CaptureStdout();
-    searcher.search("examples/test1.txt", "hello", false, false, true, "");  // Adding useRegex flag
+    searcher.search("examples/test1.txt", CompiledPattern("hello", false, true), false, "");  // Adding useRegex flag
     std::string output = testing::internal::GetCapturedStdout();
-    EXPECT_TRUE(output.find("examples/test1.txt:3: [Thread ] HELLO Galaxy") != std::string::npos);
+    EXPECT_TRUE(output.find("examples/test1.txt:3: HELLO Galaxy") != std::string::npos);
 }
 
 TEST_F(GrepUtilityTest, NoMatchShouldProduceNoOutput) {
     TextFileSearcher searcher;
     testing::internal::CaptureStdout();
-    searcher.search("examples/test3.txt", "unmatched", true, false, false, "");  // Adding useRegex flag
+    searcher.search("examples/test3.txt", CompiledPattern("unmatched", true, false), false, "");  // Adding useRegex flag
     std::string output = testing::internal::GetCapturedStdout();
     EXPECT_TRUE(output.empty());
 }
@@ -111,7 +114,7 @@ TEST_F(GrepUtilityTest, RegexSpecialCharactersShouldBeHandled) {
     createTestFile("test_regex.txt", "Question? Dot. Star*");
     TextFileSearcher searcher;
     testing::internal::CaptureStdout();
-    searcher.search("examples/test_regex.txt", "Question\\?", false, false, true, "");
+    searcher.search("examples/test_regex.txt", CompiledPattern("Question\\?", false, true), false, "");
     std::string output = testing::internal::GetCapturedStdout();
     EXPECT_TRUE(output.find("Question?") != std::string::npos);
 }
@@ -120,7 +123,7 @@ TEST_F(GrepUtilityTest, EmptyFileShouldProduceNoOutput) {
     createTestFile("empty.txt", "");
     TextFileSearcher searcher;
     testing::internal::CaptureStdout();
-    searcher.search("examples/empty.txt", "hello", false, false, false, "");
+    searcher.search("examples/empty.txt", CompiledPattern("hello", false, false), false, "");
     std::string output = testing::internal::GetCapturedStdout();
     EXPECT_TRUE(output.empty());
 }
@@ -129,7 +132,7 @@ TEST_F(GrepUtilityTest, FileWithOnlyNewlinesShouldNotMatch) {
     createTestFile("only_newlines.txt", "\n\n\n");
     TextFileSearcher searcher;
     testing::internal::CaptureStdout();
-    searcher.search("examples/only_newlines.txt", "hello", false, false, false, "");
+    searcher.search("examples/only_newlines.txt", CompiledPattern("hello", false, false), false, "");
     std::string output = testing::internal::GetCapturedStdout();
     EXPECT_TRUE(output.empty());
 }
@@ -144,7 +147,527 @@ TEST_F(GrepUtilityTest, MultipleMatchesInOneLine) {
     createTestFile("multi.txt", "test test test");
     TextFileSearcher searcher;
     testing::internal::CaptureStdout();
-    searcher.search("examples/multi.txt", "test", false, false, false, "");
+    searcher.search("examples/multi.txt", CompiledPattern("test", false, false), false, "");
     std::string output = testing::internal::GetCapturedStdout();
     EXPECT_TRUE(output.find("test test test") != std::string::npos);
 }
+
+TEST_F(GrepUtilityTest, LargeFileIsSplitIntoRangesWithCorrectLineNumbers) {
+    std::string content;
+    for (int i = 1; i <= 200; ++i) {
+        content += (i % 50 == 0 ? "needle at line " + std::to_string(i) : "filler") + "\n";
+    }
+    createTestFile("large.txt", content);
+
+    std::unique_ptr<FileSearcher> searcher = std::make_unique<TextFileSearcher>();
+    SearchManager manager(std::move(searcher), "needle", true, false, false);
+    manager.setNumThreads(3);
+    manager.setRangeSize(100);  // the file is ~1.5 KB, so it is split into many ranges
+    testing::internal::CaptureStdout();
+    manager.searchInDirectory("examples");
+    std::string output = testing::internal::GetCapturedStdout();
+    for (int line : {50, 100, 150, 200}) {
+        std::string expected = "large.txt:" + std::to_string(line) + ": [Thread ";
+        EXPECT_NE(output.find(expected), std::string::npos) << expected;
+        EXPECT_NE(output.find("needle at line " + std::to_string(line)), std::string::npos);
+    }
+    EXPECT_NE(output.find("Thread 3: "), std::string::npos);
+    EXPECT_EQ(manager.getNumThreads(), 3u);
+}
+
+TEST_F(GrepUtilityTest, SingleLargeFileIsSearchedInParallelInFileOrder) {
+    std::string content;
+    for (int i = 1; i <= 1000; ++i) {
+        content += (i % 7 == 0 ? "match " + std::to_string(i) : "filler line") + "\n";
+    }
+    createTestFile("single.txt", content);
+
+    std::unique_ptr<FileSearcher> searcher = std::make_unique<TextFileSearcher>();
+    SearchManager manager(std::move(searcher), "match", true, false, false);
+    manager.setNumThreads(4);
+    manager.setRangeSize(256);
+    testing::internal::CaptureStdout();
+    manager.searchInDirectory("examples/single.txt");
+    std::string output = testing::internal::GetCapturedStdout();
+
+    size_t previous = std::string::npos;
+    for (int i = 7; i <= 1000; i += 7) {
+        std::string expected = "examples/single.txt:" + std::to_string(i) + ": [Thread ";
+        size_t position = output.find(expected);
+        ASSERT_NE(position, std::string::npos) << expected;
+        if (previous != std::string::npos) {
+            EXPECT_GT(position, previous) << "line " << i << " printed out of order";
+        }
+        EXPECT_NE(output.find("match " + std::to_string(i) + "\n", position), std::string::npos);
+        previous = position;
+    }
+}
+
+TEST_F(GrepUtilityTest, SortedOutputIsOrderedByPathAndReproducible) {
+    std::filesystem::create_directories("examples/sorted/b");
+    for (const char* name : {"sorted/c.txt", "sorted/a.txt", "sorted/b/z.txt", "sorted/b/a.txt"})
+        createTestFile(name, "colors one\nplain\ncolors two\n");
+
+    auto runSearch = [] {
+        std::unique_ptr<FileSearcher> searcher = std::make_unique<TextFileSearcher>();
+        SearchManager manager(std::move(searcher), "colors", true, false, false);
+        manager.setNumThreads(4);
+        manager.setOrderedOutput(true);
+        testing::internal::CaptureStdout();
+        testing::internal::CaptureStderr();
+        manager.searchInDirectory("examples/sorted");
+        testing::internal::GetCapturedStderr();
+        return testing::internal::GetCapturedStdout();
+    };
+
+    const std::string output = runSearch();
+    std::string expected;
+    for (const char* name : {"a.txt", "b/a.txt", "b/z.txt", "c.txt"}) {
+        expected += std::string("examples/sorted/") + name + ":1: colors one\n";
+        expected += std::string("examples/sorted/") + name + ":3: colors two\n";
+    }
+    EXPECT_EQ(output, expected);
+    EXPECT_EQ(runSearch(), output);
+}
+
+namespace {
+
+/// Collects every delivered result, for checking them after the search.
+class CollectingSink : public ResultSink {
+public:
+    void consume(std::vector<SearchResult>& batch, const std::string&) override {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (auto& result : batch)
+            results.push_back(std::move(result));
+    }
+
+    std::mutex mutex;
+    std::vector<SearchResult> results;
+};
+
+}  // namespace
+
+TEST_F(GrepUtilityTest, ResultsCarryLineNumberByteOffsetAndSpans) {
+    createTestFile("spans.txt", "no\nab cab ab\nnone\nxab");
+    TextFileSearcher searcher;
+    CollectingSink sink;
+    testing::internal::CaptureStdout();
+    searcher.search("examples/spans.txt", CompiledPattern("ab"), sink);
+    EXPECT_EQ(testing::internal::GetCapturedStdout(), "");
+
+    ASSERT_EQ(sink.results.size(), 2u);
+    const SearchResult& first = sink.results[0];
+    EXPECT_EQ(first.path, "examples/spans.txt");
+    EXPECT_EQ(first.lineNumber, 2u);
+    EXPECT_EQ(first.byteOffset, 3u);
+    EXPECT_EQ(first.line, "ab cab ab");
+    ASSERT_EQ(first.spans.size(), 3u);
+    EXPECT_EQ(first.spans[0].position, 0u);
+    EXPECT_EQ(first.spans[1].position, 4u);
+    EXPECT_EQ(first.spans[2].position, 7u);
+    EXPECT_EQ(first.spans[2].length, 2u);
+    EXPECT_EQ(sink.results[1].lineNumber, 4u);
+    EXPECT_EQ(sink.results[1].byteOffset, 18u);
+    EXPECT_EQ(highlightSpans(first.line, first.spans), highlightMatches(first.line, CompiledPattern("ab")));
+}
+
+TEST_F(GrepUtilityTest, RegexResultsCarrySpans) {
+    TextFileSearcher searcher;
+    CollectingSink sink;
+    searcher.search("examples/test2.txt", CompiledPattern("col[a-z]+", true, true), sink);
+    ASSERT_EQ(sink.results.size(), 2u);
+    EXPECT_EQ(sink.results[1].line, "colors again");
+    ASSERT_EQ(sink.results[1].spans.size(), 1u);
+    EXPECT_EQ(sink.results[1].spans[0].position, 0u);
+    EXPECT_EQ(sink.results[1].spans[0].length, 6u);
+}
+
+TEST_F(GrepUtilityTest, ResultCallbackReplacesConsoleOutput) {
+    std::string content;
+    for (int i = 1; i <= 300; ++i)
+        content += (i % 3 == 0 ? "needle " + std::to_string(i) : "filler") + "\n";
+    createTestFile("callback.txt", content);
+
+    std::unique_ptr<FileSearcher> searcher = std::make_unique<TextFileSearcher>();
+    SearchManager manager(std::move(searcher), "needle", true, true, false);
+    manager.setNumThreads(3);
+    manager.setRangeSize(128);
+    std::vector<SearchResult> results;
+    manager.setResultCallback([&results](const SearchResult& result) { results.push_back(result); });
+    testing::internal::CaptureStdout();
+    manager.searchInDirectory("examples/callback.txt");
+    EXPECT_EQ(testing::internal::GetCapturedStdout(), "");
+
+    ASSERT_EQ(results.size(), 100u);
+    for (size_t i = 0; i < results.size(); ++i) {
+        const SearchResult& result = results[i];
+        EXPECT_EQ(result.lineNumber, 3 * (i + 1));
+        EXPECT_EQ(content.compare(result.byteOffset, result.line.size(), result.line), 0);
+        ASSERT_EQ(result.spans.size(), 1u);
+        EXPECT_EQ(result.line.substr(result.spans[0].position, result.spans[0].length), "needle");
+    }
+}
+
+TEST_F(GrepUtilityTest, PatternListOutputNamesEveryMatchedPattern) {
+    createTestFile("codes.txt", "E100 then E200\nnothing\nonly E300 here\n");
+    auto pattern = std::make_shared<const CompiledPattern>(std::vector<std::string>{"E100", "E200", "E300"});
+    std::unique_ptr<FileSearcher> searcher = std::make_unique<TextFileSearcher>();
+    SearchManager manager(std::move(searcher), pattern, true);
+    manager.setNumThreads(2);
+    manager.setOrderedOutput(true);
+    testing::internal::CaptureStdout();
+    testing::internal::CaptureStderr();
+    manager.searchInDirectory("examples/codes.txt");
+    testing::internal::GetCapturedStderr();
+    const std::string output = testing::internal::GetCapturedStdout();
+
+    EXPECT_NE(output.find(":1: [pattern: E100, E200] \033[33mE100\033[0m then \033[33mE200\033[0m\n"),
+              std::string::npos) << output;
+    EXPECT_NE(output.find(":3: [pattern: E300] only \033[33mE300\033[0m here\n"), std::string::npos);
+    EXPECT_EQ(output.find("nothing"), std::string::npos);
+}
+
+TEST_F(GrepUtilityTest, BinaryFilesFollowTheBinaryPolicy) {
+    createTestFile("blob.bin", std::string("ELF\0\0 needle inside\nneedle again\n", 34));
+    const CompiledPattern pattern("needle");
+
+    CollectingSink skipped;
+    TextFileSearcher(BinaryPolicy::Skip).search("examples/blob.bin", pattern, skipped);
+    EXPECT_TRUE(skipped.results.empty());
+
+    CollectingSink reported;
+    TextFileSearcher(BinaryPolicy::Report).search("examples/blob.bin", pattern, reported);
+    ASSERT_EQ(reported.results.size(), 1u);
+    EXPECT_TRUE(reported.results[0].binary);
+    EXPECT_EQ(reported.results[0].path, "examples/blob.bin");
+
+    CollectingSink none;
+    TextFileSearcher(BinaryPolicy::Report).search("examples/blob.bin", CompiledPattern("absent"), none);
+    EXPECT_TRUE(none.results.empty());
+
+    CollectingSink asText;
+    TextFileSearcher(BinaryPolicy::Text).search("examples/blob.bin", pattern, asText);
+    ASSERT_EQ(asText.results.size(), 2u);
+    EXPECT_FALSE(asText.results[0].binary);
+    EXPECT_EQ(asText.results[1].lineNumber, 2u);
+
+    testing::internal::CaptureStdout();
+    TextFileSearcher().search("examples/blob.bin", pattern, false);
+    EXPECT_EQ(testing::internal::GetCapturedStdout(), "Binary file examples/blob.bin matches\n");
+}
+
+TEST_F(GrepUtilityTest, Utf16FilesAreTranscodedAndSearched) {
+    // "first line\nsecond ☃ needle\n" in UTF-16LE with a BOM, then the same in UTF-16BE.
+    const std::u16string text = u"first line\nsecond ☃ needle\n";
+    std::string little("\xFF\xFE", 2);
+    std::string big("\xFE\xFF", 2);
+    for (const char16_t unit : text) {
+        little += static_cast<char>(unit & 0xFF);
+        little += static_cast<char>(unit >> 8);
+        big += static_cast<char>(unit >> 8);
+        big += static_cast<char>(unit & 0xFF);
+    }
+    createTestFile("little.txt", little);
+    createTestFile("big.txt", big);
+
+    for (const std::string file : {"examples/little.txt", "examples/big.txt"}) {
+        CollectingSink sink;
+        TextFileSearcher().search(file, CompiledPattern("\xE2\x98\x83 needle"), sink);
+        ASSERT_EQ(sink.results.size(), 1u) << file;
+        EXPECT_EQ(sink.results[0].lineNumber, 2u);
+        EXPECT_EQ(sink.results[0].line, "second \xE2\x98\x83 needle");
+        EXPECT_EQ(sink.results[0].byteOffset, 11u);
+    }
+}
+
+TEST_F(GrepUtilityTest, CountAndFilesWithMatchesModesReportOneSummaryPerFile) {
+    createTestFile("many.txt", "needle 1\nhay\nneedle 2\nneedle 3\n");
+    const CompiledPattern pattern("needle");
+
+    TextFileSearcher counter;
+    counter.setReportMode(ReportMode::Count);
+    EXPECT_FALSE(counter.supportsRanges());
+    CollectingSink counted;
+    counter.search("examples/many.txt", pattern, counted);
+    ASSERT_EQ(counted.results.size(), 1u);
+    EXPECT_EQ(counted.results[0].matchCount, 3u);
+    EXPECT_EQ(counted.results[0].path, "examples/many.txt");
+    EXPECT_TRUE(counted.results[0].line.empty());
+
+    CollectingSink none;
+    counter.search("examples/test3.txt", pattern, none);
+    EXPECT_TRUE(none.results.empty());
+
+    TextFileSearcher lister;
+    lister.setReportMode(ReportMode::FilesWithMatches);
+    CollectingSink listed;
+    lister.search("examples/many.txt", pattern, listed);
+    ASSERT_EQ(listed.results.size(), 1u);
+    EXPECT_EQ(listed.results[0].matchCount, 1u);    // done at the first match
+
+    // A binary file is counted like text: there are no lines to print.
+    createTestFile("blob.bin", std::string("\0needle\nneedle\n", 15));
+    CollectingSink binary;
+    counter.search("examples/blob.bin", pattern, binary);
+    ASSERT_EQ(binary.results.size(), 1u);
+    EXPECT_FALSE(binary.results[0].binary);
+    EXPECT_EQ(binary.results[0].matchCount, 2u);
+}
+
+TEST_F(GrepUtilityTest, MaxCountStopsReadingAFile) {
+    std::string content;
+    for (int i = 1; i <= 100; ++i)
+        content += "needle " + std::to_string(i) + "\n";
+    createTestFile("hundred.txt", content);
+
+    TextFileSearcher searcher;
+    searcher.setMaxCount(3);
+    CollectingSink lines;
+    searcher.search("examples/hundred.txt", CompiledPattern("needle"), lines);
+    ASSERT_EQ(lines.results.size(), 3u);
+    EXPECT_EQ(lines.results[2].lineNumber, 3u);
+    EXPECT_EQ(lines.results[2].line, "needle 3");
+
+    searcher.setReportMode(ReportMode::Count);
+    CollectingSink counted;
+    searcher.search("examples/hundred.txt", CompiledPattern("needle [0-9]+", true, true), counted);
+    ASSERT_EQ(counted.results.size(), 1u);
+    EXPECT_EQ(counted.results[0].matchCount, 3u);
+}
+
+TEST_F(GrepUtilityTest, SummariesArePrintedAsPathsOrCounts) {
+    auto run = [](ReportMode mode) {
+        auto searcher = std::make_unique<TextFileSearcher>();
+        searcher->setReportMode(mode);
+        SearchManager manager(std::move(searcher), "colors");
+        manager.setOrderedOutput(true);
+        testing::internal::CaptureStdout();
+        testing::internal::CaptureStderr();
+        manager.searchInDirectory("examples");
+        testing::internal::GetCapturedStderr();
+        return testing::internal::GetCapturedStdout();
+    };
+    EXPECT_EQ(run(ReportMode::FilesWithMatches), "examples/test2.txt\n");
+    EXPECT_EQ(run(ReportMode::Count), "examples/test2.txt:2\n");
+}
+
+TEST_F(GrepUtilityTest, ResultLimitStopsTheSearch) {
+    for (int file = 0; file < 50; ++file) {
+        std::string content;
+        for (int i = 0; i < 20; ++i)
+            content += "needle\n";
+        createTestFile("limit" + std::to_string(file) + ".txt", content);
+    }
+    SearchManager manager(std::make_unique<TextFileSearcher>(), "needle");
+    manager.setNumThreads(4);
+    manager.setResultLimit(25);
+    std::vector<SearchResult> results;
+    manager.setResultCallback([&results](const SearchResult& result) { results.push_back(result); });
+    manager.searchInDirectory("examples");
+    EXPECT_EQ(results.size(), 25u);
+
+    // Summaries count as one result each.
+    auto lister = std::make_unique<TextFileSearcher>();
+    lister->setReportMode(ReportMode::FilesWithMatches);
+    SearchManager listing(std::move(lister), "needle");
+    listing.setNumThreads(4);
+    listing.setResultLimit(7);
+    results.clear();
+    listing.setResultCallback([&results](const SearchResult& result) { results.push_back(result); });
+    listing.searchInDirectory("examples");
+    EXPECT_EQ(results.size(), 7u);
+}
+
+TEST_F(GrepUtilityTest, ContextLinesSurroundMatchesAndMerge) {
+    std::string content;
+    for (int i = 1; i <= 20; ++i)
+        content += (i == 5 || i == 7 || i == 15 ? "needle " : "line ") + std::to_string(i) + "\n";
+    createTestFile("context.txt", content);
+
+    TextFileSearcher searcher;
+    searcher.setContext(2, 1);
+    EXPECT_FALSE(searcher.supportsRanges());
+    CollectingSink sink;
+    searcher.search("examples/context.txt", CompiledPattern("needle"), sink);
+
+    std::vector<std::string> lines;
+    for (const SearchResult& result : sink.results) {
+        lines.push_back(std::to_string(result.lineNumber) + (result.context ? "-" : ":") +
+                        (result.gapBefore ? " gap" : ""));
+        EXPECT_EQ(content.compare(result.byteOffset, result.line.size() + 1, result.line + "\n"), 0);
+        EXPECT_EQ(result.spans.empty(), result.context);
+    }
+    EXPECT_EQ(lines, (std::vector<std::string>{"3-", "4-", "5:", "6-", "7:", "8-",
+                                               "13- gap", "14-", "15:", "16-"}));
+
+    // Without context lines nothing is marked, and summaries ignore the context.
+    TextFileSearcher plain;
+    CollectingSink matches;
+    plain.search("examples/context.txt", CompiledPattern("needle"), matches);
+    ASSERT_EQ(matches.results.size(), 3u);
+    EXPECT_FALSE(matches.results[2].gapBefore);
+
+    searcher.setReportMode(ReportMode::Count);
+    CollectingSink counted;
+    searcher.search("examples/context.txt", CompiledPattern("needle"), counted);
+    ASSERT_EQ(counted.results.size(), 1u);
+    EXPECT_EQ(counted.results[0].matchCount, 3u);
+}
+
+TEST_F(GrepUtilityTest, ContextAfterTheMaxCountIsDeliveredAsContext) {
+    createTestFile("trailing.txt", "needle 1\nneedle 2\nline 3\nline 4\n");
+    TextFileSearcher searcher;
+    searcher.setMaxCount(1);
+    searcher.setContext(0, 2);
+    CollectingSink sink;
+    searcher.search("examples/trailing.txt", CompiledPattern("needle"), sink);
+    ASSERT_EQ(sink.results.size(), 3u);
+    EXPECT_FALSE(sink.results[0].context);
+    EXPECT_TRUE(sink.results[1].context);
+    EXPECT_EQ(sink.results[1].line, "needle 2");
+    EXPECT_TRUE(sink.results[2].context);
+    EXPECT_EQ(sink.results[2].lineNumber, 3u);
+}
+
+TEST_F(GrepUtilityTest, ContextLinesCrossTranscodedChunks) {
+    // The same lines as UTF-8 and as UTF-16LE, long enough for several transcoded chunks.
+    std::string utf8;
+    std::string utf16("\xFF\xFE", 2);
+    for (int i = 1; i <= 150000; ++i) {
+        const std::string line = "line " + std::to_string(i) + (i % 10000 == 0 ? " needle" : "") + "\n";
+        utf8 += line;
+        for (const char c : line) {
+            utf16 += c;
+            utf16 += '\0';
+        }
+    }
+    ASSERT_GT(utf16.size(), 3 * TextFileSearcher::kTranscodeChunkSize);
+    createTestFile("context8.txt", utf8);
+    createTestFile("context16.txt", utf16);
+
+    // Also match a line next to every chunk boundary, so its context straddles it.
+    std::string query = "needle";
+    for (size_t chunk = 1; chunk * TextFileSearcher::kTranscodeChunkSize < utf16.size(); ++chunk) {
+        const size_t offset = (chunk * TextFileSearcher::kTranscodeChunkSize - 2) / 2;    // after the BOM
+        const size_t line = std::count(utf8.begin(), utf8.begin() + offset, '\n') + 1;
+        // Odd boundaries need the lines kept before a chunk, even ones the window carried over.
+        query += "|^line " + std::to_string(chunk % 2 == 1 ? line + 1 : line - 1) + "$";
+    }
+    const CompiledPattern pattern(query, true, true);
+    TextFileSearcher searcher;
+    searcher.setContext(3, 2);
+    CollectingSink expected;
+    CollectingSink actual;
+    searcher.search("examples/context8.txt", pattern, expected);
+    searcher.search("examples/context16.txt", pattern, actual);
+    ASSERT_EQ(actual.results.size(), expected.results.size());
+    for (size_t i = 0; i < expected.results.size(); ++i) {
+        EXPECT_EQ(actual.results[i].lineNumber, expected.results[i].lineNumber);
+        EXPECT_EQ(actual.results[i].line, expected.results[i].line);
+        EXPECT_EQ(actual.results[i].context, expected.results[i].context);
+        EXPECT_EQ(actual.results[i].gapBefore, expected.results[i].gapBefore);
+    }
+}
+
+TEST_F(GrepUtilityTest, ContextLinesArePrintedWithSeparators) {
+    createTestFile("printed.txt", "a\nb\nneedle\nc\nd\ne\nf\nneedle\n");
+    auto searcher = std::make_unique<TextFileSearcher>();
+    searcher->setContext(1, 1);
+    SearchManager manager(std::move(searcher), "needle");
+    manager.setOrderedOutput(true);
+    testing::internal::CaptureStdout();
+    testing::internal::CaptureStderr();
+    manager.searchInDirectory("examples/printed.txt");
+    testing::internal::GetCapturedStderr();
+    EXPECT_EQ(testing::internal::GetCapturedStdout(),
+              "examples/printed.txt-2- b\n"
+              "examples/printed.txt:3: needle\n"
+              "examples/printed.txt-4- c\n"
+              "--\n"
+              "examples/printed.txt-7- f\n"
+              "examples/printed.txt:8: needle\n");
+
+    // The result limit counts matched lines only.
+    auto limited = std::make_unique<TextFileSearcher>();
+    limited->setContext(1, 1);
+    SearchManager first(std::move(limited), "needle");
+    first.setResultLimit(1);
+    std::vector<SearchResult> results;
+    first.setResultCallback([&results](const SearchResult& result) { results.push_back(result); });
+    first.searchInDirectory("examples/printed.txt");
+    ASSERT_EQ(results.size(), 2u);
+    EXPECT_TRUE(results[0].context);
+    EXPECT_EQ(results[1].line, "needle");
+}
+
+TEST_F(GrepUtilityTest, ZeroContextLinesStillSeparateMatches) {
+    // Like grep -C 0: no context lines, but matches that are not adjacent are separated.
+    createTestFile("zero.txt", "a\nx\nb\nc\na\na\n");
+    auto searcher = std::make_unique<TextFileSearcher>();
+    searcher->setContext(0, 0);
+    EXPECT_FALSE(searcher->supportsRanges());
+    SearchManager manager(std::move(searcher), "a");
+    manager.setOrderedOutput(true);
+    testing::internal::CaptureStdout();
+    testing::internal::CaptureStderr();
+    manager.searchInDirectory("examples/zero.txt");
+    testing::internal::GetCapturedStderr();
+    EXPECT_EQ(testing::internal::GetCapturedStdout(),
+              "examples/zero.txt:1: a\n"
+              "--\n"
+              "examples/zero.txt:5: a\n"
+              "examples/zero.txt:6: a\n");
+}
+
+TEST_F(GrepUtilityTest, UringBackendFindsWhatWorkerReadsFind) {
+    std::filesystem::create_directories("examples/io/sub");
+    for (int file = 0; file < 40; ++file)
+        createTestFile("io/" + std::string(file % 2 ? "sub/" : "") + std::to_string(file) + ".txt",
+                       "colors " + std::to_string(file) + "\nplain\n");
+    std::string large;
+    for (int i = 1; i <= 2000; ++i)
+        large += (i % 100 == 0 ? "colors at " + std::to_string(i) : "filler line") + "\n";
+    createTestFile("io/large.txt", large);
+
+    auto run = [](IoBackend backend) {
+        SearchManager manager(std::make_unique<TextFileSearcher>(), "colors");
+        manager.setNumThreads(2);
+        manager.setRangeSize(4096);     // large.txt is split, the other files are read ahead
+        manager.setOrderedOutput(true);
+        manager.setIoBackend(backend);
+        testing::internal::CaptureStdout();
+        testing::internal::CaptureStderr();
+        manager.searchInDirectory("examples/io");
+        testing::internal::GetCapturedStderr();
+        return testing::internal::GetCapturedStdout();
+    };
+    const std::string sync = run(IoBackend::Sync);
+    EXPECT_EQ(std::count(sync.begin(), sync.end(), '\n'), 60);
+    EXPECT_EQ(run(IoBackend::Uring), sync);
+}
+
+TEST_F(GrepUtilityTest, MemoryLimitThrottlesButFindsEverything) {
+    std::filesystem::create_directories("examples/memory");
+    for (int file = 0; file < 30; ++file)
+        createTestFile("memory/" + std::to_string(file) + ".txt", "colors " + std::to_string(file) + "\nplain\n");
+    createTestFile("memory/large.txt", std::string(FileBuffer::kMapThreshold, 'x') + "\ncolors at the end\n");
+
+    auto run = [](IoBackend backend, size_t memoryLimit) {
+        SearchManager manager(std::make_unique<TextFileSearcher>(), "colors");
+        manager.setNumThreads(3);
+        manager.setOrderedOutput(true);
+        manager.setIoBackend(backend);
+        manager.setMemoryLimit(memoryLimit);
+        testing::internal::CaptureStdout();
+        testing::internal::CaptureStderr();
+        manager.searchInDirectory("examples/memory");
+        testing::internal::GetCapturedStderr();
+        return testing::internal::GetCapturedStdout();
+    };
+    const std::string unlimited = run(IoBackend::Sync, 0);
+    EXPECT_EQ(std::count(unlimited.begin(), unlimited.end(), '\n'), 31);
+    // Smaller than a single file: one file is in flight at a time.
+    EXPECT_EQ(run(IoBackend::Sync, 1), unlimited);
+    EXPECT_EQ(run(IoBackend::Uring, 1), unlimited);
+    EXPECT_EQ(run(IoBackend::Uring, 4 * FileBuffer::kBlockSize), unlimited);
+}
@@ -0,0 +1,55 @@
+#include <gtest/gtest.h>
+#include "literalMatcher.hpp"
+#include <random>
+#include <string>
+#include <string_view>
+
+namespace {
+
+const LiteralMatcher::Kernel kAllKernels[] = {
+    LiteralMatcher::Kernel::Scalar, LiteralMatcher::Kernel::Sse2, LiteralMatcher::Kernel::Avx2};
+
+}  // namespace
+
+TEST(LiteralMatcherTest, FindsFirstOccurrenceWithEveryKernel) {
+    std::string haystack(1000, 'a');
+    haystack.replace(700, 6, "needle");
+    haystack.replace(900, 6, "needle");
+    for (auto kernel : kAllKernels) {
+        LiteralMatcher matcher("needle", kernel);
+        EXPECT_EQ(matcher.find(haystack), 700u);
+        EXPECT_EQ(matcher.find(haystack, 701), 900u);
+        EXPECT_EQ(matcher.find(haystack, 901), std::string_view::npos);
+    }
+}
+
+TEST(LiteralMatcherTest, HandlesEdgeCases) {
+    for (auto kernel : kAllKernels) {
+        EXPECT_EQ(LiteralMatcher("", kernel).find("abc", 1), 1u);
+        EXPECT_EQ(LiteralMatcher("c", kernel).find("abc"), 2u);
+        EXPECT_EQ(LiteralMatcher("abcd", kernel).find("abc"), std::string_view::npos);
+        EXPECT_EQ(LiteralMatcher("bc", kernel).find("abc", 5), std::string_view::npos);
+        EXPECT_EQ(LiteralMatcher("abc", kernel).find("abc"), 0u);
+    }
+}
+
+TEST(LiteralMatcherTest, AgreesWithStdFindOnRandomInput) {
+    std::mt19937 rng(42);
+    std::uniform_int_distribution<int> letter('a', 'd');
+    std::string haystack(5000, ' ');
+    for (auto& c : haystack) {
+        c = static_cast<char>(letter(rng));
+    }
+
+    for (int trial = 0; trial < 200; ++trial) {
+        std::string needle(1 + trial % 7, ' ');
+        for (auto& c : needle) {
+            c = static_cast<char>(letter(rng));
+        }
+        const size_t from = static_cast<size_t>(trial * 13) % haystack.size();
+        const size_t expected = std::string_view(haystack).find(needle, from);
+        for (auto kernel : kAllKernels) {
+            EXPECT_EQ(LiteralMatcher(needle, kernel).find(haystack, from), expected) << needle;
+        }
+    }
+}
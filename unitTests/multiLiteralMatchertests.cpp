@@ -0,0 +1,113 @@
+#include <gtest/gtest.h>
+#include "multiLiteralMatcher.hpp"
+#include "compiledPattern.hpp"
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+/// Leftmost, then longest match by brute force; duplicates resolve to the first index.
+MatchSpan naiveFind(const std::vector<std::string>& patterns, const std::string& text, size_t from) {
+    MatchSpan best;
+    for (size_t start = from; start < text.size() && !best; ++start) {
+        for (size_t i = 0; i < patterns.size(); ++i) {
+            const std::string& pattern = patterns[i];
+            if (pattern.empty() || text.compare(start, pattern.size(), pattern) != 0)
+                continue;
+            if (!best || pattern.size() > best.length)
+                best = {start, pattern.size(), i};
+        }
+    }
+    return best;
+}
+
+}  // namespace
+
+TEST(MultiLiteralMatcherTest, FindsLeftmostLongestAndNamesThePattern) {
+    MultiLiteralMatcher matcher({"bc", "abcd", "abc", "x"});
+    MatchSpan match = matcher.find("zzabcdzz");
+    EXPECT_EQ(match.position, 2u);
+    EXPECT_EQ(match.length, 4u);
+    EXPECT_EQ(match.pattern, 1u);
+
+    match = matcher.find("zzabcdzz", 3);
+    EXPECT_EQ(match.position, 3u);
+    EXPECT_EQ(match.pattern, 0u);
+
+    EXPECT_FALSE(matcher.find("nothing here"));
+    EXPECT_FALSE(matcher.find("abc", 4));
+}
+
+TEST(MultiLiteralMatcherTest, SuffixPatternsAreReportedThroughFailureLinks) {
+    MultiLiteralMatcher matcher({"she", "he", "hers"});
+    const MatchSpan match = matcher.find("ahe");
+    EXPECT_EQ(match.position, 1u);
+    EXPECT_EQ(match.pattern, 1u);
+    EXPECT_EQ(matcher.find("ushers").pattern, 0u);
+}
+
+TEST(MultiLiteralMatcherTest, CaseInsensitiveFoldsAscii) {
+    MultiLiteralMatcher matcher({"Error", "WARN"}, false);
+    const MatchSpan match = matcher.find("a warning and an ERROR");
+    EXPECT_EQ(match.position, 2u);
+    EXPECT_EQ(match.pattern, 1u);
+    EXPECT_EQ(matcher.find("a warning and an ERROR", 3).position, 17u);
+}
+
+TEST(MultiLiteralMatcherTest, UsesOneClassForBytesOutsideThePatterns) {
+    MultiLiteralMatcher matcher({"ab", "ba"});
+    EXPECT_EQ(matcher.classCount(), 3u);
+    EXPECT_EQ(matcher.stateCount(), 5u);
+}
+
+TEST(MultiLiteralMatcherTest, MatchesBruteForceOnRandomInput) {
+    std::mt19937 rng(7);
+    auto randomString = [&rng](size_t maxLength, const char* alphabet, size_t alphabetSize) {
+        std::string s(rng() % maxLength + 1, ' ');
+        for (char& c : s)
+            c = alphabet[rng() % alphabetSize];
+        return s;
+    };
+
+    // Few start bytes (vector skip) and many (table skip).
+    for (const char* alphabet : {"abc", "abcdefghij"}) {
+        const size_t alphabetSize = std::char_traits<char>::length(alphabet);
+        for (int round = 0; round < 200; ++round) {
+            std::vector<std::string> patterns;
+            const size_t count = rng() % 20 + 1;
+            for (size_t i = 0; i < count; ++i)
+                patterns.push_back(randomString(5, alphabet, alphabetSize));
+            const std::string text = randomString(100, "abcdefghijxyz", 13) + std::string(20, 'z');
+            MultiLiteralMatcher matcher(patterns);
+
+            for (size_t from = 0; from <= text.size(); from += 7) {
+                const MatchSpan expected = naiveFind(patterns, text, from);
+                const MatchSpan actual = matcher.find(text, from);
+                ASSERT_EQ(actual.position, expected.position) << text << " from " << from;
+                if (expected) {
+                    ASSERT_EQ(actual.length, expected.length);
+                    ASSERT_EQ(patterns[actual.pattern], patterns[expected.pattern]);
+                }
+            }
+        }
+    }
+}
+
+TEST(MultiLiteralMatcherTest, CompiledPatternListDropsEmptyPatterns) {
+    CompiledPattern pattern(std::vector<std::string>{"E100", "", "E200"});
+    EXPECT_TRUE(pattern.isPatternList());
+    ASSERT_EQ(pattern.patterns().size(), 2u);
+    const MatchSpan match = pattern.find("code E200 and E100");
+    EXPECT_EQ(match.position, 5u);
+    EXPECT_EQ(pattern.patterns()[match.pattern], "E200");
+    EXPECT_TRUE(pattern.matchesLine("xE100"));
+    EXPECT_FALSE(pattern.matchesLine("E300"));
+
+    CompiledPattern single(std::vector<std::string>{"", "needle"}, false);
+    EXPECT_TRUE(single.matchesLine("a NEEDLE"));
+    EXPECT_EQ(single.find("a NEEDLE").pattern, 0u);
+
+    CompiledPattern none(std::vector<std::string>{});
+    EXPECT_FALSE(none.matchesLine("anything"));
+}
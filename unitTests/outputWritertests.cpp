@@ -0,0 +1,80 @@
+#include <gtest/gtest.h>
+#include "outputWriter.hpp"
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+std::string readAll(std::FILE* file) {
+    std::fflush(file);
+    std::rewind(file);
+    std::string content;
+    char buffer[4096];
+    size_t bytes;
+    while ((bytes = std::fread(buffer, 1, sizeof(buffer), file)) > 0)
+        content.append(buffer, bytes);
+    return content;
+}
+
+}  // namespace
+
+TEST(OutputWriterTest, StreamingKeepsEveryChunkWhole) {
+    std::FILE* file = std::tmpfile();
+    ASSERT_NE(file, nullptr);
+    {
+        OutputWriter writer(file);
+        std::vector<std::thread> producers;
+        for (int t = 0; t < 4; ++t) {
+            producers.emplace_back([&writer, t] {
+                for (int i = 0; i < 500; ++i) {
+                    const std::string line = "worker" + std::to_string(t) + " chunk" + std::to_string(i);
+                    writer.write("file" + std::to_string(t), line + " first\n" + line + " second\n");
+                }
+            });
+        }
+        for (auto& producer : producers)
+            producer.join();
+        writer.finish();
+    }
+
+    const std::string content = readAll(file);
+    std::fclose(file);
+    for (int t = 0; t < 4; ++t) {
+        for (int i = 0; i < 500; ++i) {
+            const std::string line = "worker" + std::to_string(t) + " chunk" + std::to_string(i);
+            EXPECT_NE(content.find(line + " first\n" + line + " second\n"), std::string::npos) << line;
+        }
+    }
+}
+
+TEST(OutputWriterTest, OrderedModeWritesByPathOnFinish) {
+    std::FILE* file = std::tmpfile();
+    ASSERT_NE(file, nullptr);
+    OutputWriter writer(file, true);
+    EXPECT_TRUE(writer.orderedByPath());
+    writer.write("b.txt", "b1\n");
+    writer.write("a.txt", "a1\n");
+    writer.write("b.txt", "b2\n");
+    writer.write("c.txt", "");
+    EXPECT_EQ(readAll(file), "");
+
+    writer.finish();
+    EXPECT_EQ(readAll(file), "a1\nb1\nb2\n");
+
+    writer.write("z.txt", "late\n");  // written directly once finished
+    EXPECT_EQ(readAll(file), "a1\nb1\nb2\nlate\n");
+    std::fclose(file);
+}
+
+TEST(OutputWriterTest, DestructorFlushesQueuedOutput) {
+    std::FILE* file = std::tmpfile();
+    ASSERT_NE(file, nullptr);
+    {
+        OutputWriter writer(file);
+        writer.write("x", "pending\n");
+    }
+    EXPECT_EQ(readAll(file), "pending\n");
+    std::fclose(file);
+}
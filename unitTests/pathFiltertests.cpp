@@ -0,0 +1,160 @@
+#include <gtest/gtest.h>
+#include "pathFilter.hpp"
+#include "directoryWalker.hpp"
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace {
+
+/// Enters a directory whose ignore files are given as name -> contents.
+std::shared_ptr<const IgnoreRules> enter(const PathFilter& filter, const std::shared_ptr<const IgnoreRules>& parent,
+                                         const std::string& directory,
+                                         const std::map<std::string, std::string>& files) {
+    return filter.enterDirectory(parent, directory, [&files](const char* name, std::string& contents) {
+        const auto found = files.find(name);
+        if (found == files.end())
+            return false;
+        contents = found->second;
+        return true;
+    });
+}
+
+}  // namespace
+
+TEST(IgnoreRulesTest, ParsesGitignoreSyntax) {
+    IgnoreRules rules(nullptr, "");
+    rules.add("# comment\n"
+              "\n"
+              "*.o\r\n"
+              "build/\n"
+              "/TODO\n"
+              "docs/*.pdf\n"
+              "trailing   \n"
+              "\\#hash\n"
+              "!keep.o\n");
+    EXPECT_TRUE(rules.ignored("main.o", false));
+    EXPECT_TRUE(rules.ignored("src/deep/main.o", false));
+    EXPECT_FALSE(rules.ignored("keep.o", false));
+    EXPECT_TRUE(rules.ignored("build", true));
+    EXPECT_TRUE(rules.ignored("src/build", true));
+    EXPECT_FALSE(rules.ignored("build", false));          // directory-only rule
+    EXPECT_TRUE(rules.ignored("TODO", false));
+    EXPECT_FALSE(rules.ignored("src/TODO", false));       // anchored to the root
+    EXPECT_TRUE(rules.ignored("docs/manual.pdf", false));
+    EXPECT_FALSE(rules.ignored("other/docs/manual.pdf", false));
+    EXPECT_TRUE(rules.ignored("trailing", false));
+    EXPECT_TRUE(rules.ignored("#hash", false));
+    EXPECT_FALSE(rules.ignored("comment", false));
+}
+
+TEST(IgnoreRulesTest, DeeperFilesTakePrecedence) {
+    PathFilter filter;
+    filter.setUseIgnoreFiles(true);
+    const auto root = enter(filter, nullptr, "", {{".gitignore", "*.log\ngenerated/\n"}});
+    const auto app = enter(filter, root, "app/", {{".gitignore", "!important.log\n/local.txt\n"}});
+    const auto plain = enter(filter, app, "app/src/", {});
+    EXPECT_EQ(plain, app);      // no ignore files: the parent's rules are shared
+
+    EXPECT_FALSE(filter.acceptsFile(root.get(), "debug.log"));
+    EXPECT_FALSE(filter.acceptsFile(app.get(), "app/debug.log"));
+    EXPECT_TRUE(filter.acceptsFile(app.get(), "app/important.log"));
+    EXPECT_TRUE(filter.acceptsFile(plain.get(), "app/src/important.log"));
+    EXPECT_FALSE(filter.acceptsFile(app.get(), "app/local.txt"));
+    EXPECT_TRUE(filter.acceptsFile(root.get(), "local.txt"));            // anchored to app/
+    EXPECT_TRUE(filter.acceptsFile(plain.get(), "app/src/local.txt"));
+    EXPECT_FALSE(filter.acceptsDirectory(plain.get(), "app/src/generated"));
+
+    // .ignore overrides .gitignore in the same directory.
+    const auto both = enter(filter, nullptr, "", {{".gitignore", "*.tmp\n"}, {".ignore", "!keep.tmp\n"}});
+    EXPECT_FALSE(filter.acceptsFile(both.get(), "scratch.tmp"));
+    EXPECT_TRUE(filter.acceptsFile(both.get(), "keep.tmp"));
+}
+
+TEST(PathFilterTest, AppliesIncludesExcludesAndTypes) {
+    PathFilter filter;
+    EXPECT_FALSE(filter.active());
+    filter.addExclude("vendor");
+    filter.addExclude("*.min.js");
+    EXPECT_TRUE(filter.addType("js"));
+    EXPECT_FALSE(filter.addType("no-such-type"));
+    EXPECT_TRUE(filter.active());
+
+    EXPECT_FALSE(filter.acceptsDirectory(nullptr, "a/vendor"));
+    EXPECT_TRUE(filter.acceptsDirectory(nullptr, "a/src"));
+    EXPECT_TRUE(filter.acceptsDirectory(nullptr, ".git"));     // ignore files are off
+    EXPECT_TRUE(filter.acceptsFile(nullptr, "a/src/app.js"));
+    EXPECT_FALSE(filter.acceptsFile(nullptr, "a/src/app.min.js"));
+    EXPECT_FALSE(filter.acceptsFile(nullptr, "a/src/app.py"));
+
+    filter.addInclude("src/**");
+    EXPECT_FALSE(filter.acceptsFile(nullptr, "a/src/app.js"));
+    EXPECT_TRUE(filter.acceptsFile(nullptr, "src/lib/app.js"));
+
+    filter.setUseIgnoreFiles(true);
+    EXPECT_FALSE(filter.acceptsDirectory(nullptr, "sub/.git"));
+    EXPECT_FALSE(PathFilter::typeNames().empty());
+}
+
+class FilteredWalkTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        for (const char* directory : {"filter_examples/.git/objects", "filter_examples/build/out",
+                                      "filter_examples/src/gen", "filter_examples/docs"})
+            std::filesystem::create_directories(directory);
+        for (const char* file : {"filter_examples/.git/HEAD", "filter_examples/.git/objects/ab",
+                                 "filter_examples/build/out/app.txt", "filter_examples/src/main.cpp",
+                                 "filter_examples/src/notes.txt", "filter_examples/src/gen/table.cpp",
+                                 "filter_examples/src/keep.log", "filter_examples/src/drop.log",
+                                 "filter_examples/docs/guide.md", "filter_examples/readme.md"})
+            std::ofstream(file) << "content\n";
+        std::ofstream("filter_examples/.gitignore") << "build/\n*.log\n";
+        std::ofstream("filter_examples/src/.gitignore") << "gen/\n!keep.log\n";
+    }
+
+    void TearDown() override {
+        std::filesystem::remove_all("filter_examples");
+    }
+
+    static std::vector<std::string> walk(std::shared_ptr<const PathFilter> filter) {
+        std::mutex mutex;
+        std::vector<std::string> files;
+        DirectoryWalker walker(2);
+        walker.setFilter(std::move(filter));
+        walker.walk(
+            "filter_examples",
+            [&](std::filesystem::path file) {
+                std::lock_guard<std::mutex> lock(mutex);
+                files.push_back(file.lexically_relative("filter_examples").generic_string());
+            },
+            [](const std::filesystem::path&, std::error_code) {});
+        std::sort(files.begin(), files.end());
+        return files;
+    }
+};
+
+TEST_F(FilteredWalkTest, PrunesIgnoredDirectoriesAndFiles) {
+    auto filter = std::make_shared<PathFilter>();
+    filter->setUseIgnoreFiles(true);
+    const std::vector<std::string> expected = {".gitignore", "docs/guide.md", "readme.md", "src/.gitignore",
+                                               "src/keep.log", "src/main.cpp", "src/notes.txt"};
+    EXPECT_EQ(walk(filter), expected);
+}
+
+TEST_F(FilteredWalkTest, CombinesTypesWithIgnoreFiles) {
+    auto filter = std::make_shared<PathFilter>();
+    filter->setUseIgnoreFiles(true);
+    filter->addType("cpp");
+    filter->addType("md");
+    filter->addExclude("docs");
+    EXPECT_EQ(walk(filter), (std::vector<std::string>{"readme.md", "src/main.cpp"}));
+}
+
+TEST_F(FilteredWalkTest, WalksEverythingWithoutIgnoreFiles) {
+    EXPECT_EQ(walk(std::make_shared<PathFilter>()).size(), 12u);
+    EXPECT_EQ(walk(nullptr).size(), 12u);
+}
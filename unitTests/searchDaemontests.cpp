@@ -0,0 +1,232 @@
+#include <gtest/gtest.h>
+#include "searchDaemon.hpp"
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifndef _WIN32
+
+namespace {
+
+class LineSink : public ResultSink {
+public:
+    void consume(std::vector<SearchResult>& batch, const std::string&) override {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (const auto& result : batch) {
+            lines.push_back(std::filesystem::path(result.path).filename().string() + ":" +
+                            std::to_string(result.lineNumber));
+            spans.push_back(result.spans);
+        }
+    }
+
+    std::vector<std::string> sorted() {
+        std::sort(lines.begin(), lines.end());
+        return lines;
+    }
+
+    std::mutex mutex;
+    std::vector<std::string> lines;
+    std::vector<std::vector<MatchSpan>> spans;
+};
+
+}  // namespace
+
+class SearchDaemonTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        std::filesystem::create_directories("daemon_examples/tree/sub");
+        writeFile("daemon_examples/tree/alpha.txt", "the Quick brown fox\nsecond line\n");
+        writeFile("daemon_examples/tree/sub/gamma.txt", "error E1234 timeout\nquick check\n");
+        writeFile("daemon_examples/tree/sub-2.txt", "quick sibling\n");
+        daemon = std::make_unique<SearchDaemon>("daemon_examples/tree", 2);
+        ASSERT_TRUE(daemon->listen(socketPath)) << daemon->error();
+        server = std::thread([this] { daemon->run(); });
+    }
+
+    void TearDown() override {
+        daemon->requestStop();
+        if (server.joinable())
+            server.join();
+        daemon.reset();
+        std::filesystem::remove_all("daemon_examples");
+    }
+
+    static void writeFile(const std::string& path, const std::string& content) {
+        std::ofstream(path, std::ios::binary) << content;
+    }
+
+    std::optional<size_t> query(DaemonRequest request, LineSink& sink, std::string& error) {
+        return SearchDaemon::query(socketPath, request, sink, error);
+    }
+
+    static DaemonRequest search(const std::string& query) {
+        DaemonRequest request;
+        request.query = query;
+        return request;
+    }
+
+    const std::string socketPath = "daemon_examples/daemon.sock";
+    std::unique_ptr<SearchDaemon> daemon;
+    std::thread server;
+};
+
+TEST(DaemonRequestTest, EncodesAndDecodesEveryField) {
+    DaemonRequest request;
+    request.query = "tab\there\\n and\nnewline";
+    request.caseSensitive = false;
+    request.useRegex = true;
+    request.engine = RegexEngine::Std;
+    request.path = "/some dir/with\ttab";
+    request.timeout = std::chrono::milliseconds(250);
+    request.binaryPolicy = BinaryPolicy::Skip;
+    request.decompress = true;
+
+    const std::string line = request.encode();
+    EXPECT_EQ(line.find('\n'), std::string::npos);
+    std::string error;
+    const auto decoded = DaemonRequest::decode(line, error);
+    ASSERT_TRUE(decoded) << error;
+    EXPECT_EQ(decoded->kind, DaemonRequest::Kind::Search);
+    EXPECT_EQ(decoded->query, request.query);
+    EXPECT_FALSE(decoded->caseSensitive);
+    EXPECT_TRUE(decoded->useRegex);
+    EXPECT_EQ(decoded->engine, RegexEngine::Std);
+    EXPECT_EQ(decoded->path, request.path);
+    EXPECT_EQ(decoded->timeout.count(), 250);
+    EXPECT_EQ(decoded->binaryPolicy, BinaryPolicy::Skip);
+    EXPECT_TRUE(decoded->decompress);
+
+    EXPECT_FALSE(DaemonRequest::decode("search\tbogus\t\tquery", error));
+    EXPECT_FALSE(DaemonRequest::decode("hello", error));
+    EXPECT_EQ(DaemonRequest::decode("rescan", error)->kind, DaemonRequest::Kind::Rescan);
+}
+
+TEST(CancellationTokenTest, CancelsExplicitlyOrAtTheDeadline) {
+    CancellationToken token;
+    EXPECT_FALSE(token.cancelled());
+    token.cancel();
+    EXPECT_TRUE(token.cancelled());
+    EXPECT_FALSE(token.deadlineExpired());
+
+    CancellationToken timed;
+    timed.setDeadline(CancellationToken::Clock::now() - std::chrono::milliseconds(1));
+    EXPECT_TRUE(timed.cancelled());
+    EXPECT_TRUE(timed.deadlineExpired());
+}
+
+TEST_F(SearchDaemonTest, AnswersSearchesWithSpans) {
+    EXPECT_EQ(daemon->fileCount(), 3u);
+    LineSink sink;
+    std::string error;
+    DaemonRequest request = search("quick");
+    request.caseSensitive = false;
+    EXPECT_EQ(query(request, sink, error), 3u) << error;
+    EXPECT_EQ(sink.sorted(), (std::vector<std::string>{"alpha.txt:1", "gamma.txt:2", "sub-2.txt:1"}));
+    for (const auto& spans : sink.spans) {
+        ASSERT_EQ(spans.size(), 1u);
+        EXPECT_EQ(spans[0].length, 5u);
+    }
+
+    LineSink regexSink;
+    request = search("E[0-9]+");
+    request.useRegex = true;
+    EXPECT_EQ(query(request, regexSink, error), 1u) << error;
+    EXPECT_EQ(regexSink.sorted(), std::vector<std::string>{"gamma.txt:1"});
+}
+
+TEST_F(SearchDaemonTest, RestrictsTheSearchToAPathBelowTheRoot) {
+    LineSink sink;
+    std::string error;
+    DaemonRequest request = search("quick");
+    request.path = "daemon_examples/tree/sub";
+    EXPECT_EQ(query(request, sink, error), 1u) << error;
+    EXPECT_EQ(sink.sorted(), std::vector<std::string>{"gamma.txt:2"});
+
+    request.path = "daemon_examples";
+    EXPECT_FALSE(query(request, sink, error));
+    EXPECT_NE(error.find("Not below"), std::string::npos) << error;
+}
+
+TEST_F(SearchDaemonTest, PrintedResultsHaveNoThreadField) {
+    // The daemon does not report its workers, so the client prints `path:line: line`.
+    ConsoleFormatter formatter(false);
+    std::string error;
+    DaemonRequest request = search("quick");
+    request.path = "daemon_examples/tree/sub";
+    testing::internal::CaptureStdout();
+    EXPECT_EQ(SearchDaemon::query(socketPath, request, formatter, error), 1u) << error;
+    const std::string output = testing::internal::GetCapturedStdout();
+    EXPECT_NE(output.find("gamma.txt:2: quick check\n"), std::string::npos) << output;
+    EXPECT_EQ(output.find("[Thread"), std::string::npos) << output;
+}
+
+TEST_F(SearchDaemonTest, ReportsInvalidRegex) {
+    LineSink sink;
+    std::string error;
+    DaemonRequest request = search("a(");
+    request.useRegex = true;
+    EXPECT_FALSE(query(request, sink, error));
+    EXPECT_NE(error.find("Invalid regex"), std::string::npos) << error;
+}
+
+TEST_F(SearchDaemonTest, RescanFindsNewFiles) {
+    writeFile("daemon_examples/tree/sub/new.txt", "quick and new\n");
+    LineSink sink;
+    std::string error;
+    EXPECT_EQ(query(search("new"), sink, error), 0u);
+
+    DaemonRequest rescan;
+    rescan.kind = DaemonRequest::Kind::Rescan;
+    EXPECT_EQ(query(rescan, sink, error), 4u) << error;
+    EXPECT_EQ(query(search("new"), sink, error), 1u) << error;
+}
+
+TEST_F(SearchDaemonTest, ServesConcurrentQueries) {
+    std::vector<std::thread> clients;
+    std::vector<std::optional<size_t>> counts(8);
+    for (size_t i = 0; i < counts.size(); ++i) {
+        clients.emplace_back([&, i] {
+            LineSink sink;
+            std::string error;
+            counts[i] = query(search(i % 2 ? "quick" : "line"), sink, error);
+        });
+    }
+    for (auto& client : clients)
+        client.join();
+    for (size_t i = 0; i < counts.size(); ++i)
+        EXPECT_EQ(counts[i], i % 2 ? 2u : 1u);
+}
+
+TEST_F(SearchDaemonTest, CancelsSearchesAtTheirDeadline) {
+    {
+        std::ofstream big("daemon_examples/tree/big.txt", std::ios::binary);
+        const std::string block(1 << 20, 'x');
+        for (int i = 0; i < 64; ++i)
+            big << block << "\nmatch me\n";
+    }
+    DaemonRequest rescan;
+    rescan.kind = DaemonRequest::Kind::Rescan;
+    LineSink sink;
+    std::string error;
+    ASSERT_EQ(query(rescan, sink, error), 4u);
+
+    DaemonRequest request = search("match me");
+    request.timeout = std::chrono::milliseconds(1);
+    EXPECT_FALSE(query(request, sink, error));
+    EXPECT_EQ(error, "Search cancelled (deadline)");
+
+    request.timeout = std::chrono::milliseconds(0);
+    EXPECT_EQ(query(request, sink, error), 64u) << error;
+}
+
+TEST_F(SearchDaemonTest, RefusesASocketInUse) {
+    SearchDaemon second("daemon_examples/tree", 1);
+    EXPECT_FALSE(second.listen(socketPath));
+    EXPECT_NE(second.error().find("Another daemon"), std::string::npos) << second.error();
+}
+
+#endif
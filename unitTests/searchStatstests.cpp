@@ -0,0 +1,130 @@
+#include <gtest/gtest.h>
+#include "searchStats.hpp"
+#include "grepLikeUtility.hpp"
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using Counter = SearchStats::Counter;
+
+TEST(SearchStatsTest, RecordsNothingWhileNotStarted) {
+    SearchStats stats;
+    SearchStats::add(Counter::FilesWalked, 5);
+    {
+        SearchStats::Timer timer(Counter::WalkNs);
+    }
+    EXPECT_EQ(stats.total(Counter::FilesWalked), 0u);
+    EXPECT_EQ(stats.threads(), 0u);
+
+    stats.start();
+    SearchStats::add(Counter::FilesWalked, 2);
+    stats.stop();
+    SearchStats::add(Counter::FilesWalked, 7);
+    EXPECT_EQ(stats.total(Counter::FilesWalked), 2u);
+}
+
+TEST(SearchStatsTest, SumsTheCountersOfEveryThread) {
+    SearchStats stats;
+    stats.start();
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([] {
+            for (int i = 0; i < 1000; ++i)
+                SearchStats::add(Counter::BytesRead, 3);
+        });
+    }
+    for (auto& thread : threads)
+        thread.join();
+    stats.stop();
+    EXPECT_EQ(stats.total(Counter::BytesRead), 12000u);
+    EXPECT_EQ(stats.threads(), 4u);
+
+    // A new start discards the counts, also of threads that recorded before.
+    stats.start();
+    SearchStats::add(Counter::BytesRead);
+    stats.stop();
+    EXPECT_EQ(stats.total(Counter::BytesRead), 1u);
+    EXPECT_EQ(stats.threads(), 1u);
+}
+
+TEST(SearchStatsTest, TimersExcludeNestedTimers) {
+    using namespace std::chrono;
+    SearchStats stats;
+    stats.start();
+    {
+        SearchStats::Timer outer(Counter::LiteralMatchNs);
+        std::this_thread::sleep_for(milliseconds(5));
+        {
+            SearchStats::Timer inner(Counter::OutputNs);
+            std::this_thread::sleep_for(milliseconds(20));
+        }
+    }
+    stats.stop();
+    const auto outer = nanoseconds(stats.total(Counter::LiteralMatchNs));
+    const auto inner = nanoseconds(stats.total(Counter::OutputNs));
+    EXPECT_GE(inner, milliseconds(20));
+    EXPECT_GE(outer, milliseconds(5));
+    EXPECT_LT(outer, milliseconds(20));
+    EXPECT_GE(stats.elapsed(), outer + inner);
+}
+
+TEST(SearchStatsTest, PrintsEveryCounterAsJson) {
+    SearchStats stats;
+    stats.start();
+    SearchStats::add(Counter::MatchedLines, 42);
+    stats.stop();
+    std::ostringstream json;
+    stats.printJson(json);
+    EXPECT_NE(json.str().find("\"matched_lines\":42"), std::string::npos) << json.str();
+    EXPECT_NE(json.str().find("\"write_ns\":0"), std::string::npos) << json.str();
+    EXPECT_EQ(json.str().front(), '{');
+
+    std::ostringstream text;
+    stats.print(text);
+    EXPECT_NE(text.str().find("matched:    42 lines"), std::string::npos) << text.str();
+}
+
+class SearchStatsSearchTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        std::filesystem::create_directories("stats_examples/sub");
+        std::ofstream("stats_examples/a.txt") << "one needle\ntwo\n";
+        std::ofstream("stats_examples/sub/b.txt") << "needle\nneedle again\nnothing\n";
+        std::ofstream("stats_examples/sub/c.txt") << "nothing here\n";
+    }
+
+    void TearDown() override {
+        std::filesystem::remove_all("stats_examples");
+    }
+};
+
+TEST_F(SearchStatsSearchTest, CountsTheWalkReadsAndMatchesOfASearch) {
+    auto stats = std::make_shared<SearchStats>();
+    SearchManager literal(std::make_unique<TextFileSearcher>(), "needle");
+    literal.setNumThreads(2);
+    literal.setResultCallback([](const SearchResult&) {});
+    literal.setStats(stats);
+    literal.searchInDirectory("stats_examples");
+
+    EXPECT_EQ(stats->total(Counter::DirectoriesRead), 2u);
+    EXPECT_EQ(stats->total(Counter::FilesWalked), 3u);
+    EXPECT_EQ(stats->total(Counter::FilesSearched), 3u);
+    EXPECT_EQ(stats->total(Counter::BytesRead), 15u + 28u + 13u);
+    EXPECT_EQ(stats->total(Counter::LiteralBytes), 15u + 28u + 13u);
+    EXPECT_EQ(stats->total(Counter::RegexBytes), 0u);
+    EXPECT_EQ(stats->total(Counter::MatchedLines), 3u);
+    EXPECT_GT(stats->elapsed().count(), 0);
+
+    SearchManager regex(std::make_unique<TextFileSearcher>(), "needle$", true, false, true);
+    regex.setResultCallback([](const SearchResult&) {});
+    regex.setStats(stats);
+    regex.searchInDirectory("stats_examples");
+    EXPECT_EQ(stats->total(Counter::LiteralBytes), 0u);
+    EXPECT_EQ(stats->total(Counter::RegexBytes), 15u + 28u + 13u);
+    EXPECT_EQ(stats->total(Counter::MatchedLines), 2u);
+    EXPECT_GE(stats->total(Counter::RegexLinesVerified), 3u);
+}
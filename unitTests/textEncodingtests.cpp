@@ -0,0 +1,41 @@
+#include <gtest/gtest.h>
+#include "textEncoding.hpp"
+#include <string>
+
+TEST(TextEncodingTest, DetectsBinaryByNulInTheFirstBlock) {
+    EXPECT_EQ(detectEncoding("plain text\n"), TextEncoding::Text);
+    EXPECT_EQ(detectEncoding(""), TextEncoding::Text);
+    EXPECT_EQ(detectEncoding(std::string("\x7F" "ELF\0\1", 6)), TextEncoding::Binary);
+
+    // A NUL beyond the first block does not make the file binary.
+    std::string late(kEncodingSniffSize, 'a');
+    late += '\0';
+    EXPECT_EQ(detectEncoding(late), TextEncoding::Text);
+}
+
+TEST(TextEncodingTest, DetectsUtf16ByteOrderMarks) {
+    EXPECT_EQ(detectEncoding(std::string("\xFF\xFE" "a\0", 4)), TextEncoding::Utf16LE);
+    EXPECT_EQ(detectEncoding(std::string("\xFE\xFF\0a", 4)), TextEncoding::Utf16BE);
+}
+
+TEST(TextEncodingTest, DecodesUtf16SplitAtAnyByte) {
+    // BOM, "a", U+00E9, U+2603, U+1F600 (surrogate pair), "\n", little endian.
+    const std::string input("\xFF\xFE" "a\0" "\xE9\0" "\x03\x26" "\x3D\xD8\x00\xDE" "\n\0", 14);
+    const std::string expected = "a\xC3\xA9\xE2\x98\x83\xF0\x9F\x98\x80\n";
+    for (size_t split = 0; split <= input.size(); ++split) {
+        Utf16Decoder decoder(false);
+        std::string output;
+        decoder.decode(std::string_view(input).substr(0, split), output);
+        decoder.decode(std::string_view(input).substr(split), output);
+        decoder.finish(output);
+        EXPECT_EQ(output, expected) << "split at " << split;
+    }
+}
+
+TEST(TextEncodingTest, ReplacesUnpairedSurrogates) {
+    Utf16Decoder decoder(true);
+    std::string output;
+    decoder.decode(std::string("\xD8\x3D\0a\xDE\x00\xD8\x3D", 8), output);
+    decoder.finish(output);
+    EXPECT_EQ(output, "\xEF\xBF\xBD" "a" "\xEF\xBF\xBD" "\xEF\xBF\xBD");
+}
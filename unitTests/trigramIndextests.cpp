@@ -0,0 +1,141 @@
+#include <gtest/gtest.h>
+#include "trigramIndex.hpp"
+#include "grepLikeUtility.hpp"
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <vector>
+
+class TrigramIndexTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        std::filesystem::create_directories("index_examples/tree/sub");
+        writeFile("index_examples/tree/alpha.txt", "the Quick brown fox\nsecond line\n");
+        writeFile("index_examples/tree/beta.txt", "nothing to see\n");
+        writeFile("index_examples/tree/sub/gamma.txt", "error E1234 timeout\nquick check\n");
+        writeFile("index_examples/tree/sub/delta.txt", "\xe2\x84\xaa" "elvin scale\n");  // KELVIN SIGN
+    }
+
+    void TearDown() override {
+        std::filesystem::remove_all("index_examples");
+    }
+
+    static void writeFile(const std::string& path, const std::string& content) {
+        std::ofstream(path, std::ios::binary) << content;
+    }
+
+    static std::shared_ptr<TrigramIndex> buildIndex() {
+        EXPECT_EQ(TrigramIndex::build("index_examples/tree", "index_examples/tree.idx", 2), 4u);
+        auto index = std::make_shared<TrigramIndex>();
+        EXPECT_TRUE(index->open("index_examples/tree.idx")) << index->error();
+        return index;
+    }
+
+    /// Paths of the matched lines as "path:line", sorted.
+    static std::vector<std::string> search(std::shared_ptr<const CompiledPattern> pattern,
+                                           std::shared_ptr<const TrigramIndex> index) {
+        std::vector<std::string> lines;
+        std::unique_ptr<FileSearcher> searcher = std::make_unique<TextFileSearcher>();
+        SearchManager manager(std::move(searcher), std::move(pattern));
+        manager.setNumThreads(2);
+        manager.setIndex(std::move(index));
+        manager.setResultCallback([&lines](const SearchResult& result) {
+            lines.push_back(result.path + ":" + std::to_string(result.lineNumber));
+        });
+        manager.searchInDirectory("index_examples/tree");
+        std::sort(lines.begin(), lines.end());
+        return lines;
+    }
+
+    static size_t candidateCount(const TrigramIndex& index, const CompiledPattern& pattern) {
+        const auto candidates = index.candidates(pattern);
+        return candidates ? std::count(candidates->begin(), candidates->end(), true) : index.fileCount();
+    }
+};
+
+TEST_F(TrigramIndexTest, OpensWhatWasBuilt) {
+    auto index = buildIndex();
+    EXPECT_EQ(index->fileCount(), 4u);
+    EXPECT_GT(index->trigramCount(), 0u);
+    EXPECT_EQ(index->root(), std::filesystem::canonical("index_examples/tree"));
+    EXPECT_NE(index->findFile("sub/gamma.txt"), std::string_view::npos);
+    EXPECT_EQ(index->findFile("sub/missing.txt"), std::string_view::npos);
+
+    writeFile("index_examples/garbage.idx", "not an index at all, definitely not");
+    TrigramIndex garbage;
+    EXPECT_FALSE(garbage.open("index_examples/garbage.idx"));
+    EXPECT_FALSE(garbage.error().empty());
+}
+
+TEST_F(TrigramIndexTest, NarrowsLiteralListAndRegexQueries) {
+    auto index = buildIndex();
+    EXPECT_EQ(candidateCount(*index, CompiledPattern("E1234")), 1u);
+    EXPECT_EQ(candidateCount(*index, CompiledPattern("quick")), 2u);  // trigrams are case-folded
+    EXPECT_EQ(candidateCount(*index, CompiledPattern("absent text")), 0u);
+    EXPECT_EQ(candidateCount(*index, CompiledPattern(std::vector<std::string>{"E1234", "nothing"})), 2u);
+    EXPECT_EQ(candidateCount(*index, CompiledPattern("time[o]ut", true, true)), 1u);
+
+    EXPECT_FALSE(index->candidates(CompiledPattern("fo")));                      // too short
+    EXPECT_FALSE(index->candidates(CompiledPattern("timeout", true, true, RegexEngine::Std)));
+    EXPECT_FALSE(index->candidates(CompiledPattern("kel", false)));              // only k/s-free trigrams count
+}
+
+TEST_F(TrigramIndexTest, SearchWithIndexMatchesFullScan) {
+    auto index = buildIndex();
+    std::vector<std::shared_ptr<const CompiledPattern>> patterns = {
+        std::make_shared<const CompiledPattern>("quick"),
+        std::make_shared<const CompiledPattern>("QUICK", false),
+        std::make_shared<const CompiledPattern>("kelvin", false),
+        std::make_shared<const CompiledPattern>("E12[0-9]+", true, true),
+        std::make_shared<const CompiledPattern>(std::vector<std::string>{"E1234", "second"}),
+    };
+    for (const auto& pattern : patterns) {
+        EXPECT_EQ(search(pattern, index), search(pattern, nullptr)) << pattern->query();
+        EXPECT_FALSE(search(pattern, nullptr).empty()) << pattern->query();
+    }
+}
+
+TEST_F(TrigramIndexTest, Utf16FilesAreIndexedAsTheirText) {
+    std::string wide = "\xff\xfe";    // UTF-16LE byte order mark
+    for (char c : std::string("a needle in UTF-16\n")) {
+        wide += c;
+        wide += '\0';
+    }
+    writeFile("index_examples/tree/wide.txt", wide);
+    EXPECT_EQ(TrigramIndex::build("index_examples/tree", "index_examples/tree.idx", 2), 5u);
+    auto index = std::make_shared<TrigramIndex>();
+    ASSERT_TRUE(index->open("index_examples/tree.idx")) << index->error();
+
+    const auto pattern = std::make_shared<const CompiledPattern>("needle");
+    EXPECT_EQ(candidateCount(*index, *pattern), 1u);
+    EXPECT_EQ(search(pattern, index), std::vector<std::string>{"index_examples/tree/wide.txt:1"});
+    EXPECT_EQ(search(pattern, index), search(pattern, nullptr));
+}
+
+TEST_F(TrigramIndexTest, ChangedAndNewFilesAreAlwaysSearched) {
+    auto index = buildIndex();
+    writeFile("index_examples/tree/beta.txt", "now with a needle and more bytes\n");
+    writeFile("index_examples/tree/sub/new.txt", "a needle too\n");
+
+    const auto pattern = std::make_shared<const CompiledPattern>("needle");
+    EXPECT_EQ(search(pattern, index), (std::vector<std::string>{
+        "index_examples/tree/beta.txt:1", "index_examples/tree/sub/new.txt:1"}));
+}
+
+TEST_F(TrigramIndexTest, IndexOfAnotherDirectoryIsIgnored) {
+    auto index = buildIndex();
+    std::filesystem::create_directories("index_examples/other");
+    writeFile("index_examples/other/file.txt", "quick\n");
+
+    std::vector<std::string> lines;
+    std::unique_ptr<FileSearcher> searcher = std::make_unique<TextFileSearcher>();
+    SearchManager manager(std::move(searcher), "quick");
+    manager.setIndex(index);
+    manager.setResultCallback([&lines](const SearchResult& result) { lines.push_back(result.path); });
+    testing::internal::CaptureStderr();
+    manager.searchInDirectory("index_examples/other");
+    EXPECT_NE(testing::internal::GetCapturedStderr().find("Warning"), std::string::npos);
+    EXPECT_EQ(lines.size(), 1u);
+}
@@ -0,0 +1,57 @@
+#include <gtest/gtest.h>
+#include "workStealingPool.hpp"
+#include <atomic>
+#include <chrono>
+#include <stdexcept>
+#include <thread>
+
+TEST(WorkStealingPoolTest, RunsEverySubmittedTask) {
+    WorkStealingPool pool(4);
+    std::atomic<int> sum{0};
+    for (int i = 1; i <= 1000; ++i)
+        pool.submit([&sum, i](size_t) { sum += i; });
+    pool.wait();
+    EXPECT_EQ(sum.load(), 500500);
+
+    size_t tasks = 0;
+    for (const auto& stats : pool.stats())
+        tasks += stats.tasks;
+    EXPECT_EQ(tasks, 1000u);
+}
+
+TEST(WorkStealingPoolTest, WaitCoversTasksSubmittedByTasks) {
+    WorkStealingPool pool(3);
+    std::atomic<int> leaves{0};
+    pool.submit([&pool, &leaves](size_t) {
+        for (int i = 0; i < 50; ++i)
+            pool.submit([&leaves](size_t) { ++leaves; });
+    });
+    pool.wait();
+    EXPECT_EQ(leaves.load(), 50);
+}
+
+TEST(WorkStealingPoolTest, IdleWorkersStealFromBusyOne) {
+    WorkStealingPool pool(2);
+    // All subtasks land on the deque of the worker running the parent task; the other worker
+    // can only get any of them by stealing.
+    pool.submit([&pool](size_t) {
+        for (int i = 0; i < 20; ++i)
+            pool.submit([](size_t) { std::this_thread::sleep_for(std::chrono::milliseconds(2)); });
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    });
+    pool.wait();
+
+    const auto stats = pool.stats();
+    EXPECT_GT(stats[0].stolen + stats[1].stolen, 0u);
+    EXPECT_GT(stats[0].busy.count(), 0);
+    EXPECT_GT(stats[1].busy.count(), 0);
+}
+
+TEST(WorkStealingPoolTest, WaitRethrowsTaskException) {
+    WorkStealingPool pool(2);
+    pool.submit([](size_t) { throw std::runtime_error("task failed"); });
+    pool.submit([](size_t) {});
+    EXPECT_THROW(pool.wait(), std::runtime_error);
+    pool.submit([](size_t) {});
+    EXPECT_NO_THROW(pool.wait());
+}